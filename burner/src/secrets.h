@@ -1,11 +0,0 @@
-#define WIFI_SSID "Wokwi-GUEST"
-#define WIFI_PASSWORD ""
-
-// MQTT Configuration
-#define MQTT_SERVER "192.168.1.87"  // Your computer's IP address
-#define MQTT_PORT 1883
-#define MQTT_USERNAME ""  // Leave empty for anonymous access
-#define MQTT_PASSWORD ""  // Leave empty for anonymous access
-#define MQTT_CLIENT_ID "carbon_emitter_device"
-#define MQTT_TOPIC_PREFIX "carbon_emitter"
-#define API_KEY "cc_c98d3c07dfad46e3259a2ad23724cd37b23acfb0195ba6ac10cfb71c3afd753f"
\ No newline at end of file
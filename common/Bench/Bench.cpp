@@ -0,0 +1,152 @@
+#include "Bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
+struct BenchEntry {
+  const char* name;
+  BenchFunction function;
+};
+
+static std::vector<BenchEntry>& registry() {
+  static std::vector<BenchEntry> entries;
+  return entries;
+}
+
+// Metrics of an earlier --json run by "<benchmark>/<metric>", shown next to the new values
+static std::map<std::string, double> baseline;
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunction function) {
+  registry().push_back({name, function});
+}
+
+void BenchState::report(const char* metric, double value, const char* unit) {
+  metrics_.push_back({metric, value, unit});
+  auto before = baseline.find(std::string(name_) + "/" + metric);
+  if (before == baseline.end()) {
+    printf("  %-32s %14.3f %s\n", metric, value, unit);
+  } else if (before->second != 0) {
+    printf("  %-32s %14.3f %-8s %+7.1f%% (was %.6g)\n", metric, value, unit,
+           (value - before->second) * 100 / before->second, before->second);
+  } else {
+    printf("  %-32s %14.3f %-8s (was 0)\n", metric, value, unit);
+  }
+  fflush(stdout);
+}
+
+void BenchState::fail(const char* why) {
+  failed_ = true;
+  printf("  ❌ %s\n", why);
+  fflush(stdout);
+}
+
+double benchPercentile(std::vector<double>& samples, double q) {
+  if (samples.empty()) return 0;
+  size_t index = std::min(samples.size() - 1, (size_t)(q * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+static void writeJson(const char* path, const std::vector<BenchState>& results) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "❌ Cannot write %s\n", path);
+    return;
+  }
+
+  fprintf(file, "{\"benchmarks\":[");
+  for (size_t i = 0; i < results.size(); i++) {
+    fprintf(file, "%s\n  {\"name\":\"%s\",\"metrics\":[", i ? "," : "", results[i].name());
+    const std::vector<BenchMetric>& metrics = results[i].metrics();
+    for (size_t m = 0; m < metrics.size(); m++) {
+      fprintf(file, "%s{\"name\":\"%s\",\"value\":%.6g,\"unit\":\"%s\"}", m ? "," : "",
+              metrics[m].name.c_str(), metrics[m].value, metrics[m].unit.c_str());
+    }
+    fprintf(file, "]}");
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  printf("📄 Results written to %s\n", path);
+}
+
+/**
+ * @brief Load the results of an earlier --json run (the format writeJson() produces)
+ */
+static bool readBaseline(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "❌ Cannot read %s\n", path);
+    return false;
+  }
+
+  // One benchmark per line: {"name":"<benchmark>","metrics":[{"name":"<metric>","value":<v>,...},...]}
+  char line[16384];
+  while (fgets(line, sizeof(line), file)) {
+    char benchmark[128];
+    const char* at = strstr(line, "{\"name\":\"");
+    if (!at || sscanf(at, "{\"name\":\"%127[^\"]\"", benchmark) != 1) continue;
+    at = strstr(at, "\"metrics\":[");
+    while (at && (at = strstr(at, "{\"name\":\""))) {
+      char metric[128];
+      double value;
+      if (sscanf(at, "{\"name\":\"%127[^\"]\",\"value\":%lf", metric, &value) == 2) {
+        baseline[std::string(benchmark) + "/" + metric] = value;
+      }
+      at++;
+    }
+  }
+  fclose(file);
+  printf("📄 Comparing against %s (%zu metrics)\n", path, baseline.size());
+  return true;
+}
+
+/**
+ * Usage: bench [--filter <substring>] [--json <path>] [--baseline <path>] [--list]
+ */
+int main(int argc, char** argv) {
+  const char* filter = nullptr;
+  const char* jsonPath = nullptr;
+  bool listOnly = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+    else if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+    else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+      if (!readBaseline(argv[++i])) return 1;
+    }
+    else if (!strcmp(argv[i], "--list")) listOnly = true;
+    else {
+      fprintf(stderr, "Usage: %s [--filter <substring>] [--json <path>] [--baseline <path>] [--list]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<BenchEntry> entries = registry();
+  std::sort(entries.begin(), entries.end(),
+            [](const BenchEntry& a, const BenchEntry& b) { return strcmp(a.name, b.name) < 0; });
+
+  std::vector<BenchState> results;
+  for (const BenchEntry& entry : entries) {
+    if (filter && !strstr(entry.name, filter)) continue;
+    if (listOnly) {
+      printf("%s\n", entry.name);
+      continue;
+    }
+
+    printf("⏱️  %s\n", entry.name);
+    results.emplace_back(entry.name);
+    entry.function(results.back());
+  }
+
+  if (jsonPath) writeJson(jsonPath, results);
+
+  size_t failed = std::count_if(results.begin(), results.end(), [](const BenchState& s) { return s.failed(); });
+  if (failed) {
+    printf("❌ %zu benchmark(s) failed a check\n", failed);
+    return 1;
+  }
+  return 0;
+}
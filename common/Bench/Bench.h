@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A single named measurement produced by a benchmark
+ */
+struct BenchMetric {
+  std::string name;
+  double value;
+  std::string unit;
+};
+
+/**
+ * @brief Handed to every benchmark, collects what it measured
+ */
+class BenchState {
+public:
+  explicit BenchState(const char* name) : name_(name) {}
+
+  void report(const char* metric, double value, const char* unit);
+
+  /**
+   * @brief A check the benchmark makes did not hold; the run exits non-zero
+   */
+  void fail(const char* why);
+
+  const char* name() const { return name_; }
+  bool failed() const { return failed_; }
+  const std::vector<BenchMetric>& metrics() const { return metrics_; }
+
+private:
+  const char* name_;
+  std::vector<BenchMetric> metrics_;
+  bool failed_ = false;
+};
+
+typedef void (*BenchFunction)(BenchState&);
+
+struct BenchRegistrar {
+  BenchRegistrar(const char* name, BenchFunction function);
+};
+
+/**
+ * @brief Register a benchmark, e.g. BENCHMARK(rollup_ingest) { ... }
+ */
+#define BENCHMARK(name)                                           \
+  static void bench_##name(BenchState& state);                    \
+  static BenchRegistrar registrar_##name(#name, bench_##name);    \
+  static void bench_##name(BenchState& state)
+
+inline int64_t benchNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Keep the optimizer from discarding a computed value
+ */
+template <typename T>
+inline void benchDoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Value at quantile q of an unsorted sample set (sorts in place)
+ */
+double benchPercentile(std::vector<double>& samples, double q);
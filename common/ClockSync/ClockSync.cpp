@@ -0,0 +1,202 @@
+#include "ClockSync.h"
+
+#include <math.h>
+#include <string.h>
+
+// Staleness charged to an older filter sample, on top of its delay
+static const double CLOCK_AGE_PENALTY_PPM = 15;
+// How far the crystal may wander between drift measurements (temperature)
+static const double CLOCK_DRIFT_WANDER_PPM = 0.5;
+
+static uint64_t readTimestamp(const uint8_t* p) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value = value << 8 | p[i];
+  return value;
+}
+
+static void writeTimestamp(uint8_t* p, uint64_t value) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = (uint8_t)value;
+    value >>= 8;
+  }
+}
+
+uint64_t unixUsToNtp(int64_t unixUs) {
+  uint64_t seconds = (uint64_t)(unixUs / 1000000) + NTP_UNIX_EPOCH_S;
+  uint64_t fraction = ((uint64_t)(unixUs % 1000000) << 32) / 1000000;
+  return seconds << 32 | fraction;
+}
+
+int64_t ntpToUnixUs(uint64_t ntp) {
+  int64_t seconds = (int64_t)(ntp >> 32) - (int64_t)NTP_UNIX_EPOCH_S;
+  int64_t micros = (int64_t)(((ntp & 0xFFFFFFFFULL) * 1000000 + (1ULL << 31)) >> 32);
+  return seconds * 1000000 + micros;
+}
+
+void formatNtpRequest(uint8_t* packet, uint64_t nonce) {
+  memset(packet, 0, NTP_PACKET_BYTES);
+  packet[0] = 0 << 6 | 4 << 3 | 3;   // no leap warning, version 4, client
+  writeTimestamp(packet + 40, nonce);
+}
+
+bool parseNtpReply(const uint8_t* packet, size_t length, uint64_t nonce, NtpReply& out) {
+  if (length < NTP_PACKET_BYTES) return false;
+  uint8_t leap = packet[0] >> 6;
+  uint8_t mode = packet[0] & 0x07;
+  uint8_t stratum = packet[1];
+  // Leap 3 is an unsynchronized server, stratum 0 a kiss-o'-death
+  if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15) return false;
+  if (readTimestamp(packet + 24) != nonce) return false;
+  uint64_t receive = readTimestamp(packet + 32);
+  uint64_t transmit = readTimestamp(packet + 40);
+  if (receive == 0 || transmit == 0) return false;
+  out.receiveUs = ntpToUnixUs(receive);
+  out.transmitUs = ntpToUnixUs(transmit);
+  out.stratum = stratum;
+  return out.transmitUs >= out.receiveUs;
+}
+
+bool formatNtpReply(const uint8_t* request, size_t length, int64_t receiveUs, int64_t transmitUs,
+                    uint8_t stratum, uint8_t* packet) {
+  if (length < NTP_PACKET_BYTES || (request[0] & 0x07) != 3) return false;
+  uint8_t version = request[0] >> 3 & 0x07;
+  memset(packet, 0, NTP_PACKET_BYTES);
+  packet[0] = 0 << 6 | version << 3 | 4;
+  packet[1] = stratum;
+  packet[2] = request[2];                    // poll
+  packet[3] = (uint8_t)-20;                  // precision ~1 us
+  memcpy(packet + 12, "LOCL", 4);            // reference id
+  writeTimestamp(packet + 16, unixUsToNtp(receiveUs));
+  memcpy(packet + 24, request + 40, 8);      // origin: the client's transmit timestamp
+  writeTimestamp(packet + 32, unixUsToNtp(receiveUs));
+  writeTimestamp(packet + 40, unixUsToNtp(transmitUs));
+  return true;
+}
+
+bool ClockDiscipline::addSample(int64_t sendUs, const NtpReply& reply, int64_t receiveUs) {
+  stats_.samples++;
+  int64_t delay = (receiveUs - sendUs) - (reply.transmitUs - reply.receiveUs);
+  if (delay < 0 || delay > CLOCK_MAX_DELAY_US) {
+    stats_.rejected++;
+    return false;
+  }
+
+  Sample sample;
+  sample.localUs = sendUs + (receiveUs - sendUs) / 2;
+  sample.offsetUs = ((reply.receiveUs - sendUs) + (reply.transmitUs - receiveUs)) / 2;
+  sample.delayUs = delay;
+  filter_[filterNext_] = sample;
+  filterNext_ = (filterNext_ + 1) % CLOCK_FILTER_SAMPLES;
+  if (filterCount_ < CLOCK_FILTER_SAMPLES) filterCount_++;
+
+  // Lowest delay wins, older samples charged for what the crystal may have wandered since
+  const Sample* best = nullptr;
+  double bestScore = 0;
+  for (int i = 0; i < filterCount_; i++) {
+    double age = (double)(sample.localUs - filter_[i].localUs);
+    double score = filter_[i].delayUs + age * CLOCK_AGE_PENALTY_PPM * 1e-6;
+    if (!best || score < bestScore) {
+      best = &filter_[i];
+      bestScore = score;
+    }
+  }
+
+  // The selected offset carried forward to now at the known drift
+  Sample selected = sample;
+  selected.offsetUs = best->offsetUs + (int64_t)((sample.localUs - best->localUs) * driftPpm_ * 1e-6);
+  selected.delayUs = best->delayUs;
+  // Exchanges closer together than half the shortest poll are one burst
+  bool newPoll = sample.localUs - lastSyncUs_ >= (int64_t)CLOCK_MIN_POLL_S * 1000000 / 2;
+  correct(selected, newPoll);
+  lastSyncUs_ = sample.localUs;
+  stats_.lastDelayUs = delay;
+  return true;
+}
+
+void ClockDiscipline::correct(const Sample& selected, bool newPoll) {
+  int64_t target = selected.localUs + selected.offsetUs;
+  if (!synced_) {
+    synced_ = true;
+    baseLocalUs_ = selected.localUs;
+    baseUnixUs_ = target;
+    slewUs_ = 0;
+    anchorLocalUs_ = selected.localUs;
+    anchorOffsetUs_ = selected.offsetUs;
+    anchorDelayUs_ = selected.delayUs;
+    hasAnchor_ = true;
+    return;
+  }
+
+  // Drift from offsets far enough apart that network jitter washes out: each
+  // measurement counts by its uncertainty, up to half the two delays over the span
+  int64_t span = selected.localUs - anchorLocalUs_;
+  if (trackDrift_ && hasAnchor_ && span >= CLOCK_MIN_DRIFT_SPAN_US) {
+    double measured = (double)(selected.offsetUs - anchorOffsetUs_) / span * 1e6;
+    double uncertainty = (double)(selected.delayUs + anchorDelayUs_) / 2 / span * 1e6;
+    if (measured > CLOCK_MAX_DRIFT_PPM) measured = CLOCK_MAX_DRIFT_PPM;
+    if (measured < -CLOCK_MAX_DRIFT_PPM) measured = -CLOCK_MAX_DRIFT_PPM;
+    double gain = driftVariance_ / (driftVariance_ + uncertainty * uncertainty);
+    driftPpm_ += gain * (measured - driftPpm_);
+    driftVariance_ = (1 - gain) * driftVariance_ + CLOCK_DRIFT_WANDER_PPM * CLOCK_DRIFT_WANDER_PPM;
+    driftKnown_ = true;
+    anchorLocalUs_ = selected.localUs;
+    anchorOffsetUs_ = selected.offsetUs;
+    anchorDelayUs_ = selected.delayUs;
+  }
+
+  // Re-base at the clock's current reading so it stays continuous, then correct
+  int64_t current = unixUs(selected.localUs);
+  int64_t error = target - current;
+  stats_.lastOffsetErrorUs = error;
+  baseLocalUs_ = selected.localUs;
+  baseUnixUs_ = current;
+  slewUs_ = 0;
+  if (error > CLOCK_STEP_THRESHOLD_US || error < -CLOCK_STEP_THRESHOLD_US) {
+    baseUnixUs_ = target;
+    stats_.steps++;
+    if (error < 0) stats_.backwardSteps++;
+    // A step means the drift estimate was off too; measure it afresh
+    anchorLocalUs_ = selected.localUs;
+    anchorOffsetUs_ = selected.offsetUs;
+    anchorDelayUs_ = selected.delayUs;
+    driftVariance_ = CLOCK_MAX_DRIFT_PPM * CLOCK_MAX_DRIFT_PPM;
+    driftKnown_ = false;
+    pollS_ = CLOCK_MIN_POLL_S;
+    return;
+  }
+  slewUs_ = error;
+
+  // Once per poll (not per exchange of a burst): poll less often while the clock
+  // holds within a round trip and the drift is known well enough for twice the
+  // interval, more often when it drifted off
+  if (!newPoll) return;
+  int64_t tolerance = selected.delayUs + 2000;
+  double driftSpreadUs = sqrt(driftVariance_) * 2 * pollS_;
+  if (error > 2 * tolerance || error < -2 * tolerance) {
+    if (pollS_ > CLOCK_MIN_POLL_S) pollS_ /= 2;
+  } else if (error <= tolerance && error >= -tolerance && (!trackDrift_ || (driftKnown_ && driftSpreadUs <= tolerance))) {
+    if (pollS_ < CLOCK_MAX_POLL_S) pollS_ *= 2;
+  }
+}
+
+int64_t ClockDiscipline::slewRemainingUs(int64_t monotonicUs) const {
+  int64_t elapsed = monotonicUs - baseLocalUs_;
+  if (slewUs_ == 0 || elapsed <= 0) return slewUs_;
+  int64_t applied = (int64_t)(elapsed * CLOCK_MAX_SLEW_PPM * 1e-6);
+  if (slewUs_ > 0) return applied >= slewUs_ ? 0 : slewUs_ - applied;
+  return applied >= -slewUs_ ? 0 : slewUs_ + applied;
+}
+
+int64_t ClockDiscipline::unixUs(int64_t monotonicUs) const {
+  int64_t elapsed = monotonicUs - baseLocalUs_;
+  double drift = trackDrift_ ? driftPpm_ : 0;
+  return baseUnixUs_ + elapsed + (int64_t)(elapsed * drift * 1e-6) + slewUs_ - slewRemainingUs(monotonicUs);
+}
+
+uint64_t ClockDiscipline::epochMs(int64_t monotonicUs) {
+  int64_t now = unixUs(monotonicUs);
+  uint64_t ms = now > 0 ? (uint64_t)(now / 1000) : 0;
+  if (ms < lastEpochMs_) return lastEpochMs_;
+  lastEpochMs_ = ms;
+  return ms;
+}
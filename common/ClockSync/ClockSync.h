@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * SNTP client arithmetic and a disciplined wall clock, shared by the
+ * firmware and the host.
+ *
+ * The device has no battery-backed clock, only a monotonic microsecond
+ * counter from boot (esp_timer_get_time(), which does not wrap like
+ * millis()). An SNTP exchange (RFC 4330) yields four timestamps: the local
+ * send and receive times t1/t4 on that counter, and the server's receive
+ * and transmit times t2/t3 in Unix time. From them
+ *
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2     Unix time minus monotonic time
+ *   delay  = (t4 - t1) - (t3 - t2)           round trip on the network
+ *
+ * ClockDiscipline keeps the last CLOCK_FILTER_SAMPLES exchanges and trusts
+ * the one with the lowest delay, whose offset is least skewed by queueing.
+ * Successive selected offsets give the crystal's drift (ppm), each weighed
+ * by how much its span and round trips let it be trusted, so the clock
+ * stays within a few ms between polls that are up to 17 minutes apart.
+ * Corrections under CLOCK_STEP_THRESHOLD_US are slewed rather than
+ * stepped, and epochMs() never goes backwards: after a backward step it
+ * holds until the corrected clock catches up.
+ */
+
+const size_t NTP_PACKET_BYTES = 48;
+const uint16_t NTP_PORT = 123;
+const uint64_t NTP_UNIX_EPOCH_S = 2208988800ULL;   // 1900-01-01 to 1970-01-01
+
+const int CLOCK_FILTER_SAMPLES = 8;
+const int64_t CLOCK_MAX_DELAY_US = 1000000;          // slower exchanges are discarded
+const int64_t CLOCK_STEP_THRESHOLD_US = 128000;      // larger corrections step the clock
+const double CLOCK_MAX_SLEW_PPM = 500;               // how fast a small correction is applied
+const double CLOCK_MAX_DRIFT_PPM = 500;              // crystal tolerance, anything beyond is noise
+const int64_t CLOCK_MIN_DRIFT_SPAN_US = 60000000;    // offsets at least a minute apart give the drift
+const uint32_t CLOCK_MIN_POLL_S = 16;
+const uint32_t CLOCK_MAX_POLL_S = 1024;
+
+/**
+ * @brief Server timestamps of an SNTP reply, in Unix microseconds
+ */
+struct NtpReply {
+  int64_t receiveUs;     // t2
+  int64_t transmitUs;    // t3
+  uint8_t stratum;
+};
+
+/**
+ * @brief NTP 32.32 fixed-point timestamp of a Unix time in microseconds
+ */
+uint64_t unixUsToNtp(int64_t unixUs);
+int64_t ntpToUnixUs(uint64_t ntp);
+
+/**
+ * @brief Client-mode request; nonce goes in the transmit timestamp and must come back as the origin
+ */
+void formatNtpRequest(uint8_t* packet, uint64_t nonce);
+
+/**
+ * @brief Check and read a server reply to the request carrying nonce
+ * @return false if it is not a usable answer to that request (wrong mode or
+ *         origin, unsynchronized or kiss-o'-death server)
+ */
+bool parseNtpReply(const uint8_t* packet, size_t length, uint64_t nonce, NtpReply& out);
+
+/**
+ * @brief Server-mode reply to a client request (host stand-in for an NTP server)
+ * @return false if request is not a client-mode request
+ */
+bool formatNtpReply(const uint8_t* request, size_t length, int64_t receiveUs, int64_t transmitUs,
+                    uint8_t stratum, uint8_t* packet);
+
+struct ClockSyncStats {
+  uint32_t samples = 0;           // exchanges offered to addSample()
+  uint32_t rejected = 0;          // negative or excessive delay
+  uint32_t steps = 0;
+  uint32_t backwardSteps = 0;
+  int64_t lastOffsetErrorUs = 0;  // selected offset minus the clock's, before correcting
+  int64_t lastDelayUs = 0;
+};
+
+/**
+ * @brief Wall clock disciplined by SNTP exchanges
+ */
+class ClockDiscipline {
+public:
+  /**
+   * @brief Account one SNTP exchange
+   * @param sendUs Local monotonic time the request left (t1)
+   * @param receiveUs Local monotonic time the reply arrived (t4)
+   * @return true if it was accepted into the filter
+   */
+  bool addSample(int64_t sendUs, const NtpReply& reply, int64_t receiveUs);
+
+  bool synced() const { return synced_; }
+
+  /**
+   * @brief Unix time in microseconds at a local monotonic time, without the monotonic hold
+   */
+  int64_t unixUs(int64_t monotonicUs) const;
+
+  /**
+   * @brief Unix time in milliseconds for a payload, never less than a previous result
+   */
+  uint64_t epochMs(int64_t monotonicUs);
+
+  double driftPpm() const { return driftPpm_; }
+  bool driftKnown() const { return driftKnown_; }
+
+  /**
+   * @brief Seconds until the next poll: short until the drift is known, then doubling while it holds
+   */
+  uint32_t pollIntervalS() const { return pollS_; }
+
+  /**
+   * @brief Monotonic time of the last accepted exchange
+   */
+  int64_t lastSyncUs() const { return lastSyncUs_; }
+
+  /**
+   * @brief Turn drift tracking off, for comparing against a free-running crystal
+   */
+  void setDriftTracking(bool enabled) { trackDrift_ = enabled; }
+
+  const ClockSyncStats& stats() const { return stats_; }
+
+private:
+  struct Sample {
+    int64_t localUs;    // midpoint of t1 and t4
+    int64_t offsetUs;
+    int64_t delayUs;
+  };
+
+  void correct(const Sample& selected, bool newPoll);
+  int64_t slewRemainingUs(int64_t monotonicUs) const;
+
+  Sample filter_[CLOCK_FILTER_SAMPLES];
+  int filterCount_ = 0;
+  int filterNext_ = 0;
+
+  // unixUs(m) = baseUnixUs_ + (m - baseLocalUs_) * (1 + drift) - the part of slewUs_ still pending
+  bool synced_ = false;
+  int64_t baseLocalUs_ = 0;
+  int64_t baseUnixUs_ = 0;
+  int64_t slewUs_ = 0;           // correction applied gradually from baseLocalUs_ on
+  double driftPpm_ = 0;
+  double driftVariance_ = CLOCK_MAX_DRIFT_PPM * CLOCK_MAX_DRIFT_PPM;   // ppm^2
+  bool driftKnown_ = false;
+  bool trackDrift_ = true;
+
+  // Selected offset the drift is measured from
+  int64_t anchorLocalUs_ = 0;
+  int64_t anchorOffsetUs_ = 0;
+  int64_t anchorDelayUs_ = 0;
+  bool hasAnchor_ = false;
+
+  int64_t lastSyncUs_ = 0;
+  uint64_t lastEpochMs_ = 0;
+  uint32_t pollS_ = CLOCK_MIN_POLL_S;
+  ClockSyncStats stats_;
+};
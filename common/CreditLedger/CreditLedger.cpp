@@ -0,0 +1,183 @@
+#include "CreditLedger.h"
+
+#include <string.h>
+
+static const uint32_t SNAPSHOT_MAGIC = 0x314C4343;  // "CCL1"
+static const size_t REPLAY_BATCH = 64;
+
+uint32_t ledgerCrc32(const void* data, size_t length) {
+  static uint32_t table[256];
+  static bool tableReady = false;
+  if (!tableReady) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    tableReady = true;
+  }
+
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFF;
+}
+
+static uint32_t recordCrc(const LedgerRecord& record) {
+  return ledgerCrc32((const uint8_t*)&record + sizeof(record.crc), sizeof(record) - sizeof(record.crc));
+}
+
+static uint32_t snapshotCrc(const LedgerSnapshot& snapshot) {
+  const size_t skip = sizeof(snapshot.magic) + sizeof(snapshot.crc);
+  return ledgerCrc32((const uint8_t*)&snapshot + skip, sizeof(snapshot) - skip);
+}
+
+CreditLedger::CreditLedger(LedgerStorage& storage, const LedgerConfig& config)
+  : storage_(storage), config_(config) {
+  if (config_.groupCommitEntries == 0 || config_.groupCommitEntries > MAX_PENDING) {
+    config_.groupCommitEntries = MAX_PENDING;
+  }
+}
+
+void CreditLedger::apply(uint8_t from, uint8_t to, int64_t amount) {
+  balances_[from] -= amount;
+  balances_[to] += amount;
+}
+
+bool CreditLedger::recover() {
+  memset(balances_, 0, sizeof(balances_));
+  sequence_ = 0;
+  journalEntries_ = 0;
+  pendingCount_ = 0;
+  trimJournal_ = false;
+  stats_.replayed = 0;
+  stats_.truncated = 0;
+
+  LedgerSnapshot snap;
+  if (storage_.readSnapshot(snap)) {
+    // The journal no longer holds what the snapshot covers: starting from zero would lose it
+    if (snap.magic != SNAPSHOT_MAGIC || snap.crc != snapshotCrc(snap)) {
+      stats_.failures++;
+      return false;
+    }
+    memcpy(balances_, snap.balances, sizeof(balances_));
+    sequence_ = snap.sequence;
+  }
+
+  // Replay the tail; entries up to the snapshot are leftovers from a crash
+  // between writing the snapshot and emptying the journal
+  long size = storage_.journalSize();
+  if (size < 0) {
+    stats_.failures++;
+    return false;
+  }
+  long offset = 0;
+  long validEnd = 0;
+  LedgerRecord batch[REPLAY_BATCH];
+  bool torn = false;
+
+  while (offset < size && !torn) {
+    size_t count = (size_t)(size - offset) / sizeof(LedgerRecord);
+    if (count == 0) break;  // partial record at the end
+    if (count > REPLAY_BATCH) count = REPLAY_BATCH;
+    if (!storage_.readJournal(offset, batch, count * sizeof(LedgerRecord))) {
+      stats_.failures++;
+      return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const LedgerRecord& record = batch[i];
+      bool valid = record.crc == recordCrc(record) && record.from < LEDGER_ACCOUNT_COUNT &&
+                   record.to < LEDGER_ACCOUNT_COUNT;
+      if (valid && record.sequence > sequence_ + 1) {
+        // Committed history is missing, not a torn tail; keep the journal as it is
+        stats_.failures++;
+        return false;
+      }
+      if (!valid) {
+        torn = true;
+        break;
+      }
+      if (record.sequence == sequence_ + 1) {
+        apply(record.from, record.to, record.amount);
+        sequence_ = record.sequence;
+        stats_.replayed++;
+      }
+      journalEntries_++;
+      offset += sizeof(LedgerRecord);
+      validEnd = offset;
+    }
+  }
+
+  if (validEnd < size) {
+    stats_.truncated = size - validEnd;
+    if (!storage_.truncateJournal(validEnd)) {
+      stats_.failures++;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CreditLedger::transfer(LedgerAccount from, LedgerAccount to, int64_t amount, uint32_t nowMs) {
+  if (amount == 0 || from == to) return true;
+  if (pendingCount_ == MAX_PENDING && !commit()) return false;
+
+  apply(from, to, amount);
+  LedgerRecord& record = pending_[pendingCount_];
+  record.from = from;
+  record.to = to;
+  record.reserved = 0;
+  record.sequence = ++sequence_;
+  record.amount = amount;
+  record.crc = recordCrc(record);
+  if (pendingCount_++ == 0) oldestPendingMs_ = nowMs;
+
+  if (pendingCount_ >= config_.groupCommitEntries) commit();
+  return true;
+}
+
+bool CreditLedger::commit() {
+  if (pendingCount_ == 0) return true;
+
+  // A failed append may have left part of the group behind; the retry starts on a record boundary
+  if (trimJournal_ && !storage_.truncateJournal((long)journalEntries_ * sizeof(LedgerRecord))) {
+    stats_.failures++;
+    return false;
+  }
+  trimJournal_ = false;
+  if (!storage_.appendJournal(pending_, pendingCount_ * sizeof(LedgerRecord))) {
+    // Keep the group pending; the next commit retries it
+    stats_.failures++;
+    trimJournal_ = true;
+    return false;
+  }
+  journalEntries_ += pendingCount_;
+  pendingCount_ = 0;
+  stats_.commits++;
+  return true;
+}
+
+void CreditLedger::poll(uint32_t nowMs) {
+  if (pendingCount_ > 0 && nowMs - oldestPendingMs_ >= config_.groupCommitMs) commit();
+  if (config_.snapshotEntries > 0 && journalEntries_ + pendingCount_ >= config_.snapshotEntries) snapshot();
+}
+
+bool CreditLedger::snapshot() {
+  if (!commit()) return false;
+
+  LedgerSnapshot snap;
+  snap.magic = SNAPSHOT_MAGIC;
+  snap.sequence = sequence_;
+  memcpy(snap.balances, balances_, sizeof(balances_));
+  snap.crc = snapshotCrc(snap);
+
+  // Once the snapshot is durable the journal holds nothing it needs
+  if (!storage_.writeSnapshot(snap) || !storage_.truncateJournal(0)) {
+    stats_.failures++;
+    return false;
+  }
+  journalEntries_ = 0;
+  stats_.snapshots++;
+  return true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Append-only credit ledger shared by the firmware and the host.
+ *
+ * Every change is a transfer between two accounts, appended to a journal
+ * (write-ahead log) before it counts as durable. Transfers are batched and
+ * written with one sync per group; a periodic snapshot of all balances lets
+ * the journal be cut short, so recovery is "load snapshot, replay the tail".
+ * A torn or corrupt tail (power loss, watchdog reset mid-write) is detected
+ * by CRC and sequence number and truncated away.
+ */
+
+/**
+ * @brief Ledger accounts; balances are in milli-units
+ */
+enum LedgerAccount : uint8_t {
+  LEDGER_EXTERNAL = 0,   // the outside world, minus everything that came in
+  LEDGER_AVAILABLE = 1,  // burner: credits on hand
+  LEDGER_BURNED = 2,     // burner: burned for offsets
+  LEDGER_FOR_SALE = 3,   // creator: accrued from sequestration, not listed yet
+  LEDGER_LISTED = 4,     // creator: resting in the marketplace
+  LEDGER_SOLD = 5,       // creator: delivered to burners
+  LEDGER_CASH = 6,       // money: negative for a buyer's spend, positive for earnings
+  LEDGER_ACCOUNT_COUNT = 7,
+};
+
+const int64_t LEDGER_UNIT = 1000;  // milli-credits, burns are 0.001-credit granular
+
+inline int64_t ledgerAmount(float value) {
+  return (int64_t)(value * LEDGER_UNIT + (value >= 0 ? 0.5f : -0.5f));
+}
+
+inline float ledgerValue(int64_t amount) {
+  return (float)amount / LEDGER_UNIT;
+}
+
+/**
+ * @brief One journal entry as stored, 24 bytes
+ */
+struct LedgerRecord {
+  uint32_t crc;        // CRC-32 of everything after this field
+  uint8_t from;
+  uint8_t to;
+  uint16_t reserved;
+  uint64_t sequence;   // 1, 2, 3, ... across the ledger's lifetime
+  int64_t amount;
+};
+static_assert(sizeof(LedgerRecord) == 24, "journal records must stay 24 bytes");
+
+/**
+ * @brief All balances as of one sequence number
+ */
+struct LedgerSnapshot {
+  uint32_t magic;
+  uint32_t crc;        // CRC-32 of everything after this field
+  uint64_t sequence;
+  int64_t balances[LEDGER_ACCOUNT_COUNT];
+};
+
+uint32_t ledgerCrc32(const void* data, size_t length);
+
+/**
+ * @brief Where the journal and the snapshot live
+ */
+class LedgerStorage {
+public:
+  virtual ~LedgerStorage() {}
+
+  /**
+   * @return false if there is no snapshot yet; one that cannot be read comes back with magic 0
+   */
+  virtual bool readSnapshot(LedgerSnapshot& snapshot) = 0;
+
+  /**
+   * @brief Replace the snapshot atomically and durably
+   */
+  virtual bool writeSnapshot(const LedgerSnapshot& snapshot) = 0;
+
+  virtual long journalSize() = 0;
+  virtual bool readJournal(long offset, void* data, size_t size) = 0;
+
+  /**
+   * @brief Append and sync once; durable when this returns true
+   *
+   * On failure the journal should be left at its old size (CreditLedger
+   * cuts it back itself before the retry if it is not).
+   */
+  virtual bool appendJournal(const void* data, size_t size) = 0;
+
+  virtual bool truncateJournal(long size) = 0;
+};
+
+struct LedgerConfig {
+  uint32_t groupCommitEntries = 64;    // commit once this many transfers are pending
+  uint32_t groupCommitMs = 1000;       // ... or once the oldest has waited this long
+  uint32_t snapshotEntries = 4096;     // snapshot once the journal holds this many, 0 = never
+};
+
+struct LedgerStats {
+  uint32_t commits = 0;
+  uint32_t snapshots = 0;
+  uint32_t replayed = 0;       // journal entries applied by the last recover()
+  uint32_t truncated = 0;      // bytes cut from a torn journal tail
+  uint32_t failures = 0;       // storage errors
+};
+
+/**
+ * @brief Credit balances backed by a write-ahead journal
+ *
+ * Balances change in memory as soon as transfer() is called; the change is
+ * durable once commit() (explicit, or via poll()/a full group) returns.
+ */
+class CreditLedger {
+public:
+  // Enough for the largest group on the device without allocating
+  static const uint32_t MAX_PENDING = 256;
+
+  explicit CreditLedger(LedgerStorage& storage, const LedgerConfig& config = LedgerConfig());
+
+  /**
+   * @brief Restore balances from the snapshot plus the journal tail
+   * @return false on a storage error, an unreadable snapshot or a gap in the
+   *         journal; the journal is then left as it was
+   */
+  bool recover();
+
+  /**
+   * @brief Move amount (milli-units) between two accounts and queue it for the next commit
+   * @return false if the pending group is full and the storage keeps failing
+   */
+  bool transfer(LedgerAccount from, LedgerAccount to, int64_t amount, uint32_t nowMs);
+
+  /**
+   * @brief Write every pending transfer with a single sync
+   */
+  bool commit();
+
+  /**
+   * @brief Commit an old enough group, snapshot a long enough journal
+   */
+  void poll(uint32_t nowMs);
+
+  /**
+   * @brief Write a snapshot and empty the journal (commits first)
+   */
+  bool snapshot();
+
+  int64_t balance(LedgerAccount account) const { return balances_[account]; }
+  float credits(LedgerAccount account) const { return ledgerValue(balances_[account]); }
+  uint64_t sequence() const { return sequence_; }
+  uint32_t pendingEntries() const { return pendingCount_; }
+  uint32_t journalEntries() const { return journalEntries_; }
+  const LedgerStats& stats() const { return stats_; }
+
+private:
+  void apply(uint8_t from, uint8_t to, int64_t amount);
+
+  LedgerStorage& storage_;
+  LedgerConfig config_;
+  LedgerStats stats_;
+  int64_t balances_[LEDGER_ACCOUNT_COUNT] = {};
+  uint64_t sequence_ = 0;
+  uint32_t journalEntries_ = 0;
+  bool trimJournal_ = false;   // an append failed; cut the journal back to journalEntries_ first
+  LedgerRecord pending_[MAX_PENDING];
+  uint32_t pendingCount_ = 0;
+  uint32_t oldestPendingMs_ = 0;
+};
@@ -0,0 +1,111 @@
+#include "FileLedgerStorage.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdio.h>
+
+/**
+ * @brief Flush file data to the medium; metadata only where the platform requires it
+ */
+static int syncData(int fd) {
+#if defined(ARDUINO) || defined(__APPLE__)
+  return fsync(fd);
+#else
+  return fdatasync(fd);
+#endif
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+  const char* bytes = (const char*)data;
+  while (size > 0) {
+    ssize_t written = write(fd, bytes, size);
+    if (written <= 0) return false;
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+FileLedgerStorage::FileLedgerStorage(const char* directory)
+  : directory_(directory),
+    journalPath_(std::string(directory) + "/ledger.wal"),
+    snapshotPath_(std::string(directory) + "/ledger.snap") {
+}
+
+FileLedgerStorage::~FileLedgerStorage() {
+  if (journal_ >= 0) close(journal_);
+}
+
+bool FileLedgerStorage::openJournal() {
+  if (journal_ >= 0) return true;
+  journal_ = open(journalPath_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  return journal_ >= 0;
+}
+
+bool FileLedgerStorage::readSnapshot(LedgerSnapshot& snapshot) {
+  int fd = open(snapshotPath_.c_str(), O_RDONLY);
+  if (fd < 0 && errno == ENOENT) return false;
+
+  // There is one: if it cannot be read whole, it is returned as invalid
+  bool ok = fd >= 0 && read(fd, &snapshot, sizeof(snapshot)) == (ssize_t)sizeof(snapshot);
+  if (fd >= 0) close(fd);
+  if (!ok) snapshot.magic = 0;
+  return true;
+}
+
+bool FileLedgerStorage::writeSnapshot(const LedgerSnapshot& snapshot) {
+  std::string tmpPath = snapshotPath_ + ".tmp";
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  bool ok = writeAll(fd, &snapshot, sizeof(snapshot)) && fsync(fd) == 0;
+  close(fd);
+  if (!ok || rename(tmpPath.c_str(), snapshotPath_.c_str()) != 0) return false;
+
+#ifndef ARDUINO
+  // Make the rename itself durable
+  int dir = open(directory_.c_str(), O_RDONLY);
+  if (dir >= 0) {
+    fsync(dir);
+    close(dir);
+  }
+#endif
+  return true;
+}
+
+long FileLedgerStorage::journalSize() {
+  if (!openJournal()) return -1;
+  struct stat info;
+  if (fstat(journal_, &info) != 0) return -1;
+  return (long)info.st_size;
+}
+
+bool FileLedgerStorage::readJournal(long offset, void* data, size_t size) {
+  if (!openJournal()) return false;
+  char* bytes = (char*)data;
+  while (size > 0) {
+    ssize_t n = pread(journal_, bytes, size, offset);
+    if (n <= 0) return false;
+    bytes += n;
+    offset += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool FileLedgerStorage::appendJournal(const void* data, size_t size) {
+  long before = journalSize();
+  if (before < 0) return false;
+  if (writeAll(journal_, data, size) && syncData(journal_) == 0) return true;
+
+  // Cut off whatever part made it, so the retry starts on a record boundary
+  if (ftruncate(journal_, before) == 0) syncData(journal_);
+  return false;
+}
+
+bool FileLedgerStorage::truncateJournal(long size) {
+  if (!openJournal()) return false;
+  return ftruncate(journal_, size) == 0 && syncData(journal_) == 0;
+}
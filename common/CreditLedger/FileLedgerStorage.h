@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "CreditLedger.h"
+
+/**
+ * @brief Ledger files in one directory, through POSIX file calls
+ *
+ * On the host that is any local directory. On the ESP32 the same calls go
+ * through the VFS to LittleFS once it is mounted, e.g.
+ *
+ *   LittleFS.begin(true);
+ *   FileLedgerStorage storage("/littlefs");
+ *
+ * The journal is "ledger.wal"; the snapshot is "ledger.snap", replaced by
+ * writing "ledger.snap.tmp" and renaming it over.
+ */
+class FileLedgerStorage : public LedgerStorage {
+public:
+  explicit FileLedgerStorage(const char* directory);
+  ~FileLedgerStorage() override;
+
+  bool readSnapshot(LedgerSnapshot& snapshot) override;
+  bool writeSnapshot(const LedgerSnapshot& snapshot) override;
+  long journalSize() override;
+  bool readJournal(long offset, void* data, size_t size) override;
+  bool appendJournal(const void* data, size_t size) override;
+  bool truncateJournal(long size) override;
+
+private:
+  bool openJournal();
+
+  std::string directory_;
+  std::string journalPath_;
+  std::string snapshotPath_;
+  int journal_ = -1;
+};
@@ -0,0 +1,91 @@
+#include "CreditMarket.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FlatJson.h>
+
+static const char* FILL_STATUS_NAMES[] = {"partial", "complete", "rejected"};
+
+/**
+ * @brief Print a fixed-point value with as many decimals as its scale has
+ */
+static int formatFixed(char* out, size_t size, uint32_t value, uint32_t scale) {
+  if (scale == 10) return snprintf(out, size, "%lu.%01lu", (unsigned long)(value / 10), (unsigned long)(value % 10));
+  return snprintf(out, size, "%lu.%02lu", (unsigned long)(value / 100), (unsigned long)(value % 100));
+}
+
+int formatMarketOrder(char* out, size_t size, const MarketOrder& order) {
+  char quantity[16], price[16];
+  formatFixed(quantity, sizeof(quantity), order.quantity, MARKET_QUANTITY_SCALE);
+  formatFixed(price, sizeof(price), order.price, MARKET_PRICE_SCALE);
+  return snprintf(out, size, "{\"id\":%lu,\"mac\":\"%s\",\"side\":\"%s\",\"qty\":%s,\"px\":%s}",
+                  (unsigned long)order.id, order.mac, order.side == MARKET_BUY ? "buy" : "sell",
+                  quantity, price);
+}
+
+int formatMarketFill(char* out, size_t size, const MarketFill& fill) {
+  char quantity[16], price[16], remaining[16];
+  formatFixed(quantity, sizeof(quantity), fill.quantity, MARKET_QUANTITY_SCALE);
+  formatFixed(price, sizeof(price), fill.price, MARKET_PRICE_SCALE);
+  formatFixed(remaining, sizeof(remaining), fill.remaining, MARKET_QUANTITY_SCALE);
+  return snprintf(out, size, "{\"id\":%lu,\"status\":\"%s\",\"qty\":%s,\"px\":%s,\"left\":%s}",
+                  (unsigned long)fill.id, FILL_STATUS_NAMES[fill.status], quantity, price, remaining);
+}
+
+bool parseMarketOrder(const char* json, size_t length, MarketOrder& order) {
+  order = MarketOrder();
+  bool hasId = false, hasMac = false, hasSide = false, hasQuantity = false, hasPrice = false;
+
+  bool wellFormed = forEachField(json, length, [&](const char* key, size_t keyLen, const char* value, size_t valueLen) {
+    if (keyIs(key, keyLen, "id")) {
+      hasId = parseFixed(value, valueLen, 1, order.id);
+    } else if (keyIs(key, keyLen, "mac")) {
+      if (valueLen < sizeof(order.mac)) {
+        memcpy(order.mac, value, valueLen);
+        order.mac[valueLen] = '\0';
+        hasMac = valueLen > 0;
+      }
+    } else if (keyIs(key, keyLen, "side")) {
+      if (keyIs(value, valueLen, "buy")) {
+        order.side = MARKET_BUY;
+        hasSide = true;
+      } else if (keyIs(value, valueLen, "sell")) {
+        order.side = MARKET_SELL;
+        hasSide = true;
+      }
+    } else if (keyIs(key, keyLen, "qty")) {
+      hasQuantity = parseFixed(value, valueLen, MARKET_QUANTITY_SCALE, order.quantity);
+    } else if (keyIs(key, keyLen, "px")) {
+      hasPrice = parseFixed(value, valueLen, MARKET_PRICE_SCALE, order.price);
+    }
+  });
+
+  return wellFormed && hasId && hasMac && hasSide && hasQuantity && hasPrice;
+}
+
+bool parseMarketFill(const char* json, size_t length, MarketFill& fill) {
+  fill = MarketFill();
+  bool hasId = false, hasStatus = false, hasQuantity = false;
+
+  bool wellFormed = forEachField(json, length, [&](const char* key, size_t keyLen, const char* value, size_t valueLen) {
+    if (keyIs(key, keyLen, "id")) {
+      hasId = parseFixed(value, valueLen, 1, fill.id);
+    } else if (keyIs(key, keyLen, "status")) {
+      for (uint8_t s = 0; s < 3; s++) {
+        if (keyIs(value, valueLen, FILL_STATUS_NAMES[s])) {
+          fill.status = (MarketFillStatus)s;
+          hasStatus = true;
+        }
+      }
+    } else if (keyIs(key, keyLen, "qty")) {
+      hasQuantity = parseFixed(value, valueLen, MARKET_QUANTITY_SCALE, fill.quantity);
+    } else if (keyIs(key, keyLen, "px")) {
+      parseFixed(value, valueLen, MARKET_PRICE_SCALE, fill.price);
+    } else if (keyIs(key, keyLen, "left")) {
+      parseFixed(value, valueLen, MARKET_QUANTITY_SCALE, fill.remaining);
+    }
+  });
+
+  return wellFormed && hasId && hasStatus && hasQuantity;
+}
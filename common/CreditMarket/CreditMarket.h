@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Credit marketplace messages shared by the firmware and the host.
+ *
+ * Devices publish orders to  <MARKET_TOPIC_PREFIX>/<API_KEY>/orders
+ * and receive fills on       <MARKET_TOPIC_PREFIX>/<API_KEY>/fills/<MAC>
+ *
+ *   order: {"id":7,"mac":"AA:BB:CC:DD:EE:FF","side":"buy","qty":100.0,"px":12.00}
+ *   fill:  {"id":7,"status":"partial","qty":40.0,"px":11.50,"left":60.0}
+ *
+ * Quantities and prices travel as decimals but are fixed point everywhere
+ * else, so matching never compares floats.
+ */
+
+const uint32_t MARKET_QUANTITY_SCALE = 10;   // 0.1 credit
+const uint32_t MARKET_PRICE_SCALE = 100;     // 0.01 per credit
+const uint32_t MARKET_MAX_PRICE = 100000;    // 1000.00 per credit
+
+enum MarketSide : uint8_t {
+  MARKET_BUY = 0,
+  MARKET_SELL = 1,
+};
+
+enum MarketFillStatus : uint8_t {
+  FILL_PARTIAL = 0,    // order still resting with "left" remaining
+  FILL_COMPLETE = 1,   // order fully filled
+  FILL_REJECTED = 2,   // order refused, nothing traded
+};
+
+/**
+ * @brief A limit order as sent by a device
+ */
+struct MarketOrder {
+  uint32_t id = 0;           // chosen by the device, resending the same id is idempotent
+  char mac[18] = "";
+  MarketSide side = MARKET_BUY;
+  uint32_t quantity = 0;     // MARKET_QUANTITY_SCALE units
+  uint32_t price = 0;        // MARKET_PRICE_SCALE units
+};
+
+/**
+ * @brief What the marketplace sends back for one order
+ */
+struct MarketFill {
+  uint32_t id = 0;
+  MarketFillStatus status = FILL_PARTIAL;
+  uint32_t quantity = 0;     // traded in this fill
+  uint32_t price = 0;        // execution price
+  uint32_t remaining = 0;    // still open on the order
+};
+
+inline uint32_t marketQuantity(float credits) {
+  return credits > 0 ? (uint32_t)(credits * MARKET_QUANTITY_SCALE + 0.5f) : 0;
+}
+
+inline float marketCredits(uint32_t quantity) {
+  return (float)quantity / MARKET_QUANTITY_SCALE;
+}
+
+inline uint32_t marketPrice(float price) {
+  return price > 0 ? (uint32_t)(price * MARKET_PRICE_SCALE + 0.5f) : 0;
+}
+
+inline float marketPriceValue(uint32_t price) {
+  return (float)price / MARKET_PRICE_SCALE;
+}
+
+/**
+ * @return Number of characters written (snprintf semantics)
+ */
+int formatMarketOrder(char* out, size_t size, const MarketOrder& order);
+int formatMarketFill(char* out, size_t size, const MarketFill& fill);
+
+/**
+ * @brief Parse the flat JSON written by formatMarketOrder()
+ * @return true if id, mac, side, qty and px were all present
+ */
+bool parseMarketOrder(const char* json, size_t length, MarketOrder& order);
+
+/**
+ * @brief Parse the flat JSON written by formatMarketFill()
+ * @return true if id, status and qty were present
+ */
+bool parseMarketFill(const char* json, size_t length, MarketFill& fill);
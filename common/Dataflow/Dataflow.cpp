@@ -0,0 +1,29 @@
+#include "Dataflow.h"
+
+bool Dataflow::addStage(const char* name, uint32_t triggers, DataflowStage stage) {
+  if (count_ == MAX_STAGES) return false;
+  stages_[count_++] = {name, triggers, stage, 0};
+  return true;
+}
+
+int Dataflow::dispatch() {
+  if (!pending_) return 0;
+  dispatches_++;
+
+  // Events raised by a stage reach only the stages after it, then are
+  // dropped; anything raised outside dispatch() waits for the next call
+  uint32_t events = pending_;
+  pending_ = 0;
+  int ran = 0;
+  for (int i = 0; i < count_; i++) {
+    events |= pending_;
+    pending_ = 0;
+    if (stages_[i].triggers & events) {
+      stages_[i].run();
+      stages_[i].runs++;
+      ran++;
+    }
+  }
+  pending_ = 0;
+  return ran;
+}
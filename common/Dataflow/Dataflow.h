@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Event-driven stage pipeline for the firmware loop.
+ *
+ * Stages are registered in pipeline order with the events that wake them.
+ * Producers raise events (a new sample, a balance change, ...) and
+ * dispatch() runs only the stages with something new to do. Events raised
+ * by a stage during dispatch() wake the stages after it in the same pass,
+ * so data flows downstream without a second loop iteration.
+ */
+
+typedef void (*DataflowStage)();
+
+class Dataflow {
+public:
+  static const int MAX_STAGES = 12;
+
+  /**
+   * @brief Append a stage to the pipeline
+   * @param triggers Bitmask of events that run it
+   * @return false if the pipeline is full
+   */
+  bool addStage(const char* name, uint32_t triggers, DataflowStage stage);
+
+  /**
+   * @brief Queue events for the next dispatch(), or for later stages of the current one
+   */
+  void raise(uint32_t events) { pending_ |= events; }
+
+  /**
+   * @brief Run every stage woken by a pending event, in pipeline order
+   * @return Number of stages that ran
+   */
+  int dispatch();
+
+  int stageCount() const { return count_; }
+  const char* stageName(int i) const { return stages_[i].name; }
+  uint32_t stageRuns(int i) const { return stages_[i].runs; }
+  uint32_t dispatches() const { return dispatches_; }
+
+private:
+  struct Stage {
+    const char* name;
+    uint32_t triggers;
+    DataflowStage run;
+    uint32_t runs;
+  };
+
+  Stage stages_[MAX_STAGES];
+  int count_ = 0;
+  uint32_t pending_ = 0;
+  uint32_t dispatches_ = 0;
+};
@@ -0,0 +1,194 @@
+#include "DeviceCommand.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FlatJson.h>
+
+static const char* COMMAND_NAMES[] = {"set", "get", "reset"};
+
+/**
+ * @brief One setting: its JSON key, where it lives, and what it may be set to
+ */
+struct SettingField {
+  const char* name;
+  uint32_t DeviceSettings::*member;
+  uint32_t scale;              // parseFixed() units per whole number
+  uint32_t min;
+  uint32_t max;
+};
+
+static const SettingField FIELDS[] = {
+  {"sample_ms", &DeviceSettings::sampleMs, 1, 500, 60000},
+  {"publish_ms", &DeviceSettings::publishMs, 1, 1000, 900000},
+  {"heartbeat_ms", &DeviceSettings::heartbeatMs, 1, 10000, 86400000},
+  {"alert_cooldown_ms", &DeviceSettings::alertCooldownMs, 1, 0, 86400000},
+  {"co2_alert", &DeviceSettings::co2AlertPpm, 1, 0, 10000},
+  {"credits_alert", &DeviceSettings::creditsAlert, SETTINGS_CREDITS_SCALE, 0, 1000000},
+  {"deadband_c", &DeviceSettings::co2DeadbandPpm, 1, 0, 5000},
+  {"deadband_h", &DeviceSettings::humidityDeadband, 1, 0, 100},
+  {"deadband_max_ms", &DeviceSettings::deadbandMaxMs, 1, 1000, 86400000},
+  {"batch_windows", &DeviceSettings::batchWindows, 1, 1, 64},
+  {"compress", &DeviceSettings::compress, 1, 0, 1},
+  {"sketches", &DeviceSettings::sketches, 1, 0, 1},
+};
+static const size_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+static const SettingField* findField(const char* key, size_t keyLen) {
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    if (keyIs(key, keyLen, FIELDS[i].name)) return &FIELDS[i];
+  }
+  return nullptr;
+}
+
+bool parseDeviceCommand(const char* json, size_t length, const DeviceSettings& current, DeviceCommand& command) {
+  command = DeviceCommand();
+  command.settings = current;
+  bool hasCommand = false;
+  uint32_t fields = 0;
+  auto fail = [&](const char* error, const char* key, size_t keyLen) {
+    command.error = error;
+    command.key = key;
+    command.keyLength = keyLen;
+  };
+
+  bool wellFormed = forEachField(json, length, [&](const char* key, size_t keyLen, const char* value, size_t valueLen) {
+    if (command.error) return;  // the first fault is the one reported
+    if (keyIs(key, keyLen, "id")) {
+      if (!parseFixed(value, valueLen, 1, command.id)) fail("not a number", key, keyLen);
+      return;
+    }
+    if (keyIs(key, keyLen, "cmd")) {
+      for (uint8_t c = 0; c < 3; c++) {
+        if (keyIs(value, valueLen, COMMAND_NAMES[c])) {
+          command.type = (DeviceCommandType)c;
+          hasCommand = true;
+        }
+      }
+      if (!hasCommand) fail("unknown command", key, keyLen);
+      return;
+    }
+    if (keyIs(key, keyLen, "mac")) {
+      command.mac = value;
+      command.macLength = valueLen;
+      return;
+    }
+
+    const SettingField* field = findField(key, keyLen);
+    if (!field) {
+      fail("unknown setting", key, keyLen);
+      return;
+    }
+    uint32_t parsed;
+    if (field->max == 1 && keyIs(value, valueLen, "true")) {
+      parsed = 1;
+    } else if (field->max == 1 && keyIs(value, valueLen, "false")) {
+      parsed = 0;
+    } else if (!parseFixed(value, valueLen, field->scale, parsed)) {
+      fail("not a number", key, keyLen);
+      return;
+    }
+    if (parsed < field->min || parsed > field->max) {
+      fail("out of range", key, keyLen);
+      return;
+    }
+    command.settings.*(field->member) = parsed;
+    fields++;
+  });
+
+  if (!command.error && !wellFormed) fail("malformed", nullptr, 0);
+  if (!command.error && !hasCommand) fail("no cmd", nullptr, 0);
+  if (!command.error && fields && command.type != COMMAND_SET) fail("settings need cmd set", nullptr, 0);
+  if (!command.error && command.type == COMMAND_SET) {
+    const char* key = nullptr;
+    const char* error = checkDeviceSettings(command.settings, &key);
+    if (error) fail(error, key, key ? strlen(key) : 0);
+  }
+  if (command.error) {
+    command.settings = current;
+    return false;
+  }
+
+  command.changed = countChangedSettings(command.settings, current);
+  return true;
+}
+
+uint32_t countChangedSettings(const DeviceSettings& a, const DeviceSettings& b) {
+  uint32_t changed = 0;
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    if (a.*(FIELDS[i].member) != b.*(FIELDS[i].member)) changed++;
+  }
+  return changed;
+}
+
+bool commandTargets(const DeviceCommand& command, const char* mac) {
+  if (!command.mac) return true;
+  if (strlen(mac) != command.macLength) return false;
+  for (size_t i = 0; i < command.macLength; i++) {
+    char a = command.mac[i], b = mac[i];
+    if (a >= 'a' && a <= 'z') a -= 'a' - 'A';
+    if (b >= 'a' && b <= 'z') b -= 'a' - 'A';
+    if (a != b) return false;
+  }
+  return true;
+}
+
+const char* checkDeviceSettings(const DeviceSettings& settings, const char** key) {
+  // Every field on its own first: settings restored from NVS have not been through the parser
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    uint32_t value = settings.*(FIELDS[i].member);
+    if (value < FIELDS[i].min || value > FIELDS[i].max) {
+      if (key) *key = FIELDS[i].name;
+      return "out of range";
+    }
+  }
+
+  if (key) *key = "sample_ms";
+  if (settings.sampleMs == 0) return "out of range";
+  if (key) *key = "publish_ms";
+  if (settings.publishMs < settings.sampleMs) return "shorter than sample_ms";
+  if (settings.publishMs / settings.sampleMs > MAX_WINDOW_SAMPLES) return "more samples than a window holds";
+  if (key) *key = nullptr;
+  return nullptr;
+}
+
+int formatDeviceSettings(char* out, size_t size, const DeviceSettings& settings) {
+  int written = snprintf(out, size, "{");
+  for (size_t i = 0; i < FIELD_COUNT; i++) {
+    const SettingField& field = FIELDS[i];
+    uint32_t value = settings.*(field.member);
+    size_t offset = written < (int)size ? written : size;
+    const char* separator = i ? "," : "";
+    if (field.scale == 1) {
+      written += snprintf(out + offset, size - offset, "%s\"%s\":%lu", separator, field.name, (unsigned long)value);
+    } else {
+      written += snprintf(out + offset, size - offset, "%s\"%s\":%lu.%01lu", separator, field.name,
+                          (unsigned long)(value / field.scale), (unsigned long)(value % field.scale));
+    }
+  }
+  size_t offset = written < (int)size ? written : size;
+  return written + snprintf(out + offset, size - offset, "}");
+}
+
+int formatCommandReply(char* out, size_t size, const DeviceCommand& command, const char* mac, bool accepted,
+                       const DeviceSettings& settings) {
+  if (!accepted) {
+    int written = snprintf(out, size, "{\"id\":%lu,\"mac\":\"%s\",\"status\":\"rejected\",\"error\":\"%s\"",
+                           (unsigned long)command.id, mac, command.error ? command.error : "rejected");
+    size_t offset = written < (int)size ? written : size;
+    if (command.key) {
+      written += snprintf(out + offset, size - offset, ",\"key\":\"%.*s\"}", (int)command.keyLength, command.key);
+    } else {
+      written += snprintf(out + offset, size - offset, "}");
+    }
+    return written;
+  }
+
+  int written = snprintf(out, size, "{\"id\":%lu,\"mac\":\"%s\",\"cmd\":\"%s\",\"status\":\"%s\",\"changed\":%lu,\"settings\":",
+                         (unsigned long)command.id, mac, COMMAND_NAMES[command.type],
+                         command.type == COMMAND_GET ? "ok" : "applied", (unsigned long)command.changed);
+  size_t offset = written < (int)size ? written : size;
+  written += formatDeviceSettings(out + offset, size - offset, settings);
+  offset = written < (int)size ? written : size;
+  return written + snprintf(out + offset, size - offset, "}");
+}
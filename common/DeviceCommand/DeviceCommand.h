@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Runtime settings a backend can change over a device's commands topic,
+ * shared by the firmware and the host.
+ *
+ * Devices receive on  <prefix>/<API_KEY>/commands        (every device of the key)
+ * and answer on       <prefix>/<API_KEY>/command_replies
+ *
+ *   {"id":42,"cmd":"set","publish_ms":30000,"deadband_c":25}
+ *   {"id":43,"cmd":"get","mac":"AA:BB:CC:DD:EE:FF"}       (one device only)
+ *   {"id":44,"cmd":"reset"}                               (back to the firmware defaults)
+ *
+ *   {"id":42,"mac":"...","status":"applied","changed":2,"settings":{...}}
+ *   {"id":42,"mac":"...","status":"rejected","error":"out of range","key":"publish_ms"}
+ *
+ * parseDeviceCommand() reads the payload in place (FlatJson): no copy, no
+ * allocation, and a command that fails any check changes nothing. Every
+ * setting is a uint32_t, so the whole set is also the blob kept in NVS.
+ */
+
+const uint32_t SETTINGS_VERSION = 1;           // bump when DeviceSettings changes layout
+const uint32_t SETTINGS_CREDITS_SCALE = 10;    // credits_alert in 0.1 credit
+const uint32_t MAX_WINDOW_SAMPLES = 15;        // readings one aggregated window can hold
+
+/**
+ * @brief What the firmware loop runs on; defaults are the firmware's
+ */
+struct DeviceSettings {
+  uint32_t sampleMs = 2000;             // sample_ms: one reading per
+  uint32_t publishMs = 15000;           // publish_ms: one aggregated window per
+  uint32_t heartbeatMs = 300000;        // heartbeat_ms
+  uint32_t alertCooldownMs = 30000;     // alert_cooldown_ms: between critical alerts
+  uint32_t co2AlertPpm = 0;             // co2_alert: HIGH_CO2 above this
+  uint32_t creditsAlert = 0;            // credits_alert: LOW_CREDITS below this, SETTINGS_CREDITS_SCALE units
+  uint32_t co2DeadbandPpm = 0;          // deadband_c: skip a window whose average CO2 moved less (0: ignore CO2)
+  uint32_t humidityDeadband = 0;        // deadband_h: ... and average humidity less, % RH (0: ignore humidity)
+  uint32_t deadbandMaxMs = 300000;      // deadband_max_ms: send a window at least this often anyway
+  uint32_t batchWindows = 32;           // batch_windows: most backlog windows per batch
+  uint32_t compress = 1;                // compress: LZSS-frame sensor_data when smaller
+  uint32_t sketches = 1;                // sketches: attach quantile sketches to windows
+};
+
+enum DeviceCommandType : uint8_t {
+  COMMAND_SET = 0,
+  COMMAND_GET = 1,
+  COMMAND_RESET = 2,
+};
+
+/**
+ * @brief A parsed command; text fields point into the payload it came from
+ */
+struct DeviceCommand {
+  uint32_t id = 0;
+  DeviceCommandType type = COMMAND_SET;
+  const char* mac = nullptr;            // target device, null for all of them
+  size_t macLength = 0;
+  DeviceSettings settings;              // "set": the current settings with the new values applied
+  uint32_t changed = 0;                 // "set": how many values differ from the current ones
+  const char* error = nullptr;          // why it was rejected
+  const char* key = nullptr;            // the field the error is about, if any
+  size_t keyLength = 0;
+};
+
+/**
+ * @brief Parse a command over the raw payload
+ * @param current Settings that "set" applies its fields to
+ * @return false if malformed, unknown or out of range; command.error says why
+ */
+bool parseDeviceCommand(const char* json, size_t length, const DeviceSettings& current, DeviceCommand& command);
+
+/**
+ * @brief Whether the command is for the device with this MAC
+ */
+bool commandTargets(const DeviceCommand& command, const char* mac);
+
+/**
+ * @brief How many settings differ between a and b
+ */
+uint32_t countChangedSettings(const DeviceSettings& a, const DeviceSettings& b);
+
+/**
+ * @brief Check each setting's range, then the combination, e.g. that a window holds publish_ms worth of samples
+ * @return nullptr if usable, otherwise why not (setting the offending key)
+ */
+const char* checkDeviceSettings(const DeviceSettings& settings, const char** key);
+
+/**
+ * @return Number of characters written (snprintf semantics)
+ */
+int formatDeviceSettings(char* out, size_t size, const DeviceSettings& settings);
+
+/**
+ * @brief The reply to a command; settings are included when it was accepted
+ */
+int formatCommandReply(char* out, size_t size, const DeviceCommand& command, const char* mac, bool accepted,
+                       const DeviceSettings& settings);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Fast, seedable PRNG shared by the firmware and the host simulator.
+ *
+ * xoshiro128** (32-bit words, cheap on the ESP32) seeded through splitmix64.
+ * Every simulated device gets its own stream derived from (seed, device id),
+ * so a device's readings do not depend on how many other devices run or in
+ * which order they are stepped: the same seed replays the same fleet.
+ */
+
+/**
+ * @brief splitmix64 step, used to expand seeds into generator state
+ */
+inline uint64_t splitmix64(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+class FastRandom {
+public:
+  explicit FastRandom(uint64_t seed = 1) { reseed(seed); }
+
+  /**
+   * @brief Stream for one device of a seeded fleet
+   */
+  static FastRandom forDevice(uint64_t seed, uint64_t deviceId) {
+    uint64_t a = seed, b = deviceId ^ 0x632BE59BD9B4E019ULL;
+    return FastRandom(splitmix64(a) ^ splitmix64(b));
+  }
+
+  void reseed(uint64_t seed) {
+    uint64_t x = seed;
+    uint64_t lo = splitmix64(x), hi = splitmix64(x);
+    s_[0] = (uint32_t)lo;
+    s_[1] = (uint32_t)(lo >> 32);
+    s_[2] = (uint32_t)hi;
+    s_[3] = (uint32_t)(hi >> 32);
+    if (!(s_[0] | s_[1] | s_[2] | s_[3])) s_[0] = 1;  // the all-zero state is a fixed point
+  }
+
+  uint32_t next() {
+    const uint32_t result = rotl(s_[1] * 5, 7) * 9;
+    const uint32_t t = s_[1] << 9;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 11);
+    return result;
+  }
+
+  uint64_t next64() {
+    uint64_t hi = next();
+    return (hi << 32) | next();
+  }
+
+  /**
+   * @brief Unbiased value in [0, bound) without a division on the fast path (Lemire)
+   */
+  uint32_t below(uint32_t bound) {
+    uint64_t m = (uint64_t)next() * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound) {
+      uint32_t threshold = (0u - bound) % bound;
+      while (low < threshold) {
+        m = (uint64_t)next() * bound;
+        low = (uint32_t)m;
+      }
+    }
+    return (uint32_t)(m >> 32);
+  }
+
+  /**
+   * @brief Value in [lo, hi), same contract as Arduino random(min, max)
+   */
+  int32_t range(int32_t lo, int32_t hi) {
+    if (hi <= lo) return lo;
+    return lo + (int32_t)below((uint32_t)(hi - lo));
+  }
+
+  /**
+   * @brief Uniform float in [0, 1)
+   */
+  float nextFloat() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+  /**
+   * @brief Advance 2^64 steps: repeated jumps give non-overlapping substreams
+   */
+  void jump() {
+    static const uint32_t JUMP[] = {0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b};
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (uint32_t word : JUMP) {
+      for (int b = 0; b < 32; b++) {
+        if (word & (1u << b)) {
+          s0 ^= s_[0];
+          s1 ^= s_[1];
+          s2 ^= s_[2];
+          s3 ^= s_[3];
+        }
+        next();
+      }
+    }
+    s_[0] = s0;
+    s_[1] = s1;
+    s_[2] = s2;
+    s_[3] = s3;
+  }
+
+  /**
+   * @brief Child generator seeded from this one, e.g. one per worker
+   */
+  FastRandom split() { return FastRandom(next64()); }
+
+private:
+  static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+  uint32_t s_[4];
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * In-place reading of the flat JSON objects devices and services exchange
+ * (market orders and fills, device commands).
+ *
+ * forEachField() hands out every key and value as a pointer and length into
+ * the caller's buffer: nothing is copied, nothing allocated, and the buffer
+ * need not be null-terminated (an MQTT payload as received). Values are
+ * strings (without the quotes) or bare numbers / literals; nested objects
+ * and escaped quotes are not supported.
+ */
+
+inline bool keyIs(const char* key, size_t keyLen, const char* literal) {
+  return strlen(literal) == keyLen && memcmp(key, literal, keyLen) == 0;
+}
+
+/**
+ * @brief Parse a non-negative decimal straight into fixed point, extra digits truncated
+ * @param scale 1, 10, 100, ... units per whole number
+ */
+inline bool parseFixed(const char* text, size_t length, uint32_t scale, uint32_t& out) {
+  uint64_t value = 0;
+  uint32_t fraction = 1;
+  bool seenDot = false, seenDigit = false;
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
+    if (c == '.' && !seenDot) {
+      seenDot = true;
+    } else if (c >= '0' && c <= '9') {
+      seenDigit = true;
+      if (!seenDot) {
+        value = value * 10 + (c - '0');
+        if (value > UINT32_MAX) return false;
+      } else if (fraction < scale) {
+        fraction *= 10;
+        value = value * 10 + (c - '0');
+      }
+    } else {
+      return false;
+    }
+  }
+  if (!seenDigit) return false;
+  value *= scale / fraction;
+  if (value > UINT32_MAX) return false;
+  out = (uint32_t)value;
+  return true;
+}
+
+/**
+ * @brief Walk a flat JSON object of string and number fields
+ * @param onField Called as onField(key, keyLen, value, valueLen) for each field, in order
+ * @return false if the object is malformed (fields before the fault were already visited)
+ */
+template <typename OnField>
+bool forEachField(const char* json, size_t length, OnField onField) {
+  size_t i = 0;
+  auto skipSpace = [&]() {
+    while (i < length && (json[i] == ' ' || json[i] == '\t' || json[i] == '\r' || json[i] == '\n')) i++;
+  };
+
+  skipSpace();
+  if (i >= length || json[i] != '{') return false;
+  i++;
+
+  while (true) {
+    skipSpace();
+    if (i < length && json[i] == '}') return true;
+    if (i >= length || json[i] != '"') return false;
+    const char* key = json + ++i;
+    while (i < length && json[i] != '"') i++;
+    if (i >= length) return false;
+    size_t keyLen = (json + i) - key;
+    i++;
+
+    skipSpace();
+    if (i >= length || json[i] != ':') return false;
+    i++;
+    skipSpace();
+
+    const char* value;
+    size_t valueLen;
+    if (i < length && json[i] == '"') {
+      value = json + ++i;
+      while (i < length && json[i] != '"') i++;
+      if (i >= length) return false;
+      valueLen = (json + i) - value;
+      i++;
+    } else {
+      value = json + i;
+      while (i < length && json[i] != ',' && json[i] != '}' && json[i] != ' ') i++;
+      valueLen = (json + i) - value;
+    }
+
+    onField(key, keyLen, value, valueLen);
+
+    skipSpace();
+    if (i < length && json[i] == ',') {
+      i++;
+      continue;
+    }
+    return i < length && json[i] == '}';
+  }
+}
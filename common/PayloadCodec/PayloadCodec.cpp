@@ -0,0 +1,145 @@
+#include "PayloadCodec.h"
+
+#include <string.h>
+
+static const uint16_t NO_POSITION = 0xFFFF;
+
+static inline uint32_t hash3(const uint8_t* p) {
+  uint32_t key = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+  return (key * 2654435761u) >> (32 - LZSS_HASH_BITS);
+}
+
+static inline void insertPosition(const uint8_t* in, size_t position, LzssWorkspace& work) {
+  uint32_t h = hash3(in + position);
+  work.chain[position % LZSS_WINDOW] = work.head[h];
+  work.head[h] = (uint16_t)position;
+}
+
+size_t lzssCompress(const uint8_t* in, size_t length, uint8_t* out, size_t size, LzssWorkspace& work) {
+  if (length > PAYLOAD_MAX_TEXT) return 0;
+  memset(work.head, 0xFF, sizeof(work.head));
+
+  size_t o = 0;
+  size_t control = 0;
+  int items = 8;   // a new control byte before the first item
+  size_t i = 0;
+  while (i < length) {
+    if (items == 8) {
+      if (o >= size) return 0;
+      control = o++;
+      out[control] = 0;
+      items = 0;
+    }
+
+    // Longest match among the last few positions with the same 3-byte hash
+    int bestLength = 0;
+    size_t bestDistance = 0;
+    if (i + LZSS_MIN_MATCH <= length) {
+      size_t limit = length - i < (size_t)LZSS_MAX_MATCH ? length - i : (size_t)LZSS_MAX_MATCH;
+      uint16_t candidate = work.head[hash3(in + i)];
+      for (int tries = 0; candidate != NO_POSITION && tries < LZSS_MAX_CHAIN; tries++) {
+        size_t distance = i - candidate;
+        if (distance > (size_t)LZSS_WINDOW) break;
+        if (in[candidate + bestLength] == in[i + bestLength]) {
+          size_t matched = 0;
+          while (matched < limit && in[candidate + matched] == in[i + matched]) matched++;
+          if ((int)matched > bestLength) {
+            bestLength = (int)matched;
+            bestDistance = distance;
+            if (matched == limit) break;
+          }
+        }
+        // A slot reused by a newer position ends the chain
+        uint16_t previous = work.chain[candidate % LZSS_WINDOW];
+        if (previous == NO_POSITION || previous >= candidate) break;
+        candidate = previous;
+      }
+    }
+
+    if (bestLength >= LZSS_MIN_MATCH) {
+      if (o + 2 > size) return 0;
+      out[control] |= 1 << items;
+      out[o++] = (uint8_t)(bestDistance - 1);
+      out[o++] = (uint8_t)(((bestDistance - 1) >> 8) << 6 | (bestLength - LZSS_MIN_MATCH));
+      for (int k = 0; k < bestLength; k++, i++) {
+        if (i + LZSS_MIN_MATCH <= length) insertPosition(in, i, work);
+      }
+    } else {
+      if (o >= size) return 0;
+      out[o++] = in[i];
+      if (i + LZSS_MIN_MATCH <= length) insertPosition(in, i, work);
+      i++;
+    }
+    items++;
+  }
+  return o;
+}
+
+int lzssDecompress(const uint8_t* in, size_t length, uint8_t* out, size_t size) {
+  size_t i = 0;
+  size_t o = 0;
+  while (i < length) {
+    uint8_t control = in[i++];
+    for (int item = 0; item < 8 && i < length; item++) {
+      if (!(control >> item & 1)) {
+        if (o >= size) return -1;
+        out[o++] = in[i++];
+        continue;
+      }
+      if (i + 2 > length) return -1;
+      size_t distance = (in[i] | (size_t)(in[i + 1] >> 6) << 8) + 1;
+      size_t count = (in[i + 1] & 0x3F) + LZSS_MIN_MATCH;
+      i += 2;
+      if (distance > o || count > size - o) return -1;
+      const uint8_t* from = out + o - distance;
+      if (distance >= count) {
+        memcpy(out + o, from, count);
+      } else {
+        // Overlapping: a run repeating the last distance bytes
+        for (size_t k = 0; k < count; k++) out[o + k] = from[k];
+      }
+      o += count;
+    }
+  }
+  return (int)o;
+}
+
+size_t encodePayload(const char* text, size_t length, uint8_t flags, uint8_t* out, size_t size, LzssWorkspace& work) {
+  if (length > PAYLOAD_MAX_TEXT || size < PAYLOAD_HEADER_BYTES) return 0;
+  bool compress = flags & PAYLOAD_LZSS;
+  flags &= ~PAYLOAD_LZSS;
+  out[1] = (uint8_t)length;
+  out[2] = (uint8_t)(length >> 8);
+
+  // Only worth it if it beats the text itself
+  size_t room = size - PAYLOAD_HEADER_BYTES;
+  size_t compressed = 0;
+  if (compress && length > 1) {
+    size_t limit = length - 1 < room ? length - 1 : room;
+    compressed = lzssCompress((const uint8_t*)text, length, out + PAYLOAD_HEADER_BYTES, limit, work);
+  }
+  if (compressed > 0) {
+    out[0] = PAYLOAD_FLAG_MARKER | flags | PAYLOAD_LZSS;
+    return PAYLOAD_HEADER_BYTES + compressed;
+  }
+  if (length > room) return 0;
+  out[0] = PAYLOAD_FLAG_MARKER | flags;
+  memcpy(out + PAYLOAD_HEADER_BYTES, text, length);
+  return PAYLOAD_HEADER_BYTES + length;
+}
+
+int decodePayload(const uint8_t* data, size_t length, char* out, size_t size, uint8_t& flags) {
+  if (!isFramedPayload(data, length)) return -1;
+  flags = data[0] & ~PAYLOAD_FLAG_MASK;
+  size_t textLength = framedTextLength(data);
+  if (textLength > size) return -1;
+  const uint8_t* body = data + PAYLOAD_HEADER_BYTES;
+  size_t bodyLength = length - PAYLOAD_HEADER_BYTES;
+  if (!(flags & PAYLOAD_LZSS)) {
+    if (bodyLength != textLength) return -1;
+    memcpy(out, body, textLength);
+    return (int)textLength;
+  }
+  int decoded = lzssDecompress(body, bodyLength, (uint8_t*)out, textLength);
+  return decoded == (int)textLength ? decoded : -1;
+}
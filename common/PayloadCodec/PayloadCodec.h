@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Payload framing and LZSS compression shared by the firmware and the host.
+ *
+ * Plain payloads are JSON text and start with '{'. A framed payload starts
+ * with a flag byte 0xA0-0xAF instead (never the first byte of JSON text),
+ * then the text length as uint16 little-endian, then the text, LZSS
+ * compressed if PAYLOAD_LZSS is set:
+ *
+ *   [0xA0 | flags] [length lo] [length hi] [text or LZSS stream]
+ *
+ * A batch (PAYLOAD_BATCH) is the sender's uptime in ms on the first line,
+ * then one sensor_data object per line, oldest first.
+ *
+ * The LZSS stream is groups of eight items, each group after a control byte
+ * whose bit i (LSB first) says whether item i is a literal byte (0) or a
+ * match (1) of two bytes: distance - 1 in 10 bits (low byte, then the top
+ * two bits of the second byte) and length - 3 in the low 6 bits. So matches
+ * reach back 1 KiB, which spans two windows of JSON, and copy 3 to 66 bytes.
+ * The encoder needs LzssWorkspace (4 KiB) and no other memory; the decoder
+ * needs none.
+ */
+
+const uint8_t PAYLOAD_FLAG_MARKER = 0xA0;
+const uint8_t PAYLOAD_FLAG_MASK = 0xF0;
+const uint8_t PAYLOAD_LZSS = 0x01;
+const uint8_t PAYLOAD_BATCH = 0x02;
+const size_t PAYLOAD_HEADER_BYTES = 3;
+const size_t PAYLOAD_MAX_TEXT = 65535;
+
+const int LZSS_WINDOW = 1024;
+const int LZSS_MIN_MATCH = 3;
+const int LZSS_MAX_MATCH = 66;
+const int LZSS_HASH_BITS = 10;
+const int LZSS_MAX_CHAIN = 16;      // candidates tried per position
+
+/**
+ * @brief Encoder tables: newest position per 3-byte hash, and the previous one per position
+ */
+struct LzssWorkspace {
+  uint16_t head[1 << LZSS_HASH_BITS];
+  uint16_t chain[LZSS_WINDOW];
+};
+
+/**
+ * @brief Compress up to PAYLOAD_MAX_TEXT bytes
+ * @return Bytes written, 0 if they would not fit in size
+ */
+size_t lzssCompress(const uint8_t* in, size_t length, uint8_t* out, size_t size, LzssWorkspace& work);
+
+/**
+ * @brief Decompress a stream produced by lzssCompress()
+ * @return Bytes written, -1 if the stream is malformed or does not fit in size
+ */
+int lzssDecompress(const uint8_t* in, size_t length, uint8_t* out, size_t size);
+
+/**
+ * @brief Frame text, LZSS compressed if that comes out smaller
+ * @param flags PAYLOAD_BATCH or 0, plus PAYLOAD_LZSS to allow compression
+ * @return Bytes written, 0 if the text is too long or out too small
+ */
+size_t encodePayload(const char* text, size_t length, uint8_t flags, uint8_t* out, size_t size, LzssWorkspace& work);
+
+inline bool isFramedPayload(const uint8_t* data, size_t length) {
+  return length >= PAYLOAD_HEADER_BYTES && (data[0] & PAYLOAD_FLAG_MASK) == PAYLOAD_FLAG_MARKER;
+}
+
+/**
+ * @brief Text length announced by a framed payload's header
+ */
+inline size_t framedTextLength(const uint8_t* data) {
+  return data[1] | (size_t)data[2] << 8;
+}
+
+/**
+ * @brief Text of a framed payload
+ * @param flags Set to the frame's flags (PAYLOAD_LZSS, PAYLOAD_BATCH)
+ * @return Text length, -1 if malformed or longer than size
+ */
+int decodePayload(const uint8_t* data, size_t length, char* out, size_t size, uint8_t& flags);
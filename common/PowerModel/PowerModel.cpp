@@ -0,0 +1,111 @@
+#include "PowerModel.h"
+
+#include <string.h>
+
+bool WakeSchedule::add(const char* name, const unsigned long* lastMs, unsigned long intervalMs) {
+  if (count_ >= MAX_DEADLINES) return false;
+  deadlines_[count_++] = {name, lastMs, intervalMs};
+  return true;
+}
+
+bool WakeSchedule::setInterval(const char* name, unsigned long intervalMs) {
+  for (int i = 0; i < count_; i++) {
+    if (strcmp(deadlines_[i].name, name) == 0) {
+      deadlines_[i].intervalMs = intervalMs;
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned long WakeSchedule::msUntilNext(unsigned long nowMs, const char** name) const {
+  unsigned long earliest = (unsigned long)-1;
+  const char* earliestName = nullptr;
+  for (int i = 0; i < count_; i++) {
+    // Unsigned difference, so millis() wrapping is harmless
+    unsigned long elapsed = nowMs - *deadlines_[i].lastMs;
+    unsigned long remaining = elapsed >= deadlines_[i].intervalMs ? 0 : deadlines_[i].intervalMs - elapsed;
+    if (remaining < earliest) {
+      earliest = remaining;
+      earliestName = deadlines_[i].name;
+    }
+  }
+  if (name) *name = earliestName;
+  return earliestName ? earliest : 0;
+}
+
+void SleepStats::record(unsigned long requestedMs, unsigned long elapsedUs) {
+  uint64_t requestedUs = (uint64_t)requestedMs * 1000;
+  uint32_t latency = elapsedUs > requestedUs ? (uint32_t)(elapsedUs - requestedUs) : 0;
+  sleeps++;
+  asleepMs += elapsedUs / 1000;
+  lastWakeLatencyUs = latency;
+  if (latency > maxWakeLatencyUs) maxWakeLatencyUs = latency;
+  wakeLatencySumUs += latency;
+}
+
+EnergyEstimate estimateDailyEnergy(const PowerProfile& profile, const DutySchedule& schedule) {
+  const unsigned long DAY_MS = 24UL * 60 * 60 * 1000;
+  unsigned long lastSample = 0, lastPublish = 0, lastHeartbeat = 0, lastKeepalive = 0;
+  WakeSchedule wake;
+  wake.add("sample", &lastSample, schedule.sampleIntervalMs);
+  wake.add("publish", &lastPublish, schedule.publishIntervalMs);
+  wake.add("heartbeat", &lastHeartbeat, schedule.heartbeatIntervalMs);
+  wake.add("keepalive", &lastKeepalive, schedule.keepaliveIntervalMs);
+
+  // The radio listens every DTIM when always on, every listenInterval DTIMs when sleeping
+  float beaconPeriodMs = schedule.beaconIntervalMs * schedule.dtimPeriod;
+  if (schedule.mode != POWER_ALWAYS_ON) beaconPeriodMs *= schedule.listenInterval;
+  float idleMa = schedule.mode == POWER_ALWAYS_ON ? profile.cpuIdleMa
+               : schedule.mode == POWER_MODEM_SLEEP ? profile.cpuScaledIdleMa
+               : profile.lightSleepMa;
+  float beaconCharge = profile.beaconMs * profile.radioRxMa;
+  if (schedule.mode == POWER_LIGHT_SLEEP) beaconCharge += profile.wakeMs * profile.cpuActiveMa;
+
+  double chargeMaMs = 0, beacons = 0, awakeMs = 0;
+  uint32_t wakeups = 0;
+  unsigned long now = 0;
+  while (now < DAY_MS) {
+    // Wait: a fixed delay, or exactly until the next deadline
+    unsigned long wait = schedule.mode == POWER_ALWAYS_ON ? schedule.loopDelayMs : wake.msUntilNext(now);
+    if (wait > DAY_MS - now) wait = DAY_MS - now;
+    double waitBeacons = wait / beaconPeriodMs;
+    chargeMaMs += wait * (double)idleMa + waitBeacons * beaconCharge;
+    beacons += waitBeacons;
+    now += wait;
+
+    // Wake: loop overhead plus whatever came due
+    double workMs = schedule.wakeWorkMs, txMs = 0;
+    if (now - lastSample >= schedule.sampleIntervalMs) {
+      lastSample = now;
+      workMs += schedule.sampleWorkMs;
+    }
+    if (now - lastPublish >= schedule.publishIntervalMs) {
+      lastPublish = lastKeepalive = now;
+      workMs += schedule.publishWorkMs;
+      txMs += schedule.publishTxMs;
+    }
+    if (now - lastHeartbeat >= schedule.heartbeatIntervalMs) {
+      lastHeartbeat = lastKeepalive = now;
+      workMs += schedule.publishWorkMs;
+      txMs += schedule.publishTxMs;
+    }
+    if (now - lastKeepalive >= schedule.keepaliveIntervalMs) {
+      lastKeepalive = now;
+      txMs += schedule.publishTxMs;
+    }
+    if (schedule.mode == POWER_LIGHT_SLEEP) workMs += profile.wakeMs;
+    chargeMaMs += workMs * profile.cpuActiveMa + txMs * profile.radioTxMa;
+    awakeMs += workMs + txMs;
+    wakeups++;
+    now += (unsigned long)(workMs + txMs + 0.5);
+  }
+
+  EnergyEstimate estimate;
+  estimate.wakeups = wakeups;
+  estimate.beacons = (uint32_t)beacons;
+  estimate.awakePercent = (float)(awakeMs * 100 / DAY_MS);
+  estimate.averageMa = (float)(chargeMaMs / DAY_MS);
+  estimate.mWhPerDay = estimate.averageMa * 24 * profile.supplyVolts;
+  return estimate;
+}
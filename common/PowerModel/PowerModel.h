@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Duty-cycle scheduling and energy model for battery-backed devices.
+ *
+ * WakeSchedule knows every periodic deadline of the firmware loop (sample,
+ * publish, heartbeat, MQTT keepalive) through pointers to the loop's own
+ * "last ran" timestamps, so the loop can sleep exactly until the earliest
+ * one instead of waking on a fixed delay. SleepStats counts how long the
+ * device slept and how late it woke.
+ *
+ * estimateDailyEnergy() walks the same schedule over a simulated day with
+ * a current profile per power state, so the host can compare power modes
+ * before a unit ships.
+ */
+
+enum PowerMode {
+  POWER_ALWAYS_ON,     // 240 MHz, radio at every DTIM beacon, fixed loop delay
+  POWER_MODEM_SLEEP,   // radio off between listen-interval beacons, CPU scaled to 80 MHz
+  POWER_LIGHT_SLEEP    // modem sleep, plus automatic light sleep whenever the loop waits
+};
+
+/**
+ * @brief Periodic deadlines of the firmware loop
+ */
+class WakeSchedule {
+public:
+  static const int MAX_DEADLINES = 8;
+
+  /**
+   * @brief Track a deadline that is due intervalMs after *lastMs
+   * @return false if the schedule is full
+   */
+  bool add(const char* name, const unsigned long* lastMs, unsigned long intervalMs);
+
+  /**
+   * @brief Change the interval of the deadline added under name (runtime settings)
+   * @return false if there is none
+   */
+  bool setInterval(const char* name, unsigned long intervalMs);
+
+  /**
+   * @brief Milliseconds until the earliest deadline, 0 if one is already due
+   * @param name Set to the earliest deadline's name if not null
+   */
+  unsigned long msUntilNext(unsigned long nowMs, const char** name = nullptr) const;
+
+  int deadlineCount() const { return count_; }
+
+private:
+  struct Deadline {
+    const char* name;
+    const unsigned long* lastMs;
+    unsigned long intervalMs;
+  };
+
+  Deadline deadlines_[MAX_DEADLINES];
+  int count_ = 0;
+};
+
+/**
+ * @brief Time spent waiting for the next deadline, and how late each wake came
+ */
+struct SleepStats {
+  uint32_t sleeps = 0;
+  uint64_t asleepMs = 0;           // waiting for deadlines, light sleep where the PM allowed it
+  uint32_t lastWakeLatencyUs = 0;  // woke this long after the deadline
+  uint32_t maxWakeLatencyUs = 0;
+  uint64_t wakeLatencySumUs = 0;
+
+  /**
+   * @brief Account one sleep of requestedMs that actually took elapsedUs (less if woken early)
+   */
+  void record(unsigned long requestedMs, unsigned long elapsedUs);
+
+  uint32_t meanWakeLatencyUs() const { return sleeps ? (uint32_t)(wakeLatencySumUs / sleeps) : 0; }
+};
+
+/**
+ * @brief Supply current per state, ESP32-WROOM-32 datasheet typicals at 3.3 V
+ */
+struct PowerProfile {
+  float cpuActiveMa = 50;       // 240 MHz running the loop
+  float cpuIdleMa = 40;         // 240 MHz waiting in delay()
+  float cpuScaledIdleMa = 20;   // 80 MHz waiting, frequency scaling on
+  float lightSleepMa = 0.8f;
+  float radioRxMa = 100;        // receiving a beacon
+  float radioTxMa = 190;
+  float beaconMs = 3;           // radio on per beacon received
+  float wakeMs = 1;             // light-sleep exit and re-entry
+  float supplyVolts = 3.3f;
+};
+
+/**
+ * @brief The firmware's loop timing and the work done at each deadline
+ */
+struct DutySchedule {
+  PowerMode mode = POWER_ALWAYS_ON;
+  unsigned long loopDelayMs = 1000;           // POWER_ALWAYS_ON wakes on this fixed delay
+  unsigned long sampleIntervalMs = 2000;
+  unsigned long publishIntervalMs = 15000;
+  unsigned long heartbeatIntervalMs = 300000;
+  unsigned long keepaliveIntervalMs = 55000;  // reset by every publish
+  float beaconIntervalMs = 102.4f;            // 100 TU
+  uint8_t dtimPeriod = 1;                     // AP setting
+  uint8_t listenInterval = 3;                 // DTIMs skipped in the sleep modes
+  float wakeWorkMs = 1;                       // loop overhead per wake
+  float sampleWorkMs = 2;                     // sample and pipeline stages
+  float publishWorkMs = 8;                    // payload build
+  float publishTxMs = 4;                      // radio transmitting
+};
+
+struct EnergyEstimate {
+  uint32_t wakeups;       // loop wakes per day, beacons not counted
+  uint32_t beacons;       // beacons received per day
+  float awakePercent;     // CPU running the loop
+  float averageMa;
+  float mWhPerDay;
+};
+
+/**
+ * @brief Charge and energy per device-day for a schedule
+ */
+EnergyEstimate estimateDailyEnergy(const PowerProfile& profile, const DutySchedule& schedule);
+
+/**
+ * @brief Days a battery of capacityMah lasts at the estimated average current
+ */
+inline float batteryDays(const EnergyEstimate& estimate, float capacityMah) {
+  return capacityMah / estimate.averageMa / 24;
+}
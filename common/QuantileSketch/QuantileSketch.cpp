@@ -0,0 +1,208 @@
+#include "QuantileSketch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static const float LOG_GAMMA = logf(SKETCH_GAMMA);
+
+int sketchBucketIndex(int value) {
+  if (value < 0) value = 0;
+  if (value > SKETCH_MAX_VALUE) value = SKETCH_MAX_VALUE;
+  if (value < SKETCH_LINEAR_LIMIT) return value;
+  int index = SKETCH_LINEAR_LIMIT + (int)(logf((float)value / SKETCH_LINEAR_LIMIT) / LOG_GAMMA);
+  return index < SKETCH_BUCKETS ? index : SKETCH_BUCKETS - 1;
+}
+
+float sketchBucketValue(int index) {
+  if (index < SKETCH_LINEAR_LIMIT) return (float)index;
+  // Half a bucket up in log space: lower bound times sqrt(gamma)
+  return SKETCH_LINEAR_LIMIT * expf((index - SKETCH_LINEAR_LIMIT + 0.5f) * LOG_GAMMA);
+}
+
+bool SparseSketch::add(int value) {
+  uint16_t bucket = (uint16_t)sketchBucketIndex(value);
+
+  int position = 0;
+  while (position < size && index[position] < bucket) position++;
+
+  if (position < size && index[position] == bucket) {
+    count[position]++;
+    return true;
+  }
+  if (size >= SPARSE_SKETCH_CAPACITY) return false;
+
+  // Keep buckets sorted so the encoding can use deltas
+  for (int i = size; i > position; i--) {
+    index[i] = index[i - 1];
+    count[i] = count[i - 1];
+  }
+  index[position] = bucket;
+  count[position] = 1;
+  size++;
+  return true;
+}
+
+int SparseSketch::encode(char* out, size_t outSize) const {
+  size_t length = 0;
+  if (outSize < 3) return -1;
+  out[length++] = '[';
+
+  uint16_t previous = 0;
+  for (int i = 0; i < size; i++) {
+    int written = snprintf(out + length, outSize - length, "%s%u,%u",
+                           i ? "," : "", (unsigned)(index[i] - previous), (unsigned)count[i]);
+    if (written < 0 || (size_t)written >= outSize - length) return -1;
+    length += written;
+    previous = index[i];
+  }
+
+  if (length + 1 >= outSize) return -1;
+  out[length++] = ']';
+  out[length] = '\0';
+  return (int)length;
+}
+
+void LogHistogram::clear() {
+  memset(counts, 0, sizeof(counts));
+}
+
+void LogHistogram::add(int value, uint32_t times) {
+  counts[sketchBucketIndex(value)] += times;
+}
+
+bool LogHistogram::addEncoded(const char* text, size_t length) {
+  if (length < 2 || text[0] != '[' || text[length - 1] != ']') return false;
+  if (length == 2) return true;  // "[]" is an empty sketch
+
+  // First pass validates, second pass applies, so a malformed sketch never half-applies
+  for (int pass = 0; pass < 2; pass++) {
+    uint32_t numbers[2] = {0, 0};
+    int position = 0;
+    bool haveDigit = false;
+    uint32_t bucket = 0;
+
+    for (size_t i = 1; i < length; i++) {
+      char c = text[i];
+      if (c >= '0' && c <= '9') {
+        numbers[position] = numbers[position] * 10 + (c - '0');
+        if (numbers[position] > 0xFFFFFF) return false;
+        haveDigit = true;
+      } else if (c == ',' || c == ']') {
+        if (!haveDigit) return false;
+        haveDigit = false;
+        if (position == 0) {
+          if (c == ']') return false;  // odd number of values
+          position = 1;
+          continue;
+        }
+        bucket += numbers[0];
+        if (bucket >= (uint32_t)SKETCH_BUCKETS) return false;
+        if (pass == 1) counts[bucket] += numbers[1];
+        numbers[0] = numbers[1] = 0;
+        position = 0;
+      } else if (c != ' ') {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void LogHistogram::merge(const LogHistogram& other) {
+  sketchMergeCounts(counts, other.counts, SKETCH_BUCKETS);
+}
+
+uint64_t LogHistogram::total() const {
+  uint64_t sum = 0;
+  for (int i = 0; i < SKETCH_BUCKETS; i++) sum += counts[i];
+  return sum;
+}
+
+float LogHistogram::quantile(double q) const {
+  uint64_t n = total();
+  if (n == 0) return 0;
+  if (q < 0) q = 0;
+  if (q > 1) q = 1;
+
+  // Rank of the requested quantile, 1-based
+  uint64_t rank = (uint64_t)ceil(q * n);
+  if (rank == 0) rank = 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < SKETCH_BUCKETS; i++) {
+    seen += counts[i];
+    if (seen >= rank) return sketchBucketValue(i);
+  }
+  return sketchBucketValue(SKETCH_BUCKETS - 1);
+}
+
+void sketchMergeCountsScalar(uint32_t* dst, const uint32_t* src, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+void sketchMergeCountsSimd(uint32_t* dst, const uint32_t* src, size_t n) {
+#if defined(__AVX2__)
+  for (size_t i = 0; i < n; i += 16) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(dst + i));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(dst + i + 8));
+    __m256i b0 = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i b1 = _mm256_loadu_si256((const __m256i*)(src + i + 8));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi32(a0, b0));
+    _mm256_storeu_si256((__m256i*)(dst + i + 8), _mm256_add_epi32(a1, b1));
+  }
+#elif defined(__SSE2__)
+  for (size_t i = 0; i < n; i += 16) {
+    for (size_t j = 0; j < 16; j += 4) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(dst + i + j));
+      __m128i b = _mm_loadu_si128((const __m128i*)(src + i + j));
+      _mm_storeu_si128((__m128i*)(dst + i + j), _mm_add_epi32(a, b));
+    }
+  }
+#elif defined(__ARM_NEON)
+  for (size_t i = 0; i < n; i += 4) {
+    vst1q_u32(dst + i, vaddq_u32(vld1q_u32(dst + i), vld1q_u32(src + i)));
+  }
+#else
+  sketchMergeCountsScalar(dst, src, n);
+#endif
+}
+
+void sketchMergeCounts(uint32_t* dst, const uint32_t* src, size_t n) {
+#ifdef SKETCH_SIMD_MERGE
+  sketchMergeCountsSimd(dst, src, n);
+#else
+  sketchMergeCountsScalar(dst, src, n);
+#endif
+}
+
+void sketchMergeMany(LogHistogram& dst, const LogHistogram* const* sources, size_t count) {
+#if defined(SKETCH_SIMD_MERGE) && defined(__SSE2__)
+  // Accumulate a 16-bucket block across every source in registers, then store once
+  for (int i = 0; i < SKETCH_BUCKETS; i += 16) {
+    __m128i acc0 = _mm_load_si128((const __m128i*)(dst.counts + i));
+    __m128i acc1 = _mm_load_si128((const __m128i*)(dst.counts + i + 4));
+    __m128i acc2 = _mm_load_si128((const __m128i*)(dst.counts + i + 8));
+    __m128i acc3 = _mm_load_si128((const __m128i*)(dst.counts + i + 12));
+    for (size_t s = 0; s < count; s++) {
+      const uint32_t* src = sources[s]->counts + i;
+      acc0 = _mm_add_epi32(acc0, _mm_load_si128((const __m128i*)src));
+      acc1 = _mm_add_epi32(acc1, _mm_load_si128((const __m128i*)(src + 4)));
+      acc2 = _mm_add_epi32(acc2, _mm_load_si128((const __m128i*)(src + 8)));
+      acc3 = _mm_add_epi32(acc3, _mm_load_si128((const __m128i*)(src + 12)));
+    }
+    _mm_store_si128((__m128i*)(dst.counts + i), acc0);
+    _mm_store_si128((__m128i*)(dst.counts + i + 4), acc1);
+    _mm_store_si128((__m128i*)(dst.counts + i + 8), acc2);
+    _mm_store_si128((__m128i*)(dst.counts + i + 12), acc3);
+  }
+#else
+  for (size_t s = 0; s < count; s++) dst.merge(*sources[s]);
+#endif
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed-bucket log histogram shared by the firmware and the host.
+ *
+ * Values below SKETCH_LINEAR_LIMIT get one bucket each (exact for humidity),
+ * larger values fall into buckets growing by SKETCH_GAMMA, so any quantile is
+ * within ~1% of the true reading. Because every device uses the same bucket
+ * layout, sketches merge by adding counts.
+ */
+
+const int SKETCH_LINEAR_LIMIT = 64;
+const float SKETCH_GAMMA = 1.02f;
+const int SKETCH_MAX_VALUE = 65535;
+const int SKETCH_BUCKETS = 416;  // covers SKETCH_MAX_VALUE, multiple of 16 for the merge kernels
+
+/**
+ * @brief Bucket a reading falls into
+ */
+int sketchBucketIndex(int value);
+
+/**
+ * @brief Value reported for a bucket (exact below the linear limit, geometric midpoint above)
+ */
+float sketchBucketValue(int index);
+
+// Enough for one window: the firmware keeps at most 15 readings per publish
+const int SPARSE_SKETCH_CAPACITY = 16;
+
+/**
+ * @brief Per-window sketch built on the device, a few dozen bytes of JSON
+ *
+ * Encoded as a flat array of bucket/count pairs sorted by bucket, with every
+ * bucket after the first stored as a delta: [b0,c0,db1,c1,...].
+ */
+struct SparseSketch {
+  uint8_t size = 0;
+  uint16_t index[SPARSE_SKETCH_CAPACITY];
+  uint16_t count[SPARSE_SKETCH_CAPACITY];
+
+  void clear() { size = 0; }
+
+  /**
+   * @brief Add one reading
+   * @return false if the sketch already holds SPARSE_SKETCH_CAPACITY distinct buckets
+   */
+  bool add(int value);
+
+  /**
+   * @brief Write the JSON array form
+   * @return Characters written, or -1 if the buffer was too small
+   */
+  int encode(char* out, size_t size) const;
+};
+
+/**
+ * @brief Dense histogram used on the ingest side to merge sketches
+ */
+struct alignas(64) LogHistogram {
+  uint32_t counts[SKETCH_BUCKETS];
+
+  LogHistogram() { clear(); }
+
+  void clear();
+  void add(int value, uint32_t times = 1);
+
+  /**
+   * @brief Add the JSON array form produced by SparseSketch::encode()
+   * @return false if the text was malformed (nothing is added in that case)
+   */
+  bool addEncoded(const char* text, size_t length);
+
+  void merge(const LogHistogram& other);
+
+  uint64_t total() const;
+
+  /**
+   * @brief Value at quantile q in [0, 1], 0 if the histogram is empty
+   */
+  float quantile(double q) const;
+};
+
+/**
+ * @brief dst[i] += src[i] for n bucket counts, n a multiple of 16
+ *
+ * The scalar loop, which the compiler vectorizes for the target: the
+ * hand-written kernels did not beat it in sketch_merge on x86-64 (SSE2).
+ * Build with -DSKETCH_SIMD_MERGE to use sketchMergeCountsSimd() instead.
+ */
+void sketchMergeCounts(uint32_t* dst, const uint32_t* src, size_t n);
+
+/**
+ * @brief Merge many histograms into one (one source at a time unless SKETCH_SIMD_MERGE)
+ */
+void sketchMergeMany(LogHistogram& dst, const LogHistogram* const* sources, size_t count);
+
+/**
+ * @brief Scalar loop behind sketchMergeCounts()
+ */
+void sketchMergeCountsScalar(uint32_t* dst, const uint32_t* src, size_t n);
+
+/**
+ * @brief Hand-written AVX2, SSE2 or NEON kernel for the target (scalar if none)
+ */
+void sketchMergeCountsSimd(uint32_t* dst, const uint32_t* src, size_t n);
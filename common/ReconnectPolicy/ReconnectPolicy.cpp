@@ -0,0 +1,52 @@
+#include "ReconnectPolicy.h"
+
+ReconnectPolicy::ReconnectPolicy(const ReconnectConfig& config, uint64_t seed) : config_(config), random_(seed) {}
+
+ReconnectConfig ReconnectPolicy::fixedInterval(uint32_t intervalMs) {
+  ReconnectConfig config;
+  config.initialMs = intervalMs;
+  config.maxMs = intervalMs;
+  config.minMs = 0;
+  config.jitter = false;
+  return config;
+}
+
+uint32_t ReconnectPolicy::msUntilAttempt(uint32_t nowMs) const {
+  uint32_t elapsed = nowMs - fromMs_;
+  return elapsed >= waitMs_ ? 0 : waitMs_ - elapsed;
+}
+
+void ReconnectPolicy::schedule(uint32_t nowMs, uint32_t windowMs) {
+  fromMs_ = nowMs;
+  if (!config_.jitter) {
+    waitMs_ = windowMs;
+    return;
+  }
+  uint32_t floor = config_.minMs < windowMs ? config_.minMs : windowMs;
+  waitMs_ = floor + random_.below(windowMs - floor + 1);
+}
+
+void ReconnectPolicy::attempted(uint32_t nowMs, bool connected) {
+  attempts_++;
+  // Fixed interval: counted from every attempt, whatever came of it
+  if (!config_.jitter) {
+    schedule(nowMs, config_.initialMs);
+    failures_ = connected ? 0 : failures_ + 1;
+    return;
+  }
+  if (connected) {
+    failures_ = 0;
+    return;
+  }
+  failures_++;
+  // initialMs * 2^failures, capped without overflowing
+  uint32_t window = config_.initialMs;
+  for (uint32_t i = 0; i < failures_ && window < config_.maxMs; i++) window *= 2;
+  schedule(nowMs, window < config_.maxMs ? window : config_.maxMs);
+}
+
+void ReconnectPolicy::disconnected(uint32_t nowMs) {
+  failures_ = 0;
+  // The old fixed interval retries as soon as the last attempt is initialMs old
+  if (config_.jitter) schedule(nowMs, config_.initialMs);
+}
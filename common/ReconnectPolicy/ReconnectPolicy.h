@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <FastRandom.h>
+
+/*
+ * When a device retries its MQTT connection, shared by the firmware and the
+ * host chaos benchmarks.
+ *
+ * A fixed retry interval keeps a fleet in lockstep: a broker restart drops
+ * every device at the same instant, so every device retries at the same
+ * instant, every retry interval, until the broker has worked through all of
+ * them (a reconnect storm). Here each failed attempt doubles the wait up to
+ * maxMs, and every wait is drawn uniformly from [minMs, cap] ("full
+ * jitter"), so a dropped fleet spreads its attempts over the window instead
+ * of arriving together. The first attempt after a lost connection is
+ * jittered over initialMs as well. Times are millis() values; differences
+ * are taken modulo 2^32 so the 49-day wrap does not matter.
+ */
+
+struct ReconnectConfig {
+  uint32_t initialMs = 5000;     // first retry window after a lost connection
+  uint32_t maxMs = 30000;        // ceiling of the doubling window
+  uint32_t minMs = 250;          // no retry sooner than this
+  bool jitter = true;            // false: retry every initialMs, the old fixed interval
+};
+
+class ReconnectPolicy {
+public:
+  explicit ReconnectPolicy(const ReconnectConfig& config = ReconnectConfig(), uint64_t seed = 1);
+
+  /**
+   * @brief Fixed-interval retries, as the firmware did before (for comparison)
+   */
+  static ReconnectConfig fixedInterval(uint32_t intervalMs);
+
+  /**
+   * @brief Whether it is time to try connecting
+   */
+  bool due(uint32_t nowMs) const { return msUntilAttempt(nowMs) == 0; }
+
+  /**
+   * @brief Milliseconds until the next attempt is due, 0 if it is due now
+   */
+  uint32_t msUntilAttempt(uint32_t nowMs) const;
+
+  /**
+   * @brief Record an attempt and schedule the next one if it failed
+   */
+  void attempted(uint32_t nowMs, bool connected);
+
+  /**
+   * @brief The connection was lost: schedule the first attempt
+   */
+  void disconnected(uint32_t nowMs);
+
+  uint32_t failures() const { return failures_; }     // in a row, since the last connection
+  uint32_t attempts() const { return attempts_; }     // in total
+
+private:
+  void schedule(uint32_t nowMs, uint32_t windowMs);
+
+  ReconnectConfig config_;
+  FastRandom random_;
+  uint32_t fromMs_ = 0;        // next attempt at fromMs_ + waitMs_
+  uint32_t waitMs_ = 0;
+  uint32_t failures_ = 0;
+  uint32_t attempts_ = 0;
+};
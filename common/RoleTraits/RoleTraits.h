@@ -0,0 +1,164 @@
+#pragma once
+
+/*
+ * Compile-time description of the two device roles.
+ *
+ * The creator (sequester) and burner (emitter) firmwares are one codebase
+ * in firmware/. Everything that differs between them is a constant of
+ * RoleTraits<role>: ranges, multipliers, payload type, thresholds and the
+ * credit policy. The firmware selects a specialization with the DEVICE_ROLE
+ * build flag, so every role check is a constant expression and the other
+ * role's code is dropped. FleetSim reads the same traits to publish like the
+ * firmware.
+ */
+
+enum DeviceRole {
+  ROLE_CREATOR,   // sequesters CO2, accrues credits and sells them
+  ROLE_BURNER,    // emits CO2, burns credits and buys more
+};
+
+enum CreditPolicy {
+  CREDIT_POLICY_SELL,   // accrue credits from sequestration, list them on the marketplace
+  CREDIT_POLICY_BURN,   // burn credits against emissions, buy when running low
+};
+
+template <DeviceRole R>
+struct RoleTraits;
+
+/**
+ * @brief Carbon credit creator: greenhouse/forest plot sequestering CO2
+ */
+template <>
+struct RoleTraits<ROLE_CREATOR> {
+  static constexpr DeviceRole ROLE = ROLE_CREATOR;
+  static constexpr CreditPolicy CREDIT_POLICY = CREDIT_POLICY_SELL;
+  static constexpr const char* NAME = "Carbon Sequester";
+  static constexpr const char* TAGLINE = "Carbon Capture";
+  static constexpr const char* TOPIC_PREFIX = "carbon_sequester";
+  static constexpr const char* PAYLOAD_TYPE = "sequester";
+  static constexpr bool SIMULATED_ADDRESSES = false;   // publish the board's own MAC/IP
+
+  // Sensor data ranges
+  static constexpr int CO2_MIN = 300;         // Normal outdoor CO2 level
+  static constexpr int CO2_MAX = 2000;        // High indoor CO2 level
+  static constexpr int HUMIDITY_MIN = 20;     // Dry environment
+  static constexpr int HUMIDITY_MAX = 80;     // Humid environment
+
+  // Credits generated and emissions offset per reading
+  static constexpr float CREDIT_MULTIPLIER = 0.5f;
+  static constexpr float EMISSION_MULTIPLIER = 0.2f;
+
+  // Critical thresholds; the credit alert watches credits generated
+  static constexpr int CRITICAL_CO2_THRESHOLD = 1800;
+  static constexpr float CRITICAL_CREDITS_THRESHOLD = 2.0f;
+  static constexpr const char* CO2_ALERT = "High CO2 levels detected - sequestration needed!";
+  static constexpr const char* CREDITS_ALERT = "Low carbon credit generation!";
+
+  // Credit policy: sell sequestered credits to burners
+  static constexpr float CREDIT_ACCRUAL_RATE = 0.001f;  // Sellable credits per generated credit point per reading
+  static constexpr float CREDIT_SELL_LOT = 10.0f;       // List once this much is unsold
+  static constexpr int CREDIT_ASK_MIN_CENTS = 900;      // Ask price range per credit, 9.00 - 12.00
+  static constexpr int CREDIT_ASK_MAX_CENTS = 1200;
+
+  // Built-in scenario, a copy of host/scenarios/sequester.ini
+  static constexpr const char* SCENARIO_NAME = "sequester";
+  static constexpr const char* DEFAULT_SCENARIO = R"(
+[co2]
+base = 650
+diurnal_amplitude = 220
+peak_hour = 4
+walk_sigma = 12
+walk_reversion = 0.98
+device_spread = 120
+min = 300
+max = 2000
+[humidity]
+base = 55
+diurnal_amplitude = 15
+peak_hour = 5
+co2_coupling = 0.02
+noise = 1.0
+min = 20
+max = 80
+[steps]
+rate_per_hour = 0.1
+magnitude = 250
+duration_minutes = 40
+[outages]
+rate_per_hour = 0.03
+duration_minutes = 6
+)";
+};
+
+/**
+ * @brief Carbon credit burner: industrial stack emitting CO2
+ */
+template <>
+struct RoleTraits<ROLE_BURNER> {
+  static constexpr DeviceRole ROLE = ROLE_BURNER;
+  static constexpr CreditPolicy CREDIT_POLICY = CREDIT_POLICY_BURN;
+  static constexpr const char* NAME = "Gas Burner Monitor";
+  static constexpr const char* TAGLINE = "High Emission";
+  static constexpr const char* TOPIC_PREFIX = "carbon_emitter";
+  static constexpr const char* PAYLOAD_TYPE = "emitter";
+  static constexpr bool SIMULATED_ADDRESSES = true;    // random MAC/IP so many instances can run
+
+  // High gas emission ranges (similar to creator but higher)
+  static constexpr int CO2_MIN = 800;         // High baseline CO2 level
+  static constexpr int CO2_MAX = 3000;        // Very high CO2 level requiring credits
+  static constexpr int HUMIDITY_MIN = 40;     // Higher humidity baseline
+  static constexpr int HUMIDITY_MAX = 90;     // High humidity environment
+
+  // Credits needed and emissions per reading
+  static constexpr float CREDIT_MULTIPLIER = 0.8f;
+  static constexpr float EMISSION_MULTIPLIER = 0.3f;
+
+  // Critical thresholds; the credit alert watches available credits
+  static constexpr int CRITICAL_CO2_THRESHOLD = 2500;
+  static constexpr float CRITICAL_CREDITS_THRESHOLD = 5.0f;
+  static constexpr const char* CO2_ALERT = "Dangerous CO2 levels detected!";
+  static constexpr const char* CREDITS_ALERT = "Critical low carbon credits!";
+
+  // Credit policy: burn against excess CO2, buy from creators when low
+  static constexpr float STARTING_CREDITS = 50.0f;            // Start with limited credits
+  static constexpr int BURN_CO2_BASELINE = 1000;              // Only burn above this CO2 level
+  static constexpr float BURN_RATE = 0.001f;                  // Credits burned per ppm above the baseline
+  static constexpr float CREDIT_PURCHASE_THRESHOLD = 10.0f;   // Auto-purchase when below this
+  static constexpr float CREDIT_PURCHASE_AMOUNT = 100.0f;     // Amount to purchase
+  static constexpr float CREDIT_BID_PRICE = 12.00f;           // Highest price paid per credit
+
+  // Built-in scenario, a copy of host/scenarios/emitter.ini
+  static constexpr const char* SCENARIO_NAME = "emitter";
+  static constexpr const char* DEFAULT_SCENARIO = R"(
+[co2]
+base = 1300
+diurnal_amplitude = 250
+peak_hour = 15
+shift_start_hour = 6
+shift_end_hour = 22
+shift_boost = 450
+walk_sigma = 30
+walk_reversion = 0.97
+device_spread = 200
+min = 800
+max = 3000
+[humidity]
+base = 62
+diurnal_amplitude = 8
+peak_hour = 5
+co2_coupling = 0.012
+noise = 1.5
+min = 40
+max = 90
+[steps]
+rate_per_hour = 0.4
+magnitude = 600
+duration_minutes = 25
+[outages]
+rate_per_hour = 0.05
+duration_minutes = 4
+)";
+};
+
+typedef RoleTraits<ROLE_CREATOR> CreatorTraits;
+typedef RoleTraits<ROLE_BURNER> BurnerTraits;
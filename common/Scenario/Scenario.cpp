@@ -0,0 +1,267 @@
+#include "Scenario.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int64_t DAY_MS = 24LL * 60 * 60 * 1000;
+
+// Standard normal quantiles at (i + 0.5) / 1024, indexed by 10 random bits
+static const int NORMAL_BITS = 10;
+static float normalTable[1 << NORMAL_BITS];
+static bool normalTableReady = false;
+
+static void buildNormalTable() {
+  if (normalTableReady) return;
+  const int size = 1 << NORMAL_BITS;
+  for (int i = 0; i < size; i++) {
+    double p = (i + 0.5) / size;
+    double lo = -6, hi = 6;
+    for (int iteration = 0; iteration < 50; iteration++) {
+      double mid = (lo + hi) / 2;
+      if (0.5 * (1 + erf(mid / sqrt(2.0))) < p) lo = mid;
+      else hi = mid;
+    }
+    normalTable[i] = (float)((lo + hi) / 2);
+  }
+  normalTableReady = true;
+}
+
+struct ScenarioKey {
+  const char* section;
+  const char* key;
+  float ScenarioConfig::*field;
+};
+
+static const ScenarioKey SCENARIO_KEYS[] = {
+  {"co2", "base", &ScenarioConfig::co2Base},
+  {"co2", "diurnal_amplitude", &ScenarioConfig::co2DiurnalAmplitude},
+  {"co2", "peak_hour", &ScenarioConfig::co2PeakHour},
+  {"co2", "shift_start_hour", &ScenarioConfig::shiftStartHour},
+  {"co2", "shift_end_hour", &ScenarioConfig::shiftEndHour},
+  {"co2", "shift_boost", &ScenarioConfig::shiftBoost},
+  {"co2", "walk_sigma", &ScenarioConfig::walkSigma},
+  {"co2", "walk_reversion", &ScenarioConfig::walkReversion},
+  {"co2", "device_spread", &ScenarioConfig::deviceSpread},
+  {"co2", "min", &ScenarioConfig::co2Min},
+  {"co2", "max", &ScenarioConfig::co2Max},
+  {"humidity", "base", &ScenarioConfig::humidityBase},
+  {"humidity", "diurnal_amplitude", &ScenarioConfig::humidityDiurnalAmplitude},
+  {"humidity", "peak_hour", &ScenarioConfig::humidityPeakHour},
+  {"humidity", "co2_coupling", &ScenarioConfig::humidityCo2Coupling},
+  {"humidity", "noise", &ScenarioConfig::humidityNoise},
+  {"humidity", "min", &ScenarioConfig::humidityMin},
+  {"humidity", "max", &ScenarioConfig::humidityMax},
+  {"steps", "rate_per_hour", &ScenarioConfig::stepRatePerHour},
+  {"steps", "magnitude", &ScenarioConfig::stepMagnitude},
+  {"steps", "duration_minutes", &ScenarioConfig::stepDurationMinutes},
+  {"outages", "rate_per_hour", &ScenarioConfig::outageRatePerHour},
+  {"outages", "duration_minutes", &ScenarioConfig::outageDurationMinutes},
+};
+
+/**
+ * @brief Copy [begin, end) without surrounding whitespace into out
+ */
+static void trimCopy(const char* begin, const char* end, char* out, size_t outSize) {
+  while (begin < end && isspace((unsigned char)*begin)) begin++;
+  while (end > begin && isspace((unsigned char)end[-1])) end--;
+  size_t length = (size_t)(end - begin);
+  if (length >= outSize) length = outSize - 1;
+  memcpy(out, begin, length);
+  out[length] = '\0';
+}
+
+bool parseScenarioConfig(const char* text, ScenarioConfig& config) {
+  char section[16] = "";
+  const char* line = text;
+
+  while (*line) {
+    const char* end = line + strcspn(line, "\r\n");
+    const char* comment = line;
+    while (comment < end && *comment != ';' && *comment != '#') comment++;
+
+    char content[96];
+    trimCopy(line, comment, content, sizeof(content));
+    size_t length = strlen(content);
+
+    if (length > 0 && content[0] == '[') {
+      if (content[length - 1] != ']') return false;
+      trimCopy(content + 1, content + length - 1, section, sizeof(section));
+    } else if (length > 0) {
+      char* equals = strchr(content, '=');
+      if (!equals) return false;
+      char key[32], value[32];
+      trimCopy(content, equals, key, sizeof(key));
+      trimCopy(equals + 1, content + length, value, sizeof(value));
+
+      char* parsedEnd;
+      float number = strtof(value, &parsedEnd);
+      if (parsedEnd == value || *parsedEnd != '\0') return false;
+
+      bool known = false;
+      for (const ScenarioKey& entry : SCENARIO_KEYS) {
+        if (strcmp(entry.section, section) == 0 && strcmp(entry.key, key) == 0) {
+          config.*entry.field = number;
+          known = true;
+          break;
+        }
+      }
+      if (!known) return false;
+    }
+
+    line = end;
+    while (*line == '\r' || *line == '\n') line++;
+  }
+  return true;
+}
+
+bool loadScenarioConfig(const char* path, ScenarioConfig& config) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+  std::vector<char> text;
+  char buffer[256];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) text.insert(text.end(), buffer, buffer + read);
+  fclose(file);
+  text.push_back('\0');
+  return parseScenarioConfig(text.data(), config);
+}
+
+static bool inShift(float hour, float start, float end) {
+  if (start < end) return hour >= start && hour < end;
+  if (start > end) return hour >= start || hour < end;
+  return false;
+}
+
+/**
+ * @brief Chance per sample of an event at ratePerHour, as a 32-bit threshold
+ */
+static uint32_t eventThreshold(float ratePerHour, int64_t sampleIntervalMs) {
+  double p = ratePerHour * sampleIntervalMs / 3600000.0;
+  if (p <= 0) return 0;
+  if (p >= 1) return 0xFFFFFFFFu;
+  return (uint32_t)(p * 4294967296.0);
+}
+
+static int32_t durationSamples(float minutes, int64_t sampleIntervalMs) {
+  int32_t samples = (int32_t)lround(minutes * 60000.0 / sampleIntervalMs);
+  return samples < 1 ? 1 : samples;
+}
+
+struct StepConstants {
+  float co2Daily, humidityDaily;
+  float reversion, walkSigma, magnitude;
+  float coupling, humiditySigma, co2Base;
+  float co2Min, co2Max, humidityMin, humidityMax;
+  uint32_t stepThreshold, outageThreshold;
+  int32_t stepSamples, outageSamples;
+};
+
+/**
+ * @brief Branch-free update of every device, only selects
+ *
+ * The arrays never overlap; __restrict on the parameters spares the
+ * vectorizer the run-time alias checks it would otherwise give up on, and
+ * the event flags are int32_t because selects on bool don't vectorize.
+ */
+static void advanceDevices(const StepConstants k, uint32_t devices,
+                           float* __restrict walk, float* __restrict stepLevel,
+                           int32_t* __restrict stepLeft, int32_t* __restrict outageLeft,
+                           const float* __restrict offset, const float* __restrict co2Noise,
+                           const float* __restrict humidityNoise, const uint32_t* __restrict stepDraw,
+                           const uint32_t* __restrict outageDraw, int* __restrict co2,
+                           int* __restrict humidity, uint8_t* __restrict valid) {
+  for (uint32_t i = 0; i < devices; i++) {
+    float w = k.reversion * walk[i] + k.walkSigma * co2Noise[i];
+    walk[i] = w;
+
+    int32_t left = stepLeft[i];
+    int32_t stepStarts = (left == 0) & (stepDraw[i] < k.stepThreshold);
+    float level = stepStarts ? ((stepDraw[i] & 1) ? k.magnitude : -k.magnitude) : stepLevel[i];
+    left = stepStarts ? k.stepSamples : left;
+    float stepOffset = left > 0 ? level : 0.0f;
+    stepLevel[i] = level;
+    stepLeft[i] = left > 0 ? left - 1 : 0;
+
+    int32_t outage = outageLeft[i];
+    int32_t outageStarts = (outage == 0) & (outageDraw[i] < k.outageThreshold);
+    outage = outageStarts ? k.outageSamples : outage;
+    valid[i] = (uint8_t)((uint32_t)(outage - 1) >> 31);  // outage == 0, without a bool select
+    outageLeft[i] = outage > 0 ? outage - 1 : 0;
+
+    float c = k.co2Daily + offset[i] + w + stepOffset;
+    c = c < k.co2Min ? k.co2Min : (c > k.co2Max ? k.co2Max : c);
+    float h = k.humidityDaily + k.coupling * (c - k.co2Base) + k.humiditySigma * humidityNoise[i];
+    h = h < k.humidityMin ? k.humidityMin : (h > k.humidityMax ? k.humidityMax : h);
+    co2[i] = (int)(c + 0.5f);
+    humidity[i] = (int)(h + 0.5f);
+  }
+}
+
+ScenarioBank::ScenarioBank(const ScenarioConfig& config, uint32_t devices, int64_t sampleIntervalMs)
+    : config_(config),
+      stepThreshold_(eventThreshold(config.stepRatePerHour, sampleIntervalMs)),
+      outageThreshold_(eventThreshold(config.outageRatePerHour, sampleIntervalMs)),
+      stepSamples_(durationSamples(config.stepDurationMinutes, sampleIntervalMs)),
+      outageSamples_(durationSamples(config.outageDurationMinutes, sampleIntervalMs)),
+      randoms_(devices), offset_(devices), walk_(devices, 0), stepLevel_(devices, 0),
+      stepLeft_(devices, 0), outageLeft_(devices, 0), co2Noise_(devices), humidityNoise_(devices),
+      stepDraw_(devices), outageDraw_(devices) {
+  buildNormalTable();
+
+  const float twoPi = 6.28318530718f;
+  for (int slot = 0; slot <= PROFILE_SLOTS; slot++) {
+    float hour = 24.0f * (slot % PROFILE_SLOTS) / PROFILE_SLOTS;
+    co2Profile_[slot] = config.co2Base
+      + config.co2DiurnalAmplitude * cosf(twoPi * (hour - config.co2PeakHour) / 24)
+      + (inShift(hour, config.shiftStartHour, config.shiftEndHour) ? config.shiftBoost : 0);
+    humidityProfile_[slot] = config.humidityBase
+      + config.humidityDiurnalAmplitude * cosf(twoPi * (hour - config.humidityPeakHour) / 24);
+  }
+
+  for (uint32_t i = 0; i < devices; i++) seedDevice(i, FastRandom::forDevice(1, i));
+}
+
+void ScenarioBank::seedDevice(uint32_t device, const FastRandom& random) {
+  randoms_[device] = random;
+  offset_[device] = config_.deviceSpread * (2 * randoms_[device].nextFloat() - 1);
+}
+
+void ScenarioBank::step(int64_t timeMs, int* co2, int* humidity, uint8_t* valid) {
+  uint32_t devices = deviceCount();
+
+  // Scalar pass: random draws, one 32-bit word gives both noise terms
+  for (uint32_t i = 0; i < devices; i++) {
+    FastRandom& random = randoms_[i];
+    uint32_t noise = random.next();
+    co2Noise_[i] = normalTable[noise >> (32 - NORMAL_BITS)];
+    humidityNoise_[i] = normalTable[(noise >> (32 - 2 * NORMAL_BITS)) & ((1 << NORMAL_BITS) - 1)];
+    stepDraw_[i] = random.next();
+    outageDraw_[i] = random.next();
+  }
+
+  // Daily profile, shared by every device at this time
+  int64_t dayMs = ((timeMs % DAY_MS) + DAY_MS) % DAY_MS;
+  float position = (float)dayMs * PROFILE_SLOTS / DAY_MS;
+  int slot = (int)position;
+  float fraction = position - slot;
+  float co2Daily = co2Profile_[slot] + (co2Profile_[slot + 1] - co2Profile_[slot]) * fraction;
+  float humidityDaily = humidityProfile_[slot] + (humidityProfile_[slot + 1] - humidityProfile_[slot]) * fraction;
+
+  StepConstants constants = {
+    co2Daily, humidityDaily, config_.walkReversion, config_.walkSigma, config_.stepMagnitude,
+    config_.humidityCo2Coupling, config_.humidityNoise, config_.co2Base, config_.co2Min, config_.co2Max,
+    config_.humidityMin, config_.humidityMax, stepThreshold_, outageThreshold_, stepSamples_, outageSamples_,
+  };
+  advanceDevices(constants, devices, walk_.data(), stepLevel_.data(), stepLeft_.data(), outageLeft_.data(),
+                 offset_.data(), co2Noise_.data(), humidityNoise_.data(), stepDraw_.data(), outageDraw_.data(),
+                 co2, humidity, valid);
+}
+
+bool ScenarioBank::sample(int64_t timeMs, int& co2, int& humidity) {
+  uint8_t valid;
+  step(timeMs, &co2, &humidity, &valid);
+  return valid != 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <FastRandom.h>
+
+/*
+ * Scenario engine for simulated CO2 / humidity signals.
+ *
+ * A reading is the sum of a per-device baseline, a daily profile (cosine
+ * around a peak hour plus an optional shift boost), a mean-reverting random
+ * walk (AR(1)), and step events such as a kiln firing or a ventilation
+ * failure. Humidity follows its own daily profile, is coupled to the CO2
+ * deviation, and has white noise on top. Outages mark whole stretches of
+ * samples as missing, like a sensor that stopped answering.
+ *
+ * The daily profile is a per-scenario table and the noise comes from an
+ * inverse-CDF table, so a sample costs a few multiply-adds. ScenarioBank keeps
+ * every device's state in flat arrays and steps all of them for one timestamp
+ * in a single branch-free loop the compiler can vectorize.
+ */
+
+/**
+ * @brief Parameters of one scenario, usually loaded from an INI file
+ */
+struct ScenarioConfig {
+  // [co2], ppm
+  float co2Base = 1000;
+  float co2DiurnalAmplitude = 0;
+  float co2PeakHour = 14;
+  float shiftStartHour = 0;         // shift boost applies from start to end hour
+  float shiftEndHour = 0;
+  float shiftBoost = 0;
+  float walkSigma = 20;             // random walk noise per sample
+  float walkReversion = 0.98f;      // AR(1) coefficient, 1 is a pure random walk
+  float deviceSpread = 0;           // per-device baseline offset, uniform +-spread
+  float co2Min = 0;
+  float co2Max = 5000;
+  // [humidity], %
+  float humidityBase = 50;
+  float humidityDiurnalAmplitude = 0;
+  float humidityPeakHour = 5;
+  float humidityCo2Coupling = 0;    // % per ppm of CO2 above co2Base
+  float humidityNoise = 1;
+  float humidityMin = 0;
+  float humidityMax = 100;
+  // [steps]
+  float stepRatePerHour = 0;
+  float stepMagnitude = 0;          // ppm, sign is random
+  float stepDurationMinutes = 10;
+  // [outages]
+  float outageRatePerHour = 0;
+  float outageDurationMinutes = 5;
+};
+
+/**
+ * @brief Parse "key = value" lines grouped in [co2], [humidity], [steps] and [outages]
+ *
+ * Keys not present keep their current value. Comments start with ';' or '#'.
+ * @return false on a malformed line or an unknown section/key
+ */
+bool parseScenarioConfig(const char* text, ScenarioConfig& config);
+
+/**
+ * @brief Load and parse an INI file
+ * @return false if it can't be read or parsed
+ */
+bool loadScenarioConfig(const char* path, ScenarioConfig& config);
+
+/**
+ * @brief Signals for a bank of devices sharing one scenario and sample interval
+ */
+class ScenarioBank {
+public:
+  static const int PROFILE_SLOTS = 96;  // 15 minute resolution, interpolated
+
+  ScenarioBank(const ScenarioConfig& config, uint32_t devices, int64_t sampleIntervalMs);
+
+  /**
+   * @brief Give a device its own stream; also draws its baseline offset
+   */
+  void seedDevice(uint32_t device, const FastRandom& random);
+
+  /**
+   * @brief Advance every device by one sample
+   * @param timeMs Time of day source; only timeMs modulo 24 h matters
+   * @param valid 0 where the device is in an outage and the reading is missing
+   */
+  void step(int64_t timeMs, int* co2, int* humidity, uint8_t* valid);
+
+  /**
+   * @brief Advance a bank of one device
+   * @return false during an outage
+   */
+  bool sample(int64_t timeMs, int& co2, int& humidity);
+
+  uint32_t deviceCount() const { return (uint32_t)randoms_.size(); }
+  const ScenarioConfig& config() const { return config_; }
+
+private:
+  ScenarioConfig config_;
+  float co2Profile_[PROFILE_SLOTS + 1];
+  float humidityProfile_[PROFILE_SLOTS + 1];
+  uint32_t stepThreshold_;      // event fires when a 32-bit draw is below this
+  uint32_t outageThreshold_;
+  int32_t stepSamples_;
+  int32_t outageSamples_;
+
+  // Per device, structure of arrays
+  std::vector<FastRandom> randoms_;
+  std::vector<float> offset_;
+  std::vector<float> walk_;
+  std::vector<float> stepLevel_;
+  std::vector<int32_t> stepLeft_;
+  std::vector<int32_t> outageLeft_;
+
+  // Scratch filled by the scalar draw pass, consumed by the vector pass
+  std::vector<float> co2Noise_;
+  std::vector<float> humidityNoise_;
+  std::vector<uint32_t> stepDraw_;
+  std::vector<uint32_t> outageDraw_;
+};
@@ -0,0 +1,163 @@
+#include "SensorCalibration.h"
+
+#include <math.h>
+
+static const int32_t FULL_SCALE_CODE = 4095 << SIGNAL_CODE_FRACTION_BITS;
+
+// Compile-time math for the tables; pow()/log() are not constexpr
+static constexpr double LN2 = 0.69314718055994530942;
+
+static constexpr double constexprLn(double x) {
+  // Scale into [1, 2), then ln x = 2 atanh((x - 1) / (x + 1))
+  int exponent = 0;
+  while (x >= 2) { x /= 2; exponent++; }
+  while (x < 1) { x *= 2; exponent--; }
+  double z = (x - 1) / (x + 1);
+  double term = z, sum = 0;
+  for (int k = 1; k < 60; k += 2) {
+    sum += term / k;
+    term *= z * z;
+  }
+  return 2 * sum + exponent * LN2;
+}
+
+static constexpr double constexprExp(double x) {
+  // e^x = 2^n * e^r with |r| <= ln2 / 2
+  int n = (int)(x / LN2 + (x >= 0 ? 0.5 : -0.5));
+  double r = x - n * LN2;
+  double term = 1, sum = 1;
+  for (int k = 1; k < 30; k++) {
+    term *= r / k;
+    sum += term;
+  }
+  for (; n > 0; n--) sum *= 2;
+  for (; n < 0; n++) sum /= 2;
+  return sum;
+}
+
+/**
+ * @brief 1/256 ppm at the start of every segment: Rs/R0 = 2^octave * (1 + segment / 32)
+ */
+struct Mq135Table {
+  uint32_t ppmQ8[MQ135_TABLE_SIZE];
+
+  constexpr Mq135Table() : ppmQ8() {
+    for (int i = 0; i < MQ135_TABLE_SIZE; i++) {
+      int octave = MQ135_MIN_OCTAVE + i / MQ135_SEGMENTS_PER_OCTAVE;
+      double ratio = 1.0 + (double)(i % MQ135_SEGMENTS_PER_OCTAVE) / MQ135_SEGMENTS_PER_OCTAVE;
+      double ppm = MQ135_PARA * constexprExp(MQ135_PARB * (constexprLn(ratio) + octave * LN2));
+      ppmQ8[i] = (uint32_t)(ppm * 256 + 0.5);
+    }
+  }
+};
+
+/**
+ * @brief 1/256 %RH at 25 C every 16 ADC codes
+ */
+struct HumidityTable {
+  int32_t percentQ8[HUMIDITY_TABLE_SEGMENTS + 1];
+
+  constexpr HumidityTable() : percentQ8() {
+    for (int i = 0; i <= HUMIDITY_TABLE_SEGMENTS; i++) {
+      double fraction = (double)(i * 16) / 4095;   // Vout / Vs, the ADC reads the sensor ratiometrically
+      double percent = (fraction - HUMIDITY_SENSOR_OFFSET) / HUMIDITY_SENSOR_SLOPE;
+      percentQ8[i] = (int32_t)(percent * 256 + (percent >= 0 ? 0.5 : -0.5));
+    }
+  }
+};
+
+static constexpr Mq135Table MQ135_TABLE;
+static constexpr HumidityTable HUMIDITY_TABLE;
+
+// Rs = R0 gives exactly MQ135_PARA; Rs/R0 = 2 gives PARA * 2^PARB = 17.105 ppm
+static_assert(MQ135_TABLE.ppmQ8[-MQ135_MIN_OCTAVE * MQ135_SEGMENTS_PER_OCTAVE] == 29850, "MQ135 table at Rs = R0");
+static_assert(MQ135_TABLE.ppmQ8[(1 - MQ135_MIN_OCTAVE) * MQ135_SEGMENTS_PER_OCTAVE] == 4379, "MQ135 table at Rs = 2 R0");
+static_assert(HUMIDITY_TABLE.percentQ8[0] == -6606, "humidity table at 0 V");
+
+uint32_t mq135PpmFromRatio(uint32_t ratioQ16) {
+  const uint32_t low = 1u << (16 + MQ135_MIN_OCTAVE);
+  const uint32_t high = 1u << (16 + MQ135_MIN_OCTAVE + MQ135_OCTAVES);
+  if (ratioQ16 <= low) return MQ135_TABLE.ppmQ8[0];
+  if (ratioQ16 >= high) return MQ135_TABLE.ppmQ8[MQ135_TABLE_SIZE - 1];
+
+  // Leading bit picks the octave, the next 5 bits the segment, 16 more interpolate
+  int msb = 31 - __builtin_clz(ratioQ16);
+  uint32_t mantissa = ratioQ16 << (31 - msb);
+  int index = (msb - (16 + MQ135_MIN_OCTAVE)) * MQ135_SEGMENTS_PER_OCTAVE + (int)((mantissa >> 26) & 31);
+  int64_t fraction = (mantissa >> 10) & 0xFFFF;
+  int64_t start = MQ135_TABLE.ppmQ8[index];
+  int64_t end = MQ135_TABLE.ppmQ8[index + 1];
+  return (uint32_t)(start + (((end - start) * fraction) >> 16));
+}
+
+double mq135ReferencePpm(double ratio) {
+  return MQ135_PARA * pow(ratio, MQ135_PARB);
+}
+
+float mq135Correction(float temperatureC, float humidity) {
+  // Fit of the MQ135 datasheet's temperature/humidity dependency
+  if (temperatureC < 20) {
+    return 0.00035f * temperatureC * temperatureC - 0.02718f * temperatureC + 1.39538f - (humidity - 33.0f) * 0.0018f;
+  }
+  return -0.003333333f * temperatureC - 0.001923077f * humidity + 1.130128205f;
+}
+
+Mq135::Mq135() : rzero_((float)MQ135_RZERO_KOHM), correction_(1) {
+  updateScale();
+}
+
+void Mq135::setEnvironment(float temperatureC, float humidity) {
+  correction_ = mq135Correction(temperatureC, humidity);
+  if (correction_ < 0.5f) correction_ = 0.5f;
+  updateScale();
+}
+
+void Mq135::calibrate(int32_t code, float ppm) {
+  if (code <= 0 || code >= FULL_SCALE_CODE || ppm <= 0) return;
+  float rs = (float)MQ135_RLOAD_KOHM * (FULL_SCALE_CODE - code) / code / correction_;
+  rzero_ = rs / powf(ppm / (float)MQ135_PARA, 1.0f / (float)MQ135_PARB);
+  updateScale();
+}
+
+void Mq135::updateScale() {
+  scaleQ16_ = (uint32_t)((float)MQ135_RLOAD_KOHM / (rzero_ * correction_) * 65536.0f + 0.5f);
+}
+
+uint32_t Mq135::ratio(int32_t code) const {
+  // Rs = RLOAD * (full scale - code) / code; no signal means Rs is out of range high
+  if (code <= 0) return UINT32_MAX;
+  if (code >= FULL_SCALE_CODE) return 0;
+  uint32_t span = (uint32_t)(FULL_SCALE_CODE - code);   // below 2^16
+  if (scaleQ16_ <= 0xFFFF) return span * scaleQ16_ / (uint32_t)code;
+  uint64_t ratio = (uint64_t)span * scaleQ16_ / (uint32_t)code;
+  return ratio > UINT32_MAX ? UINT32_MAX : (uint32_t)ratio;
+}
+
+uint32_t Mq135::ppmQ8(int32_t code) const {
+  return mq135PpmFromRatio(ratio(code));
+}
+
+void HumidityCalibration::setTemperature(float temperatureC) {
+  // True RH = sensor RH / (1.0546 - 0.00216 T)
+  temperatureGainQ16_ = (int32_t)(65536.0f / (1.0546f - 0.00216f * temperatureC) + 0.5f);
+}
+
+int32_t HumidityCalibration::percentQ8(int32_t code) const {
+  if (code < 0) code = 0;
+  if (code > FULL_SCALE_CODE) code = FULL_SCALE_CODE;
+  int32_t index = code >> 8;
+  int32_t fraction = code & 0xFF;
+  int32_t start = HUMIDITY_TABLE.percentQ8[index];
+  int32_t end = HUMIDITY_TABLE.percentQ8[index + 1];
+  int32_t percent = start + (((end - start) * fraction) >> 8);
+  percent = (int32_t)(((int64_t)percent * temperatureGainQ16_) >> 16);
+  if (percent < 0) return 0;
+  if (percent > 100 * 256) return 100 * 256;
+  return percent;
+}
+
+double humidityReferencePercent(double code, float temperatureC) {
+  double percent = (code / 4095 - HUMIDITY_SENSOR_OFFSET) / HUMIDITY_SENSOR_SLOPE;
+  percent /= 1.0546 - 0.00216 * temperatureC;
+  return percent < 0 ? 0 : percent > 100 ? 100 : percent;
+}
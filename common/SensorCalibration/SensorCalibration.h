@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <SignalChain.h>
+
+/*
+ * Sensor curves for the firmware's ADC channels, shared with the host.
+ *
+ * MQ135: ppm = MQ135_PARA * (Rs / R0)^MQ135_PARB, with Rs from the load
+ * divider and a temperature/humidity correction on Rs. The power law is a
+ * fixed-point table built at compile time, indexed like a float: octave of
+ * Rs/R0 from the leading bit, then 32 linear segments per octave from the
+ * next bits. A conversion is a clz, a load pair and one multiply, with no
+ * pow() and no FPU.
+ *
+ * Humidity: analog RH sensor (HIH-4030 class, Vout = Vs * (0.0062 RH + 0.16))
+ * tabulated over the ADC code, with the sensor's temperature correction
+ * applied at runtime.
+ */
+
+// constexpr, not const: the tables are built from them at compile time
+constexpr double MQ135_PARA = 116.6020682;
+constexpr double MQ135_PARB = -2.769034857;
+constexpr double MQ135_RLOAD_KOHM = 10.0;        // load resistor on the module
+constexpr double MQ135_RZERO_KOHM = 76.63;       // R0 at atmospheric CO2, until calibrated
+const float MQ135_ATMOSPHERIC_PPM = 411.0;
+
+const int MQ135_SEGMENTS_PER_OCTAVE = 32;
+const int MQ135_MIN_OCTAVE = -4;                 // table covers Rs/R0 in [1/16, 16)
+const int MQ135_OCTAVES = 8;
+const int MQ135_TABLE_SIZE = MQ135_OCTAVES * MQ135_SEGMENTS_PER_OCTAVE + 1;
+
+constexpr double HUMIDITY_SENSOR_SLOPE = 0.0062;    // Vout/Vs per %RH at 25 C
+constexpr double HUMIDITY_SENSOR_OFFSET = 0.16;     // Vout/Vs at 0 %RH
+const int HUMIDITY_TABLE_SEGMENTS = 256;            // 16 ADC codes per segment
+
+/**
+ * @brief Convert filtered MQ135 codes (SignalChain::lastCode) to ppm
+ */
+class Mq135 {
+public:
+  Mq135();
+
+  /**
+   * @brief Set the ambient conditions Rs is corrected for (cheap, call per reading)
+   */
+  void setEnvironment(float temperatureC, float humidity);
+
+  /**
+   * @brief Take R0 from a reading at a known concentration, e.g. outdoors at MQ135_ATMOSPHERIC_PPM
+   */
+  void calibrate(int32_t code, float ppm = MQ135_ATMOSPHERIC_PPM);
+
+  /**
+   * @brief Rs / R0 after correction, Q16
+   */
+  uint32_t ratio(int32_t code) const;
+
+  /**
+   * @brief CO2 for a filtered code, 1/256 ppm
+   */
+  uint32_t ppmQ8(int32_t code) const;
+
+  int32_t ppm(int32_t code) const { return (int32_t)((ppmQ8(code) + 128) >> 8); }
+
+  float rzero() const { return rzero_; }
+
+private:
+  void updateScale();
+
+  float rzero_;
+  float correction_;     // Rs multiplier for temperature/humidity
+  uint32_t scaleQ16_;    // RLOAD / (R0 * correction), Q16
+};
+
+/**
+ * @brief Table lookup of the power law for Rs/R0 in Q16, 1/256 ppm (clamped at the table ends)
+ */
+uint32_t mq135PpmFromRatio(uint32_t ratioQ16);
+
+/**
+ * @brief Reference conversion with pow(), for tests and benchmarks
+ */
+double mq135ReferencePpm(double ratio);
+
+/**
+ * @brief MQ135 Rs correction factor for temperature (C) and relative humidity (%)
+ */
+float mq135Correction(float temperatureC, float humidity);
+
+/**
+ * @brief Convert filtered humidity codes to %RH
+ */
+class HumidityCalibration {
+public:
+  HumidityCalibration() { setTemperature(25); }
+
+  /**
+   * @brief Ambient temperature the sensor output is corrected for
+   */
+  void setTemperature(float temperatureC);
+
+  /**
+   * @brief Relative humidity for a filtered code, 1/256 %
+   */
+  int32_t percentQ8(int32_t code) const;
+
+  int32_t percent(int32_t code) const { return (percentQ8(code) + 128) >> 8; }
+
+private:
+  int32_t temperatureGainQ16_;
+};
+
+/**
+ * @brief Reference conversion for a code in whole LSB, for tests and benchmarks
+ */
+double humidityReferencePercent(double code, float temperatureC);
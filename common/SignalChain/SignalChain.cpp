@@ -0,0 +1,128 @@
+#include "SignalChain.h"
+
+#include <math.h>
+
+/**
+ * @brief Blackman-windowed sinc low-pass in Q15, summing to exactly 1.0
+ * @param cutoff Cutoff in cycles per input sample
+ */
+static void designLowPass(int16_t* taps, uint32_t count, double cutoff) {
+  double weights[SignalChain::MAX_FIR_TAPS];
+  double sum = 0;
+  double center = (count - 1) / 2.0;
+  for (uint32_t i = 0; i < count; i++) {
+    double x = i - center;
+    double sinc = x == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * x) / (M_PI * x);
+    double window = count == 1 ? 1 : 0.42 - 0.5 * cos(2 * M_PI * i / (count - 1)) + 0.08 * cos(4 * M_PI * i / (count - 1));
+    weights[i] = sinc * window;
+    sum += weights[i];
+  }
+
+  // Quantize, then put the rounding error on the center tap so DC gain is exact
+  int32_t total = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    taps[i] = (int16_t)lround(weights[i] / sum * 32768.0);
+    total += taps[i];
+  }
+  taps[count / 2] += (int16_t)(32768 - total);
+}
+
+SignalChain::SignalChain(const SignalChainConfig& config) {
+  cicDecimation_ = config.cicDecimation;
+  if (cicDecimation_ < 1) cicDecimation_ = 1;
+  if (cicDecimation_ > MAX_CIC_DECIMATION) cicDecimation_ = MAX_CIC_DECIMATION;
+  firDecimation_ = config.firDecimation ? config.firDecimation : 1;
+  tapCount_ = config.firTaps;
+  if (tapCount_ < 1) tapCount_ = 1;
+  if (tapCount_ > MAX_FIR_TAPS) tapCount_ = MAX_FIR_TAPS;
+
+  // Pass up to 80% of the output Nyquist frequency
+  designLowPass(taps_, tapCount_, 0.4 / firDecimation_);
+
+  int64_t cicGain = (int64_t)cicDecimation_ * cicDecimation_ * cicDecimation_;
+  outputDivisor_ = cicGain << (15 - SIGNAL_CODE_FRACTION_BITS);
+
+  const LinearCalibration& calibration = config.calibration;
+  int32_t codeSpan = (calibration.rawHigh - calibration.rawLow) << SIGNAL_CODE_FRACTION_BITS;
+  if (codeSpan == 0) codeSpan = 1;
+  calibrationGain_ = (int32_t)(((int64_t)(calibration.valueHigh - calibration.valueLow) << 16) / codeSpan);
+  calibrationCode_ = calibration.rawLow << SIGNAL_CODE_FRACTION_BITS;
+  calibrationValue_ = calibration.valueLow;
+
+  reset();
+}
+
+void SignalChain::reset() {
+  for (int i = 0; i < CIC_ORDER; i++) {
+    integrator_[i] = 0;
+    comb_[i] = 0;
+  }
+  cicPhase_ = 0;
+  historyPos_ = 0;
+  firPhase_ = 0;
+  primed_ = 0;
+  lastCode_ = 0;
+}
+
+size_t SignalChain::process(const uint16_t* raw, size_t count, int32_t* out) {
+  size_t written = 0;
+  while (count > 0) {
+    // Integrate up to the next comb; unsigned wrap-around is exact for a CIC
+    uint32_t run = cicDecimation_ - cicPhase_;
+    if (run > count) run = (uint32_t)count;
+    uint32_t a = integrator_[0], b = integrator_[1], c = integrator_[2];
+    for (uint32_t i = 0; i < run; i++) {
+      a += raw[i];
+      b += a;
+      c += b;
+    }
+    integrator_[0] = a;
+    integrator_[1] = b;
+    integrator_[2] = c;
+    raw += run;
+    count -= run;
+    cicPhase_ += run;
+
+    if (cicPhase_ == cicDecimation_) {
+      cicPhase_ = 0;
+      combAndFilter(out, written);
+    }
+  }
+  return written;
+}
+
+void SignalChain::combAndFilter(int32_t* out, size_t& written) {
+  uint32_t value = integrator_[CIC_ORDER - 1];
+  for (int i = 0; i < CIC_ORDER; i++) {
+    uint32_t delayed = comb_[i];
+    comb_[i] = value;
+    value -= delayed;
+  }
+
+  // The first CIC_ORDER outputs are start-up transients; the first settled
+  // one fills the FIR history so output starts without a long ramp
+  if (primed_ < (uint32_t)CIC_ORDER) {
+    if (++primed_ < (uint32_t)CIC_ORDER) return;
+    for (uint32_t i = 0; i < 2 * tapCount_; i++) history_[i] = value;
+    firPhase_ = 0;
+    return;
+  }
+
+  history_[historyPos_] = value;
+  history_[historyPos_ + tapCount_] = value;
+  if (++historyPos_ == tapCount_) historyPos_ = 0;
+  if (++firPhase_ < firDecimation_) return;
+  firPhase_ = 0;
+
+  // Oldest sample first: the window starts at historyPos_
+  const uint32_t* window = &history_[historyPos_];
+  int64_t acc = 0;
+  for (uint32_t i = 0; i < tapCount_; i++) {
+    acc += (int64_t)window[i] * taps_[i];
+  }
+  if (acc < 0) acc = 0;
+  lastCode_ = (int32_t)((acc + outputDivisor_ / 2) / outputDivisor_);
+
+  int64_t scaled = (int64_t)(lastCode_ - calibrationCode_) * calibrationGain_;
+  out[written++] = calibrationValue_ + (int32_t)((scaled + (1 << 15)) >> 16);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Integer decimation chain for high-rate ADC samples, shared by the
+ * firmware and the host.
+ *
+ * Raw 12-bit codes go through a third-order CIC decimator (three adds per
+ * sample, no multiplies), then a windowed-sinc FIR low-pass that decimates
+ * again and removes what the CIC lets alias. Only the FIR runs with
+ * multiplies, and only at the output rate. A linear calibration maps the
+ * filtered code to engineering units (ppm, %).
+ *
+ * With the firmware's 200 frames/s per pin, R = 100 and M = 4 give one
+ * sample every 2 s, the rate the pipeline aggregates at.
+ */
+
+const int SIGNAL_INPUT_BITS = 12;          // ESP32 ADC width
+const int SIGNAL_CODE_FRACTION_BITS = 4;   // filtered codes keep 4 bits below one LSB
+
+/**
+ * @brief Two-point linear map from filtered ADC code to engineering units
+ */
+struct LinearCalibration {
+  int32_t rawLow = 0;        // ADC code at valueLow
+  int32_t rawHigh = 4095;    // ADC code at valueHigh
+  int32_t valueLow = 0;
+  int32_t valueHigh = 4095;
+};
+
+struct SignalChainConfig {
+  uint16_t cicDecimation = 100;   // R, at most SignalChain::MAX_CIC_DECIMATION
+  uint8_t firDecimation = 4;      // M
+  uint8_t firTaps = 16;           // at most SignalChain::MAX_FIR_TAPS
+  LinearCalibration calibration;
+};
+
+class SignalChain {
+public:
+  static const int CIC_ORDER = 3;
+  static const int MAX_CIC_DECIMATION = 101;  // 4095 * R^3 must fit the 32-bit CIC registers
+  static const int MAX_FIR_TAPS = 64;
+
+  explicit SignalChain(const SignalChainConfig& config = SignalChainConfig());
+
+  /**
+   * @brief Clear the filter state; the next output needs a full FIR history again
+   */
+  void reset();
+
+  /**
+   * @brief Filter a block of raw codes
+   * @param out Calibrated samples, room for count / decimation() + 1
+   * @return Number of samples written
+   */
+  size_t process(const uint16_t* raw, size_t count, int32_t* out);
+
+  /**
+   * @brief Filter one raw code
+   * @return true when a decimated sample was written to value
+   */
+  bool push(uint16_t raw, int32_t& value) { return process(&raw, 1, &value) == 1; }
+
+  /**
+   * @brief Filtered code of the last output, in 1/16 LSB (before calibration)
+   */
+  int32_t lastCode() const { return lastCode_; }
+
+  uint32_t decimation() const { return (uint32_t)cicDecimation_ * firDecimation_; }
+  const int16_t* firCoefficients() const { return taps_; }
+
+private:
+  void combAndFilter(int32_t* out, size_t& written);
+
+  uint32_t cicDecimation_;
+  uint32_t firDecimation_;
+  uint32_t tapCount_;
+  int64_t outputDivisor_;       // CIC gain R^3 times the Q15 tap scale, less the code fraction bits
+  int32_t calibrationGain_;     // Q16 units per 1/16 LSB
+  int32_t calibrationCode_;     // code at valueLow, 1/16 LSB
+  int32_t calibrationValue_;
+
+  // CIC: integrators run at the input rate, combs once every R samples
+  uint32_t integrator_[CIC_ORDER];
+  uint32_t comb_[CIC_ORDER];
+  uint32_t cicPhase_;
+
+  // FIR history stored twice so a window is always contiguous
+  int16_t taps_[MAX_FIR_TAPS];
+  uint32_t history_[2 * MAX_FIR_TAPS];
+  uint32_t historyPos_;
+  uint32_t firPhase_;
+  uint32_t primed_;             // CIC outputs seen, up to tapCount_
+  int32_t lastCode_;
+};
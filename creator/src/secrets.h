@@ -1,11 +0,0 @@
-#define WIFI_SSID "Wokwi-GUEST"
-#define WIFI_PASSWORD ""
-
-// MQTT Configuration
-#define MQTT_SERVER "192.168.1.87"  // Your computer's IP address
-#define MQTT_PORT 1883
-#define MQTT_USERNAME ""  // Leave empty for anonymous access
-#define MQTT_PASSWORD ""  // Leave empty for anonymous access
-#define MQTT_CLIENT_ID "carbon_sequester_device"
-#define MQTT_TOPIC_PREFIX "carbon_sequester"
-#define API_KEY "cc_dfd4d3742159b53e68b4f2bae6df4132f2374c64b53a26b43cf6604e46c7e62a"
\ No newline at end of file
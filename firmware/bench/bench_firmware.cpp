@@ -0,0 +1,167 @@
+#include <Bench.h>
+
+#include <Arduino.h>
+#include <DeviceCommand.h>
+#include <LittleFS.h>
+#include <NativeShims.h>
+#include <RoleTraits.h>
+
+// main.cpp has no header: what the benchmarks drive and look at
+void setup();
+void loop();
+void generateSensorData();
+void deriveMetrics();
+void aggregateReading();
+void publishAggregatedDataToMqtt();
+void burnCreditsForOffset();
+void updateOLEDDisplay();
+extern DeviceSettings settings;
+extern int co2Reading;
+extern int readingsCount;
+extern float availableCredits;
+extern bool useScenario;
+
+/**
+ * @brief Run setup() once, on empty flash and a reachable broker
+ */
+static void bootFirmware() {
+  static bool booted = false;
+  if (booted) return;
+  booted = true;
+  LittleFS.format();
+  shimBroker.up = true;
+  setup();
+  shimReset();
+}
+
+/**
+ * @brief Fill the window buffers with one publish interval of samples
+ */
+static void fillWindow() {
+  for (uint32_t i = 0; i < MAX_WINDOW_SAMPLES; i++) {
+    shimSkipMs(settings.sampleMs);
+    generateSensorData();
+    aggregateReading();
+  }
+}
+
+BENCHMARK(firmware_generate_sample) {
+  bootFirmware();
+  const int samples = 200000;
+
+  // generateSensorData() with the scenario (default) and with uniform readings
+  for (bool scenarioOn : {true, false}) {
+    useScenario = scenarioOn;
+    int64_t start = benchNowNs();
+    for (int i = 0; i < samples; i++) {
+      shimSkipMs(settings.sampleMs);
+      generateSensorData();
+    }
+    state.report(scenarioOn ? "scenario_sample_ns" : "uniform_sample_ns", (double)(benchNowNs() - start) / samples,
+                 "ns");
+  }
+  useScenario = true;
+
+  // The "HIGH GAS EMISSION" stage that follows each sample
+  shimReset();
+  int64_t start = benchNowNs();
+  for (int i = 0; i < samples; i++) {
+    deriveMetrics();
+  }
+  state.report("derive_ns", (double)(benchNowNs() - start) / samples, "ns");
+  state.report("derive_serial_bytes", (double)shimCounters.serialBytes / samples, "B");
+}
+
+BENCHMARK(firmware_publish_window) {
+  bootFirmware();
+  fillWindow();
+  DeviceSettings saved = settings;
+  const int windows = 20000;
+
+  // Every combination of the payload options; the broker takes each publish
+  const struct {
+    const char* name;
+    uint32_t sketches;
+    uint32_t compress;
+  } variants[] = {
+    {"json", 0, 0},
+    {"sketches", 1, 0},
+    {"lzss", 0, 1},
+    {"sketches_lzss", 1, 1},
+  };
+  for (const auto& variant : variants) {
+    settings.sketches = variant.sketches;
+    settings.compress = variant.compress;
+    shimReset();
+    int64_t start = benchNowNs();
+    for (int i = 0; i < windows; i++) {
+      readingsCount = MAX_WINDOW_SAMPLES;
+      publishAggregatedDataToMqtt();
+    }
+    double elapsed = benchNowNs() - start;
+
+    char metric[48];
+    snprintf(metric, sizeof(metric), "%s_ns", variant.name);
+    state.report(metric, elapsed / windows, "ns");
+    snprintf(metric, sizeof(metric), "%s_wire_bytes", variant.name);
+    state.report(metric, shimCounters.publishes ? (double)shimCounters.publishBytes / shimCounters.publishes : 0, "B");
+    snprintf(metric, sizeof(metric), "%s_serial_bytes", variant.name);
+    state.report(metric, (double)shimCounters.serialBytes / windows, "B");
+    snprintf(metric, sizeof(metric), "%s_published", variant.name);
+    state.report(metric, (double)shimCounters.publishes / windows, "");
+  }
+  settings = saved;
+}
+
+BENCHMARK(firmware_burn_credits) {
+  bootFirmware();
+  const int burns = 200000;
+  co2Reading = BurnerTraits::BURN_CO2_BASELINE + 500;
+
+  // Each burn is journaled; the ledger commits a group of 16 to flash
+  shimReset();
+  int64_t start = benchNowNs();
+  for (int i = 0; i < burns; i++) {
+    availableCredits = 1000;
+    burnCreditsForOffset();
+  }
+  state.report("burn_ns", (double)(benchNowNs() - start) / burns, "ns");
+  state.report("burn_serial_bytes", (double)shimCounters.serialBytes / burns, "B");
+}
+
+BENCHMARK(firmware_oled_update) {
+  bootFirmware();
+  const int frames = 500000;
+
+  shimReset();
+  int64_t start = benchNowNs();
+  for (int i = 0; i < frames; i++) {
+    updateOLEDDisplay();
+  }
+  state.report("frame_ns", (double)(benchNowNs() - start) / frames, "ns");
+  state.report("chars_per_frame", (double)shimCounters.displayChars / frames, "");
+}
+
+BENCHMARK(firmware_loop) {
+  // A simulated day of the whole loop: sampling, stages, publishes, heartbeats, SNTP polls, ledger
+  bootFirmware();
+  const unsigned long dayMs = 24UL * 60 * 60 * 1000;
+
+  shimReset();
+  unsigned long begin = millis();
+  uint64_t loops = 0;
+  int64_t start = benchNowNs();
+  while (millis() - begin < dayMs) {
+    loop();
+    loops++;
+  }
+  double elapsed = benchNowNs() - start;
+
+  state.report("loop_ns", elapsed / loops, "ns");
+  state.report("day_host_ms", elapsed / 1e6, "ms");
+  state.report("publishes_per_hour", shimCounters.publishes / 24.0, "");
+  state.report("wire_bytes_per_hour", shimCounters.publishBytes / 24.0, "B");
+  state.report("serial_bytes_per_hour", shimCounters.serialBytes / 24.0, "B");
+  state.report("display_frames_per_hour", shimCounters.displayFrames / 24.0, "");
+  state.report("nvs_writes_per_day", (double)shimCounters.nvsWrites, "");
+}
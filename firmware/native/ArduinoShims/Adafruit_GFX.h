@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Text drawing; every character written counts as one drawn
+ */
+class Adafruit_GFX : public Print {
+public:
+  size_t write(uint8_t c) override;
+  void setTextSize(uint8_t size) {}
+  void setTextColor(uint16_t color) {}
+  void setCursor(int16_t x, int16_t y) {}
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+/*
+ * The subset of the ESP32 Arduino core the firmware uses, for the native
+ * build. See NativeShims.h for what the shims record.
+ */
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define DEC 10
+#define HEX 16
+#define INPUT 0
+#define OUTPUT 1
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+/**
+ * @brief Arduino String on top of std::string
+ */
+class String : public std::string {
+public:
+  String() {}
+  String(const char* text) : std::string(text) {}
+  String(const std::string& text) : std::string(text) {}
+  String(char c) : std::string(1, c) {}
+  String(int value, int base = DEC) : String((long)value, base) {}
+  String(unsigned value, int base = DEC) : String((unsigned long)value, base) {}
+  String(unsigned char value, int base = DEC) : String((unsigned long)value, base) {}
+  String(long value, int base = DEC);
+  String(unsigned long value, int base = DEC);
+  String(float value, int decimals = 2) : String((double)value, decimals) {}
+  String(double value, int decimals = 2);
+
+  unsigned int length() const { return size(); }
+  void toUpperCase();
+
+  String& operator+=(const String& other) { append(other); return *this; }
+  String& operator+=(const char* other) { append(other); return *this; }
+  String& operator+=(char c) { push_back(c); return *this; }
+  friend String operator+(const String& a, const String& b) { String result(a); result += b; return result; }
+  friend String operator+(const char* a, const String& b) { String result(a); result += b; return result; }
+  friend String operator+(const String& a, const char* b) { String result(a); result += b; return result; }
+};
+
+class IPAddress;
+
+/**
+ * @brief Text output, formatted here and written a byte or a block at a time
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write((const uint8_t*)text.data(), text.size()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+  size_t print(const IPAddress& address);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <typename T>
+  size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) {}
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+};
+
+extern HardwareSerial Serial;
+
+class IPAddress {
+public:
+  IPAddress() : bytes_{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes_{a, b, c, d} {}
+  uint8_t operator[](int index) const { return bytes_[index]; }
+  uint8_t& operator[](int index) { return bytes_[index]; }
+
+private:
+  uint8_t bytes_[4];
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char* host, uint16_t port) = 0;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t* buffer, size_t size) = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
+
+// FreeRTOS: tasks are never started and queues stay empty
+#define ARDUINO_ISR_ATTR
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portYIELD_FROM_ISR(...) do {} while (0)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack, void* parameter,
+                                   unsigned priority, TaskHandle_t* task, BaseType_t core);
+QueueHandle_t xQueueCreate(unsigned length, unsigned itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t wait);
+
+// esp32-hal-adc continuous mode: never starts, so the firmware falls back to simulated readings
+typedef struct {
+  uint8_t pin;
+  uint8_t channel;
+  int avg_read_raw;
+  int avg_read_mvolts;
+} adc_continuous_data_t;
+typedef enum { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db } adc_attenuation_t;
+
+bool analogContinuous(const uint8_t pins[], size_t pinCount, uint32_t conversionsPerPin, uint32_t sampleRateHz,
+                      void (*onFrame)(void));
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeoutMs);
+bool analogContinuousStart();
+bool analogContinuousStop();
+void analogContinuousSetAtten(adc_attenuation_t attenuation);
+void analogContinuousSetWidth(uint8_t bits);
@@ -0,0 +1,334 @@
+#include "NativeShims.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+
+#include <Adafruit_SSD1306.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Wire.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+
+ShimCounters shimCounters;
+ShimBroker shimBroker;
+bool shimSerialEcho = false;
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+TwoWire Wire;
+LittleFSFS LittleFS;
+
+static PubSubClient* callbackClient = nullptr;
+static uint64_t clockSkippedMs = 0;   // unlike shimCounters, never reset: the clock only goes forward
+
+void shimReset() {
+  shimCounters = ShimCounters();
+  shimBroker.lastTopic.clear();
+  shimBroker.lastPayload.clear();
+}
+
+void shimSkipMs(unsigned long ms) {
+  clockSkippedMs += ms;
+  shimCounters.skippedMs += ms;
+}
+
+bool shimDeliver(const char* topic, const uint8_t* payload, unsigned int length) {
+  return callbackClient && callbackClient->deliver(topic, payload, length);
+}
+
+// Time: the host clock since the first call, plus everything skipped
+
+static int64_t hostMicros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long millis() {
+  return (unsigned long)(hostMicros() / 1000 + clockSkippedMs);
+}
+
+unsigned long micros() {
+  return (unsigned long)(hostMicros() + clockSkippedMs * 1000);
+}
+
+int64_t esp_timer_get_time() {
+  return hostMicros() + (int64_t)clockSkippedMs * 1000;
+}
+
+void delay(unsigned long ms) {
+  shimSkipMs(ms);
+}
+
+// Random: fixed seeds, so a run replays (splitmix64)
+
+static uint64_t randomState = 1;
+static uint64_t hardwareRandomState = 0x45535033325f524eULL;
+
+static uint64_t splitMix(uint64_t& state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+uint32_t esp_random() {
+  return (uint32_t)(splitMix(hardwareRandomState) >> 32);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) randomState = seed;
+}
+
+long random(long howBig) {
+  if (howBig <= 0) return 0;
+  return (long)((splitMix(randomState) >> 33) % (uint64_t)howBig);
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) return howSmall;
+  return howSmall + random(howBig - howSmall);
+}
+
+// String and Print
+
+String::String(long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", value);
+  assign(text);
+}
+
+String::String(unsigned long value, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", value);
+  assign(text);
+}
+
+String::String(double value, int decimals) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  assign(text);
+}
+
+void String::toUpperCase() {
+  for (char& c : *this) c = toupper((unsigned char)c);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (size--) written += write(*buffer++);
+  return written;
+}
+
+size_t Print::print(long value, int base) {
+  char text[24];
+  int length = base == HEX ? snprintf(text, sizeof(text), "%lX", value) : snprintf(text, sizeof(text), "%ld", value);
+  return write((const uint8_t*)text, length);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char text[24];
+  int length = base == HEX ? snprintf(text, sizeof(text), "%lX", value) : snprintf(text, sizeof(text), "%lu", value);
+  return write((const uint8_t*)text, length);
+}
+
+size_t Print::print(double value, int digits) {
+  char text[48];
+  int length = snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write((const uint8_t*)text, length);
+}
+
+size_t Print::print(const IPAddress& address) {
+  char text[16];
+  int length = snprintf(text, sizeof(text), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+  return write((const uint8_t*)text, length);
+}
+
+size_t Print::printf(const char* format, ...) {
+  // Like the ESP32 core: a stack buffer, the heap when the text is longer
+  char small[64];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(small, sizeof(small), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  if ((size_t)length < sizeof(small)) return write((const uint8_t*)small, length);
+
+  char* large = (char*)malloc(length + 1);
+  if (!large) return 0;
+  va_start(args, format);
+  vsnprintf(large, length + 1, format, args);
+  va_end(args);
+  size_t written = write((const uint8_t*)large, length);
+  free(large);
+  return written;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  shimCounters.serialBytes += size;
+  shimCounters.serialWrites++;
+  if (shimSerialEcho) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+// OLED
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c != '\r' && c != '\n') shimCounters.displayChars++;
+  return 1;
+}
+
+void Adafruit_SSD1306::display() {
+  shimCounters.displayFrames++;
+}
+
+// MQTT
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+  this->callback = callback;
+  callbackClient = this;
+  return *this;
+}
+
+bool PubSubClient::connect(const char* id, const char* user, const char* pass, const char* willTopic,
+                           uint8_t willQos, bool willRetain, const char* willMessage, bool cleanSession) {
+  connected_ = shimBroker.up;
+  if (connected_) shimCounters.connects++;
+  return connected_;
+}
+
+bool PubSubClient::connected() {
+  if (!shimBroker.up) connected_ = false;
+  return connected_;
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+  // PubSubClient refuses what does not fit its buffer with the fixed header and topic
+  if (!connected() || 5 + 2 + strlen(topic) + length > bufferSize_) return false;
+  shimCounters.publishes++;
+  shimCounters.publishBytes += length;
+  shimBroker.lastTopic.assign(topic);
+  shimBroker.lastPayload.assign((const char*)payload, length);
+  return true;
+}
+
+bool PubSubClient::subscribe(const char* topic, uint8_t qos) {
+  if (!connected()) return false;
+  shimCounters.subscribes++;
+  return true;
+}
+
+bool PubSubClient::deliver(const char* topic, const uint8_t* payload, unsigned int length) {
+  if (!connected() || !callback) return false;
+  // PubSubClient hands over its own receive buffer; so does this, a copy of the message
+  std::string topicCopy(topic);
+  std::string payloadCopy((const char*)payload, length);
+  callback(&topicCopy[0], (uint8_t*)&payloadCopy[0], length);
+  return true;
+}
+
+int WiFiUDP::parsePacket() {
+  shimSkipMs(1);
+  return 0;
+}
+
+// NVS: namespace/key -> bytes
+
+static std::map<std::string, std::string>& nvs() {
+  static std::map<std::string, std::string> values;
+  return values;
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  name_ = name;
+  return true;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t value;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t size) {
+  auto found = nvs().find(name_ + "/" + key);
+  if (found == nvs().end() || found->second.size() > size) return 0;
+  memcpy(buffer, found->second.data(), found->second.size());
+  return found->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t size) {
+  nvs()[name_ + "/" + key].assign((const char*)value, size);
+  shimCounters.nvsWrites++;
+  return size;
+}
+
+// LittleFS
+
+bool LittleFSFS::begin(bool formatOnFail) {
+  return mkdir(FLASH_ROOT, 0755) == 0 || errno == EEXIST;
+}
+
+bool LittleFSFS::format() {
+  DIR* dir = opendir(FLASH_ROOT);
+  if (!dir) return begin();
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') continue;
+    std::string path = std::string(FLASH_ROOT) + "/" + entry->d_name;
+    unlink(path.c_str());
+  }
+  closedir(dir);
+  return true;
+}
+
+// ESP-IDF power management and FreeRTOS: nothing to manage, nothing runs
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* config) {
+  config->sta.listen_interval = 3;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* config) { return ESP_OK; }
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) { return ESP_OK; }
+esp_err_t esp_pm_configure(const void* config) { return ESP_ERR_NOT_SUPPORTED; }
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {}
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack, void* parameter,
+                                   unsigned priority, TaskHandle_t* task, BaseType_t core) {
+  return pdFALSE;
+}
+
+QueueHandle_t xQueueCreate(unsigned length, unsigned itemSize) { return nullptr; }
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) { return pdFALSE; }
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) { return pdFALSE; }
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t wait) {
+  shimSkipMs(wait);
+  return pdFALSE;
+}
+
+bool analogContinuous(const uint8_t pins[], size_t pinCount, uint32_t conversionsPerPin, uint32_t sampleRateHz,
+                      void (*onFrame)(void)) {
+  return false;
+}
+
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeoutMs) { return false; }
+bool analogContinuousStart() { return false; }
+bool analogContinuousStop() { return false; }
+void analogContinuousSetAtten(adc_attenuation_t attenuation) {}
+void analogContinuousSetWidth(uint8_t bits) {}
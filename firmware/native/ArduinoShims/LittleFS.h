@@ -0,0 +1,17 @@
+#pragma once
+
+// Where the native build keeps what the device keeps on flash
+#ifndef FLASH_ROOT
+#define FLASH_ROOT ".pio/flash"
+#endif
+
+/**
+ * @brief LittleFS as a folder on the host, FLASH_ROOT
+ */
+class LittleFSFS {
+public:
+  bool begin(bool formatOnFail = false);
+  bool format();   // remove every file
+};
+
+extern LittleFSFS LittleFS;
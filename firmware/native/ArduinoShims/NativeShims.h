@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/*
+ * Control and inspection of the Arduino/ESP32 shims the native firmware
+ * build ([env:native]) links against instead of the ESP32 core.
+ *
+ * Nothing touches hardware: Serial output is counted and dropped, MQTT
+ * publishes are recorded, the OLED counts frames and characters, NVS is a
+ * map in RAM and LittleFS is a folder on the host (FLASH_ROOT). millis()
+ * and micros() follow the host clock plus all time skipped by delay(), so
+ * the firmware loop runs a simulated day in seconds.
+ */
+
+/**
+ * @brief What the firmware asked of the hardware since the last shimReset()
+ */
+struct ShimCounters {
+  uint64_t serialBytes = 0;      // written to Serial
+  uint64_t serialWrites = 0;     // print/println/printf calls that wrote to Serial
+  uint64_t connects = 0;         // MQTT connects that succeeded
+  uint64_t subscribes = 0;
+  uint64_t publishes = 0;        // MQTT publishes that went out
+  uint64_t publishBytes = 0;     // their payload bytes
+  uint64_t displayFrames = 0;    // OLED display() calls
+  uint64_t displayChars = 0;     // characters drawn on the OLED
+  uint64_t nvsWrites = 0;
+  uint64_t skippedMs = 0;        // time delay() skipped instead of waiting
+};
+
+/**
+ * @brief The broker the PubSubClient shim talks to
+ */
+struct ShimBroker {
+  bool up = true;                // connect() succeeds
+  std::string lastTopic;         // of the last publish
+  std::string lastPayload;
+};
+
+extern ShimCounters shimCounters;
+extern ShimBroker shimBroker;
+extern bool shimSerialEcho;      // also print Serial output to stdout
+
+/**
+ * @brief Zero the counters and forget the last publish
+ */
+void shimReset();
+
+/**
+ * @brief Move millis()/micros() forward without waiting
+ */
+void shimSkipMs(unsigned long ms);
+
+/**
+ * @brief Hand a message to the MQTT callback, as PubSubClient::loop() does
+ * @return false if no client is connected or it has no callback
+ */
+bool shimDeliver(const char* topic, const uint8_t* payload, unsigned int length);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief NVS in RAM: values last until the program exits
+ */
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  size_t putUInt(const char* key, uint32_t value);
+  size_t getBytes(const char* key, void* buffer, size_t size);
+  size_t putBytes(const char* key, const void* value, size_t size);
+
+private:
+  std::string name_;
+};
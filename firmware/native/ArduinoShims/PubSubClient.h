@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+/**
+ * @brief PubSubClient 2.8's interface over the shim broker (NativeShims.h)
+ *
+ * connect() succeeds while shimBroker.up; publishes are counted and the last
+ * one kept, and shimDeliver() plays the part of an incoming message.
+ */
+class PubSubClient {
+public:
+  explicit PubSubClient(Client& client) {}
+
+  PubSubClient& setServer(const char* host, uint16_t port) { return *this; }
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+  bool setBufferSize(uint16_t size) { bufferSize_ = size; return true; }
+  uint16_t getBufferSize() { return bufferSize_; }
+  PubSubClient& setKeepAlive(uint16_t seconds) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t seconds) { return *this; }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr, true); }
+  bool connect(const char* id, const char* user, const char* pass) {
+    return connect(id, user, pass, nullptr, 0, false, nullptr, true);
+  }
+  bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos,
+               bool willRetain, const char* willMessage, bool cleanSession = true);
+  void disconnect() { connected_ = false; }
+
+  bool publish(const char* topic, const char* payload) { return publish(topic, payload, false); }
+  bool publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const uint8_t*)payload, strlen(payload), retained);
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+    return publish(topic, payload, length, false);
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+
+  bool subscribe(const char* topic) { return subscribe(topic, 0); }
+  bool subscribe(const char* topic, uint8_t qos);
+  bool unsubscribe(const char* topic) { return connected(); }
+
+  bool loop() { return connected(); }
+  bool connected();
+  int state() { return connected() ? 0 : -1; }
+
+  /**
+   * @brief Run the callback as if the broker sent this message
+   */
+  bool deliver(const char* topic, const uint8_t* payload, unsigned int length);
+
+private:
+  MQTT_CALLBACK_SIGNATURE;
+  uint16_t bufferSize_ = 256;
+  bool connected_ = false;
+};
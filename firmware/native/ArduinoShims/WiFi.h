@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+
+/**
+ * @brief A TCP client that never connects; PubSubClient's shim does not use it
+ */
+class WiFiClient : public Client {
+public:
+  int connect(IPAddress ip, uint16_t port) override { return 0; }
+  int connect(const char* host, uint16_t port) override { return 0; }
+  size_t write(uint8_t c) override { return 1; }
+  size_t write(const uint8_t* buffer, size_t size) override { return size; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t* buffer, size_t size) override { return -1; }
+  int peek() override { return -1; }
+  void flush() override {}
+  void stop() override {}
+  uint8_t connected() override { return 0; }
+  operator bool() override { return false; }
+};
+
+/**
+ * @brief Always associated, with a fixed address and signal
+ */
+class WiFiClass {
+public:
+  int begin(const char* ssid, const char* password) { return WL_CONNECTED; }
+  int status() { return WL_CONNECTED; }
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) { return true; }
+  IPAddress localIP() { return IPAddress(10, 0, 0, 2); }
+  IPAddress gatewayIP() { return IPAddress(10, 0, 0, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP() { return IPAddress(8, 8, 8, 8); }
+  String macAddress() { return "24:6F:28:00:00:01"; }
+  int8_t RSSI() { return -60; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief UDP that sends nowhere and receives nothing
+ *
+ * Every empty parsePacket() skips a millisecond, so a wait for a reply
+ * times out in simulated time rather than the host's.
+ */
+class WiFiUDP {
+public:
+  uint8_t begin(uint16_t port) { return 1; }
+  int beginPacket(const char* host, uint16_t port) { return 1; }
+  size_t write(const uint8_t* buffer, size_t size) { return size; }
+  int endPacket() { return 1; }
+  int parsePacket();
+  int read(uint8_t* buffer, size_t size) { return 0; }
+};
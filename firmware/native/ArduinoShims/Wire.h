@@ -0,0 +1,7 @@
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire {};
+
+extern TwoWire Wire;
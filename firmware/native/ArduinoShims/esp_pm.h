@@ -0,0 +1,12 @@
+#pragma once
+
+#include <esp_wifi.h>
+
+typedef struct {
+  int max_freq_mhz;
+  int min_freq_mhz;
+  bool light_sleep_enable;
+} esp_pm_config_t;
+
+// Not supported: the firmware stays in modem sleep, which changes nothing here
+esp_err_t esp_pm_configure(const void* config);
@@ -0,0 +1,1765 @@
+#include <Wire.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <PubSubClient.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <ClockSync.h>
+#include <CreditLedger.h>
+#include <CreditMarket.h>
+#include <Dataflow.h>
+#include <DeviceCommand.h>
+#include <FastRandom.h>
+#include <FileLedgerStorage.h>
+#include <PayloadCodec.h>
+#include <PowerModel.h>
+#include <QuantileSketch.h>
+#include <ReconnectPolicy.h>
+#include <RoleTraits.h>
+#include <Scenario.h>
+#include <SensorCalibration.h>
+#include <SignalChain.h>
+#include "secrets.h"
+
+// Device role from the PlatformIO env: pio run -e creator / pio run -e burner
+#ifndef DEVICE_ROLE
+#error "DEVICE_ROLE is not set - build with -e creator or -e burner"
+#endif
+typedef RoleTraits<DEVICE_ROLE> Role;
+const bool IS_BURNER = Role::CREDIT_POLICY == CREDIT_POLICY_BURN;
+
+// Broker identity for this role (secrets.h)
+const char* const MQTT_CLIENT_ID = IS_BURNER ? BURNER_MQTT_CLIENT_ID : CREATOR_MQTT_CLIENT_ID;
+const char* const API_KEY = IS_BURNER ? BURNER_API_KEY : CREATOR_API_KEY;
+const char* const MQTT_TOPIC_PREFIX = Role::TOPIC_PREFIX;
+
+// OLED settings
+#define SCREEN_WIDTH 128
+#define SCREEN_HEIGHT 64
+#define OLED_RESET -1
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+
+/**
+ * @brief WiFiClient that notes the session-present flag of each CONNACK
+ *
+ * PubSubClient 2.8 reads CONNACK itself and keeps only the return code, so
+ * the first bytes after every connect are looked at on their way through.
+ */
+class SessionAwareClient : public WiFiClient {
+public:
+  using WiFiClient::connect;
+
+  int connect(IPAddress ip, uint16_t port) override {
+    restart();
+    return WiFiClient::connect(ip, port);
+  }
+  int connect(const char* host, uint16_t port) override {
+    restart();
+    return WiFiClient::connect(host, port);
+  }
+  int read() override {
+    int value = WiFiClient::read();
+    if (value >= 0) watch((uint8_t)value);
+    return value;
+  }
+  int read(uint8_t* buffer, size_t size) override {
+    int count = WiFiClient::read(buffer, size);
+    for (int i = 0; i < count; i++) watch(buffer[i]);
+    return count;
+  }
+
+  // The broker still had this client id's session (subscriptions included)
+  bool sessionPresent() const { return sessionPresent_; }
+
+private:
+  void restart() {
+    seen_ = 0;
+    sessionPresent_ = false;
+  }
+  void watch(uint8_t value) {
+    // CONNACK: 0x20 0x02 <acknowledge flags> <return code>
+    if (seen_ >= 3) return;
+    if (seen_ == 0 && value != 0x20) {
+      seen_ = 3;
+      return;
+    }
+    if (seen_ == 2) sessionPresent_ = value & 0x01;
+    seen_++;
+  }
+
+  uint8_t seen_ = 3;
+  bool sessionPresent_ = false;
+};
+
+// MQTT client
+SessionAwareClient espClient;
+PubSubClient mqttClient(espClient);
+
+// Sensor pins
+#define CO2_PIN 34
+#define HUMIDITY_PIN 35
+
+// Sensor data variables
+int co2Reading = 0;
+int humidityReading = 0;
+float carbonCredits = 0;   // Burner: credits needed, creator: credits generated
+float emissions = 0;
+bool offset = false;
+
+// Intervals, thresholds and publishing options the backend can change at runtime over
+// the commands topic (common/DeviceCommand); kept in NVS so they survive a reboot
+DeviceSettings settings;
+Preferences settingsStore;
+bool settingsStoreReady = false;
+char commandsTopic[100] = "";
+
+// Random data generation
+unsigned long lastDataUpdate = 0;   // a reading every settings.sampleMs (2 s)
+
+// Simulated readings and addresses come from a seeded stream: a fixed SIMULATION_SEED
+// replays the same run on every boot, 0 seeds from the hardware RNG. Instances sharing
+// a seed get independent streams by SIMULATION_DEVICE (same as FleetSim's device index).
+const uint64_t SIMULATION_SEED = 0;
+const uint32_t SIMULATION_DEVICE = 0;
+FastRandom simRandom;
+
+// LittleFS mount point; the native build ([env:native]) keeps it in a host folder
+#ifndef FLASH_ROOT
+#define FLASH_ROOT "/littlefs"
+#endif
+
+// Readings follow a scenario (daily profile, random walk, step events, outages).
+// /littlefs/scenario.ini overrides the role's built-in scenario (Role::DEFAULT_SCENARIO)
+const char* SCENARIO_PATH = FLASH_ROOT "/scenario.ini";
+const int64_t SCENARIO_CLOCK_OFFSET_MS = 8LL * 60 * 60 * 1000;  // boot at 08:00 scenario time
+bool useScenario = true;   // false: uniform readings in [CO2_MIN, CO2_MAX] as before
+ScenarioBank scenario(ScenarioConfig(), 1, settings.sampleMs);
+bool sensorOutage = false;
+
+// Real acquisition: both pins in ADC continuous (DMA) mode, each frame averaging
+// ADC_CONVERSIONS_PER_PIN conversions, so 200 frames/s per pin. A task woken per
+// frame runs them through CIC + FIR decimation (SignalChain, x400), converts the
+// filtered codes with the MQ135/humidity tables (SensorCalibration) and queues
+// one reading per settings.sampleMs. false: simulated readings.
+bool useAdcSensors = false;
+const uint32_t ADC_SAMPLE_RATE_HZ = 20000;       // both pins together, the ESP32 continuous-mode minimum
+const uint32_t ADC_CONVERSIONS_PER_PIN = 50;
+const uint32_t ADC_FRAME_RATE_HZ = ADC_SAMPLE_RATE_HZ / 2 / ADC_CONVERSIONS_PER_PIN;
+const uint8_t ADC_FIR_DECIMATION = 4;
+struct AdcReading {
+  int32_t co2;
+  int32_t humidity;
+};
+SignalChain co2Chain, humidityChain;
+Mq135 mq135;
+HumidityCalibration humidityCalibration;
+float ambientTemperatureC = 20.0;   // no temperature sensor on the board yet
+TaskHandle_t adcTaskHandle = nullptr;
+QueueHandle_t adcReadings = nullptr;
+
+// Sample pipeline: a new sample drives derive -> credit policy -> alerts -> display -> aggregate
+Dataflow pipeline;
+const uint32_t EVENT_SAMPLE = 0x01;       // new CO2/humidity reading
+const uint32_t EVENT_CREDITS = 0x02;      // a credit balance changed
+const uint32_t EVENT_CONNECTION = 0x04;   // mqttConnected changed
+
+// Addresses published with every message: the board's own, or random ones
+// (Role::SIMULATED_ADDRESSES) so several simulator instances look like a fleet
+String deviceMacAddress = "";
+IPAddress deviceIPAddress;
+
+// MQTT transmission timing
+unsigned long lastMqttPublish = 0;      // aggregated data every settings.publishMs (15 s)
+unsigned long lastHeartbeat = 0;        // heartbeat every settings.heartbeatMs (5 min)
+unsigned long lastCriticalAlert = 0;    // settings.alertCooldownMs (30 s) between alerts
+const uint16_t MQTT_KEEPALIVE_S = 60;
+unsigned long lastMqttActivity = 0;
+const unsigned long mqttKeepaliveInterval = (MQTT_KEEPALIVE_S + 1) * 1000UL; // PubSubClient pings once it lapsed
+
+// Power management for battery units: instead of a fixed delay(1000) the loop
+// waits exactly until its next deadline, with the radio in modem sleep between
+// listen-interval beacons and, in POWER_LIGHT_SLEEP, the idle task in light
+// sleep (needs CONFIG_PM_ENABLE; the ADC's continuous mode holds a PM lock
+// while sampling, so with useAdcSensors the CPU only scales down).
+PowerMode powerMode = POWER_ALWAYS_ON;
+const uint8_t WIFI_LISTEN_INTERVAL = 3;   // wake for every 3rd DTIM beacon
+WakeSchedule wakeSchedule;
+SleepStats sleepStats;
+
+// Data aggregation arrays
+int co2Readings[MAX_WINDOW_SAMPLES]; // Store 15 readings (30 seconds worth)
+int humidityReadings[MAX_WINDOW_SAMPLES];
+int readingIndex = 0;
+int readingsCount = 0;
+
+// Deadband (settings.co2DeadbandPpm / humidityDeadband, off by default): a window whose
+// averages stayed that close to the last one sent is skipped, up to settings.deadbandMaxMs
+bool windowSent = false;
+float lastWindowCo2 = 0;
+float lastWindowHumidity = 0;
+unsigned long lastWindowMs = 0;
+uint32_t windowsSkipped = 0;
+
+// settings.sketches: attach a mergeable quantile sketch of each window's raw readings ("q_c"/"q_h")
+
+// Windows closed while MQTT is down wait here ('\n'-separated JSON, oldest first)
+// and go out as batches after the reconnect; the oldest are dropped when it is full
+const size_t WINDOW_BACKLOG_BYTES = 8192;   // ~18 windows with sketches
+char windowBacklog[WINDOW_BACKLOG_BYTES];
+size_t windowBacklogLength = 0;
+uint16_t windowBacklogCount = 0;
+uint32_t backlogWindowsDropped = 0;
+
+// settings.compress: LZSS-compress sensor_data payloads (common/PayloadCodec) whenever that
+// saves bytes. Backlog batches shrink several times over; the host consumer reads both forms.
+const uint16_t MQTT_BUFFER_SIZE = 1024;
+const size_t MAX_FRAMED_PAYLOAD = MQTT_BUFFER_SIZE - 128;   // room for the topic and headers
+const size_t BATCH_TEXT_BYTES = 4096;                       // uncompressed text per batch
+LzssWorkspace payloadCodecWork;                             // 4 KiB, used from loop() only
+char batchText[BATCH_TEXT_BYTES];
+uint8_t framedPayload[MAX_FRAMED_PAYLOAD];
+
+// Wall clock: SNTP against NTP_SERVER (secrets.h), disciplined by ClockDiscipline for
+// drift between polls (16 s at first, up to 17 min once it holds). Every payload's "t"
+// is Unix ms with "ts":1 once synced, ms since boot with "ts":0 before that.
+const int NTP_BURST = 4;                              // exchanges per poll, the fastest one counts
+const unsigned long NTP_REPLY_TIMEOUT_MS = 1000;
+const uint16_t NTP_LOCAL_PORT = 4123;
+WiFiUDP ntpUdp;
+ClockDiscipline wallClock;
+unsigned long lastTimeSync = 0;
+bool timeSyncAttempted = false;
+
+// Every payload's "seq" rises across reboots, so ingest can drop redeliveries. NVS
+// keeps the end of a reserved block of numbers; a reboot starts after it, one
+// write per SEQUENCE_BLOCK messages
+const uint32_t SEQUENCE_BLOCK = 1024;
+Preferences sequenceStore;
+bool sequenceStoreReady = false;
+uint32_t messageSequence = 0;
+uint32_t sequenceReserved = 0;   // numbers up to this one may be used without an NVS write
+
+// MQTT connection status. Retries back off with jitter (5 s window doubling up to 30 s),
+// so a broker restart does not bring the whole fleet back in the same instant
+bool mqttConnected = false;
+ReconnectPolicy mqttReconnect;   // reseeded at boot, every device on its own schedule
+
+// Persistent session: the broker keeps the subscriptions and queues QoS 1 commands while
+// the device is away, so the id must be this device's alone (MQTT_CLIENT_ID is per role)
+char mqttClientId[64] = "";
+uint32_t mqttSessionsResumed = 0;  // reconnects that skipped subscribing
+
+// What the session outlives a reboot with, in NVS: the instance id of a role with simulated
+// addresses (its instances share the board's MAC) and the fills topic the session holds
+Preferences sessionStore;
+bool sessionStoreReady = false;
+char sessionFillsTopic[120] = "";
+
+// Credit marketplace (host/src/marketplace): burners buy from creators instead of topping up locally
+const bool useCreditMarket = true;
+char fillsTopic[120] = "";
+uint32_t nextOrderId = 0;        // Randomized at boot so the marketplace can spot resends
+
+// Burner credit state
+float availableCredits = BurnerTraits::STARTING_CREDITS;
+float creditsBurned = 0.0;
+bool autoPurchaseEnabled = true;
+const unsigned long creditOrderTimeout = 120000;      // Resend an unfilled order after 2 minutes
+uint32_t pendingOrderId = 0;     // Outstanding buy order, 0 if none
+unsigned long lastOrderSent = 0;
+float creditsPurchased = 0.0;
+float creditSpend = 0.0;
+
+// Creator credit state
+float creditsForSale = 0.0;  // Accrued, not listed yet
+float creditsListed = 0.0;   // Resting in the order book
+float creditsSold = 0.0;
+float creditEarnings = 0.0;
+
+// Credit ledger on LittleFS: every credit movement is journaled so balances survive resets
+FileLedgerStorage ledgerStorage(FLASH_ROOT);
+const LedgerConfig LEDGER_CONFIG = {16, 5000, 512};  // group of 16 or 5 s, snapshot every 512 entries
+CreditLedger ledger(ledgerStorage, LEDGER_CONFIG);
+bool ledgerReady = false;
+
+/**
+ * @brief Credits the LOW_CREDITS alert and the alert payload report
+ */
+float alertCredits() {
+  if constexpr (IS_BURNER) {
+    return availableCredits;
+  } else {
+    return carbonCredits;
+  }
+}
+
+/**
+ * @brief Microseconds since boot; unlike millis() it does not wrap after 49 days
+ */
+int64_t monotonicUs() {
+  return esp_timer_get_time();
+}
+
+/**
+ * @brief Payload "t": Unix ms once the clock is synced, ms since boot before that
+ */
+uint64_t payloadTimeMs() {
+  int64_t now = monotonicUs();
+  return wallClock.synced() ? wallClock.epochMs(now) : (uint64_t)(now / 1000);
+}
+
+/**
+ * @brief Continue "seq" after the last block reserved before the reboot
+ */
+void restoreMessageSequence() {
+  sequenceStoreReady = sequenceStore.begin("telemetry", false);
+  if (!sequenceStoreReady) {
+    Serial.println("❌ NVS unavailable - seq restarts at 1 on every boot");
+    return;
+  }
+  messageSequence = sequenceStore.getUInt("seq_end", 0);
+  sequenceReserved = messageSequence;
+  Serial.printf("🔢 Message seq continues after %lu\n", (unsigned long)messageSequence);
+}
+
+/**
+ * @brief Payload "seq", reserving the next block in NVS before it is used
+ */
+uint32_t nextMessageSequence() {
+  if (++messageSequence > sequenceReserved && sequenceStoreReady) {
+    sequenceReserved = messageSequence + SEQUENCE_BLOCK - 1;
+    sequenceStore.putUInt("seq_end", sequenceReserved);
+  }
+  return messageSequence;
+}
+
+/**
+ * @brief One SNTP exchange with NTP_SERVER, fed to the clock discipline
+ * @return true if a valid reply came back in time and was accepted
+ */
+bool exchangeNtp() {
+  uint8_t packet[NTP_PACKET_BYTES];
+  uint64_t nonce = (uint64_t)esp_random() << 32 | esp_random();
+  formatNtpRequest(packet, nonce);
+  while (ntpUdp.parsePacket() > 0) {
+    // Late replies to an earlier request
+  }
+
+  // beginPacket() resolves the name, so the send time is taken after it
+  if (!ntpUdp.beginPacket(NTP_SERVER, NTP_SERVER_PORT)) {
+    return false;
+  }
+  ntpUdp.write(packet, sizeof(packet));
+  int64_t sentUs = monotonicUs();
+  if (!ntpUdp.endPacket()) {
+    return false;
+  }
+
+  unsigned long start = millis();
+  while (millis() - start < NTP_REPLY_TIMEOUT_MS) {
+    int size = ntpUdp.parsePacket();
+    if (size > 0) {
+      int64_t receivedUs = monotonicUs();
+      int length = ntpUdp.read(packet, sizeof(packet));
+      NtpReply reply;
+      if (length > 0 && parseNtpReply(packet, length, nonce, reply)) {
+        return wallClock.addSample(sentUs, reply, receivedUs);
+      }
+    }
+    delay(1);
+  }
+  return false;
+}
+
+/**
+ * @brief Poll the time server when the clock discipline asks for it, a burst of exchanges at a time
+ */
+void syncClock() {
+  unsigned long now = millis();
+  if (timeSyncAttempted && now - lastTimeSync < wallClock.pollIntervalS() * 1000UL) {
+    return;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+  timeSyncAttempted = true;
+  lastTimeSync = now;
+
+  bool wasSynced = wallClock.synced();
+  uint32_t stepsBefore = wallClock.stats().steps;
+  int accepted = 0;
+  for (int i = 0; i < NTP_BURST; i++) {
+    accepted += exchangeNtp();
+  }
+  if (accepted == 0) {
+    Serial.printf("⚠️ No time from %s:%d, retrying in %lu s\n", NTP_SERVER, NTP_SERVER_PORT,
+                  (unsigned long)wallClock.pollIntervalS());
+    return;
+  }
+
+  const ClockSyncStats& stats = wallClock.stats();
+  if (!wasSynced) {
+    Serial.printf("🕒 Clock synced to %s: %llu ms (round trip %ld us)\n", NTP_SERVER,
+                  (unsigned long long)payloadTimeMs(), (long)stats.lastDelayUs);
+  } else if (stats.steps != stepsBefore) {
+    Serial.printf("🕒 Clock stepped by %ld ms\n", (long)(stats.lastOffsetErrorUs / 1000));
+  } else {
+    Serial.printf("🕒 Clock off by %ld us, drift %.1f ppm, next poll in %lu s\n", (long)stats.lastOffsetErrorUs,
+                  wallClock.driftPpm(), (unsigned long)wallClock.pollIntervalS());
+  }
+}
+
+/**
+ * @brief Seed the simulation stream and log the seed so the run can be replayed
+ */
+void seedSimulation() {
+  uint64_t seed = SIMULATION_SEED;
+  if (seed == 0) seed = ((uint64_t)esp_random() << 32) | esp_random();
+  simRandom = FastRandom::forDevice(seed, SIMULATION_DEVICE);
+  Serial.printf("🎲 Simulation seed %llu, device stream %lu\n", (unsigned long long)seed, (unsigned long)SIMULATION_DEVICE);
+}
+
+/**
+ * @brief Build the reading scenario from flash or the built-in default (after LittleFS is mounted)
+ */
+void loadScenario() {
+  ScenarioConfig config;
+  parseScenarioConfig(Role::DEFAULT_SCENARIO, config);
+  ScenarioConfig fromFile = config;
+  if (ledgerReady && loadScenarioConfig(SCENARIO_PATH, fromFile)) {
+    config = fromFile;
+    Serial.printf("🎬 Scenario loaded from %s\n", SCENARIO_PATH);
+  } else {
+    Serial.printf("🎬 Built-in %s scenario\n", Role::SCENARIO_NAME);
+  }
+  scenario = ScenarioBank(config, 1, settings.sampleMs);
+  scenario.seedDevice(0, simRandom.split());
+}
+
+/**
+ * @brief The settings this firmware ships with; alert thresholds come from the role
+ */
+DeviceSettings defaultSettings() {
+  DeviceSettings defaults;
+  defaults.co2AlertPpm = Role::CRITICAL_CO2_THRESHOLD;
+  defaults.creditsAlert = (uint32_t)(Role::CRITICAL_CREDITS_THRESHOLD * SETTINGS_CREDITS_SCALE + 0.5f);
+  return defaults;
+}
+
+/**
+ * @brief Load the settings a command last applied, or the defaults (before the deadlines are registered)
+ */
+void restoreSettings() {
+  settings = defaultSettings();
+  settingsStoreReady = settingsStore.begin("settings", false);
+  if (!settingsStoreReady) {
+    Serial.println("❌ NVS unavailable - settings from commands last until reboot");
+    return;
+  }
+
+  DeviceSettings stored;
+  if (settingsStore.getUInt("version", 0) != SETTINGS_VERSION ||
+      settingsStore.getBytes("values", &stored, sizeof(stored)) != sizeof(stored) ||
+      checkDeviceSettings(stored, nullptr)) {
+    Serial.println("⚙️ Default settings");
+    return;
+  }
+  settings = stored;
+  Serial.printf("⚙️ Settings restored: sample %lu ms, publish %lu ms, heartbeat %lu ms\n",
+                (unsigned long)settings.sampleMs, (unsigned long)settings.publishMs,
+                (unsigned long)settings.heartbeatMs);
+}
+
+/**
+ * @brief Keep the current settings in NVS for the next boot
+ */
+void saveSettings() {
+  if (!settingsStoreReady) return;
+  settingsStore.putBytes("values", &settings, sizeof(settings));
+  settingsStore.putUInt("version", SETTINGS_VERSION);
+}
+
+/**
+ * @brief Switch the loop to new settings, rescheduling its deadlines
+ */
+void applySettings(const DeviceSettings& next) {
+  bool sampleChanged = next.sampleMs != settings.sampleMs;
+  settings = next;
+  wakeSchedule.setInterval("sample", settings.sampleMs);
+  wakeSchedule.setInterval("publish", settings.publishMs);
+  wakeSchedule.setInterval("heartbeat", settings.heartbeatMs);
+
+  // The ADC filter chain decimates to the sample rate it was started with
+  if (sampleChanged && useAdcSensors) {
+    Serial.println("⚙️ sample_ms applies to the ADC sensors after a reboot");
+  } else if (sampleChanged) {
+    loadScenario();
+  }
+  saveSettings();
+}
+
+/**
+ * @brief Generate a random MAC address for simulator instances
+ * @return String containing the random MAC address
+ */
+String generateRandomMacAddress() {
+  String mac = "";
+  for (int i = 0; i < 6; i++) {
+    if (i > 0) mac += ":";
+    byte randomByte = simRandom.range(0, 256);
+    if (randomByte < 16) mac += "0";
+    mac += String(randomByte, HEX);
+  }
+  mac.toUpperCase();
+  return mac;
+}
+
+/**
+ * @brief Generate a random IP address for simulator instances
+ * @return IPAddress containing the random IP
+ */
+IPAddress generateRandomIPAddress() {
+  // Generate IP in common private ranges: 192.168.x.x, 10.x.x.x, or 172.16-31.x.x
+  int range = simRandom.range(0, 3);
+  IPAddress ip;
+
+  switch (range) {
+    case 0: // 192.168.x.x
+      {
+        int c = simRandom.range(1, 255);
+        ip = IPAddress(192, 168, c, simRandom.range(1, 255));
+      }
+      break;
+    case 1: // 10.x.x.x
+      {
+        int b = simRandom.range(0, 255);
+        int c = simRandom.range(0, 255);
+        ip = IPAddress(10, b, c, simRandom.range(1, 255));
+      }
+      break;
+    case 2: // 172.16-31.x.x
+      {
+        int b = simRandom.range(16, 32);
+        int c = simRandom.range(0, 255);
+        ip = IPAddress(172, b, c, simRandom.range(1, 255));
+      }
+      break;
+  }
+  return ip;
+}
+
+/**
+ * @brief Open the session store; a role with simulated addresses draws its instance id on first boot
+ * @return Instance id for the MQTT client id, 0 for a role with real addresses
+ */
+uint32_t restoreSessionStore() {
+  sessionStoreReady = sessionStore.begin("mqtt", false);
+  if (sessionStoreReady) {
+    sessionStore.getBytes("fills", sessionFillsTopic, sizeof(sessionFillsTopic) - 1);
+  }
+  if constexpr (!Role::SIMULATED_ADDRESSES) {
+    return 0;
+  }
+
+  uint32_t instance = sessionStoreReady ? sessionStore.getUInt("instance", 0) : 0;
+  if (instance == 0) {
+    instance = esp_random() | 1;
+    if (sessionStoreReady) sessionStore.putUInt("instance", instance);
+  }
+  return instance;
+}
+
+/**
+ * @brief Pick the MAC and IP this instance publishes (after WiFi is up and the stream is seeded)
+ */
+void initializeDeviceAddresses() {
+  if constexpr (Role::SIMULATED_ADDRESSES) {
+    deviceMacAddress = generateRandomMacAddress();
+    deviceIPAddress = generateRandomIPAddress();
+    Serial.printf("🎲 Generated Random Addresses:\n");
+  } else {
+    deviceMacAddress = WiFi.macAddress();
+    deviceIPAddress = WiFi.localIP();
+  }
+
+  Serial.printf("   MAC: %s\n", deviceMacAddress.c_str());
+  Serial.printf("   IP: %d.%d.%d.%d\n",
+                deviceIPAddress[0], deviceIPAddress[1],
+                deviceIPAddress[2], deviceIPAddress[3]);
+
+  // "<role id>-<hardware mac without colons>[-<instance>]": the broker keeps the session under
+  // this id, so it must survive a reboot even when the published MAC is simulated (and new each
+  // boot), and simulated instances on one board (or simulator) each need their own
+  uint32_t instance = restoreSessionStore();
+  String hardwareMac = WiFi.macAddress();
+  size_t length = snprintf(mqttClientId, sizeof(mqttClientId), "%s-", MQTT_CLIENT_ID);
+  for (const char* c = hardwareMac.c_str(); *c && length + 1 < sizeof(mqttClientId); c++) {
+    if (*c != ':') mqttClientId[length++] = *c;
+  }
+  mqttClientId[length] = '\0';
+  if (instance != 0) {
+    snprintf(mqttClientId + length, sizeof(mqttClientId) - length, "-%08lx", (unsigned long)instance);
+  }
+  Serial.printf("   MQTT client: %s\n", mqttClientId);
+}
+
+/**
+ * @brief Journal a credit movement; balances on flash follow the RAM values
+ * @param durable Commit now instead of with the next group
+ */
+void journalCredits(LedgerAccount from, LedgerAccount to, float amount, bool durable) {
+  if (!ledgerReady) {
+    return;
+  }
+  ledger.transfer(from, to, ledgerAmount(amount), millis());
+  if (durable && !ledger.commit()) {
+    Serial.println("❌ Ledger commit failed - will retry");
+  }
+}
+
+/**
+ * @brief Mount LittleFS and restore credit balances from the ledger
+ */
+void restoreCreditsFromLedger() {
+  if (!LittleFS.begin(true) || !ledger.recover()) {
+    Serial.println("❌ Credit ledger unavailable - balances will not survive a reboot");
+    return;
+  }
+  ledgerReady = true;
+
+  if constexpr (IS_BURNER) {
+    if (ledger.sequence() == 0) {
+      // First boot: record the starting balance
+      journalCredits(LEDGER_EXTERNAL, LEDGER_AVAILABLE, availableCredits, true);
+    }
+
+    availableCredits = ledger.credits(LEDGER_AVAILABLE);
+    creditsBurned = ledger.credits(LEDGER_BURNED);
+    creditSpend = -ledger.credits(LEDGER_CASH);
+    Serial.printf("📒 Ledger restored at entry %llu (%lu replayed): available %.1f, burned %.1f\n",
+                  (unsigned long long)ledger.sequence(), (unsigned long)ledger.stats().replayed,
+                  availableCredits, creditsBurned);
+  } else {
+    creditsForSale = ledger.credits(LEDGER_FOR_SALE);
+    creditsListed = ledger.credits(LEDGER_LISTED);
+    creditsSold = ledger.credits(LEDGER_SOLD);
+    creditEarnings = ledger.credits(LEDGER_CASH);
+    Serial.printf("📒 Ledger restored at entry %llu (%lu replayed): for sale %.1f, listed %.1f, sold %.1f\n",
+                  (unsigned long long)ledger.sequence(), (unsigned long)ledger.stats().replayed,
+                  creditsForSale, creditsListed, creditsSold);
+  }
+}
+
+/**
+ * @brief Apply a fill of a buy order to the credit balance (burner)
+ */
+void applyBuyFill(const MarketFill& fill) {
+  if (fill.status == FILL_REJECTED) {
+    Serial.printf("❌ Buy order %lu rejected by marketplace\n", (unsigned long)fill.id);
+    if (fill.id == pendingOrderId) pendingOrderId = 0;
+    return;
+  }
+
+  float credits = marketCredits(fill.quantity);
+  float price = marketPriceValue(fill.price);
+  availableCredits += credits;
+  creditsPurchased += credits;
+  creditSpend += credits * price;
+  journalCredits(LEDGER_EXTERNAL, LEDGER_AVAILABLE, credits, false);
+  journalCredits(LEDGER_CASH, LEDGER_EXTERNAL, credits * price, true);
+  if (fill.status == FILL_COMPLETE && fill.id == pendingOrderId) pendingOrderId = 0;
+  pipeline.raise(EVENT_CREDITS);
+
+  Serial.printf("🤝 BOUGHT %.1f credits @ %.2f (order %lu, %.1f left). Total: %.1f\n",
+                credits, price, (unsigned long)fill.id, marketCredits(fill.remaining), availableCredits);
+}
+
+/**
+ * @brief Book a fill of a sell order against listed credits (creator)
+ */
+void applySellFill(const MarketFill& fill) {
+  if (fill.status == FILL_REJECTED) {
+    // Nothing traded, the lot goes back up for sale
+    float credits = min(marketCredits(fill.remaining), creditsListed);
+    creditsListed -= credits;
+    creditsForSale += credits;
+    journalCredits(LEDGER_LISTED, LEDGER_FOR_SALE, credits, true);
+    pipeline.raise(EVENT_CREDITS);
+    Serial.printf("❌ Sell order %lu rejected by marketplace\n", (unsigned long)fill.id);
+    return;
+  }
+
+  float credits = marketCredits(fill.quantity);
+  float price = marketPriceValue(fill.price);
+  creditsListed = max(0.0f, creditsListed - credits);
+  creditsSold += credits;
+  creditEarnings += credits * price;
+  journalCredits(LEDGER_LISTED, LEDGER_SOLD, credits, false);
+  journalCredits(LEDGER_EXTERNAL, LEDGER_CASH, credits * price, true);
+  pipeline.raise(EVENT_CREDITS);
+
+  Serial.printf("🤝 SOLD %.1f credits @ %.2f (order %lu, %.1f left). Sold: %.1f Earned: %.2f\n",
+                credits, price, (unsigned long)fill.id, marketCredits(fill.remaining),
+                creditsSold, creditEarnings);
+}
+
+/**
+ * @brief Apply a fill from the marketplace to this role's balances
+ * @param payload Fill JSON, not null-terminated
+ * @param length The length of the payload
+ */
+void handleMarketFill(const char* payload, unsigned int length) {
+  MarketFill fill;
+  if (!parseMarketFill(payload, length, fill)) {
+    Serial.println("❌ Unreadable market fill");
+    return;
+  }
+
+  if constexpr (IS_BURNER) {
+    applyBuyFill(fill);
+  } else {
+    applySellFill(fill);
+  }
+}
+
+/**
+ * @brief Publish to <prefix>/<API_KEY>/<channel>, falling back to <prefix>/<channel>
+ * @return true if either publish went out
+ */
+bool publishWithFallback(const char* channel, const char* payload, int payloadLen) {
+  char topic[100];
+  snprintf(topic, sizeof(topic), "%s/%s/%s", MQTT_TOPIC_PREFIX, API_KEY, channel);
+
+  bool result = mqttClient.publish(topic, (const uint8_t*)payload, payloadLen, false);
+
+  // Fallback to simple topic if complex topic fails
+  if (!result) {
+    char simpleTopic[50];
+    snprintf(simpleTopic, sizeof(simpleTopic), "%s/%s", MQTT_TOPIC_PREFIX, channel);
+    result = mqttClient.publish(simpleTopic, (const uint8_t*)payload, payloadLen, false);
+    Serial.printf("🔄 %s fallback result: %s\n", channel, result ? "SUCCESS" : "FAILED");
+  }
+  if (result) {
+    lastMqttActivity = millis();
+  }
+  return result;
+}
+
+/**
+ * @brief Run a command from the backend and answer on command_replies
+ * @param payload Command JSON, not null-terminated; parsed where it lies
+ * @param length The length of the payload
+ */
+void handleCommand(const char* payload, unsigned int length) {
+  DeviceCommand command;
+  bool accepted = parseDeviceCommand(payload, length, settings, command);
+  if (!commandTargets(command, deviceMacAddress.c_str())) {
+    return;
+  }
+
+  if (accepted && command.type == COMMAND_RESET) {
+    command.settings = defaultSettings();
+    command.changed = countChangedSettings(command.settings, settings);
+  }
+  if (accepted && command.type != COMMAND_GET && command.changed > 0) {
+    applySettings(command.settings);
+  }
+
+  char reply[512];
+  int replyLen = formatCommandReply(reply, sizeof(reply), command, deviceMacAddress.c_str(), accepted, settings);
+  if (replyLen >= (int)sizeof(reply)) {
+    Serial.println("❌ Command reply too large - truncated");
+    return;
+  }
+
+  if (accepted) {
+    Serial.printf("⚙️ Command %lu (%s): %lu settings changed\n", (unsigned long)command.id,
+                  command.type == COMMAND_GET ? "get" : command.type == COMMAND_SET ? "set" : "reset",
+                  (unsigned long)command.changed);
+  } else {
+    Serial.printf("❌ Command %lu rejected: %s\n", (unsigned long)command.id, command.error);
+  }
+  if (!publishWithFallback("command_replies", reply, replyLen)) {
+    Serial.printf("❌ Command reply publish failed. State: %d\n", mqttClient.state());
+  }
+}
+
+/**
+ * @brief Callback function for MQTT messages
+ * @param topic The topic the message was received on
+ * @param payload The message payload, valid only during the call
+ * @param length The length of the payload
+ */
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  if (fillsTopic[0] && strcmp(topic, fillsTopic) == 0) {
+    handleMarketFill((const char*)payload, length);
+    return;
+  }
+  if (commandsTopic[0] && strcmp(topic, commandsTopic) == 0) {
+    handleCommand((const char*)payload, length);
+    return;
+  }
+
+  Serial.printf("Message arrived [%s] %u bytes\n", topic, length);
+}
+
+/**
+ * @brief Subscribe the fills of this boot's MAC; the session remembers it, so drop the old one
+ */
+void subscribeFills() {
+  if (sessionFillsTopic[0] && strcmp(sessionFillsTopic, fillsTopic) != 0) {
+    mqttClient.unsubscribe(sessionFillsTopic);
+  }
+  if (!mqttClient.subscribe(fillsTopic, 1)) {
+    return;
+  }
+  Serial.printf("📡 Subscribed to: %s\n", fillsTopic);
+
+  if (strcmp(sessionFillsTopic, fillsTopic) != 0) {
+    snprintf(sessionFillsTopic, sizeof(sessionFillsTopic), "%s", fillsTopic);
+    if (sessionStoreReady) sessionStore.putBytes("fills", sessionFillsTopic, strlen(sessionFillsTopic));
+  }
+}
+
+/**
+ * @brief Connect to MQTT broker
+ * @return true if connection successful, false otherwise
+ */
+bool connectToMqtt() {
+  if (mqttClient.connected()) {
+    return true;
+  }
+
+  Serial.printf("Attempting MQTT connection to %s:%d...", MQTT_SERVER, MQTT_PORT);
+
+  // Set keep alive and timeout
+  mqttClient.setKeepAlive(MQTT_KEEPALIVE_S);
+
+  // Clean session off (no will): the broker resumes the session on the next connect
+  if (mqttClient.connect(mqttClientId, MQTT_USERNAME, MQTT_PASSWORD, nullptr, 0, false, nullptr, false)) {
+    Serial.println(" ✅ CONNECTED");
+    mqttConnected = true;
+    lastMqttActivity = millis();
+    pipeline.raise(EVENT_CONNECTION);
+
+    // Settings commands for every device of the API key, fills for this device's market orders
+    snprintf(commandsTopic, sizeof(commandsTopic), "%s/%s/commands", MQTT_TOPIC_PREFIX, API_KEY);
+    if (useCreditMarket) {
+      snprintf(fillsTopic, sizeof(fillsTopic), "%s/%s/fills/%s", MARKET_TOPIC_PREFIX, API_KEY, deviceMacAddress.c_str());
+    }
+
+    // A resumed session is still subscribed, and whatever was queued arrives on its own; only
+    // the fills topic moves, with a simulated MAC that is new after a reboot
+    if (espClient.sessionPresent()) {
+      mqttSessionsResumed++;
+      Serial.printf("♻️ Session resumed, subscriptions kept (%lu resumes)\n", (unsigned long)mqttSessionsResumed);
+      if (useCreditMarket && strcmp(fillsTopic, sessionFillsTopic) != 0) {
+        subscribeFills();
+      }
+      return true;
+    }
+
+    // Subscribe to topics with API key, QoS 1 so the broker holds them while we are away
+    mqttClient.subscribe(commandsTopic, 1);
+    Serial.printf("📡 Subscribed to: %s\n", commandsTopic);
+
+    if (useCreditMarket) {
+      subscribeFills();
+    }
+
+    return true;
+  } else {
+    Serial.printf(" ❌ FAILED, rc=%d\n", mqttClient.state());
+    mqttConnected = false;
+
+    // Print detailed error information
+    switch (mqttClient.state()) {
+      case -4: Serial.println("  Error: Connection timeout"); break;
+      case -3: Serial.println("  Error: Connection lost"); break;
+      case -2: Serial.println("  Error: Connect failed"); break;
+      case -1: Serial.println("  Error: Disconnected"); break;
+      case 1: Serial.println("  Error: Bad protocol"); break;
+      case 2: Serial.println("  Error: Bad client ID"); break;
+      case 3: Serial.println("  Error: Unavailable"); break;
+      case 4: Serial.println("  Error: Bad credentials"); break;
+      case 5: Serial.println("  Error: Unauthorized"); break;
+      default: Serial.printf("  Error: Unknown state %d\n", mqttClient.state()); break;
+    }
+
+    return false;
+  }
+}
+
+/**
+ * @brief Append quantile sketches of the readings being aggregated
+ * @param out Position in the payload to write at
+ * @param size Space left in the payload
+ * @return Number of characters appended (snprintf semantics), 0 if skipped
+ */
+int appendQuantileSketches(char* out, size_t size) {
+  SparseSketch co2Sketch, humiditySketch;
+  for (int i = 0; i < readingsCount; i++) {
+    co2Sketch.add(co2Readings[i]);
+    humiditySketch.add(humidityReadings[i]);
+  }
+
+  char co2Text[128], humidityText[128];
+  if (co2Sketch.encode(co2Text, sizeof(co2Text)) < 0 ||
+      humiditySketch.encode(humidityText, sizeof(humidityText)) < 0) {
+    Serial.println("❌ Quantile sketch too large - skipping");
+    return 0;
+  }
+
+  return snprintf(out, size, ",\"q_c\":%s,\"q_h\":%s", co2Text, humidityText);
+}
+
+/**
+ * @brief Keep a window for the next batch, dropping the oldest ones if the backlog is full
+ */
+void backlogWindow(const char* payload, int payloadLen) {
+  if ((size_t)payloadLen + 1 > WINDOW_BACKLOG_BYTES) return;
+  while (windowBacklogLength + payloadLen + 1 > WINDOW_BACKLOG_BYTES) {
+    const char* newline = (const char*)memchr(windowBacklog, '\n', windowBacklogLength);
+    size_t oldest = newline - windowBacklog + 1;
+    memmove(windowBacklog, windowBacklog + oldest, windowBacklogLength - oldest);
+    windowBacklogLength -= oldest;
+    windowBacklogCount--;
+    backlogWindowsDropped++;
+  }
+  memcpy(windowBacklog + windowBacklogLength, payload, payloadLen);
+  windowBacklogLength += payloadLen;
+  windowBacklog[windowBacklogLength++] = '\n';
+  windowBacklogCount++;
+}
+
+/**
+ * @brief Bytes taken by the first count windows of the backlog
+ */
+size_t backlogPrefix(uint16_t count) {
+  size_t length = 0;
+  for (uint16_t i = 0; i < count && length < windowBacklogLength; i++) {
+    const char* newline = (const char*)memchr(windowBacklog + length, '\n', windowBacklogLength - length);
+    length = newline - windowBacklog + 1;
+  }
+  return length;
+}
+
+/**
+ * @brief Send the backlog as sensor_data batches, oldest windows first
+ * @return false if a publish failed; what is left stays queued
+ */
+bool flushWindowBacklog() {
+  while (windowBacklogCount > 0) {
+    // Uptime line, then as many whole windows as fit the batch text
+    int headerLength = snprintf(batchText, sizeof(batchText), "%llu\n", (unsigned long long)(monotonicUs() / 1000));
+    uint16_t count = 0;
+    size_t length = 0;
+    while (count < windowBacklogCount && count < settings.batchWindows) {
+      size_t next = backlogPrefix(count + 1);
+      if (headerLength + next > sizeof(batchText)) break;
+      length = next;
+      count++;
+    }
+
+    // Fewer windows until the frame fits one MQTT packet
+    size_t framedLen = 0;
+    while (count > 0) {
+      memcpy(batchText + headerLength, windowBacklog, length);
+      uint8_t flags = PAYLOAD_BATCH | (settings.compress ? PAYLOAD_LZSS : 0);
+      framedLen = encodePayload(batchText, headerLength + length, flags, framedPayload, sizeof(framedPayload),
+                                payloadCodecWork);
+      if (framedLen > 0 || count == 1) break;
+      count = (count + 1) / 2;
+      length = backlogPrefix(count);
+    }
+    if (framedLen == 0) {
+      // A single window too large to frame; cannot happen with MAX_FRAMED_PAYLOAD above the payload size
+      length = backlogPrefix(1);
+    } else {
+      if (!publishWithFallback("sensor_data", (const char*)framedPayload, framedLen)) return false;
+      Serial.printf("📦 Sent %u backlog windows: %u bytes of JSON as %u\n",
+                    count, (unsigned)(headerLength + length), (unsigned)framedLen);
+    }
+    memmove(windowBacklog, windowBacklog + length, windowBacklogLength - length);
+    windowBacklogLength -= length;
+    windowBacklogCount -= count ? count : 1;
+  }
+  return true;
+}
+
+/**
+ * @brief Publish the readings aggregated since the last window to MQTT
+ *
+ * While MQTT is down the window goes to the backlog instead, which is sent
+ * ahead of the next window published.
+ */
+void publishAggregatedDataToMqtt() {
+  if (readingsCount == 0) {
+    Serial.println("❌ No readings to aggregate, skipping publish");
+    return;
+  }
+
+  // Calculate aggregated statistics
+  float avgCO2 = 0, avgHumidity = 0;
+  int maxCO2 = 0, minCO2 = 9999;
+  int maxHumidity = 0, minHumidity = 9999;
+
+  for (int i = 0; i < readingsCount; i++) {
+    avgCO2 += co2Readings[i];
+    avgHumidity += humidityReadings[i];
+    maxCO2 = max(maxCO2, co2Readings[i]);
+    minCO2 = min(minCO2, co2Readings[i]);
+    maxHumidity = max(maxHumidity, humidityReadings[i]);
+    minHumidity = min(minHumidity, humidityReadings[i]);
+  }
+
+  avgCO2 /= readingsCount;
+  avgHumidity /= readingsCount;
+
+  // Deadband: nothing worth a window moved since the last one sent (no seq is used up)
+  unsigned long now = millis();
+  bool deadbandOn = settings.co2DeadbandPpm > 0 || settings.humidityDeadband > 0;
+  if (deadbandOn && windowSent && now - lastWindowMs < settings.deadbandMaxMs &&
+      (settings.co2DeadbandPpm == 0 || fabsf(avgCO2 - lastWindowCo2) < settings.co2DeadbandPpm) &&
+      (settings.humidityDeadband == 0 || fabsf(avgHumidity - lastWindowHumidity) < settings.humidityDeadband)) {
+    windowsSkipped++;
+    Serial.printf("🔇 Window within deadband - skipped (%lu so far)\n", (unsigned long)windowsSkipped);
+    readingsCount = 0;
+    return;
+  }
+  windowSent = true;
+  lastWindowCo2 = avgCO2;
+  lastWindowHumidity = avgHumidity;
+  lastWindowMs = now;
+
+  IPAddress ip = deviceIPAddress;
+
+  // Create comprehensive JSON payload with larger buffer
+  char payload[768];
+  int payloadLen = snprintf(payload, sizeof(payload),
+    "{\"ip\":\"%d.%d.%d.%d\",\"mac\":\"%s\",\"avg_c\":%.1f,\"max_c\":%d,\"min_c\":%d,\"avg_h\":%.1f,\"max_h\":%d,\"min_h\":%d,\"cr\":%.1f,\"e\":%.1f,\"o\":%s,\"t\":%llu,\"ts\":%d,\"seq\":%lu,\"type\":\"%s\",\"samples\":%d",
+    ip[0], ip[1], ip[2], ip[3], deviceMacAddress.c_str(),
+    avgCO2, maxCO2, minCO2, avgHumidity, maxHumidity, minHumidity,
+    carbonCredits, emissions, offset ? "true" : "false", (unsigned long long)payloadTimeMs(), wallClock.synced(),
+    (unsigned long)nextMessageSequence(), Role::PAYLOAD_TYPE, readingsCount);
+
+  // Burners also report the balance they offset from
+  if constexpr (IS_BURNER) {
+    if (payloadLen < (int)sizeof(payload)) {
+      payloadLen += snprintf(payload + payloadLen, sizeof(payload) - payloadLen, ",\"credits_avail\":%.1f", availableCredits);
+    }
+  }
+
+  // Optional fleet percentile support, then close the object
+  if (settings.sketches && payloadLen < (int)sizeof(payload)) {
+    payloadLen += appendQuantileSketches(payload + payloadLen, sizeof(payload) - payloadLen);
+  }
+  if (payloadLen < (int)sizeof(payload)) {
+    payloadLen += snprintf(payload + payloadLen, sizeof(payload) - payloadLen, "}");
+  }
+
+  // Check if payload was truncated
+  if (payloadLen >= (int)sizeof(payload) - 1) {
+    Serial.println("❌ Payload too large - truncated");
+    return;
+  }
+
+  // Offline: the window waits in the backlog, a new one starts
+  if (!mqttClient.connected() || !mqttConnected || !flushWindowBacklog()) {
+    backlogWindow(payload, payloadLen);
+    Serial.printf("📥 MQTT not connected - window kept for later (%u in backlog, %lu dropped)\n",
+                  windowBacklogCount, (unsigned long)backlogWindowsDropped);
+    readingsCount = 0;
+    return;
+  }
+
+  // Publish to topic with API key
+  char topic[100];
+  snprintf(topic, sizeof(topic), "%s/%s/sensor_data", MQTT_TOPIC_PREFIX, API_KEY);
+
+  // Compressed only when it comes out shorter than the JSON
+  const uint8_t* body = (const uint8_t*)payload;
+  size_t bodyLen = payloadLen;
+  if (settings.compress) {
+    size_t framedLen = encodePayload(payload, payloadLen, PAYLOAD_LZSS, framedPayload, sizeof(framedPayload),
+                                     payloadCodecWork);
+    if (framedLen > 0 && framedLen < bodyLen) {
+      body = framedPayload;
+      bodyLen = framedLen;
+    }
+  }
+
+  Serial.printf("📤 Publishing to topic: %s\n", topic);
+  Serial.printf("📤 Payload length: %d (%u on the wire)\n", payloadLen, (unsigned)bodyLen);
+
+  bool result = mqttClient.publish(topic, body, bodyLen, false);
+
+  if (result) {
+    Serial.printf("📊 Published aggregated data to MQTT topic: %s (samples: %d)\n", topic, readingsCount);
+  } else {
+    Serial.printf("❌ MQTT aggregated publish failed - State: %d\n", mqttClient.state());
+    backlogWindow(payload, payloadLen);
+  }
+  readingsCount = 0; // Reset for next aggregation
+}
+
+/**
+ * @brief Send critical alert for dangerous conditions
+ */
+void sendCriticalAlert(const char* alertType, const char* message) {
+  if (!mqttClient.connected()) {
+    Serial.println("❌ MQTT not connected, skipping critical alert");
+    return;
+  }
+
+  IPAddress ip = deviceIPAddress;
+
+  char payload[500];
+  int payloadLen = snprintf(payload, sizeof(payload),
+    "{\"ip\":\"%d.%d.%d.%d\",\"mac\":\"%s\",\"alert_type\":\"%s\",\"message\":\"%s\",\"co2\":%d,\"credits\":%.1f,\"t\":%llu,\"ts\":%d,\"seq\":%lu,\"type\":\"alert\"}",
+    ip[0], ip[1], ip[2], ip[3], deviceMacAddress.c_str(),
+    alertType, message, co2Reading, alertCredits(), (unsigned long long)payloadTimeMs(), wallClock.synced(),
+    (unsigned long)nextMessageSequence());
+
+  // Check if payload was truncated
+  if (payloadLen >= (int)sizeof(payload) - 1) {
+    Serial.println("❌ Alert payload too large - truncated");
+    return;
+  }
+
+  Serial.printf("🚨 Sending critical alert: %s\n", alertType);
+
+  if (publishWithFallback("alerts", payload, payloadLen)) {
+    Serial.printf("✅ CRITICAL ALERT sent: %s - %s\n", alertType, message);
+  } else {
+    Serial.printf("❌ Critical alert publish failed. State: %d\n", mqttClient.state());
+  }
+}
+
+/**
+ * @brief Send heartbeat status every 5 minutes
+ */
+void sendHeartbeat() {
+  if (!mqttClient.connected()) {
+    Serial.println("❌ MQTT not connected, skipping heartbeat");
+    return;
+  }
+
+  IPAddress ip = deviceIPAddress;
+
+  // Share of uptime spent waiting for deadlines, and how late the wakes came
+  float asleepPercent = millis() ? sleepStats.asleepMs * 100.0f / millis() : 0;
+
+  char payload[400];
+  int payloadLen = snprintf(payload, sizeof(payload),
+    "{\"ip\":\"%d.%d.%d.%d\",\"mac\":\"%s\",\"status\":\"online\",\"uptime\":%llu,\"rssi\":%d,"
+    "\"power\":%d,\"asleep_pct\":%.1f,\"sleeps\":%lu,\"wake_us\":%lu,\"wake_us_max\":%lu,"
+    "\"drift_ppm\":%.1f,\"clock_steps\":%lu,\"resumes\":%lu,\"skipped\":%lu,\"t\":%llu,\"ts\":%d,\"seq\":%lu,\"type\":\"heartbeat\"}",
+    ip[0], ip[1], ip[2], ip[3], deviceMacAddress.c_str(),
+    (unsigned long long)(monotonicUs() / 1000), WiFi.RSSI(), (int)powerMode, asleepPercent,
+    (unsigned long)sleepStats.sleeps, (unsigned long)sleepStats.meanWakeLatencyUs(),
+    (unsigned long)sleepStats.maxWakeLatencyUs, wallClock.driftPpm(), (unsigned long)wallClock.stats().steps,
+    (unsigned long)mqttSessionsResumed, (unsigned long)windowsSkipped, (unsigned long long)payloadTimeMs(), wallClock.synced(), (unsigned long)nextMessageSequence());
+
+  // Check if payload was truncated
+  if (payloadLen >= (int)sizeof(payload) - 1) {
+    Serial.println("❌ Heartbeat payload too large - truncated");
+    return;
+  }
+
+  Serial.printf("💓 Sending heartbeat (asleep %.1f%%, wake latency %lu us mean / %lu us max)\n",
+                asleepPercent, (unsigned long)sleepStats.meanWakeLatencyUs(),
+                (unsigned long)sleepStats.maxWakeLatencyUs);
+
+  if (publishWithFallback("heartbeat", payload, payloadLen)) {
+    Serial.println("✅ Heartbeat sent");
+  } else {
+    Serial.printf("❌ Heartbeat publish failed. State: %d\n", mqttClient.state());
+  }
+}
+
+/**
+ * @brief ADC frame-done interrupt: wake the filter task
+ */
+void ARDUINO_ISR_ATTR onAdcFrame() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(adcTaskHandle, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief Filter every ADC frame and queue the decimated readings in ppm and %RH
+ */
+void adcFilterTask(void* parameter) {
+  AdcReading reading = {0, 0};
+  bool co2Ready = false, humidityReady = false;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    adc_continuous_data_t* frame = nullptr;
+    if (!analogContinuousRead(&frame, 0)) {
+      continue;
+    }
+
+    for (int i = 0; i < 2; i++) {
+      uint16_t raw = (uint16_t)frame[i].avg_read_raw;
+      if (frame[i].pin == CO2_PIN) {
+        co2Ready |= co2Chain.push(raw, reading.co2);
+      } else if (frame[i].pin == HUMIDITY_PIN) {
+        humidityReady |= humidityChain.push(raw, reading.humidity);
+      }
+    }
+
+    // Both chains decimate alike, so their outputs land on the same frame
+    if (co2Ready && humidityReady) {
+      reading.humidity = humidityCalibration.percent(humidityChain.lastCode());
+      mq135.setEnvironment(ambientTemperatureC, reading.humidity);
+      reading.co2 = mq135.ppm(co2Chain.lastCode());
+      xQueueSend(adcReadings, &reading, 0);
+      co2Ready = humidityReady = false;
+    }
+  }
+}
+
+/**
+ * @brief Start continuous sampling of CO2_PIN and HUMIDITY_PIN
+ * @return false if the ADC could not be started (simulated readings are used instead)
+ */
+bool startAdcSensors() {
+  SignalChainConfig config;
+  config.cicDecimation = ADC_FRAME_RATE_HZ * settings.sampleMs / 1000 / ADC_FIR_DECIMATION;
+  config.firDecimation = ADC_FIR_DECIMATION;
+  co2Chain = SignalChain(config);
+  humidityChain = SignalChain(config);
+  humidityCalibration.setTemperature(ambientTemperatureC);
+
+  adcReadings = xQueueCreate(4, sizeof(AdcReading));
+  xTaskCreatePinnedToCore(adcFilterTask, "adc_filter", 3072, nullptr, 5, &adcTaskHandle, 0);
+
+  const uint8_t pins[] = {CO2_PIN, HUMIDITY_PIN};
+  analogContinuousSetWidth(SIGNAL_INPUT_BITS);
+  analogContinuousSetAtten(ADC_11db);
+  if (!analogContinuous(pins, 2, ADC_CONVERSIONS_PER_PIN, ADC_SAMPLE_RATE_HZ, onAdcFrame) ||
+      !analogContinuousStart()) {
+    Serial.println("❌ ADC continuous mode failed - using simulated readings");
+    return false;
+  }
+
+  Serial.printf("📈 ADC sampling %lu frames/s per pin, one reading every %lu ms\n",
+                (unsigned long)ADC_FRAME_RATE_HZ, (unsigned long)settings.sampleMs);
+  return true;
+}
+
+/**
+ * @brief Take the next decimated ADC reading, if the filter task queued one
+ */
+void readAdcSensors() {
+  AdcReading reading;
+  if (xQueueReceive(adcReadings, &reading, 0) != pdTRUE) {
+    return;
+  }
+  co2Reading = reading.co2;
+  humidityReading = reading.humidity;
+  pipeline.raise(EVENT_SAMPLE);
+}
+
+/**
+ * @brief Take a new sample every settings.sampleMs
+ */
+void generateSensorData() {
+  unsigned long currentTime = millis();
+
+  if (currentTime - lastDataUpdate >= settings.sampleMs) {
+    lastDataUpdate = currentTime;
+
+    int co2 = 0, humidity = 0;
+    bool valid = true;
+    if (useScenario) {
+      valid = scenario.sample(SCENARIO_CLOCK_OFFSET_MS + currentTime, co2, humidity);
+    } else {
+      co2 = simRandom.range(Role::CO2_MIN, Role::CO2_MAX + 1);
+      humidity = simRandom.range(Role::HUMIDITY_MIN, Role::HUMIDITY_MAX + 1);
+    }
+
+    // During an outage the sensor doesn't answer: no sample, nothing downstream runs
+    if (!valid) {
+      if (!sensorOutage) Serial.println("⚠️ Sensor not responding (scenario outage)");
+      sensorOutage = true;
+      return;
+    }
+    if (sensorOutage) Serial.println("✅ Sensor responding again");
+    sensorOutage = false;
+
+    co2Reading = co2;
+    humidityReading = humidity;
+    pipeline.raise(EVENT_SAMPLE);
+  }
+}
+
+/**
+ * @brief Derive credits, emissions and offset from the new sample
+ */
+void deriveMetrics() {
+  carbonCredits = co2Reading * Role::CREDIT_MULTIPLIER;
+  emissions = humidityReading * Role::EMISSION_MULTIPLIER;
+
+  if constexpr (IS_BURNER) {
+    // Credits needed are covered by the available balance
+    offset = (availableCredits >= carbonCredits);
+    Serial.printf("🔥 HIGH GAS EMISSION - CO2:%d Hum:%d Credits Needed:%.1f Available:%.1f Offset:%s\n",
+                  co2Reading, humidityReading, carbonCredits, availableCredits,
+                  offset ? "YES" : "NO");
+  } else {
+    offset = (carbonCredits >= emissions);
+
+    // Sequestration accrues real credits that can be sold to burners
+    if (useCreditMarket) {
+      creditsForSale += carbonCredits * CreatorTraits::CREDIT_ACCRUAL_RATE;
+      journalCredits(LEDGER_EXTERNAL, LEDGER_FOR_SALE, carbonCredits * CreatorTraits::CREDIT_ACCRUAL_RATE, false);
+      pipeline.raise(EVENT_CREDITS);
+    }
+
+    Serial.printf("🌱 CARBON SEQUESTRATION - CO2:%d Hum:%d Credits Generated:%.1f Offset:%s\n",
+                  co2Reading, humidityReading, carbonCredits,
+                  offset ? "YES" : "NO");
+  }
+}
+
+/**
+ * @brief Store the new sample for the next aggregated publish
+ */
+void aggregateReading() {
+  co2Readings[readingIndex] = co2Reading;
+  humidityReadings[readingIndex] = humidityReading;
+  readingIndex = (readingIndex + 1) % MAX_WINDOW_SAMPLES;
+  if (readingsCount < (int)MAX_WINDOW_SAMPLES) readingsCount++;
+}
+
+/**
+ * @brief Send critical alerts for the new sample or balance (with cooldown)
+ */
+void checkCriticalAlerts() {
+  unsigned long currentTime = millis();
+  if (currentTime - lastCriticalAlert < settings.alertCooldownMs) {
+    return;
+  }
+
+  if (co2Reading > (int)settings.co2AlertPpm) {
+    sendCriticalAlert("HIGH_CO2", Role::CO2_ALERT);
+    lastCriticalAlert = currentTime;
+  } else if (alertCredits() < (float)settings.creditsAlert / SETTINGS_CREDITS_SCALE) {
+    sendCriticalAlert("LOW_CREDITS", Role::CREDITS_ALERT);
+    lastCriticalAlert = currentTime;
+  }
+}
+
+/**
+ * @brief Update OLED display with current sensor data
+ */
+void updateOLEDDisplay() {
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+
+  // Title
+  display.setCursor(0, 0);
+  display.println(Role::NAME);
+
+  // CO2 reading
+  display.setCursor(0, 12);
+  display.print("CO2: ");
+  display.print(co2Reading);
+  display.println(" ppm");
+
+  // Humidity reading
+  display.setCursor(0, 24);
+  display.print("Humidity: ");
+  display.print(humidityReading);
+  display.println("%");
+
+  // Burner: credits available / needed, creator: credits generated
+  display.setCursor(0, 36);
+  display.print("Credits: ");
+  if constexpr (IS_BURNER) {
+    display.print(availableCredits, 1);
+    display.print("/");
+  }
+  display.print(carbonCredits, 1);
+
+  // Offset status
+  display.setCursor(0, 48);
+  display.print("Offset: ");
+  display.println(offset ? "YES" : "NO");
+
+  // MQTT status
+  display.setCursor(0, 56);
+  display.print("MQTT: ");
+  display.println(mqttConnected ? "OK" : "ERR");
+
+  display.display();
+}
+
+/**
+ * @brief Send a buy order for CREDIT_PURCHASE_AMOUNT to the marketplace (burner)
+ * @param orderId Id to use; resending the same id never buys twice
+ * @return true if the order was published
+ */
+bool sendBuyOrder(uint32_t orderId) {
+  if (!mqttClient.connected() || !mqttConnected) {
+    return false;
+  }
+
+  MarketOrder order;
+  order.id = orderId;
+  snprintf(order.mac, sizeof(order.mac), "%s", deviceMacAddress.c_str());
+  order.side = MARKET_BUY;
+  order.quantity = marketQuantity(BurnerTraits::CREDIT_PURCHASE_AMOUNT);
+  order.price = marketPrice(BurnerTraits::CREDIT_BID_PRICE);
+
+  char payload[160];
+  int payloadLen = formatMarketOrder(payload, sizeof(payload), order);
+
+  char topic[100];
+  snprintf(topic, sizeof(topic), "%s/%s/orders", MARKET_TOPIC_PREFIX, API_KEY);
+
+  bool result = mqttClient.publish(topic, (const uint8_t*)payload, payloadLen, false);
+  if (result) {
+    Serial.printf("🛒 Buy order %lu sent: %.1f credits @ <= %.2f\n",
+                  (unsigned long)orderId, BurnerTraits::CREDIT_PURCHASE_AMOUNT, BurnerTraits::CREDIT_BID_PRICE);
+  } else {
+    Serial.printf("❌ Buy order publish failed - State: %d\n", mqttClient.state());
+  }
+  return result;
+}
+
+/**
+ * @brief Automatically purchase credits when running low (burner)
+ */
+void autoPurchaseCredits() {
+  if (!autoPurchaseEnabled || availableCredits >= BurnerTraits::CREDIT_PURCHASE_THRESHOLD) {
+    return;
+  }
+
+  if (!useCreditMarket) {
+    Serial.println("🛒 AUTO-PURCHASING CREDITS!");
+    availableCredits += BurnerTraits::CREDIT_PURCHASE_AMOUNT;
+    journalCredits(LEDGER_EXTERNAL, LEDGER_AVAILABLE, BurnerTraits::CREDIT_PURCHASE_AMOUNT, true);
+    pipeline.raise(EVENT_CREDITS);
+    Serial.println("Purchased " + String(BurnerTraits::CREDIT_PURCHASE_AMOUNT) + " credits. Total: " + String(availableCredits));
+    return;
+  }
+
+  // One order at a time; credits arrive with the fills
+  unsigned long currentTime = millis();
+  if (pendingOrderId == 0) {
+    if (sendBuyOrder(nextOrderId)) {
+      pendingOrderId = nextOrderId++;
+      lastOrderSent = currentTime;
+    }
+  } else if (currentTime - lastOrderSent >= creditOrderTimeout) {
+    // No complete fill yet: resend in case the order or the marketplace was lost
+    if (sendBuyOrder(pendingOrderId)) {
+      lastOrderSent = currentTime;
+    }
+  }
+}
+
+/**
+ * @brief Burn credits to offset high emissions (burner)
+ */
+void burnCreditsForOffset() {
+  if (co2Reading > BurnerTraits::BURN_CO2_BASELINE && availableCredits > 0) { // Only burn for high emissions
+    float creditsToBurn = (co2Reading - BurnerTraits::BURN_CO2_BASELINE) * BurnerTraits::BURN_RATE;
+
+    if (creditsToBurn > availableCredits) {
+      creditsToBurn = availableCredits;
+    }
+
+    if (creditsToBurn > 0.01) {
+      availableCredits -= creditsToBurn;
+      creditsBurned += creditsToBurn;
+      journalCredits(LEDGER_AVAILABLE, LEDGER_BURNED, creditsToBurn, false);
+      pipeline.raise(EVENT_CREDITS);
+
+      Serial.println("🔥 BURNING CREDITS: " + String(creditsToBurn, 4) + " for CO2 offset");
+    }
+  }
+}
+
+/**
+ * @brief List accrued credits on the marketplace once a full lot is unsold (creator)
+ */
+void postCreditSupply() {
+  if (!useCreditMarket || creditsForSale < CreatorTraits::CREDIT_SELL_LOT) {
+    return;
+  }
+  if (!mqttClient.connected() || !mqttConnected) {
+    return; // Keep accruing until the broker is back
+  }
+
+  MarketOrder order;
+  order.id = nextOrderId;
+  snprintf(order.mac, sizeof(order.mac), "%s", deviceMacAddress.c_str());
+  order.side = MARKET_SELL;
+  order.quantity = marketQuantity(creditsForSale);
+  order.price = simRandom.range(CreatorTraits::CREDIT_ASK_MIN_CENTS, CreatorTraits::CREDIT_ASK_MAX_CENTS + 1);
+
+  char payload[160];
+  int payloadLen = formatMarketOrder(payload, sizeof(payload), order);
+
+  char topic[100];
+  snprintf(topic, sizeof(topic), "%s/%s/orders", MARKET_TOPIC_PREFIX, API_KEY);
+
+  if (mqttClient.publish(topic, (const uint8_t*)payload, payloadLen, false)) {
+    float credits = marketCredits(order.quantity);
+    creditsListed += credits;
+    creditsForSale -= credits;
+    journalCredits(LEDGER_FOR_SALE, LEDGER_LISTED, credits, true);
+    nextOrderId++;
+    Serial.printf("🏷️ Sell order %lu listed: %.1f credits @ %.2f\n",
+                  (unsigned long)order.id, credits, marketPriceValue(order.price));
+  } else {
+    Serial.printf("❌ Sell order publish failed - State: %d\n", mqttClient.state());
+  }
+}
+
+/**
+ * @brief Register the pipeline stages; the other role's credit stages are never referenced
+ */
+void registerStages() {
+  // Each stage runs only when an event it depends on was raised
+  pipeline.addStage("derive", EVENT_SAMPLE, deriveMetrics);
+  if constexpr (IS_BURNER) {
+    pipeline.addStage("burn", EVENT_SAMPLE, burnCreditsForOffset);
+    pipeline.addStage("purchase", EVENT_SAMPLE | EVENT_CREDITS, autoPurchaseCredits);
+    pipeline.addStage("alerts", EVENT_SAMPLE | EVENT_CREDITS, checkCriticalAlerts);
+  } else {
+    pipeline.addStage("supply", EVENT_CREDITS | EVENT_CONNECTION, postCreditSupply);
+    pipeline.addStage("alerts", EVENT_SAMPLE, checkCriticalAlerts);
+  }
+  pipeline.addStage("display", EVENT_SAMPLE | EVENT_CREDITS | EVENT_CONNECTION, updateOLEDDisplay);
+  pipeline.addStage("aggregate", EVENT_SAMPLE, aggregateReading);
+}
+
+/**
+ * @brief Enter the configured power mode once WiFi is up
+ */
+void configurePowerManagement() {
+  if (powerMode == POWER_ALWAYS_ON) {
+    return;
+  }
+
+  // Skip beacons the AP has nothing buffered for; the listen interval is sent
+  // at association, and the IDF default the AP already saw is also 3
+  wifi_config_t wifiConfig;
+  esp_wifi_get_config(WIFI_IF_STA, &wifiConfig);
+  wifiConfig.sta.listen_interval = WIFI_LISTEN_INTERVAL;
+  esp_wifi_set_config(WIFI_IF_STA, &wifiConfig);
+  esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+
+  // Scale the CPU down while the loop waits and, for light sleep, sleep in the idle task
+  esp_pm_config_t pmConfig = {};
+  pmConfig.max_freq_mhz = 240;
+  pmConfig.min_freq_mhz = 80;
+  pmConfig.light_sleep_enable = powerMode == POWER_LIGHT_SLEEP;
+  if (esp_pm_configure(&pmConfig) != ESP_OK) {
+    Serial.println("❌ Power management not available in this build - modem sleep only");
+    powerMode = POWER_MODEM_SLEEP;
+  }
+  Serial.printf("🔋 Power mode %d, listen interval %u\n", (int)powerMode, WIFI_LISTEN_INTERVAL);
+}
+
+/**
+ * @brief Register the loop's periodic deadlines for sleepUntilNextDeadline()
+ */
+void registerDeadlines() {
+  // ADC readings arrive through a queue, which ends the wait by itself
+  if (!useAdcSensors) {
+    wakeSchedule.add("sample", &lastDataUpdate, settings.sampleMs);
+  }
+  wakeSchedule.add("publish", &lastMqttPublish, settings.publishMs);
+  wakeSchedule.add("heartbeat", &lastHeartbeat, settings.heartbeatMs);
+  wakeSchedule.add("keepalive", &lastMqttActivity, mqttKeepaliveInterval);
+}
+
+/**
+ * @brief Wait until the next deadline; the radio and, with power management on, the CPU sleep meanwhile
+ */
+void sleepUntilNextDeadline() {
+  if (powerMode == POWER_ALWAYS_ON) {
+    delay(1000); // Faster update for better display experience
+    return;
+  }
+
+  unsigned long now = millis();
+  unsigned long waitMs = wakeSchedule.msUntilNext(now);
+  if (!mqttConnected) {
+    waitMs = min(waitMs, (unsigned long)mqttReconnect.msUntilAttempt(now));
+  }
+  if (waitMs == 0) {
+    return;
+  }
+
+  unsigned long start = micros();
+  if (useAdcSensors) {
+    AdcReading reading;
+    xQueuePeek(adcReadings, &reading, pdMS_TO_TICKS(waitMs));
+  } else {
+    delay(waitMs);
+  }
+  sleepStats.record(waitMs, micros() - start);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  // WiFi with Google DNS
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  Serial.print("Connecting to WiFi");
+
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(300);
+    Serial.print(".");
+  }
+
+  // CRITICAL: Set Google DNS to fix DNS resolution
+  WiFi.config(WiFi.localIP(), WiFi.gatewayIP(), WiFi.subnetMask(),
+              IPAddress(8, 8, 8, 8), IPAddress(8, 8, 4, 4));
+
+  Serial.println("\n✅ WiFi Connected!");
+  Serial.print("IP: "); Serial.println(WiFi.localIP());
+  Serial.print("DNS: "); Serial.println(WiFi.dnsIP());
+  configurePowerManagement();
+
+  // Wall clock and sequence before the first payload carries a "t" and "seq", settings before the deadlines
+  ntpUdp.begin(NTP_LOCAL_PORT);
+  syncClock();
+  restoreMessageSequence();
+  restoreSettings();
+
+  // Order ids and reconnect times must differ across reboots even on a fixed simulation seed
+  randomSeed(esp_random());
+  mqttReconnect = ReconnectPolicy(ReconnectConfig(), ((uint64_t)esp_random() << 32) | esp_random());
+  seedSimulation();
+
+  // Addresses before MQTT, the fills topic uses the MAC
+  initializeDeviceAddresses();
+  nextOrderId = random(1, 0x7FFFFFFF);
+
+  // Balances from flash before anything burns, buys, accrues or sells
+  restoreCreditsFromLedger();
+  loadScenario();
+  if (useAdcSensors) {
+    useAdcSensors = startAdcSensors();
+  }
+  registerStages();
+  registerDeadlines();
+
+  // MQTT setup
+  mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+  mqttClient.setCallback(mqttCallback);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE); // Increase buffer size for larger payloads
+
+  // Test MQTT connection
+  Serial.println("🔌 Testing MQTT connection...");
+  bool mqttUp = connectToMqtt();
+  mqttReconnect.attempted(millis(), mqttUp);
+  if (mqttUp) {
+    Serial.println("✅ MQTT connection test successful");
+  } else {
+    Serial.println("❌ MQTT connection test failed - will retry in loop");
+  }
+
+  // OLED setup
+  if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
+    Serial.println("❌ OLED failed");
+    for (;;);
+  }
+
+  // Initialize display
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+  display.setCursor(0, 0);
+  display.println(Role::NAME);
+  display.setCursor(0, 15);
+  display.println(Role::TAGLINE);
+  display.setCursor(0, 35);
+  display.println("Initializing...");
+  display.display();
+  delay(2000);
+
+  Serial.printf("✅ %s Setup Complete!\n", Role::NAME);
+  if constexpr (IS_BURNER) {
+    Serial.println("🔥 HIGH GAS EMISSION MODE ACTIVATED");
+  } else {
+    Serial.println("🌱 CARBON SEQUESTRATION MODE ACTIVATED");
+  }
+}
+
+void loop() {
+  // Handle MQTT connection with better debugging
+  if (!mqttClient.connected()) {
+    if (mqttConnected) {
+      pipeline.raise(EVENT_CONNECTION);
+      mqttReconnect.disconnected(millis());
+    }
+    mqttConnected = false;
+    if (mqttReconnect.due(millis())) {
+      Serial.printf("🔄 Attempting MQTT reconnection... (State: %d, failures: %u)\n",
+                    mqttClient.state(), mqttReconnect.failures());
+      bool connected = connectToMqtt();
+      mqttReconnect.attempted(millis(), connected);
+    }
+  } else {
+    mqttClient.loop();
+    // loop() pinged the broker if the keepalive lapsed
+    if (millis() - lastMqttActivity >= mqttKeepaliveInterval) {
+      lastMqttActivity = millis();
+    }
+    // Update connection status
+    if (!mqttConnected) {
+      mqttConnected = true;
+      pipeline.raise(EVENT_CONNECTION);
+      Serial.println("✅ MQTT connection restored");
+    }
+  }
+
+  // SNTP poll when due (at least every 17 min, the loop wakes every publish interval)
+  syncClock();
+
+  // Take a sample, then run the stages it (or a fill) woke up
+  if (useAdcSensors) {
+    readAdcSensors();
+  } else {
+    generateSensorData();
+  }
+  pipeline.dispatch();
+
+  // Group-commit journaled credit movements, snapshot when the journal is long
+  if (ledgerReady) {
+    ledger.poll(millis());
+  }
+
+  // Hybrid MQTT transmission system
+  unsigned long currentTime = millis();
+
+  // 1. Send aggregated data every publish interval (15 s)
+  if (currentTime - lastMqttPublish >= settings.publishMs) {
+    publishAggregatedDataToMqtt();
+    lastMqttPublish = currentTime;
+  }
+
+  // 2. Send heartbeat every heartbeat interval (5 min; critical alerts run in the pipeline)
+  if (currentTime - lastHeartbeat >= settings.heartbeatMs) {
+    sendHeartbeat();
+    lastHeartbeat = currentTime;
+  }
+
+  sleepUntilNextDeadline();
+}
@@ -0,0 +1,19 @@
+#define WIFI_SSID "Wokwi-GUEST"
+#define WIFI_PASSWORD ""
+
+// MQTT Configuration
+#define MQTT_SERVER "192.168.1.87"  // Your computer's IP address
+#define MQTT_PORT 1883
+#define MQTT_USERNAME ""  // Leave empty for anonymous access
+#define MQTT_PASSWORD ""  // Leave empty for anonymous access
+#define MARKET_TOPIC_PREFIX "carbon_market"
+
+// Time server for payload timestamps; the load-test broker answers too (--ntp 1123)
+#define NTP_SERVER "pool.ntp.org"
+#define NTP_SERVER_PORT 123
+
+// Per-role identity, picked by the env's DEVICE_ROLE (topic prefixes are in RoleTraits)
+#define CREATOR_MQTT_CLIENT_ID "carbon_sequester_device"
+#define CREATOR_API_KEY "cc_dfd4d3742159b53e68b4f2bae6df4132f2374c64b53a26b43cf6604e46c7e62a"
+#define BURNER_MQTT_CLIENT_ID "carbon_emitter_device"
+#define BURNER_API_KEY "cc_c98d3c07dfad46e3259a2ad23724cd37b23acfb0195ba6ac10cfb71c3afd753f"
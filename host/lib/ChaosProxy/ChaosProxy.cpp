@@ -0,0 +1,342 @@
+#include "ChaosProxy.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+static const int MAX_EVENTS = 256;
+static const size_t READ_CHUNK = 16384;
+
+static int64_t steadyNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ChaosProxy::ChaosProxy(const ChaosProxyConfig& config, uint64_t seed) : config_(config), random_(seed) {}
+
+ChaosProxy::~ChaosProxy() {
+  for (auto& link : links_) {
+    if (!link) continue;
+    if (link->device >= 0) close(link->device);
+    if (link->broker >= 0) close(link->broker);
+  }
+  closeListener();
+  if (wakeFd_ >= 0) close(wakeFd_);
+  if (epollFd_ >= 0) close(epollFd_);
+}
+
+bool ChaosProxy::openListener() {
+  listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) return false;
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port_ ? port_ : config_.port);
+  if (inet_pton(AF_INET, config_.bindAddress, &address.sin_addr) != 1 ||
+      bind(listenFd_, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd_, config_.listenBacklog) != 0) {
+    closeListener();
+    return false;
+  }
+  socklen_t addressLength = sizeof(address);
+  getsockname(listenFd_, (sockaddr*)&address, &addressLength);
+  port_ = ntohs(address.sin_port);
+  return true;
+}
+
+void ChaosProxy::closeListener() {
+  if (listenFd_ < 0) return;
+  close(listenFd_);   // also drops it from the epoll set
+  listenFd_ = -1;
+  listenWatched_ = false;
+}
+
+bool ChaosProxy::start() {
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || wakeFd_ < 0 || !openListener()) return false;
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = wakeFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+  lastRefillMs_ = steadyNowMs();
+  return true;
+}
+
+void ChaosProxy::run() {
+  running_ = true;
+  while (running_) poll(100);
+}
+
+void ChaosProxy::stop() {
+  running_ = false;
+  uint64_t one = 1;
+  if (wakeFd_ >= 0 && write(wakeFd_, &one, sizeof(one)) < 0) {
+    // Already signalled
+  }
+}
+
+void ChaosProxy::setFaults(const ChaosFaults& faults) {
+  {
+    std::lock_guard<std::mutex> guard(faultLock_);
+    pendingFaults_ = faults;
+  }
+  uint64_t one = 1;
+  if (wakeFd_ >= 0 && write(wakeFd_, &one, sizeof(one)) < 0) {
+    // Already signalled
+  }
+}
+
+ChaosFaults ChaosProxy::faults() const {
+  std::lock_guard<std::mutex> guard(faultLock_);
+  return pendingFaults_;
+}
+
+ChaosProxyStats ChaosProxy::stats() const {
+  ChaosProxyStats stats;
+  stats.connections = connections_.load(std::memory_order_relaxed);
+  stats.connectionsAccepted = connectionsAccepted_.load(std::memory_order_relaxed);
+  stats.upstreamFailures = upstreamFailures_.load(std::memory_order_relaxed);
+  stats.bytesForwarded = bytesForwarded_.load(std::memory_order_relaxed);
+  stats.segmentsDelayed = segmentsDelayed_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+int ChaosProxy::poll(int timeoutMs) {
+  if (epollFd_ < 0) return 0;
+  int64_t now = steadyNowMs();
+  bool wasPartitioned = faults_.partition;
+  {
+    std::lock_guard<std::mutex> guard(faultLock_);
+    faults_ = pendingFaults_;
+  }
+  if (faults_.refuse && listenFd_ >= 0) closeListener();
+  if (!faults_.refuse && listenFd_ < 0) openListener();
+
+  // Connections accepted during the partition reach the broker once it heals
+  if (wasPartitioned && !faults_.partition) {
+    for (auto& link : links_) {
+      if (!link || link->closing || link->broker >= 0) continue;
+      if (link->toBroker.eof) closeLink(link.get());
+      else connectBroker(link.get(), now);
+    }
+  }
+
+  // Admission: a token bucket holding 50 ms worth of connects
+  if (faults_.acceptPerSecond) {
+    double burst = std::max(1.0, faults_.acceptPerSecond / 20.0);
+    acceptTokens_ = std::min(burst, acceptTokens_ + (now - lastRefillMs_) * faults_.acceptPerSecond / 1000.0);
+  }
+  lastRefillMs_ = now;
+  bool admit = listenFd_ >= 0 && (!faults_.acceptPerSecond || acceptTokens_ >= 1);
+  if (admit != listenWatched_) {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd_;
+    epoll_ctl(epollFd_, admit ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, listenFd_, &event);
+    listenWatched_ = admit;
+  }
+
+  int64_t wake = std::min(now + timeoutMs, nextWakeMs(now));
+  epoll_event events[MAX_EVENTS];
+  int count = epoll_wait(epollFd_, events, MAX_EVENTS, (int)std::max<int64_t>(0, wake - now));
+  now = steadyNowMs();
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == listenFd_) {
+      acceptDevices(now);
+      continue;
+    }
+    if (fd == wakeFd_) {
+      uint64_t value;
+      if (read(wakeFd_, &value, sizeof(value)) < 0) {
+        // Nothing pending
+      }
+      continue;
+    }
+    Link* link = (size_t)fd < linkByFd_.size() ? linkByFd_[fd] : nullptr;
+    if (!link || link->closing) continue;
+    uint32_t ready = events[i].events;
+    if (fd == link->broker && !link->brokerReady) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+      if (error || (ready & (EPOLLERR | EPOLLHUP))) {
+        upstreamFailures_.fetch_add(1, std::memory_order_relaxed);
+        closeLink(link);
+        continue;
+      }
+      link->brokerReady = true;
+    }
+    if (ready & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      if (fd == link->device) readInto(link, fd, link->toBroker, now);
+      else readInto(link, fd, link->toDevice, now);
+    }
+  }
+
+  for (auto& link : links_) {
+    if (link && !link->closing) pump(link.get(), now);
+  }
+  closed_.clear();
+  return count;
+}
+
+void ChaosProxy::acceptDevices(int64_t nowMs) {
+  while (!faults_.acceptPerSecond || acceptTokens_ >= 1) {
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    if (faults_.acceptPerSecond) acceptTokens_ -= 1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if ((size_t)fd >= links_.size()) links_.resize(fd + 1);
+    if ((size_t)fd >= linkByFd_.size()) linkByFd_.resize(fd + 1, nullptr);
+    links_[fd].reset(new Link());
+    Link* link = links_[fd].get();
+    link->device = fd;
+    linkByFd_[fd] = link;
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    connectionsAccepted_.fetch_add(1, std::memory_order_relaxed);
+    if (!faults_.partition) connectBroker(link, nowMs);
+    if (!link->closing) updateInterest(link, nowMs);
+  }
+}
+
+void ChaosProxy::connectBroker(Link* link, int64_t nowMs) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(config_.upstreamPort);
+  inet_pton(AF_INET, config_.upstreamAddress, &address.sin_addr);
+  if (fd < 0 || (connect(fd, (sockaddr*)&address, sizeof(address)) != 0 && errno != EINPROGRESS)) {
+    if (fd >= 0) close(fd);
+    upstreamFailures_.fetch_add(1, std::memory_order_relaxed);
+    closeLink(link);
+    return;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if ((size_t)fd >= linkByFd_.size()) linkByFd_.resize(fd + 1, nullptr);
+  linkByFd_[fd] = link;
+  link->broker = fd;
+  updateInterest(link, nowMs);
+}
+
+void ChaosProxy::readInto(Link* link, int fd, Flow& flow, int64_t nowMs) {
+  if (flow.eof || flow.queuedBytes >= config_.maxQueuedBytes) return;
+  uint8_t buffer[READ_CHUNK];
+  ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+  if (n <= 0) {
+    // Closed or reset: passed on once what it sent has gone through
+    flow.eof = true;
+    return;
+  }
+
+  int64_t release = nowMs + faults_.latencyMs;
+  if (faults_.jitterMs) release += random_.below(faults_.jitterMs + 1);
+  if (faults_.lossRate > 0 && random_.nextFloat() < faults_.lossRate) {
+    release += faults_.retransmitMs;
+    segmentsDelayed_.fetch_add(1, std::memory_order_relaxed);
+  }
+  release = std::max(release, flow.lastReleaseMs);
+  flow.lastReleaseMs = release;
+  flow.chunks.push_back({release, std::vector<uint8_t>(buffer, buffer + n)});
+  flow.queuedBytes += n;
+}
+
+bool ChaosProxy::writeFrom(Link* link, int fd, Flow& flow, int64_t nowMs) {
+  while (!flow.chunks.empty() && flow.chunks.front().releaseMs <= nowMs) {
+    Chunk& chunk = flow.chunks.front();
+    ssize_t n = send(fd, chunk.bytes.data() + flow.offset, chunk.bytes.size() - flow.offset, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      closeLink(link);
+      return false;
+    }
+    bytesForwarded_.fetch_add(n, std::memory_order_relaxed);
+    flow.offset += n;
+    if (flow.offset == chunk.bytes.size()) {
+      flow.queuedBytes -= chunk.bytes.size();
+      flow.offset = 0;
+      flow.chunks.pop_front();
+    }
+  }
+  return true;
+}
+
+void ChaosProxy::pump(Link* link, int64_t nowMs) {
+  if (!faults_.partition) {
+    if (link->brokerReady && !writeFrom(link, link->broker, link->toBroker, nowMs)) return;
+    if (!writeFrom(link, link->device, link->toDevice, nowMs)) return;
+    // A closed end closes the other once everything it sent went through
+    bool deviceDone = link->toBroker.eof && link->toBroker.chunks.empty();
+    bool brokerDone = link->toDevice.eof && link->toDevice.chunks.empty();
+    if (deviceDone || brokerDone) {
+      if (brokerDone) upstreamFailures_.fetch_add(1, std::memory_order_relaxed);
+      closeLink(link);
+      return;
+    }
+  }
+  updateInterest(link, nowMs);
+}
+
+void ChaosProxy::updateInterest(Link* link, int64_t nowMs) {
+  auto blocked = [&](const Flow& flow) {
+    return !faults_.partition && !flow.chunks.empty() && flow.chunks.front().releaseMs <= nowMs;
+  };
+  auto readable = [&](const Flow& flow) { return !flow.eof && flow.queuedBytes < config_.maxQueuedBytes; };
+  auto apply = [&](int fd, uint32_t& armed, uint32_t wanted) {
+    if (fd < 0 || wanted == armed) return;
+    epoll_event event = {};
+    event.events = wanted;
+    event.data.fd = fd;
+    epoll_ctl(epollFd_, !armed ? EPOLL_CTL_ADD : wanted ? EPOLL_CTL_MOD : EPOLL_CTL_DEL, fd, &event);
+    armed = wanted;
+  };
+
+  uint32_t device = (readable(link->toBroker) ? (uint32_t)EPOLLIN : 0u) | (blocked(link->toDevice) ? (uint32_t)EPOLLOUT : 0u);
+  uint32_t broker = !link->brokerReady ? EPOLLOUT
+                    : (readable(link->toDevice) ? (uint32_t)EPOLLIN : 0u) | (blocked(link->toBroker) ? (uint32_t)EPOLLOUT : 0u);
+  apply(link->device, link->deviceEvents, device);
+  apply(link->broker, link->brokerEvents, broker);
+}
+
+void ChaosProxy::closeLink(Link* link) {
+  if (link->closing) return;
+  link->closing = true;
+  for (int fd : {link->device, link->broker}) {
+    if (fd < 0) continue;
+    linkByFd_[fd] = nullptr;
+    close(fd);
+  }
+  connections_.fetch_sub(1, std::memory_order_relaxed);
+  // Kept alive to the end of the pass: events already read may still point at it
+  closed_.push_back(std::move(links_[link->device]));
+}
+
+int64_t ChaosProxy::nextWakeMs(int64_t nowMs) const {
+  int64_t wake = INT64_MAX;
+  if (listenFd_ >= 0 && !listenWatched_ && faults_.acceptPerSecond) {
+    wake = nowMs + std::max<int64_t>(1, (int64_t)(1000 / faults_.acceptPerSecond));
+  }
+  if (faults_.partition) return wake;
+  for (const auto& link : links_) {
+    if (!link || link->closing) continue;
+    for (const Flow* flow : {&link->toBroker, &link->toDevice}) {
+      if (!flow->chunks.empty() && flow->chunks.front().releaseMs > nowMs) {
+        wake = std::min(wake, flow->chunks.front().releaseMs);
+      }
+    }
+  }
+  return wake;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <FastRandom.h>
+
+/*
+ * TCP proxy that puts network and broker faults between devices and a
+ * broker, for the chaos benchmarks (Linux, epoll).
+ *
+ * Devices connect to the proxy, which opens one broker connection per
+ * device connection and copies bytes both ways through one thread. Faults
+ * can be changed at any time from any thread:
+ *
+ *   refuse      the listening socket is closed, connects are refused as if
+ *               the broker were down
+ *   partition   nothing is delivered either way and no close is passed on;
+ *               what was sent waits, as TCP retransmissions would, and
+ *               goes through once the partition heals (if both ends still
+ *               hold the connection)
+ *   latency     one-way delay plus uniform jitter on every segment read
+ *   loss        a lost segment costs a retransmission timeout, and delays
+ *               everything behind it on that connection (head-of-line)
+ *   admission   at most acceptPerSecond new connections are taken from the
+ *               listen queue, like a broker busy with CONNECT handshakes.
+ *               The rest wait in the kernel's backlog, and once it is full
+ *               new SYNs are dropped and the devices' connects stall.
+ *
+ * Times are the proxy's own steady clock; a benchmark running scaled time
+ * scales the fault parameters itself.
+ */
+
+struct ChaosProxyConfig {
+  const char* bindAddress = "127.0.0.1";
+  uint16_t port = 0;                     // 0 picks a free port, see ChaosProxy::port()
+  const char* upstreamAddress = "127.0.0.1";
+  uint16_t upstreamPort = 1883;
+  int listenBacklog = 128;               // pending connects the kernel holds for an accept
+  size_t maxQueuedBytes = 256 << 10;     // per direction; beyond it the sender is not read
+};
+
+struct ChaosFaults {
+  bool refuse = false;
+  bool partition = false;
+  uint32_t latencyMs = 0;
+  uint32_t jitterMs = 0;
+  float lossRate = 0;                    // fraction of segments that need a retransmission
+  uint32_t retransmitMs = 200;           // TCP's minimum RTO
+  uint32_t acceptPerSecond = 0;          // 0: unlimited
+};
+
+struct ChaosProxyStats {
+  uint64_t connections = 0;              // open right now
+  uint64_t connectionsAccepted = 0;      // taken from the listen queue
+  uint64_t upstreamFailures = 0;         // the broker refused or dropped the other end
+  uint64_t bytesForwarded = 0;
+  uint64_t segmentsDelayed = 0;          // by loss
+};
+
+class ChaosProxy {
+public:
+  explicit ChaosProxy(const ChaosProxyConfig& config = ChaosProxyConfig(), uint64_t seed = 1);
+  ~ChaosProxy();
+
+  ChaosProxy(const ChaosProxy&) = delete;
+  ChaosProxy& operator=(const ChaosProxy&) = delete;
+
+  /**
+   * @brief Bind and listen
+   * @return false if the socket could not be set up
+   */
+  bool start();
+
+  uint16_t port() const { return port_; }
+
+  /**
+   * @brief One pass of the event loop, for callers that drive it themselves
+   */
+  int poll(int timeoutMs);
+
+  /**
+   * @brief Run the event loop until stop()
+   */
+  void run();
+
+  /**
+   * @brief Make run() return (any thread)
+   */
+  void stop();
+
+  /**
+   * @brief Replace the active faults (any thread; applied on the next loop pass)
+   */
+  void setFaults(const ChaosFaults& faults);
+  ChaosFaults faults() const;
+
+  ChaosProxyStats stats() const;
+
+private:
+  struct Chunk {
+    int64_t releaseMs;
+    std::vector<uint8_t> bytes;
+  };
+
+  // Bytes read from one end, waiting to be written to the other
+  struct Flow {
+    std::deque<Chunk> chunks;
+    size_t queuedBytes = 0;
+    size_t offset = 0;             // already written of chunks.front()
+    int64_t lastReleaseMs = 0;     // keeps segments in order
+    bool eof = false;              // the source closed
+  };
+
+  struct Link {
+    int device = -1;
+    int broker = -1;
+    bool brokerReady = false;      // connect() to the broker completed
+    bool closing = false;
+    uint32_t deviceEvents = 0;     // epoll interest armed on each fd
+    uint32_t brokerEvents = 0;
+    Flow toBroker;
+    Flow toDevice;
+  };
+
+  bool openListener();
+  void closeListener();
+  void acceptDevices(int64_t nowMs);
+  void connectBroker(Link* link, int64_t nowMs);
+  void readInto(Link* link, int fd, Flow& flow, int64_t nowMs);
+  bool writeFrom(Link* link, int fd, Flow& flow, int64_t nowMs);
+  void pump(Link* link, int64_t nowMs);
+  void updateInterest(Link* link, int64_t nowMs);
+  void closeLink(Link* link);
+  int64_t nextWakeMs(int64_t nowMs) const;
+
+  ChaosProxyConfig config_;
+  uint16_t port_ = 0;
+  int listenFd_ = -1;
+  bool listenWatched_ = false;
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  std::atomic<bool> running_{false};
+
+  std::vector<std::unique_ptr<Link>> links_;   // by device fd
+  std::vector<Link*> linkByFd_;                // both fds of a link
+  std::vector<std::unique_ptr<Link>> closed_;  // freed at the end of the pass
+
+  mutable std::mutex faultLock_;
+  ChaosFaults pendingFaults_;
+  ChaosFaults faults_;                         // loop thread's copy
+  FastRandom random_;
+  double acceptTokens_ = 0;
+  int64_t lastRefillMs_ = 0;
+
+  std::atomic<uint64_t> connections_{0};
+  std::atomic<uint64_t> connectionsAccepted_{0};
+  std::atomic<uint64_t> upstreamFailures_{0};
+  std::atomic<uint64_t> bytesForwarded_{0};
+  std::atomic<uint64_t> segmentsDelayed_{0};
+};
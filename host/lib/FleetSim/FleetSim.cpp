@@ -0,0 +1,173 @@
+#include "FleetSim.h"
+
+#include <algorithm>
+
+#include <QuantileSketch.h>
+#include <RoleTraits.h>
+
+// Ranges, multipliers and the burner's credit policy come from the firmware's RoleTraits
+
+FleetSim::FleetSim(const FleetSimConfig& config) : config_(config) {
+  devices_.resize(config.devices);
+  uint32_t emitters = (uint32_t)(config.devices * config.emitterShare);
+
+  for (uint32_t i = 0; i < config.devices; i++) {
+    SimDevice& device = devices_[i];
+    device.random = FastRandom::forDevice(config.seed, i);
+    device.mac = device.random.next64() & 0xFFFFFFFFFFFFULL;
+    // Octets are drawn in a fixed order so every compiler replays the same fleet
+    int range = uniform(device, 0, 2);
+    int a = range == 0 ? 168 : range == 1 ? uniform(device, 0, 254) : uniform(device, 16, 31);
+    int b = range == 0 ? uniform(device, 1, 254) : uniform(device, 0, 254);
+    int c = uniform(device, 1, 254);
+    uint32_t first = range == 0 ? 192u : range == 1 ? 10u : 172u;
+    device.ip = (first << 24) | ((uint32_t)a << 16) | ((uint32_t)b << 8) | (uint32_t)c;
+    device.type = i < emitters ? DeviceType::Emitter : DeviceType::Sequester;
+    device.availableCredits = BurnerTraits::STARTING_CREDITS;
+    device.sequence = 0;
+  }
+
+  samplesPerWindow_ = (int)std::min<int64_t>(15, config.publishIntervalMs / config.sampleIntervalMs);
+  emitterCount_ = emitters;
+  if (config.emitterScenario) {
+    emitterBank_.reset(new ScenarioBank(*config.emitterScenario, emitters, config.sampleIntervalMs));
+  }
+  if (config.sequesterScenario) {
+    sequesterBank_.reset(new ScenarioBank(*config.sequesterScenario, config.devices - emitters, config.sampleIntervalMs));
+  }
+  if (emitterBank_ || sequesterBank_) {
+    // Scenario streams split off each device's own stream, so they stay per device too
+    for (uint32_t i = 0; i < config.devices; i++) {
+      if (i < emitters && emitterBank_) emitterBank_->seedDevice(i, devices_[i].random.split());
+      if (i >= emitters && sequesterBank_) sequesterBank_->seedDevice(i - emitters, devices_[i].random.split());
+    }
+    size_t cells = (size_t)samplesPerWindow_ * config.devices;
+    roundCo2_.resize(cells);
+    roundHumidity_.resize(cells);
+    roundValid_.resize(cells, 1);
+  }
+}
+
+void FleetSim::generateRound() {
+  uint32_t devices = (uint32_t)devices_.size();
+  int64_t roundStart = config_.startMs + (int64_t)round_ * config_.publishIntervalMs;
+  for (int s = 0; s < samplesPerWindow_; s++) {
+    int64_t sampleMs = roundStart + s * config_.sampleIntervalMs;
+    size_t row = (size_t)s * devices;
+    if (emitterBank_) {
+      emitterBank_->step(sampleMs, &roundCo2_[row], &roundHumidity_[row], &roundValid_[row]);
+    }
+    if (sequesterBank_) {
+      size_t first = row + emitterCount_;
+      sequesterBank_->step(sampleMs, &roundCo2_[first], &roundHumidity_[first], &roundValid_[first]);
+    }
+  }
+}
+
+int FleetSim::uniform(SimDevice& device, int lo, int hi) {
+  return device.random.range(lo, hi + 1);
+}
+
+uint32_t FleetSim::next(SensorWindow& window, int64_t& timestampMs) {
+  uint32_t devices = (uint32_t)devices_.size();
+  uint32_t skipped = 0;
+
+  while (true) {
+    if (cursor_ == 0 && !roundValid_.empty()) generateRound();
+
+    uint32_t index = cursor_;
+    SimDevice& device = devices_[index];
+    bool emitter = device.type == DeviceType::Emitter;
+    bool scenario = emitter ? (bool)emitterBank_ : (bool)sequesterBank_;
+
+    int64_t stagger = config_.publishIntervalMs * index / devices;
+    timestampMs = config_.startMs + (int64_t)round_ * config_.publishIntervalMs + stagger;
+
+    if (++cursor_ == devices) {
+      cursor_ = 0;
+      round_++;
+    }
+
+    int co2Min = emitter ? BurnerTraits::CO2_MIN : CreatorTraits::CO2_MIN;
+    int co2Max = emitter ? BurnerTraits::CO2_MAX : CreatorTraits::CO2_MAX;
+    int humidityMin = emitter ? BurnerTraits::HUMIDITY_MIN : CreatorTraits::HUMIDITY_MIN;
+    int humidityMax = emitter ? BurnerTraits::HUMIDITY_MAX : CreatorTraits::HUMIDITY_MAX;
+
+    window = SensorWindow();
+    window.ip = device.ip;
+    window.mac = device.mac;
+    window.type = device.type;
+    window.deviceTime = (uint64_t)(config_.timeSynced ? timestampMs : timestampMs - config_.startMs);
+    window.timeSynced = config_.timeSynced;
+    window.sequence = ++device.sequence;
+    window.minCo2 = 9999;
+    window.minHumidity = 9999;
+
+    int co2 = 0, humidity = 0;
+    float co2Sum = 0, humiditySum = 0;
+    int samples = 0;
+    for (int i = 0; i < samplesPerWindow_; i++) {
+      if (scenario) {
+        size_t cell = (size_t)i * devices + index;
+        if (!roundValid_[cell]) continue;  // outage: the firmware takes no sample
+        co2 = roundCo2_[cell];
+        humidity = roundHumidity_[cell];
+      } else {
+        co2 = uniform(device, co2Min, co2Max);
+        humidity = uniform(device, humidityMin, humidityMax);
+      }
+      co2Readings_[samples] = co2;
+      humidityReadings_[samples] = humidity;
+      samples++;
+      co2Sum += co2;
+      humiditySum += humidity;
+      window.maxCo2 = std::max(window.maxCo2, co2);
+      window.minCo2 = std::min(window.minCo2, co2);
+      window.maxHumidity = std::max(window.maxHumidity, humidity);
+      window.minHumidity = std::min(window.minHumidity, humidity);
+
+      if (emitter) {
+        if (device.availableCredits < BurnerTraits::CREDIT_PURCHASE_THRESHOLD) {
+          device.availableCredits += BurnerTraits::CREDIT_PURCHASE_AMOUNT;
+        }
+        if (co2 > BurnerTraits::BURN_CO2_BASELINE) {
+          float burn = std::min((co2 - BurnerTraits::BURN_CO2_BASELINE) * BurnerTraits::BURN_RATE, device.availableCredits);
+          if (burn > 0.01f) device.availableCredits -= burn;
+        }
+      }
+    }
+    // Like publishAggregatedDataToMqtt, nothing is sent without readings,
+    // unless a whole round was dark and the caller has to get something back
+    if (samples == 0 && ++skipped < devices) continue;
+    window.samples = samples;
+    window.avgCo2 = samples ? co2Sum / samples : 0;
+    window.avgHumidity = samples ? humiditySum / samples : 0;
+
+    if (config_.sketches) {
+      SparseSketch co2Sketch, humiditySketch;
+      for (int i = 0; i < window.samples; i++) {
+        co2Sketch.add(co2Readings_[i]);
+        humiditySketch.add(humidityReadings_[i]);
+      }
+      window.co2Sketch = co2SketchText_;
+      window.co2SketchLength = (uint16_t)co2Sketch.encode(co2SketchText_, sizeof(co2SketchText_));
+      window.humiditySketch = humiditySketchText_;
+      window.humiditySketchLength = (uint16_t)humiditySketch.encode(humiditySketchText_, sizeof(humiditySketchText_));
+    }
+
+    // Credits and emissions come from the last reading of the window
+    if (emitter) {
+      window.credits = co2 * BurnerTraits::CREDIT_MULTIPLIER;
+      window.emissions = humidity * BurnerTraits::EMISSION_MULTIPLIER;
+      window.offset = device.availableCredits >= window.credits;
+      window.creditsAvailable = device.availableCredits;
+      window.hasCreditsAvailable = true;
+    } else {
+      window.credits = co2 * CreatorTraits::CREDIT_MULTIPLIER;
+      window.emissions = humidity * CreatorTraits::EMISSION_MULTIPLIER;
+      window.offset = window.credits >= window.emissions;
+    }
+
+    return index;
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include <FastRandom.h>
+#include <Scenario.h>
+#include <Telemetry.h>
+
+/**
+ * @brief Shape of a simulated fleet
+ */
+struct FleetSimConfig {
+  uint32_t devices = 1000;
+  double emitterShare = 0.5;              // fraction of devices running the burner firmware
+  uint64_t seed = 1;
+  int64_t startMs = 1735689600000LL;      // 2025-01-01T00:00:00Z
+  int64_t publishIntervalMs = 15000;      // mqttPublishInterval
+  int64_t sampleIntervalMs = 2000;        // dataUpdateInterval
+  bool sketches = false;                  // attach "q_c"/"q_h" like publishQuantileSketch
+  bool timeSynced = true;                 // "t" is the Unix ms timestamp ("ts":1), else ms since startMs
+  // Signal shapes; without one, readings are uniform in the firmware ranges
+  const ScenarioConfig* emitterScenario = nullptr;
+  const ScenarioConfig* sequesterScenario = nullptr;
+};
+
+/**
+ * @brief Per-device state the firmware keeps between windows
+ */
+struct SimDevice {
+  uint64_t mac;
+  uint32_t ip;
+  DeviceType type;
+  float availableCredits;  // emitter only, starts at 50 like the burner
+  uint32_t sequence;       // "seq" of the last window
+  FastRandom random;       // FastRandom::forDevice(seed, index)
+};
+
+/**
+ * @brief Host-side stand-in for a fleet of creator and burner devices
+ *
+ * Produces sensor_data windows with the same ranges, multipliers and credit
+ * logic as the firmware, in timestamp order across the whole fleet. Each
+ * device publishes once per publish interval, staggered so the load is flat.
+ * Every device draws from its own stream of the fleet seed, so a device's
+ * windows are the same whatever the fleet size and runs can be diffed.
+ *
+ * With a scenario, a whole round of readings is generated up front by a
+ * ScenarioBank per device type; samples lost to an outage are left out of
+ * the window and a device with none left skips that round.
+ */
+class FleetSim {
+public:
+  explicit FleetSim(const FleetSimConfig& config);
+
+  /**
+   * @brief Produce the next window in fleet-wide time order
+   * @param timestampMs Simulated wall-clock time the window is published
+   * @return Index of the device that produced it
+   */
+  uint32_t next(SensorWindow& window, int64_t& timestampMs);
+
+  /**
+   * @brief Raw readings behind the last window returned by next()
+   *
+   * The window's sketch pointers also refer to FleetSim-owned buffers and are
+   * only valid until the next call.
+   */
+  const int* lastCo2Readings() const { return co2Readings_; }
+  const int* lastHumidityReadings() const { return humidityReadings_; }
+
+  const FleetSimConfig& config() const { return config_; }
+  const SimDevice& device(uint32_t index) const { return devices_[index]; }
+  uint32_t deviceCount() const { return (uint32_t)devices_.size(); }
+
+private:
+  static int uniform(SimDevice& device, int lo, int hi);
+  void generateRound();
+
+  FleetSimConfig config_;
+  std::vector<SimDevice> devices_;
+  uint32_t cursor_ = 0;
+  uint64_t round_ = 0;
+  int samplesPerWindow_;
+  uint32_t emitterCount_;
+  std::unique_ptr<ScenarioBank> emitterBank_;
+  std::unique_ptr<ScenarioBank> sequesterBank_;
+  // Readings of the current round, [sample * devices + device]
+  std::vector<int> roundCo2_;
+  std::vector<int> roundHumidity_;
+  std::vector<uint8_t> roundValid_;
+  int co2Readings_[15];
+  int humidityReadings_[15];
+  char co2SketchText_[128];
+  char humiditySketchText_[128];
+};
@@ -0,0 +1,272 @@
+#include "HeavyHitters.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+static const uint64_t EMPTY_KEY = UINT64_MAX;  // MACs only use 48 bits
+
+static inline uint32_t hashKey(uint64_t key, uint32_t mask) {
+  return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+SpaceSaving::SpaceSaving(uint32_t capacity) : capacity_(capacity), heap_(capacity) {
+  uint32_t indexSize = 1;
+  while (indexSize < capacity * 2) indexSize <<= 1;
+  indexKeys_.assign(indexSize, EMPTY_KEY);
+  indexPositions_.assign(indexSize, 0);
+  indexMask_ = indexSize - 1;
+}
+
+void SpaceSaving::clear() {
+  if (size_ == 0) return;
+  size_ = 0;
+  std::fill(indexKeys_.begin(), indexKeys_.end(), EMPTY_KEY);
+}
+
+uint32_t SpaceSaving::findSlot(uint64_t key) const {
+  uint32_t slot = hashKey(key, indexMask_);
+  while (indexKeys_[slot] != key && indexKeys_[slot] != EMPTY_KEY) slot = (slot + 1) & indexMask_;
+  return slot;
+}
+
+void SpaceSaving::eraseSlot(uint32_t slot) {
+  // Backward-shift deletion keeps linear probing chains intact without tombstones
+  uint32_t hole = slot;
+  uint32_t next = (hole + 1) & indexMask_;
+  while (indexKeys_[next] != EMPTY_KEY) {
+    uint32_t home = hashKey(indexKeys_[next], indexMask_);
+    bool movable = ((next - home) & indexMask_) >= ((next - hole) & indexMask_);
+    if (movable) {
+      indexKeys_[hole] = indexKeys_[next];
+      indexPositions_[hole] = indexPositions_[next];
+      heap_[indexPositions_[hole]].slot = hole;
+      hole = next;
+    }
+    next = (next + 1) & indexMask_;
+  }
+  indexKeys_[hole] = EMPTY_KEY;
+}
+
+void SpaceSaving::siftDown(uint32_t position) {
+  // Move the hole down and write the counter once at the end
+  Counter moving = heap_[position];
+  while (true) {
+    uint32_t child = position * 2 + 1;
+    if (child >= size_) break;
+    if (child + 1 < size_ && heap_[child + 1].hitter.weight < heap_[child].hitter.weight) child++;
+    if (heap_[child].hitter.weight >= moving.hitter.weight) break;
+    heap_[position] = heap_[child];
+    indexPositions_[heap_[position].slot] = position;
+    position = child;
+  }
+  heap_[position] = moving;
+  indexPositions_[moving.slot] = position;
+}
+
+void SpaceSaving::siftUp(uint32_t position) {
+  Counter moving = heap_[position];
+  while (position > 0) {
+    uint32_t parent = (position - 1) / 2;
+    if (heap_[parent].hitter.weight <= moving.hitter.weight) break;
+    heap_[position] = heap_[parent];
+    indexPositions_[heap_[position].slot] = position;
+    position = parent;
+  }
+  heap_[position] = moving;
+  indexPositions_[moving.slot] = position;
+}
+
+void SpaceSaving::add(uint64_t key, double weight) {
+  uint32_t slot = findSlot(key);
+
+  if (indexKeys_[slot] == key) {
+    uint32_t position = indexPositions_[slot];
+    heap_[position].hitter.weight += weight;
+    siftDown(position);
+    return;
+  }
+
+  if (size_ < capacity_) {
+    uint32_t position = size_++;
+    heap_[position].hitter = {key, weight, 0};
+    heap_[position].slot = slot;
+    indexKeys_[slot] = key;
+    indexPositions_[slot] = position;
+    siftUp(position);
+    return;
+  }
+
+  // Evict the smallest counter; the newcomer inherits its weight as error
+  Counter& root = heap_[0];
+  double inherited = root.hitter.weight;
+  eraseSlot(root.slot);
+  slot = findSlot(key);
+  root.hitter = {key, inherited + weight, inherited};
+  root.slot = slot;
+  indexKeys_[slot] = key;
+  indexPositions_[slot] = 0;
+  siftDown(0);
+}
+
+SlidingTopK::SlidingTopK(int64_t windowMs, uint32_t panes, uint32_t capacity, int64_t refreshMs)
+  : paneMs_(windowMs / panes), refreshMs_(refreshMs), panes_(panes, SpaceSaving(capacity)) {
+  closed_.reserve((size_t)panes * capacity);
+  closedSeen_.reserve((size_t)panes * capacity);
+  candidates_.reserve(capacity + TOP_K);
+  uint32_t indexSize = 1;
+  while (indexSize < panes * capacity * 2) indexSize <<= 1;
+  closedIndex_.assign(indexSize, 0);
+}
+
+void SlidingTopK::advance(int64_t pane) {
+  // Clear every pane that falls out of the window, at most all of them
+  int64_t first = currentPane_ == INT64_MIN ? pane - (int64_t)panes_.size() + 1 : currentPane_ + 1;
+  first = std::max(first, pane - (int64_t)panes_.size() + 1);
+  for (int64_t p = first; p <= pane; p++) panes_[(uint64_t)p % panes_.size()].clear();
+  currentPane_ = pane;
+  closedDirty_ = true;
+}
+
+void SlidingTopK::add(uint64_t key, double weight, int64_t timestampMs) {
+  int64_t pane = timestampMs / paneMs_;
+
+  if (pane > currentPane_) {
+    bool rotated = currentPane_ != INT64_MIN;
+    advance(pane);
+    if (rotated) publish(timestampMs);
+  } else if (pane <= currentPane_ - (int64_t)panes_.size()) {
+    return;  // Already outside the window
+  } else if (pane != currentPane_) {
+    closedDirty_ = true;  // Late window for an older pane
+  }
+
+  panes_[(uint64_t)pane % panes_.size()].add(key, weight);
+
+  if (lastPublishMs_ == INT64_MIN || timestampMs - lastPublishMs_ >= refreshMs_) {
+    publish(timestampMs);
+  }
+}
+
+int32_t SlidingTopK::findClosed(uint64_t key) const {
+  uint32_t mask = closedIndex_.size() - 1;
+  uint32_t slot = hashKey(key, mask);
+  while (closedIndex_[slot]) {
+    if (closed_[closedIndex_[slot] - 1].hitter.key == key) return closedIndex_[slot] - 1;
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+void SlidingTopK::mergeClosedPanes() {
+  closed_.clear();
+  std::fill(closedIndex_.begin(), closedIndex_.end(), 0);
+  uint32_t mask = closedIndex_.size() - 1;
+
+  closedMinSum_ = 0;
+  for (uint32_t p = 0; p < panes_.size(); p++) {
+    if (currentPane_ != INT64_MIN && p == (uint64_t)currentPane_ % panes_.size()) continue;
+    const SpaceSaving& pane = panes_[p];
+    double paneMin = pane.minWeight();
+    closedMinSum_ += paneMin;
+
+    for (uint32_t i = 0; i < pane.size(); i++) {
+      const HeavyHitter& counter = pane.counter(i);
+      uint32_t slot = hashKey(counter.key, mask);
+      while (closedIndex_[slot] && closed_[closedIndex_[slot] - 1].hitter.key != counter.key) {
+        slot = (slot + 1) & mask;
+      }
+      if (!closedIndex_[slot]) {
+        closed_.push_back({{counter.key, 0, 0}, 0});
+        closedIndex_[slot] = closed_.size();
+      }
+      Merged& entry = closed_[closedIndex_[slot] - 1];
+      entry.hitter.weight += counter.weight;
+      entry.hitter.error += counter.error;
+      entry.trackedMinSum += paneMin;
+    }
+  }
+
+  for (Merged& entry : closed_) {
+    double untracked = closedMinSum_ - entry.trackedMinSum;
+    entry.hitter.weight += untracked;
+    entry.hitter.error += untracked;
+  }
+
+  std::sort(closed_.begin(), closed_.end(),
+            [](const Merged& a, const Merged& b) { return a.hitter.weight > b.hitter.weight; });
+  // Sorting moved the entries, so index them again by their new positions
+  std::fill(closedIndex_.begin(), closedIndex_.end(), 0);
+  for (uint32_t i = 0; i < closed_.size(); i++) {
+    uint32_t slot = hashKey(closed_[i].hitter.key, mask);
+    while (closedIndex_[slot]) slot = (slot + 1) & mask;
+    closedIndex_[slot] = i + 1;
+  }
+  closedSeen_.assign(closed_.size(), 0);
+  generation_ = 0;
+  closedDirty_ = false;
+}
+
+void SlidingTopK::publish(int64_t timestampMs) {
+  lastPublishMs_ = timestampMs;
+  if (closedDirty_) mergeClosedPanes();
+  generation_++;
+  candidates_.clear();
+
+  // Keys tracked by the current pane, topped up from the closed panes
+  static const SpaceSaving EMPTY_PANE(1);
+  const SpaceSaving& current =
+    currentPane_ == INT64_MIN ? EMPTY_PANE : panes_[(uint64_t)currentPane_ % panes_.size()];
+  for (uint32_t i = 0; i < current.size(); i++) {
+    HeavyHitter hitter = current.counter(i);
+    int32_t found = findClosed(hitter.key);
+    if (found >= 0) {
+      hitter.weight += closed_[found].hitter.weight;
+      hitter.error += closed_[found].hitter.error;
+      closedSeen_[found] = generation_;
+    } else {
+      hitter.weight += closedMinSum_;
+      hitter.error += closedMinSum_;
+    }
+    candidates_.push_back(hitter);
+  }
+
+  // Everything else gains the same current-pane bound, so the closed order
+  // holds and only its first TOP_K unseen entries can make the cut
+  double currentMin = current.minWeight();
+  int taken = 0;
+  for (uint32_t i = 0; i < closed_.size() && taken < TOP_K; i++) {
+    if (closedSeen_[i] == generation_) continue;
+    HeavyHitter hitter = closed_[i].hitter;
+    hitter.weight += currentMin;
+    hitter.error += currentMin;
+    candidates_.push_back(hitter);
+    taken++;
+  }
+
+  size_t count = std::min<size_t>(TOP_K, candidates_.size());
+  std::partial_sort(candidates_.begin(), candidates_.begin() + count, candidates_.end(),
+                    [](const HeavyHitter& a, const HeavyHitter& b) { return a.weight > b.weight; });
+
+  TopKSnapshot snapshot;
+  snapshot.asOfMs = timestampMs;
+  snapshot.count = count;
+  for (size_t i = 0; i < count; i++) snapshot.entries[i] = candidates_[i];
+  published_.write(snapshot);
+}
+
+TopEmitters::TopEmitters(uint32_t capacity)
+  : windows_{
+      SlidingTopK(5LL * 60 * 1000, 10, capacity, 1000),         // 30 s panes
+      SlidingTopK(60LL * 60 * 1000, 12, capacity, 1000),        // 5 min panes
+      SlidingTopK(24LL * 60 * 60 * 1000, 24, capacity, 1000),   // 1 h panes
+    } {
+}
+
+void TopEmitters::add(uint64_t mac, double creditsNeeded, int64_t timestampMs) {
+  for (SlidingTopK& window : windows_) window.add(mac, creditsNeeded, timestampMs);
+}
+
+void TopEmitters::publish(int64_t timestampMs) {
+  for (SlidingTopK& window : windows_) window.publish(timestampMs);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <Seqlock.h>
+
+/**
+ * @brief One tracked key in a Space-Saving summary
+ */
+struct HeavyHitter {
+  uint64_t key = 0;
+  double weight = 0;  // estimated total, never below the true total
+  double error = 0;   // weight - error is never above the true total
+};
+
+/**
+ * @brief Weighted Space-Saving summary with a fixed number of counters
+ *
+ * Keys are found through an open-addressing index and counters sit in an
+ * indexed min-heap. A hit only grows its counter, so it sinks a level or two
+ * at most in practice; a miss replaces the root. Both are O(log k) worst case
+ * and effectively constant per update.
+ */
+class SpaceSaving {
+public:
+  explicit SpaceSaving(uint32_t capacity);
+
+  void add(uint64_t key, double weight);
+  void clear();
+
+  /**
+   * @brief Smallest tracked weight, the error bound for untracked keys
+   */
+  double minWeight() const { return size_ < capacity_ ? 0 : heap_[0].hitter.weight; }
+
+  uint32_t size() const { return size_; }
+
+  const HeavyHitter& counter(uint32_t i) const { return heap_[i].hitter; }
+
+private:
+  struct Counter {
+    HeavyHitter hitter;
+    uint32_t slot;  // where the key sits in the index
+  };
+
+  uint32_t findSlot(uint64_t key) const;
+  void eraseSlot(uint32_t slot);
+  void siftDown(uint32_t position);
+  void siftUp(uint32_t position);
+
+  uint32_t capacity_;
+  uint32_t size_ = 0;
+  std::vector<Counter> heap_;
+  // Open-addressing key -> heap position, at least twice the capacity, power of two
+  std::vector<uint64_t> indexKeys_;
+  std::vector<uint32_t> indexPositions_;
+  uint32_t indexMask_;
+};
+
+const int TOP_K = 32;
+
+/**
+ * @brief What a dashboard reads: the current top entries of one window
+ */
+struct TopKSnapshot {
+  int64_t asOfMs = 0;
+  uint32_t count = 0;
+  HeavyHitter entries[TOP_K];
+};
+
+/**
+ * @brief Top-K over a sliding time window built from per-pane summaries
+ *
+ * The window is split into panes, each with its own Space-Saving summary.
+ * Updates only touch the current pane; expired panes are cleared as time
+ * moves on. The merged top-K is republished through a seqlock whenever a
+ * pane rotates and at most every refreshMs otherwise. A key missing from a
+ * pane is charged that pane's minWeight(), so merged weights stay upper
+ * bounds and the error column says by how much.
+ */
+class SlidingTopK {
+public:
+  SlidingTopK(int64_t windowMs, uint32_t panes, uint32_t capacity, int64_t refreshMs);
+
+  void add(uint64_t key, double weight, int64_t timestampMs);
+
+  /**
+   * @brief Lock-free read of the last published top-K, safe from any thread
+   */
+  TopKSnapshot snapshot() const { return published_.read(); }
+
+  /**
+   * @brief Merge the live panes and publish now
+   */
+  void publish(int64_t timestampMs);
+
+  int64_t windowMs() const { return paneMs_ * panes_.size(); }
+
+private:
+  struct Merged {
+    HeavyHitter hitter;
+    double trackedMinSum;  // sum of minWeight() over panes that track this key
+  };
+
+  void advance(int64_t pane);
+  void mergeClosedPanes();
+  int32_t findClosed(uint64_t key) const;
+
+  int64_t paneMs_;
+  int64_t refreshMs_;
+  int64_t currentPane_ = INT64_MIN;
+  int64_t lastPublishMs_ = INT64_MIN;
+  std::vector<SpaceSaving> panes_;
+  Seqlock<TopKSnapshot> published_;
+
+  // Panes other than the current one only change on rotation or late data,
+  // so their merge is cached, sorted by weight, and a publish only folds in
+  // the current pane
+  std::vector<Merged> closed_;
+  std::vector<uint32_t> closedIndex_;  // key -> position in closed_ + 1
+  std::vector<uint32_t> closedSeen_;   // publish generation that consumed the entry
+  double closedMinSum_ = 0;
+  bool closedDirty_ = true;
+  uint32_t generation_ = 0;
+  std::vector<HeavyHitter> candidates_;
+};
+
+enum TopWindow {
+  TOP_WINDOW_5_MIN = 0,
+  TOP_WINDOW_1_HOUR = 1,
+  TOP_WINDOW_24_HOURS = 2,
+  TOP_WINDOW_COUNT = 3,
+};
+
+/**
+ * @brief Worst emitters by credits needed ("cr") over 5 min, 1 h and 24 h
+ */
+class TopEmitters {
+public:
+  explicit TopEmitters(uint32_t capacity = 1024);
+
+  /**
+   * @brief Feed one emitter window from the ingest path
+   */
+  void add(uint64_t mac, double creditsNeeded, int64_t timestampMs);
+
+  TopKSnapshot snapshot(TopWindow window) const { return windows_[window].snapshot(); }
+
+  void publish(int64_t timestampMs);
+
+private:
+  SlidingTopK windows_[TOP_WINDOW_COUNT];
+};
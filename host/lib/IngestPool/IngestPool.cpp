@@ -0,0 +1,161 @@
+#include "IngestPool.h"
+
+#include <algorithm>
+
+// Shard of the worker running on this thread, -1 outside the pool
+static thread_local int workerShard = -1;
+
+IngestPool::IngestPool(int shards) {
+  if (shards < 1) shards = 1;
+  for (int i = 0; i < shards; i++) shards_.emplace_back(new Shard());
+}
+
+void IngestPool::setWorkerShard(int shard) {
+  workerShard = shard;
+}
+
+int IngestPool::ownerOf(uint64_t mac) const {
+  // Locally administered MACs share prefixes; mix before taking the shard
+  uint64_t h = mac * 0x9E3779B97F4A7C15ULL;
+  return (int)(((h >> 32) * (uint64_t)shards_.size()) >> 32);
+}
+
+bool IngestPool::route(const char* payload, size_t length, int64_t timestampMs) {
+  static thread_local std::vector<char> scratch;
+  int windows = forEachSensorWindow(payload, length, timestampMs, scratch,
+                                    [&](const SensorWindow& window, int64_t windowMs) {
+    route(window, windowMs);
+  });
+  if (windows < 0) {
+    countRejected(1);
+    return false;
+  }
+  return true;
+}
+
+void IngestPool::route(const SensorWindow& parsed, int64_t timestampMs) {
+  RoutedWindow routed;
+  routed.window = parsed;
+  routed.timestampMs = timestampMs;
+  SensorWindow& window = routed.window;
+  if (window.co2Sketch || window.humiditySketch) {
+    routed.sketches.reserve(window.co2SketchLength + window.humiditySketchLength);
+    if (window.co2Sketch) routed.sketches.append(window.co2Sketch, window.co2SketchLength);
+    if (window.humiditySketch) routed.sketches.append(window.humiditySketch, window.humiditySketchLength);
+  }
+
+  int owner = ownerOf(window.mac);
+  if (owner != workerShard) routedAway_.fetch_add(1, std::memory_order_relaxed);
+  Shard& shard = *shards_[owner];
+  std::lock_guard<std::mutex> guard(shard.inboxLock);
+  shard.inbox.push_back(std::move(routed));
+}
+
+size_t IngestPool::drain(int shardIndex) {
+  Shard& shard = *shards_[shardIndex];
+  {
+    std::lock_guard<std::mutex> guard(shard.inboxLock);
+    if (shard.inbox.empty()) return 0;
+    shard.batch.swap(shard.inbox);
+  }
+
+  std::lock_guard<std::mutex> guard(shard.stateLock);
+  size_t count = 0;
+  for (RoutedWindow& routed : shard.batch) {
+    SensorWindow& window = routed.window;
+    SequenceVerdict verdict = shard.dedupe.accept(window.mac, window.sequence);
+    if (verdict == SequenceVerdict::Duplicate || verdict == SequenceVerdict::Stale) continue;
+
+    // Point the sketches at the copied text
+    const char* text = routed.sketches.data();
+    if (window.co2Sketch) {
+      window.co2Sketch = text;
+      text += window.co2SketchLength;
+    }
+    if (window.humiditySketch) window.humiditySketch = text;
+
+    shard.rollups.ingest(window, routed.timestampMs);
+    shard.quantiles.ingest(window, routed.timestampMs);
+    if (window.type == DeviceType::Emitter) shard.topEmitters.add(window.mac, window.credits, routed.timestampMs);
+    count++;
+  }
+  shard.ingested += count;
+  shard.batch.clear();
+  return count;
+}
+
+size_t IngestPool::deviceCount() const {
+  size_t devices = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->stateLock);
+    devices += shard->rollups.deviceCount();
+  }
+  return devices;
+}
+
+RollupCell IngestPool::queryType(DeviceType type, int64_t fromMs, int64_t toMs) const {
+  RollupCell merged;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->stateLock);
+    merged.merge(shard->rollups.queryType(type, fromMs, toMs));
+  }
+  return merged;
+}
+
+void IngestPool::queryQuantiles(DeviceType type, int64_t fromMs, int64_t toMs,
+                                LogHistogram& co2, LogHistogram& humidity) const {
+  // SketchRollup::query() adds onto the histograms it is given
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->stateLock);
+    shard->quantiles.query(type, fromMs, toMs, co2, humidity);
+  }
+}
+
+void IngestPool::publishTopEmitters(int shardIndex, int64_t nowMs) {
+  Shard& shard = *shards_[shardIndex];
+  std::lock_guard<std::mutex> guard(shard.stateLock);
+  shard.topEmitters.publish(nowMs);
+}
+
+TopKSnapshot IngestPool::topEmitters(TopWindow window) const {
+  std::vector<HeavyHitter> candidates;
+  int64_t asOfMs = INT64_MAX;
+  for (const auto& shard : shards_) {
+    TopKSnapshot top = shard->topEmitters.snapshot(window);
+    asOfMs = std::min(asOfMs, top.asOfMs);
+    candidates.insert(candidates.end(), top.entries, top.entries + top.count);
+  }
+
+  // Each device is counted in one shard only, so the shards' top lists just interleave
+  std::sort(candidates.begin(), candidates.end(),
+            [](const HeavyHitter& a, const HeavyHitter& b) { return a.weight > b.weight; });
+  TopKSnapshot merged;
+  merged.asOfMs = asOfMs;
+  merged.count = (uint32_t)std::min(candidates.size(), (size_t)TOP_K);
+  std::copy(candidates.begin(), candidates.begin() + merged.count, merged.entries);
+  return merged;
+}
+
+uint64_t IngestPool::ingested() const {
+  uint64_t total = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->stateLock);
+    total += shard->ingested;
+  }
+  return total;
+}
+
+SequenceDedupeStats IngestPool::dedupeStats() const {
+  SequenceDedupeStats total;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->stateLock);
+    const SequenceDedupeStats& stats = shard->dedupe.stats();
+    total.fresh += stats.fresh;
+    total.duplicates += stats.duplicates;
+    total.stale += stats.stale;
+    total.resets += stats.resets;
+    total.unsequenced += stats.unsequenced;
+    total.devices += stats.devices;
+  }
+  return total;
+}
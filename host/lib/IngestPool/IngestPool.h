@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <HeavyHitters.h>
+#include <QuantileSketch.h>
+#include <Rollup.h>
+#include <SequenceDedupe.h>
+#include <SketchRollup.h>
+#include <Telemetry.h>
+
+/*
+ * Device-affine ingest state for a pool of shared-subscription workers.
+ *
+ * With "$share/<group>/<filter>" the broker hands each message to one
+ * client of the group, so consecutive windows of a device land on different
+ * workers. Each device is therefore owned by one shard (MAC hash): the
+ * worker that received a window parses it and routes it to the owner's
+ * inbox, and only the owner folds it into its rollups, quantiles and top
+ * emitters. Per-MAC state keeps a single writer, and since every window is
+ * placed by its device time (or arrival, for an unsynced clock), it comes
+ * out the same whatever the routing order. Fleet-wide reads merge the
+ * shards; devices never span shards, so the merged top emitters are exact.
+ */
+
+class IngestPool {
+public:
+  explicit IngestPool(int shards);
+
+  int shardCount() const { return (int)shards_.size(); }
+
+  /**
+   * @brief Shard that owns a device
+   */
+  int ownerOf(uint64_t mac) const;
+
+  /**
+   * @brief Parse a sensor_data payload received by any worker and queue its windows for their owners
+   *
+   * @param timestampMs Arrival; windows of an unsynced device are placed there, less their age in a batch
+   * @return false if the payload was rejected
+   */
+  bool route(const char* payload, size_t length, int64_t timestampMs);
+
+  /**
+   * @brief Queue a window parsed by the caller; its sketch text is copied
+   */
+  void route(const SensorWindow& window, int64_t timestampMs);
+
+  /**
+   * @brief Count payloads the caller rejected before route()
+   */
+  void countRejected(uint64_t count) { rejected_.fetch_add(count, std::memory_order_relaxed); }
+
+  /**
+   * @brief Fold everything queued for a shard into its state (call from the owning worker)
+   * @return Windows ingested, duplicates not included
+   */
+  size_t drain(int shard);
+
+  /**
+   * @brief Republish a shard's top emitters as of nowMs (call from the owning worker on its tick)
+   */
+  void publishTopEmitters(int shard, int64_t nowMs);
+
+  // Fleet-wide reads, merged across shards under each shard's lock
+  size_t deviceCount() const;
+  RollupCell queryType(DeviceType type, int64_t fromMs, int64_t toMs) const;
+  void queryQuantiles(DeviceType type, int64_t fromMs, int64_t toMs, LogHistogram& co2, LogHistogram& humidity) const;
+
+  /**
+   * @brief Merge what each shard last published; reads the seqlocks only, so it never waits on ingest
+   *
+   * asOfMs is that of the shard that published longest ago.
+   */
+  TopKSnapshot topEmitters(TopWindow window) const;
+
+  uint64_t ingested() const;
+  SequenceDedupeStats dedupeStats() const;
+  uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+  uint64_t routedAway() const { return routedAway_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Record which shard a worker owns, so route() can count handoffs
+   */
+  static void setWorkerShard(int shard);
+
+private:
+  // A parsed window on its way to the owner; the sketch text is copied out of the payload
+  struct RoutedWindow {
+    SensorWindow window;
+    int64_t timestampMs;
+    std::string sketches;
+  };
+
+  struct Shard {
+    std::mutex inboxLock;
+    std::vector<RoutedWindow> inbox;
+    std::vector<RoutedWindow> batch;   // swapped with inbox by drain()
+
+    mutable std::mutex stateLock;
+    RollupStore rollups;
+    SketchRollup quantiles;
+    TopEmitters topEmitters;
+    SequenceDedupe dedupe;
+    uint64_t ingested = 0;
+  };
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> rejected_{0};
+  std::atomic<uint64_t> routedAway_{0};
+};
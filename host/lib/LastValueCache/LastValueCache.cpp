@@ -0,0 +1,262 @@
+#include "LastValueCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+// Rows checked per pass of readRange()
+static const uint32_t READ_BLOCK = 64;
+
+/**
+ * @brief Cache-line aligned column of count atomics, zeroed
+ */
+template <typename T>
+static T* allocateColumn(size_t count) {
+  size_t bytes = (count * sizeof(T) + 63) / 64 * 64;
+  T* column = (T*)aligned_alloc(64, bytes ? bytes : 64);
+  for (size_t i = 0; i < count; i++) new (&column[i]) T(typename T::value_type());
+  return column;
+}
+
+static inline uint64_t mixMac(uint64_t mac) {
+  // Locally administered MACs share prefixes; mix before taking the slot
+  uint64_t h = mac * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 31);
+}
+
+LastValueCache::LastValueCache(uint32_t capacity) : capacity_(capacity) {
+  uint64_t slots = 16;
+  while (slots < 2 * (uint64_t)capacity) slots <<= 1;
+  indexMask_ = slots - 1;
+  indexMacs_ = allocateColumn<std::atomic<uint64_t>>(slots);
+  indexIds_ = allocateColumn<std::atomic<uint32_t>>(slots);
+  for (uint64_t i = 0; i < slots; i++) indexIds_[i].store(NO_ID, std::memory_order_relaxed);
+
+  sequence_ = allocateColumn<std::atomic<uint32_t>>(capacity);
+  mac_ = allocateColumn<std::atomic<uint64_t>>(capacity);
+  co2_ = allocateColumn<std::atomic<float>>(capacity);
+  credits_ = allocateColumn<std::atomic<float>>(capacity);
+  rssi_ = allocateColumn<std::atomic<int8_t>>(capacity);
+  flags_ = allocateColumn<std::atomic<uint8_t>>(capacity);
+  updatedMs_ = allocateColumn<std::atomic<int64_t>>(capacity);
+}
+
+LastValueCache::~LastValueCache() {
+  // Atomics of integral and float types are trivially destructible
+  free(indexMacs_);
+  free(indexIds_);
+  free(sequence_);
+  free(mac_);
+  free(co2_);
+  free(credits_);
+  free(rssi_);
+  free(flags_);
+  free(updatedMs_);
+}
+
+int32_t LastValueCache::deviceId(uint64_t mac) {
+  if (mac == 0) return -1;
+  for (uint64_t slot = mixMac(mac) & indexMask_;; slot = (slot + 1) & indexMask_) {
+    uint64_t key = indexMacs_[slot].load(std::memory_order_acquire);
+    if (key == 0) {
+      // Full: stop claiming index slots, so the index never fills up
+      if (nextId_.load(std::memory_order_relaxed) >= capacity_) return -1;
+      if (indexMacs_[slot].compare_exchange_strong(key, mac, std::memory_order_acq_rel)) {
+        uint32_t id = nextId_.fetch_add(1, std::memory_order_relaxed);
+        if (id >= capacity_) {
+          indexIds_[slot].store(FULL, std::memory_order_release);
+          return -1;
+        }
+        mac_[id].store(mac, std::memory_order_relaxed);
+        indexIds_[slot].store(id, std::memory_order_release);
+        return (int32_t)id;
+      }
+      // Lost the slot; key now holds the winner's MAC
+    }
+    if (key == mac) {
+      // The thread that claimed the slot publishes the id right after
+      uint32_t id;
+      while ((id = indexIds_[slot].load(std::memory_order_acquire)) == NO_ID) {
+      }
+      return id == FULL ? -1 : (int32_t)id;
+    }
+  }
+}
+
+int32_t LastValueCache::findDevice(uint64_t mac) const {
+  if (mac == 0) return -1;
+  for (uint64_t slot = mixMac(mac) & indexMask_;; slot = (slot + 1) & indexMask_) {
+    uint64_t key = indexMacs_[slot].load(std::memory_order_acquire);
+    if (key == 0) return -1;
+    if (key == mac) {
+      uint32_t id = indexIds_[slot].load(std::memory_order_acquire);
+      return id >= FULL ? -1 : (int32_t)id;
+    }
+  }
+}
+
+uint32_t LastValueCache::deviceCount() const {
+  return std::min(nextId_.load(std::memory_order_acquire), capacity_);
+}
+
+uint32_t LastValueCache::beginWrite(uint32_t id) {
+  std::atomic<uint32_t>& sequence = sequence_[id];
+  uint32_t value = sequence.load(std::memory_order_relaxed);
+  while (true) {
+    // Odd: another writer holds the row
+    if (!(value & 1) &&
+        sequence.compare_exchange_weak(value, value + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      break;
+    }
+    if (value & 1) value = sequence.load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  return value;
+}
+
+bool LastValueCache::update(const SensorWindow& window, int64_t nowMs) {
+  int32_t id = deviceId(window.mac);
+  if (id < 0) return false;
+  uint32_t sequence = beginWrite(id);
+  uint8_t flags = flags_[id].load(std::memory_order_relaxed) & (LAST_VALUE_HAS_HEARTBEAT | LAST_VALUE_ONLINE);
+  flags |= LAST_VALUE_HAS_WINDOW | (window.offset ? LAST_VALUE_OFFSET : 0);
+  flags |= (uint8_t)window.type << LAST_VALUE_TYPE_SHIFT;
+  co2_[id].store(window.avgCo2, std::memory_order_relaxed);
+  credits_[id].store(window.credits, std::memory_order_relaxed);
+  flags_[id].store(flags, std::memory_order_relaxed);
+  updatedMs_[id].store(nowMs, std::memory_order_relaxed);
+  endWrite(id, sequence);
+  return true;
+}
+
+bool LastValueCache::update(const Heartbeat& heartbeat, DeviceType type, int64_t nowMs) {
+  int32_t id = deviceId(heartbeat.mac);
+  if (id < 0) return false;
+  uint32_t sequence = beginWrite(id);
+  uint8_t flags = flags_[id].load(std::memory_order_relaxed);
+  flags &= ~LAST_VALUE_ONLINE;
+  flags |= LAST_VALUE_HAS_HEARTBEAT | (heartbeat.online ? LAST_VALUE_ONLINE : 0);
+  if (type != DeviceType::Unknown) {
+    flags = (flags & ~(3 << LAST_VALUE_TYPE_SHIFT)) | (uint8_t)type << LAST_VALUE_TYPE_SHIFT;
+  }
+  int rssi = heartbeat.rssi < -128 ? -128 : heartbeat.rssi > 127 ? 127 : heartbeat.rssi;
+  rssi_[id].store((int8_t)rssi, std::memory_order_relaxed);
+  flags_[id].store(flags, std::memory_order_relaxed);
+  updatedMs_[id].store(nowMs, std::memory_order_relaxed);
+  endWrite(id, sequence);
+  return true;
+}
+
+void LastValueCache::copyRow(uint32_t id, DeviceLastValue& out) const {
+  out.mac = mac_[id].load(std::memory_order_relaxed);
+  out.co2 = co2_[id].load(std::memory_order_relaxed);
+  out.credits = credits_[id].load(std::memory_order_relaxed);
+  out.rssi = rssi_[id].load(std::memory_order_relaxed);
+  out.flags = flags_[id].load(std::memory_order_relaxed);
+  out.updatedMs = updatedMs_[id].load(std::memory_order_relaxed);
+}
+
+DeviceLastValue LastValueCache::read(uint32_t id) const {
+  DeviceLastValue value;
+  while (true) {
+    uint32_t before = sequence_[id].load(std::memory_order_acquire);
+    if (before & 1) continue;
+    copyRow(id, value);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_[id].load(std::memory_order_relaxed) == before) {
+      value.version = before;
+      return value;
+    }
+  }
+}
+
+size_t LastValueCache::readRange(uint32_t first, uint32_t count, DeviceLastValue* out) const {
+  size_t retried = 0;
+  uint32_t before[READ_BLOCK];
+  for (uint32_t base = 0; base < count; base += READ_BLOCK) {
+    uint32_t rows = std::min(READ_BLOCK, count - base);
+    const uint32_t start = first + base;
+    // One pass over the block, then only the rows a writer touched meanwhile
+    for (uint32_t i = 0; i < rows; i++) before[i] = sequence_[start + i].load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < rows; i++) copyRow(start + i, out[base + i]);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    for (uint32_t i = 0; i < rows; i++) {
+      if (!(before[i] & 1) && sequence_[start + i].load(std::memory_order_relaxed) == before[i]) {
+        out[base + i].version = before[i];
+      } else {
+        out[base + i] = read(start + i);
+        retried++;
+      }
+    }
+  }
+  return retried;
+}
+
+size_t LastValueCache::snapshot(std::vector<uint8_t>& out, int64_t nowMs) const {
+  uint32_t devices = deviceCount();
+  size_t bytes = sizeof(LastValueSnapshotHeader) + devices * LAST_VALUE_SNAPSHOT_ROW_BYTES;
+  out.resize(bytes);
+
+  LastValueSnapshotHeader header = {LAST_VALUE_SNAPSHOT_MAGIC, devices, nowMs};
+  memcpy(out.data(), &header, sizeof(header));
+  uint8_t* macs = out.data() + sizeof(header);
+  uint8_t* co2 = macs + devices * sizeof(uint64_t);
+  uint8_t* credits = co2 + devices * sizeof(float);
+  uint8_t* rssi = credits + devices * sizeof(float);
+  uint8_t* flags = rssi + devices;
+  uint8_t* ages = flags + devices;
+
+  DeviceLastValue block[READ_BLOCK];
+  for (uint32_t base = 0; base < devices; base += READ_BLOCK) {
+    uint32_t rows = std::min(READ_BLOCK, devices - base);
+    readRange(base, rows, block);
+    for (uint32_t i = 0; i < rows; i++) {
+      const DeviceLastValue& row = block[i];
+      uint32_t id = base + i;
+      int64_t ageMs = nowMs - row.updatedMs;
+      uint32_t age = row.flags == 0 ? UINT32_MAX : ageMs <= 0 ? 0 : (uint32_t)std::min<int64_t>(ageMs / 1000, UINT32_MAX - 1);
+      memcpy(macs + id * sizeof(uint64_t), &row.mac, sizeof(uint64_t));
+      memcpy(co2 + id * sizeof(float), &row.co2, sizeof(float));
+      memcpy(credits + id * sizeof(float), &row.credits, sizeof(float));
+      rssi[id] = (uint8_t)row.rssi;
+      flags[id] = row.flags;
+      memcpy(ages + id * sizeof(uint32_t), &age, sizeof(uint32_t));
+    }
+  }
+  return bytes;
+}
+
+bool decodeLastValueSnapshot(const uint8_t* data, size_t length, int64_t& asOfMs,
+                             std::vector<DeviceLastValue>& devices) {
+  LastValueSnapshotHeader header;
+  if (length < sizeof(header)) return false;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != LAST_VALUE_SNAPSHOT_MAGIC) return false;
+  if (length != sizeof(header) + (size_t)header.devices * LAST_VALUE_SNAPSHOT_ROW_BYTES) return false;
+
+  uint32_t n = header.devices;
+  const uint8_t* macs = data + sizeof(header);
+  const uint8_t* co2 = macs + n * sizeof(uint64_t);
+  const uint8_t* credits = co2 + n * sizeof(float);
+  const uint8_t* rssi = credits + n * sizeof(float);
+  const uint8_t* flags = rssi + n;
+  const uint8_t* ages = flags + n;
+
+  asOfMs = header.asOfMs;
+  devices.resize(n);
+  for (uint32_t i = 0; i < n; i++) {
+    DeviceLastValue& device = devices[i];
+    uint32_t age;
+    memcpy(&device.mac, macs + i * sizeof(uint64_t), sizeof(uint64_t));
+    memcpy(&device.co2, co2 + i * sizeof(float), sizeof(float));
+    memcpy(&device.credits, credits + i * sizeof(float), sizeof(float));
+    device.rssi = (int8_t)rssi[i];
+    device.flags = flags[i];
+    memcpy(&age, ages + i * sizeof(uint32_t), sizeof(uint32_t));
+    device.updatedMs = age == UINT32_MAX ? 0 : header.asOfMs - (int64_t)age * 1000;
+    device.version = 0;
+  }
+  return true;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include <Telemetry.h>
+
+/*
+ * Latest state of every device, for dashboards.
+ *
+ * Each MAC gets a dense id the first time it is seen (lock-free
+ * open-addressing table), and the values live in struct-of-arrays columns
+ * indexed by that id, each column 64-byte aligned. A fleet overview
+ * reads a few contiguous columns instead of gathering a record per
+ * device, and never touches history.
+ *
+ * Every row has its own sequence number, used as a seqlock: a writer makes
+ * it odd (by compare-and-swap, so two ingest threads updating the same
+ * device take turns), stores the fields and makes it even again. Readers
+ * never block writers; they copy a block of rows, then re-check the block's
+ * sequences and copy again only the rows that moved. The sequence also
+ * tells a reader whether a device changed since it last looked.
+ */
+
+const uint32_t LAST_VALUE_SNAPSHOT_MAGIC = 0x3143564C;   // "LVC1"
+
+// Row flags
+const uint8_t LAST_VALUE_OFFSET = 0x01;          // "o" of the last window
+const uint8_t LAST_VALUE_HAS_WINDOW = 0x02;
+const uint8_t LAST_VALUE_HAS_HEARTBEAT = 0x04;
+const uint8_t LAST_VALUE_ONLINE = 0x08;
+const int LAST_VALUE_TYPE_SHIFT = 4;             // DeviceType in bits 4-5
+
+/**
+ * @brief One device's row, copied out consistently
+ */
+struct DeviceLastValue {
+  uint64_t mac = 0;
+  float co2 = 0;              // avg_c of the last window
+  float credits = 0;          // cr of the last window
+  int8_t rssi = 0;            // from the last heartbeat
+  uint8_t flags = 0;
+  int64_t updatedMs = 0;      // arrival of the last window or heartbeat
+  uint32_t version = 0;       // even; advances by 2 per update
+
+  bool offset() const { return flags & LAST_VALUE_OFFSET; }
+  DeviceType type() const { return (DeviceType)((flags >> LAST_VALUE_TYPE_SHIFT) & 3); }
+};
+
+/**
+ * @brief Header of the binary fleet snapshot
+ *
+ * Followed by one column per field, devices in id order: uint64 mac,
+ * float co2, float credits, int8 rssi, uint8 flags, uint32 age in seconds
+ * (relative to asOfMs), 22 bytes per device. Little-endian, as on the host.
+ */
+struct LastValueSnapshotHeader {
+  uint32_t magic;
+  uint32_t devices;
+  int64_t asOfMs;
+};
+
+const size_t LAST_VALUE_SNAPSHOT_ROW_BYTES = 8 + 4 + 4 + 1 + 1 + 4;
+
+class LastValueCache {
+public:
+  /**
+   * @param capacity Devices tracked at most; later MACs are not cached
+   */
+  explicit LastValueCache(uint32_t capacity);
+  ~LastValueCache();
+
+  LastValueCache(const LastValueCache&) = delete;
+  LastValueCache& operator=(const LastValueCache&) = delete;
+
+  /**
+   * @brief Dense id of a device, assigned on first sight
+   * @return -1 if the cache is full
+   */
+  int32_t deviceId(uint64_t mac);
+
+  /**
+   * @brief Id of a device already seen, -1 otherwise
+   */
+  int32_t findDevice(uint64_t mac) const;
+
+  /**
+   * @brief Record a sensor_data window (any thread)
+   */
+  bool update(const SensorWindow& window, int64_t nowMs);
+
+  /**
+   * @brief Record a heartbeat (any thread)
+   */
+  bool update(const Heartbeat& heartbeat, DeviceType type, int64_t nowMs);
+
+  /**
+   * @brief Consistent copy of one row
+   */
+  DeviceLastValue read(uint32_t id) const;
+
+  /**
+   * @brief Row sequence, to tell whether a device changed since a previous read
+   */
+  uint32_t version(uint32_t id) const { return sequence_[id].load(std::memory_order_acquire) & ~1u; }
+
+  /**
+   * @brief Consistent copy of rows [first, first + count) into out
+   * @return Rows copied again because a writer moved them
+   */
+  size_t readRange(uint32_t first, uint32_t count, DeviceLastValue* out) const;
+
+  /**
+   * @brief Whole fleet in the binary snapshot format, replacing out's contents
+   * @return Bytes written
+   */
+  size_t snapshot(std::vector<uint8_t>& out, int64_t nowMs) const;
+
+  /**
+   * @brief Devices with an id so far
+   */
+  uint32_t deviceCount() const;
+
+  uint32_t capacity() const { return capacity_; }
+
+private:
+  static const uint32_t NO_ID = UINT32_MAX;
+  static const uint32_t FULL = UINT32_MAX - 1;
+
+  uint32_t beginWrite(uint32_t id);
+  void endWrite(uint32_t id, uint32_t sequence) { sequence_[id].store(sequence + 2, std::memory_order_release); }
+  void copyRow(uint32_t id, DeviceLastValue& out) const;
+
+  uint32_t capacity_;
+
+  // MAC -> id index, at least twice the capacity, power of two; MAC 0 marks a free slot
+  std::atomic<uint64_t>* indexMacs_;
+  std::atomic<uint32_t>* indexIds_;
+  uint64_t indexMask_;
+  std::atomic<uint32_t> nextId_{0};
+
+  // Columns, one entry per id
+  std::atomic<uint32_t>* sequence_;
+  std::atomic<uint64_t>* mac_;
+  std::atomic<float>* co2_;
+  std::atomic<float>* credits_;
+  std::atomic<int8_t>* rssi_;
+  std::atomic<uint8_t>* flags_;
+  std::atomic<int64_t>* updatedMs_;
+};
+
+/**
+ * @brief Read a snapshot back (dashboards, tests)
+ * @return false if the buffer isn't a complete snapshot
+ */
+bool decodeLastValueSnapshot(const uint8_t* data, size_t length, int64_t& asOfMs,
+                             std::vector<DeviceLastValue>& devices);
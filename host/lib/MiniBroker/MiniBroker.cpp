@@ -0,0 +1,941 @@
+#include "MiniBroker.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+// Control packet types (high nibble of the first byte)
+static const uint8_t CONNECT = 0x10;
+static const uint8_t CONNACK = 0x20;
+static const uint8_t PUBLISH = 0x30;
+static const uint8_t PUBACK = 0x40;
+static const uint8_t PUBREC = 0x50;
+static const uint8_t PUBREL = 0x60;
+static const uint8_t PUBCOMP = 0x70;
+static const uint8_t SUBSCRIBE = 0x80;
+static const uint8_t SUBACK = 0x90;
+static const uint8_t UNSUBSCRIBE = 0xA0;
+static const uint8_t UNSUBACK = 0xB0;
+static const uint8_t PINGREQ = 0xC0;
+static const uint8_t PINGRESP = 0xD0;
+static const uint8_t DISCONNECT = 0xE0;
+
+static const uint8_t MQTT_3_1_1 = 4;
+static const uint8_t MQTT_5 = 5;
+
+static const int MAX_EVENTS = 256;
+static const size_t READ_CHUNK = 65536;
+static const int MAX_IOVECS = 64;
+static const size_t MAX_PACKET = 1 << 20;
+static const int64_t EXPIRY_SCAN_MS = 1000;
+
+// A QoS 1 message kept for resending, shared by every session it went to
+struct MiniBroker::Message {
+  std::string topic;
+  std::vector<uint8_t> payload;
+};
+
+struct MiniBroker::Client {
+  int fd;
+  bool connected = false;       // CONNECT accepted
+  bool closing = false;
+  bool dirty = false;           // in dirty_ this pass
+  bool writeWatched = false;    // EPOLLOUT armed
+  uint8_t version = MQTT_3_1_1;
+  uint16_t keepAliveSeconds = 0;
+  int64_t lastSeenMs = 0;
+  uint64_t lastRoute = 0;       // routeSequence_ of the last delivery, to send overlaps once
+  std::string id;
+  std::vector<uint8_t> rx;
+  struct Pending {
+    PacketBuffer packet;
+    size_t offset;
+  };
+  std::deque<Pending> tx;
+  size_t queuedBytes = 0;
+  std::vector<std::string> filters;
+
+  // Session state, kept in sessions_ after the connection if persistent
+  bool persistent = false;
+  uint32_t sessionExpirySeconds = 0;
+  int64_t expiresAtMs = 0;      // while stored
+  uint16_t nextPacketId = 1;
+  struct Unacked {
+    uint16_t packetId;
+    bool sent;                    // went out on some connection, DUP when sent again
+    std::shared_ptr<const Message> message;
+  };
+  std::deque<Unacked> unacked;  // QoS 1 deliveries awaiting PUBACK
+  size_t unackedBytes = 0;
+};
+
+struct MiniBroker::TopicNode {
+  // A "$share/<group>/..." group on this filter, served round-robin
+  struct Subscriber {
+    Client* client;
+    uint8_t qos;                // granted: 0 or 1
+  };
+  struct SharedGroup {
+    std::string name;
+    std::vector<Subscriber> members;
+    size_t next = 0;
+  };
+
+  std::unordered_map<std::string, std::unique_ptr<TopicNode>> children;  // "+" and "#" included
+  std::vector<Subscriber> subscribers;
+  std::vector<SharedGroup> groups;
+
+  /**
+   * @brief The plain subscribers, or the members of a shared group
+   */
+  std::vector<Subscriber>* list(const std::string& group, bool create) {
+    if (group.empty()) return &subscribers;
+    for (SharedGroup& g : groups) {
+      if (g.name == group) return &g.members;
+    }
+    if (!create) return nullptr;
+    groups.push_back(SharedGroup());
+    groups.back().name = group;
+    return &groups.back().members;
+  }
+};
+
+static int64_t steadyNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Decode a variable byte integer
+ * @return Bytes used, 0 if more data is needed, -1 if malformed
+ */
+static int readVarint(const uint8_t* data, size_t available, size_t& value) {
+  value = 0;
+  for (size_t i = 0; i < 4; i++) {
+    if (i >= available) return 0;
+    value |= (size_t)(data[i] & 0x7F) << (7 * i);
+    if (!(data[i] & 0x80)) return (int)i + 1;
+  }
+  return -1;
+}
+
+static void putVarint(std::vector<uint8_t>& out, size_t value) {
+  do {
+    uint8_t digit = value % 128;
+    value /= 128;
+    out.push_back(digit | (value ? 0x80 : 0));
+  } while (value);
+}
+
+/**
+ * @brief Bounds-checked reader over a packet body
+ */
+struct PacketReader {
+  const uint8_t* data;
+  size_t length;
+  size_t position = 0;
+
+  bool ok() const { return position <= length; }
+  size_t left() const { return position <= length ? length - position : 0; }
+
+  uint8_t byte() {
+    if (position >= length) { position = length + 1; return 0; }
+    return data[position++];
+  }
+  uint16_t word() {
+    uint16_t high = byte();
+    return (high << 8) | byte();
+  }
+  bool string(const char*& text, size_t& size) {
+    size = word();
+    if (!ok() || left() < size) { position = length + 1; return false; }
+    text = (const char*)data + position;
+    position += size;
+    return true;
+  }
+  uint32_t longWord() {
+    uint32_t high = word();
+    return (high << 16) | word();
+  }
+  /**
+   * @brief Skip the CONNECT properties, keeping the Session Expiry Interval
+   */
+  void connectProperties(uint32_t& sessionExpiry) {
+    size_t size = 0;
+    int used = readVarint(data + position, left(), size);
+    if (used <= 0 || left() < used + size) { position = length + 1; return; }
+    position += used;
+    size_t end = position + size;
+    const char* text;
+    size_t textLength;
+    while (position < end && ok()) {
+      switch (byte()) {
+        case 0x11: sessionExpiry = longWord(); break;
+        case 0x27: longWord(); break;                   // maximum packet size
+        case 0x21: case 0x22: word(); break;            // receive maximum, topic alias maximum
+        case 0x17: case 0x19: byte(); break;            // problem / response information
+        case 0x15: case 0x16: string(text, textLength); break;  // authentication method / data
+        case 0x26: string(text, textLength); string(text, textLength); break;  // user property
+        default: position = end; break;                 // not valid here; ignore the rest
+      }
+    }
+    if (position > end) position = length + 1;
+  }
+  void skipProperties() {
+    size_t size = 0;
+    int used = readVarint(data + position, left(), size);
+    if (used <= 0 || left() < used + size) { position = length + 1; return; }
+    position += used + size;
+  }
+};
+
+/**
+ * @brief Split a topic or filter into levels (views into the text)
+ */
+static void splitLevels(const char* text, size_t length, std::vector<std::pair<const char*, size_t>>& levels) {
+  levels.clear();
+  size_t start = 0;
+  for (size_t i = 0; i <= length; i++) {
+    if (i == length || text[i] == '/') {
+      levels.emplace_back(text + start, i - start);
+      start = i + 1;
+    }
+  }
+}
+
+/**
+ * @brief Encode a PUBLISH for one protocol version
+ */
+static std::vector<uint8_t>* encodePublish(uint8_t version, uint8_t flags, uint16_t packetId, const char* topic,
+                                           size_t topicLength, const uint8_t* payload, size_t payloadLength) {
+  std::vector<uint8_t>* buffer = new std::vector<uint8_t>();
+  size_t bodyLength = 2 + topicLength + (packetId ? 2 : 0) + (version == MQTT_5 ? 1 : 0) + payloadLength;
+  buffer->reserve(5 + bodyLength);
+  buffer->push_back(PUBLISH | flags);
+  putVarint(*buffer, bodyLength);
+  buffer->push_back(topicLength >> 8);
+  buffer->push_back(topicLength & 0xFF);
+  buffer->insert(buffer->end(), topic, topic + topicLength);
+  if (packetId) {
+    buffer->push_back(packetId >> 8);
+    buffer->push_back(packetId & 0xFF);
+  }
+  if (version == MQTT_5) buffer->push_back(0);
+  buffer->insert(buffer->end(), payload, payload + payloadLength);
+  return buffer;
+}
+
+static bool validFilter(const std::vector<std::pair<const char*, size_t>>& levels) {
+  for (size_t i = 0; i < levels.size(); i++) {
+    const char* level = levels[i].first;
+    size_t size = levels[i].second;
+    for (size_t j = 0; j < size; j++) {
+      if ((level[j] == '+' || level[j] == '#') && size != 1) return false;
+    }
+    if (size == 1 && level[0] == '#' && i + 1 != levels.size()) return false;
+  }
+  return true;
+}
+
+MiniBroker::MiniBroker(const MiniBrokerConfig& config) : config_(config), root_(new TopicNode()) {}
+
+MiniBroker::~MiniBroker() {
+  for (auto& client : clients_) {
+    if (client) close(client->fd);
+  }
+  if (listenFd_ >= 0) close(listenFd_);
+  if (wakeFd_ >= 0) close(wakeFd_);
+  if (epollFd_ >= 0) close(epollFd_);
+}
+
+bool MiniBroker::start() {
+  listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) return false;
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(config_.port);
+  if (inet_pton(AF_INET, config_.bindAddress, &address.sin_addr) != 1) return false;
+  if (bind(listenFd_, (sockaddr*)&address, sizeof(address)) != 0) return false;
+  if (listen(listenFd_, 4096) != 0) return false;
+  socklen_t addressLength = sizeof(address);
+  getsockname(listenFd_, (sockaddr*)&address, &addressLength);
+  port_ = ntohs(address.sin_port);
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || wakeFd_ < 0) return false;
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = listenFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+  event.data.fd = wakeFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+  lastExpiryMs_ = steadyNowMs();
+  return true;
+}
+
+void MiniBroker::run() {
+  running_ = true;
+  while (running_) poll(100);
+}
+
+void MiniBroker::stop() {
+  running_ = false;
+  uint64_t one = 1;
+  if (wakeFd_ >= 0 && write(wakeFd_, &one, sizeof(one)) < 0) {
+    // Already signalled
+  }
+}
+
+void MiniBroker::publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos) {
+  {
+    std::lock_guard<std::mutex> guard(injectLock_);
+    injected_.push_back({topic, std::vector<uint8_t>(payload, payload + length), qos});
+  }
+  uint64_t one = 1;
+  if (wakeFd_ >= 0 && write(wakeFd_, &one, sizeof(one)) < 0) {
+    // Already signalled
+  }
+}
+
+MiniBrokerStats MiniBroker::stats() const {
+  MiniBrokerStats stats;
+  stats.connections = connections_.load(std::memory_order_relaxed);
+  stats.connectionsAccepted = connectionsAccepted_.load(std::memory_order_relaxed);
+  stats.messagesIn = messagesIn_.load(std::memory_order_relaxed);
+  stats.messagesOut = messagesOut_.load(std::memory_order_relaxed);
+  stats.messagesDropped = messagesDropped_.load(std::memory_order_relaxed);
+  stats.messagesStored = messagesStored_.load(std::memory_order_relaxed);
+  stats.sessionsResumed = sessionsResumed_.load(std::memory_order_relaxed);
+  stats.sessionsStored = sessionsStored_.load(std::memory_order_relaxed);
+  stats.bytesIn = bytesIn_.load(std::memory_order_relaxed);
+  stats.bytesOut = bytesOut_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+int MiniBroker::poll(int timeoutMs) {
+  if (epollFd_ < 0) return 0;
+  epoll_event events[MAX_EVENTS];
+  int count = epoll_wait(epollFd_, events, MAX_EVENTS, timeoutMs);
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == listenFd_) {
+      acceptClients();
+    } else if (fd == wakeFd_) {
+      uint64_t value;
+      if (read(wakeFd_, &value, sizeof(value)) < 0) {
+        // Nothing pending
+      }
+      std::vector<Injected> batch;
+      {
+        std::lock_guard<std::mutex> guard(injectLock_);
+        batch.swap(injected_);
+      }
+      for (const Injected& message : batch) {
+        messagesIn_.fetch_add(1, std::memory_order_relaxed);
+        route(message.topic.data(), message.topic.size(), message.payload.data(), message.payload.size(), message.qos);
+      }
+    } else if ((size_t)fd < clients_.size() && clients_[fd]) {
+      Client* client = clients_[fd].get();
+      if (client->closing) continue;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readClient(client);
+      if (!client->closing && (events[i].events & EPOLLOUT)) flush(client);
+    }
+  }
+
+  // One writev per client for everything routed this pass
+  for (Client* client : dirty_) {
+    client->dirty = false;
+    if (!client->closing) flush(client);
+  }
+  dirty_.clear();
+
+  int64_t now = steadyNowMs();
+  if (now - lastExpiryMs_ >= EXPIRY_SCAN_MS) {
+    lastExpiryMs_ = now;
+    expireIdleClients(now);
+  }
+  releaseClosed();
+  return count;
+}
+
+void MiniBroker::acceptClients() {
+  while (true) {
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    if (connections_.load(std::memory_order_relaxed) >= config_.maxConnections) {
+      close(fd);
+      continue;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if ((size_t)fd >= clients_.size()) clients_.resize(fd + 1);
+    clients_[fd].reset(new Client());
+    Client* client = clients_[fd].get();
+    client->fd = fd;
+    client->lastSeenMs = steadyNowMs();
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+    connections_.fetch_add(1, std::memory_order_relaxed);
+    connectionsAccepted_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void MiniBroker::readClient(Client* client) {
+  uint8_t buffer[READ_CHUNK];
+  ssize_t n = recv(client->fd, buffer, sizeof(buffer), 0);
+  if (n <= 0) {
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    closeClient(client);
+    return;
+  }
+  client->rx.insert(client->rx.end(), buffer, buffer + n);
+  client->lastSeenMs = steadyNowMs();
+  bytesIn_.fetch_add(n, std::memory_order_relaxed);
+
+  size_t offset = 0;
+  while (!client->closing) {
+    size_t available = client->rx.size() - offset;
+    if (available < 2) break;
+    size_t length = 0;
+    int lengthBytes = readVarint(client->rx.data() + offset + 1, available - 1, length);
+    if (lengthBytes < 0 || length > MAX_PACKET) {
+      closeClient(client);
+      return;
+    }
+    if (lengthBytes == 0 || available < 1 + lengthBytes + length) break;
+
+    uint8_t type = client->rx[offset];
+    const uint8_t* body = client->rx.data() + offset + 1 + lengthBytes;
+    offset += 1 + lengthBytes + length;
+    if (!handlePacket(client, type, body, length)) {
+      closeClient(client);
+      return;
+    }
+  }
+  if (offset) client->rx.erase(client->rx.begin(), client->rx.begin() + offset);
+}
+
+bool MiniBroker::handlePacket(Client* client, uint8_t type, const uint8_t* body, size_t length) {
+  uint8_t kind = type & 0xF0;
+  if (!client->connected) return kind == CONNECT && handleConnect(client, body, length);
+
+  switch (kind) {
+    case PUBLISH:
+      return handlePublish(client, type, body, length);
+    case PUBREL:
+      // QoS 2 second half; the message was routed on PUBLISH already
+      if (length < 2) return false;
+      sendControl(client, {PUBCOMP, 0x02, body[0], body[1]});
+      return true;
+    case SUBSCRIBE:
+      return handleSubscribe(client, body, length, true);
+    case UNSUBSCRIBE:
+      return handleSubscribe(client, body, length, false);
+    case PINGREQ:
+      sendControl(client, {PINGRESP, 0x00});
+      return true;
+    case DISCONNECT:
+      return false;
+    case PUBACK:
+      handlePuback(client, body, length);
+      return true;
+    case PUBREC:
+    case PUBCOMP:
+      return true;  // never sent QoS 2, nothing to track
+    default:
+      return false;
+  }
+}
+
+bool MiniBroker::handleConnect(Client* client, const uint8_t* body, size_t length) {
+  PacketReader reader = {body, length};
+  const char* protocol;
+  size_t protocolLength;
+  if (!reader.string(protocol, protocolLength)) return false;
+  uint8_t version = reader.byte();
+  uint8_t flags = reader.byte();
+  client->keepAliveSeconds = reader.word();
+  if (!reader.ok()) return false;
+  if (protocolLength != 4 || memcmp(protocol, "MQTT", 4) != 0 || (version != MQTT_3_1_1 && version != MQTT_5)) {
+    sendControl(client, {CONNACK, 0x02, 0x00, 0x01});  // unacceptable protocol version
+    flush(client);
+    return false;
+  }
+  client->version = version;
+  uint32_t sessionExpiry = 0;
+  if (version == MQTT_5) reader.connectProperties(sessionExpiry);
+
+  const char* id;
+  size_t idLength;
+  if (!reader.string(id, idLength)) return false;
+  if (flags & 0x04) {
+    // Will: properties (5), topic, payload; accepted but never published
+    const char* skipped;
+    size_t skippedLength;
+    if (version == MQTT_5) reader.skipProperties();
+    if (!reader.string(skipped, skippedLength) || !reader.string(skipped, skippedLength)) return false;
+  }
+  if (idLength) {
+    client->id.assign(id, idLength);
+  } else {
+    client->id = "mini-" + std::to_string(++anonymousClients_);
+  }
+
+  // 3.1.1 keeps the session unless clean session is set; 5 keeps it for the expiry interval
+  bool cleanStart = flags & 0x02;
+  if (version != MQTT_5) sessionExpiry = cleanStart ? 0 : config_.maxSessionExpirySeconds;
+  client->sessionExpirySeconds = std::min(sessionExpiry, config_.maxSessionExpirySeconds);
+  client->persistent = client->sessionExpirySeconds > 0;
+
+  // A second connection with the same client id takes the session over
+  Client* previous = nullptr;
+  for (auto& other : clients_) {
+    if (!other || other.get() == client || !other->connected || other->id != client->id) continue;
+    if (!other->closing) closeClient(other.get());
+    if (other->persistent) previous = other.get();  // closed, but not stored until the end of the pass
+  }
+  if (!previous) {
+    auto stored = sessions_.find(client->id);
+    if (stored != sessions_.end()) previous = stored->second.get();
+  }
+  bool present = false;
+  if (previous && cleanStart) {
+    discardSession(previous);
+  } else if (previous) {
+    present = resumeSession(client, previous);
+  }
+
+  client->connected = true;
+  uint8_t acknowledge = present ? 0x01 : 0x00;  // session present
+  if (version == MQTT_5) {
+    sendControl(client, {CONNACK, 0x03, acknowledge, 0x00, 0x00});
+  } else {
+    sendControl(client, {CONNACK, 0x02, acknowledge, 0x00});
+  }
+  if (present) sendUnacked(client);
+  return true;
+}
+
+bool MiniBroker::resumeSession(Client* client, Client* stored) {
+  for (const std::string& filter : stored->filters) moveSubscription(stored, client, filter);
+  client->filters.swap(stored->filters);
+  client->unacked.swap(stored->unacked);
+  client->unackedBytes = stored->unackedBytes;
+  client->nextPacketId = stored->nextPacketId;
+  stored->filters.clear();
+  stored->unacked.clear();
+  stored->persistent = false;
+  if (stored->fd < 0) {
+    std::string id = stored->id;
+    sessions_.erase(id);
+    sessionsStored_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  sessionsResumed_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void MiniBroker::discardSession(Client* client) {
+  for (const std::string& filter : client->filters) removeSubscription(client, filter);
+  client->filters.clear();
+  client->unacked.clear();
+  client->unackedBytes = 0;
+  client->persistent = false;
+  if (client->fd < 0) {
+    std::string id = client->id;
+    sessions_.erase(id);
+    sessionsStored_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+bool MiniBroker::handlePublish(Client* client, uint8_t type, const uint8_t* body, size_t length) {
+  PacketReader reader = {body, length};
+  const char* topic;
+  size_t topicLength;
+  if (!reader.string(topic, topicLength) || topicLength == 0) return false;
+  uint8_t qos = (type >> 1) & 0x03;
+  uint16_t packetId = 0;
+  if (qos > 0) packetId = reader.word();
+  if (client->version == MQTT_5) reader.skipProperties();
+  if (!reader.ok() || qos > 2) return false;
+  if (memchr(topic, '+', topicLength) || memchr(topic, '#', topicLength)) return false;
+
+  messagesIn_.fetch_add(1, std::memory_order_relaxed);
+  route(topic, topicLength, body + reader.position, length - reader.position, qos);
+  if (qos == 1) sendControl(client, {PUBACK, 0x02, (uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF)});
+  if (qos == 2) sendControl(client, {PUBREC, 0x02, (uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF)});
+  return true;
+}
+
+bool MiniBroker::handleSubscribe(Client* client, const uint8_t* body, size_t length, bool subscribe) {
+  PacketReader reader = {body, length};
+  uint16_t packetId = reader.word();
+  if (client->version == MQTT_5) reader.skipProperties();
+  if (!reader.ok()) return false;
+
+  std::vector<uint8_t> codes;
+  while (reader.left() > 0) {
+    const char* filter;
+    size_t filterLength;
+    if (!reader.string(filter, filterLength)) return false;
+    std::string text(filter, filterLength);
+    if (subscribe) {
+      uint8_t qos = std::min(reader.byte() & 0x03, 1);  // requested QoS (low bits of the 5 options); 2 is granted as 1
+      if (!reader.ok()) return false;
+      codes.push_back(addSubscription(client, text, qos) ? qos : 0x80);
+    } else {
+      auto it = std::find(client->filters.begin(), client->filters.end(), text);
+      if (it != client->filters.end()) {
+        removeSubscription(client, text);
+        client->filters.erase(it);
+        codes.push_back(0x00);
+      } else {
+        codes.push_back(0x11);  // no subscription existed (MQTT 5)
+      }
+    }
+  }
+  if (subscribe && codes.empty()) return false;
+
+  std::vector<uint8_t> packet;
+  bool withCodes = subscribe || client->version == MQTT_5;
+  bool withProperties = client->version == MQTT_5;
+  packet.push_back(subscribe ? SUBACK : UNSUBACK);
+  putVarint(packet, 2 + (withProperties ? 1 : 0) + (withCodes ? codes.size() : 0));
+  packet.push_back(packetId >> 8);
+  packet.push_back(packetId & 0xFF);
+  if (withProperties) packet.push_back(0);
+  if (withCodes) packet.insert(packet.end(), codes.begin(), codes.end());
+  sendControl(client, std::move(packet));
+  return true;
+}
+
+MiniBroker::TopicNode* MiniBroker::filterNode(const std::string& filter, std::string& group, bool create) {
+  // "$share/<group>/<filter>": one member of the group gets each message
+  group.clear();
+  size_t start = 0;
+  if (filter.compare(0, 7, "$share/") == 0) {
+    size_t slash = filter.find('/', 7);
+    if (slash == std::string::npos || slash == 7) return nullptr;
+    group = filter.substr(7, slash - 7);
+    start = slash + 1;
+  }
+  if (filter.empty() || (!group.empty() && start >= filter.size())) return nullptr;
+  std::vector<std::pair<const char*, size_t>> levels;
+  splitLevels(filter.data() + start, filter.size() - start, levels);
+  if (!validFilter(levels)) return nullptr;
+
+  TopicNode* node = root_.get();
+  for (const auto& level : levels) {
+    if (create) {
+      std::unique_ptr<TopicNode>& child = node->children[std::string(level.first, level.second)];
+      if (!child) child.reset(new TopicNode());
+      node = child.get();
+    } else {
+      auto it = node->children.find(std::string(level.first, level.second));
+      if (it == node->children.end()) return nullptr;
+      node = it->second.get();
+    }
+  }
+  return node;
+}
+
+bool MiniBroker::addSubscription(Client* client, const std::string& filter, uint8_t qos) {
+  std::string group;
+  TopicNode* node = filterNode(filter, group, true);
+  if (!node) return false;
+  std::vector<TopicNode::Subscriber>* list = node->list(group, true);
+  // Subscribing to the same filter again replaces the granted QoS
+  for (TopicNode::Subscriber& subscriber : *list) {
+    if (subscriber.client == client) {
+      subscriber.qos = qos;
+      return true;
+    }
+  }
+  list->push_back({client, qos});
+  client->filters.push_back(filter);
+  return true;
+}
+
+void MiniBroker::removeSubscription(Client* client, const std::string& filter) {
+  std::string group;
+  TopicNode* node = filterNode(filter, group, false);
+  std::vector<TopicNode::Subscriber>* list = node ? node->list(group, false) : nullptr;
+  if (!list) return;
+  list->erase(std::remove_if(list->begin(), list->end(),
+                             [&](const TopicNode::Subscriber& subscriber) { return subscriber.client == client; }),
+              list->end());
+  for (TopicNode::SharedGroup& g : node->groups) {
+    if (g.next >= g.members.size()) g.next = 0;
+  }
+}
+
+void MiniBroker::moveSubscription(Client* from, Client* to, const std::string& filter) {
+  std::string group;
+  TopicNode* node = filterNode(filter, group, false);
+  std::vector<TopicNode::Subscriber>* list = node ? node->list(group, false) : nullptr;
+  if (!list) return;
+  for (TopicNode::Subscriber& subscriber : *list) {
+    if (subscriber.client == from) subscriber.client = to;
+  }
+}
+
+void MiniBroker::route(const char* topic, size_t topicLength, const uint8_t* payload, size_t payloadLength,
+                       uint8_t qos) {
+  // Encoded once per protocol version, shared by every QoS 0 subscriber
+  PacketBuffer packets[2];
+  auto packetFor = [&](uint8_t version) -> const PacketBuffer& {
+    PacketBuffer& packet = packets[version == MQTT_5 ? 1 : 0];
+    if (!packet) packet.reset(encodePublish(version, 0, 0, topic, topicLength, payload, payloadLength));
+    return packet;
+  };
+  // QoS 1 copies carry a packet id per session, so only the message is shared
+  std::shared_ptr<const Message> message;
+
+  uint64_t sequence = ++routeSequence_;
+  auto deliver = [&](const TopicNode::Subscriber& subscriber) {
+    Client* client = subscriber.client;
+    if (qos && subscriber.qos) {
+      if (!message) {
+        std::shared_ptr<Message> copy = std::make_shared<Message>();
+        copy->topic.assign(topic, topicLength);
+        copy->payload.assign(payload, payload + payloadLength);
+        message = copy;
+      }
+      sendReliable(client, message);
+    } else if (!client->closing) {
+      send(client, packetFor(client->version));
+    }
+  };
+  auto deliverNode = [&](TopicNode* node) {
+    for (const TopicNode::Subscriber& subscriber : node->subscribers) {
+      if (subscriber.client->lastRoute == sequence) continue;
+      subscriber.client->lastRoute = sequence;
+      deliver(subscriber);
+    }
+    for (TopicNode::SharedGroup& group : node->groups) {
+      if (group.members.empty()) continue;
+      // A closing member passes its turn to the next live one; drop only when none is left
+      size_t count = group.members.size();
+      bool delivered = false;
+      for (size_t attempt = 0; attempt < count && !delivered; attempt++) {
+        const TopicNode::Subscriber& member = group.members[group.next % count];
+        group.next = (group.next + 1) % count;
+        if (member.client->closing) continue;
+        deliver(member);
+        delivered = true;
+      }
+      if (!delivered) messagesDropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+
+  std::vector<std::pair<const char*, size_t>> levels;
+  splitLevels(topic, topicLength, levels);
+  // Wildcards never match a first level starting with '$' (e.g. $SYS)
+  bool system = topic[0] == '$';
+
+  // Depth-first over the trie: exact level, "+", and "#" for the rest of the topic
+  std::vector<std::pair<TopicNode*, size_t>> stack = {{root_.get(), 0}};
+  std::string key;
+  while (!stack.empty()) {
+    TopicNode* node = stack.back().first;
+    size_t depth = stack.back().second;
+    stack.pop_back();
+    bool wildcardsAllowed = depth > 0 || !system;
+    if (wildcardsAllowed) {
+      auto hash = node->children.find("#");
+      if (hash != node->children.end()) deliverNode(hash->second.get());
+    }
+    if (depth == levels.size()) {
+      deliverNode(node);
+      continue;
+    }
+    key.assign(levels[depth].first, levels[depth].second);
+    auto exact = node->children.find(key);
+    if (exact != node->children.end()) stack.push_back({exact->second.get(), depth + 1});
+    if (wildcardsAllowed) {
+      auto plus = node->children.find("+");
+      if (plus != node->children.end()) stack.push_back({plus->second.get(), depth + 1});
+    }
+  }
+}
+
+void MiniBroker::send(Client* client, PacketBuffer packet) {
+  if (client->queuedBytes + packet->size() > config_.maxQueuedBytes) {
+    messagesDropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  enqueue(client, std::move(packet));
+  messagesOut_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MiniBroker::sendReliable(Client* client, const std::shared_ptr<const Message>& message) {
+  // Bounded by what is unacknowledged, so a session that never comes back cannot grow without limit
+  size_t size = message->topic.size() + message->payload.size();
+  if (client->unackedBytes + size > config_.maxQueuedBytes || client->unacked.size() >= 0xFFFF) {
+    messagesDropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  uint16_t packetId = client->nextPacketId++;
+  if (client->nextPacketId == 0) client->nextPacketId = 1;
+  bool online = !client->closing;
+  client->unacked.push_back({packetId, online, message});
+  client->unackedBytes += size;
+  if (!online) {
+    messagesStored_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  enqueue(client, PacketBuffer(encodePublish(client->version, 0x02, packetId, message->topic.data(),
+                                             message->topic.size(), message->payload.data(),
+                                             message->payload.size())));
+  messagesOut_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MiniBroker::sendUnacked(Client* client) {
+  // In order, DUP set on whatever an earlier connection may have received
+  for (Client::Unacked& pending : client->unacked) {
+    uint8_t flags = 0x02 | (pending.sent ? 0x08 : 0);
+    const Message& message = *pending.message;
+    enqueue(client, PacketBuffer(encodePublish(client->version, flags, pending.packetId, message.topic.data(),
+                                               message.topic.size(), message.payload.data(),
+                                               message.payload.size())));
+    pending.sent = true;
+    messagesOut_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void MiniBroker::handlePuback(Client* client, const uint8_t* body, size_t length) {
+  if (length < 2) return;
+  uint16_t packetId = (body[0] << 8) | body[1];
+  for (auto it = client->unacked.begin(); it != client->unacked.end(); ++it) {
+    if (it->packetId != packetId) continue;
+    client->unackedBytes -= it->message->topic.size() + it->message->payload.size();
+    client->unacked.erase(it);
+    return;
+  }
+}
+
+void MiniBroker::sendControl(Client* client, std::vector<uint8_t> packet) {
+  // Control packets are never dropped
+  enqueue(client, std::make_shared<const std::vector<uint8_t>>(std::move(packet)));
+}
+
+void MiniBroker::enqueue(Client* client, PacketBuffer packet) {
+  client->queuedBytes += packet->size();
+  client->tx.push_back({std::move(packet), 0});
+  if (!client->dirty) {
+    client->dirty = true;
+    dirty_.push_back(client);
+  }
+}
+
+void MiniBroker::flush(Client* client) {
+  while (!client->tx.empty()) {
+    iovec parts[MAX_IOVECS];
+    int count = 0;
+    for (auto it = client->tx.begin(); it != client->tx.end() && count < MAX_IOVECS; ++it, ++count) {
+      parts[count].iov_base = (void*)(it->packet->data() + it->offset);
+      parts[count].iov_len = it->packet->size() - it->offset;
+    }
+    ssize_t n = writev(client->fd, parts, count);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      closeClient(client);
+      return;
+    }
+    bytesOut_.fetch_add(n, std::memory_order_relaxed);
+    client->queuedBytes -= n;
+    while (n > 0) {
+      Client::Pending& front = client->tx.front();
+      size_t left = front.packet->size() - front.offset;
+      if ((size_t)n < left) {
+        front.offset += n;
+        break;
+      }
+      n -= left;
+      client->tx.pop_front();
+    }
+  }
+
+  // Wait for room only while something is left over
+  bool wantWrite = !client->tx.empty();
+  if (wantWrite != client->writeWatched) {
+    client->writeWatched = wantWrite;
+    epoll_event event = {};
+    event.events = wantWrite ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.fd = client->fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, client->fd, &event);
+  }
+}
+
+void MiniBroker::closeClient(Client* client) {
+  if (client->closing) return;
+  client->closing = true;
+  // A persistent session stays subscribed, QoS 1 messages are held for it
+  if (!client->persistent) {
+    for (const std::string& filter : client->filters) removeSubscription(client, filter);
+    client->filters.clear();
+  }
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, client->fd, nullptr);
+  closed_.push_back(client);
+}
+
+void MiniBroker::releaseClosed() {
+  // The fd is closed only now, so no event of this pass can refer to a reused number
+  int64_t now = steadyNowMs();
+  for (Client* client : closed_) {
+    int fd = client->fd;
+    close(fd);
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+    if (!client->persistent) {
+      clients_[fd].reset();
+      continue;
+    }
+    // Kept without a connection until it is resumed or expires
+    client->fd = -1;
+    client->tx.clear();
+    client->queuedBytes = 0;
+    client->rx.clear();
+    client->expiresAtMs = now + client->sessionExpirySeconds * 1000LL;
+    auto stale = sessions_.find(client->id);
+    if (stale != sessions_.end()) discardSession(stale->second.get());
+    sessions_[client->id] = std::move(clients_[fd]);
+    sessionsStored_.fetch_add(1, std::memory_order_relaxed);
+  }
+  closed_.clear();
+}
+
+void MiniBroker::expireIdleClients(int64_t nowMs) {
+  for (auto& client : clients_) {
+    if (!client || client->closing || client->keepAliveSeconds == 0) continue;
+    // The spec allows one and a half keepalive periods of silence
+    if (nowMs - client->lastSeenMs > client->keepAliveSeconds * 1500LL) closeClient(client.get());
+  }
+  for (auto it = sessions_.begin(); it != sessions_.end();) {
+    Client* session = it->second.get();
+    if (nowMs < session->expiresAtMs) {
+      ++it;
+      continue;
+    }
+    for (const std::string& filter : session->filters) removeSubscription(session, filter);
+    it = sessions_.erase(it);
+    sessionsStored_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * In-process MQTT 3.1.1 / 5 broker for load tests and benchmarks (Linux, epoll).
+ *
+ * One thread runs a level-triggered epoll loop over every connection.
+ * Subscriptions live in a topic trie with "+" / "#" matching and
+ * "$share/<group>/<filter>" groups served round-robin. A publish is encoded
+ * once per protocol version and the same reference-counted buffer is queued
+ * on every subscriber, then written out with writev() once per loop pass.
+ *
+ * Persistent sessions: a client connecting with clean session 0 (3.1.1) or
+ * a session expiry (5) keeps its subscriptions when it disconnects, and QoS 1
+ * messages for it are held until it is back; CONNACK then reports the
+ * session as present. QoS 1 deliveries stay unacknowledged until PUBACK and
+ * are sent again (DUP) on the next connection. QoS 2 is granted as 1.
+ *
+ * Deliberately small otherwise: QoS 0 subscriptions are best effort, QoS 2
+ * publishes are acknowledged on receipt, and there are no retained messages
+ * or wills. A subscriber that falls more than maxQueuedBytes behind loses
+ * messages instead of growing without bound, for a session as well.
+ */
+
+struct MiniBrokerConfig {
+  const char* bindAddress = "127.0.0.1";
+  uint16_t port = 0;                     // 0 picks a free port, see MiniBroker::port()
+  size_t maxConnections = 100000;        // still bounded by the process fd limit
+  size_t maxQueuedBytes = 8u << 20;      // per subscriber
+  uint32_t maxSessionExpirySeconds = 86400;  // also what 3.1.1 persistent sessions get
+};
+
+struct MiniBrokerStats {
+  uint64_t connections = 0;              // open right now
+  uint64_t connectionsAccepted = 0;
+  uint64_t messagesIn = 0;               // PUBLISH received (and in-process publishes)
+  uint64_t messagesOut = 0;              // copies queued to subscribers
+  uint64_t messagesDropped = 0;          // copies dropped at maxQueuedBytes
+  uint64_t messagesStored = 0;           // QoS 1 copies held for a disconnected session
+  uint64_t sessionsResumed = 0;          // connects that found their session
+  uint64_t sessionsStored = 0;           // sessions without a connection right now
+  uint64_t bytesIn = 0;
+  uint64_t bytesOut = 0;
+};
+
+class MiniBroker {
+public:
+  explicit MiniBroker(const MiniBrokerConfig& config = MiniBrokerConfig());
+  ~MiniBroker();
+
+  MiniBroker(const MiniBroker&) = delete;
+  MiniBroker& operator=(const MiniBroker&) = delete;
+
+  /**
+   * @brief Bind and listen
+   * @return false if the socket could not be set up
+   */
+  bool start();
+
+  uint16_t port() const { return port_; }
+
+  /**
+   * @brief One pass of the event loop, for callers that drive it themselves
+   * @return Number of events handled
+   */
+  int poll(int timeoutMs);
+
+  /**
+   * @brief Run the event loop until stop()
+   */
+  void run();
+
+  /**
+   * @brief Make run() return (any thread)
+   */
+  void stop();
+
+  /**
+   * @brief Publish as if a client had sent it (any thread; delivered on the next loop pass)
+   */
+  void publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos = 0);
+
+  MiniBrokerStats stats() const;
+
+private:
+  typedef std::shared_ptr<const std::vector<uint8_t>> PacketBuffer;
+  struct Client;
+  struct TopicNode;
+  struct Message;
+
+  struct Injected {
+    std::string topic;
+    std::vector<uint8_t> payload;
+    uint8_t qos;
+  };
+
+  void acceptClients();
+  void readClient(Client* client);
+  bool handlePacket(Client* client, uint8_t type, const uint8_t* body, size_t length);
+  bool handleConnect(Client* client, const uint8_t* body, size_t length);
+  bool handlePublish(Client* client, uint8_t type, const uint8_t* body, size_t length);
+  bool handleSubscribe(Client* client, const uint8_t* body, size_t length, bool subscribe);
+  void handlePuback(Client* client, const uint8_t* body, size_t length);
+  void route(const char* topic, size_t topicLength, const uint8_t* payload, size_t payloadLength, uint8_t qos);
+  void send(Client* client, PacketBuffer packet);
+  void sendReliable(Client* client, const std::shared_ptr<const Message>& message);
+  void sendUnacked(Client* client);
+  void sendControl(Client* client, std::vector<uint8_t> packet);
+  void enqueue(Client* client, PacketBuffer packet);
+  void flush(Client* client);
+  void closeClient(Client* client);
+  void releaseClosed();
+  void expireIdleClients(int64_t nowMs);
+
+  bool resumeSession(Client* client, Client* stored);
+  void discardSession(Client* client);
+
+  TopicNode* filterNode(const std::string& filter, std::string& group, bool create);
+  bool addSubscription(Client* client, const std::string& filter, uint8_t qos);
+  void removeSubscription(Client* client, const std::string& filter);
+  void moveSubscription(Client* from, Client* to, const std::string& filter);
+
+  MiniBrokerConfig config_;
+  uint16_t port_ = 0;
+  int listenFd_ = -1;
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  std::atomic<bool> running_{false};
+
+  std::vector<std::unique_ptr<Client>> clients_;  // by fd
+  std::vector<Client*> dirty_;                    // clients with queued output this pass
+  std::vector<Client*> closed_;                   // freed at the end of the pass
+  std::unordered_map<std::string, std::unique_ptr<Client>> sessions_;  // persistent, disconnected
+  std::unique_ptr<TopicNode> root_;
+  uint64_t routeSequence_ = 0;
+  int64_t lastExpiryMs_ = 0;
+  uint32_t anonymousClients_ = 0;
+
+  std::mutex injectLock_;
+  std::vector<Injected> injected_;
+
+  std::atomic<uint64_t> connections_{0};
+  std::atomic<uint64_t> connectionsAccepted_{0};
+  std::atomic<uint64_t> messagesIn_{0};
+  std::atomic<uint64_t> messagesOut_{0};
+  std::atomic<uint64_t> messagesDropped_{0};
+  std::atomic<uint64_t> messagesStored_{0};
+  std::atomic<uint64_t> sessionsResumed_{0};
+  std::atomic<uint64_t> sessionsStored_{0};
+  std::atomic<uint64_t> bytesIn_{0};
+  std::atomic<uint64_t> bytesOut_{0};
+};
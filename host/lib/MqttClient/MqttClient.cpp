@@ -0,0 +1,342 @@
+#include "MqttClient.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+// Control packet types (first byte, flags included where they are fixed)
+static const uint8_t CONNECT = 0x10;
+static const uint8_t CONNACK = 0x20;
+static const uint8_t PUBLISH = 0x30;
+static const uint8_t PUBACK = 0x40;
+static const uint8_t SUBSCRIBE = 0x82;
+static const uint8_t SUBACK = 0x90;
+static const uint8_t PINGREQ = 0xC0;
+static const uint8_t PINGRESP = 0xD0;
+static const uint8_t DISCONNECT = 0xE0;
+
+/**
+ * @brief Decode a variable byte integer (remaining length, property length)
+ * @return Bytes used, 0 if more data is needed, -1 if malformed
+ */
+static int readVarint(const uint8_t* data, size_t available, size_t& value) {
+  value = 0;
+  for (size_t i = 0; i < 4; i++) {
+    if (i >= available) return 0;
+    value |= (size_t)(data[i] & 0x7F) << (7 * i);
+    if (!(data[i] & 0x80)) return (int)i + 1;
+  }
+  return -1;
+}
+
+static void putString(std::vector<uint8_t>& out, const char* text, size_t length) {
+  out.push_back(length >> 8);
+  out.push_back(length & 0xFF);
+  out.insert(out.end(), text, text + length);
+}
+
+static void putString(std::vector<uint8_t>& out, const char* text) {
+  putString(out, text, strlen(text));
+}
+
+MqttClient::MqttClient() {
+  rx_.reserve(4096);
+}
+
+MqttClient::~MqttClient() {
+  disconnect();
+}
+
+void MqttClient::setServer(const char* host, uint16_t port) {
+  host_ = host;
+  port_ = port;
+}
+
+int64_t MqttClient::nowMs() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void MqttClient::closeSocket(int state) {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+  state_ = state;
+  rx_.clear();
+  pingOutstanding_ = false;
+}
+
+bool MqttClient::connect(const char* clientId, const char* username, const char* password) {
+  if (connected()) return true;
+  sessionPresent_ = false;
+
+  char port[8];
+  snprintf(port, sizeof(port), "%u", port_);
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  if (getaddrinfo(host_.c_str(), port, &hints, &addresses) != 0) {
+    state_ = MQTT_CONNECT_FAILED;
+    return false;
+  }
+
+  // Non-blocking connect, so a dropped SYN costs the socket timeout rather than the kernel's retries
+  int timeoutMs = socketTimeoutSeconds_ * 1000;
+  bool timedOut = false;
+  for (addrinfo* a = addresses; a && fd_ < 0; a = a->ai_next) {
+    fd_ = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd_ < 0) continue;
+    int flags = fcntl(fd_, F_GETFL);
+    fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+    int result = ::connect(fd_, a->ai_addr, a->ai_addrlen);
+    if (result != 0 && errno == EINPROGRESS) {
+      pollfd p = {fd_, POLLOUT, 0};
+      int error = 0;
+      socklen_t length = sizeof(error);
+      if (poll(&p, 1, timeoutMs) == 1 && getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && !error) {
+        result = 0;
+      } else {
+        timedOut = timedOut || !error;
+      }
+    }
+    if (result != 0) {
+      close(fd_);
+      fd_ = -1;
+      continue;
+    }
+    fcntl(fd_, F_SETFL, flags);
+  }
+  freeaddrinfo(addresses);
+  if (fd_ < 0) {
+    state_ = timedOut ? MQTT_CONNECTION_TIMEOUT : MQTT_CONNECT_FAILED;
+    return false;
+  }
+  int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  bool hasUser = username && *username;
+  bool hasPassword = hasUser && password && *password;
+  std::vector<uint8_t> body;
+  putString(body, "MQTT");
+  body.push_back(protocolVersion_);
+  body.push_back((cleanSession_ ? 0x02 : 0) | (hasUser ? 0x80 : 0) | (hasPassword ? 0x40 : 0));  // clean session / clean start
+  body.push_back(keepAliveSeconds_ >> 8);
+  body.push_back(keepAliveSeconds_ & 0xFF);
+  if (protocolVersion_ >= MQTT_VERSION_5) {
+    if (sessionExpirySeconds_) {
+      // Session Expiry Interval (0x11), four byte integer
+      body.insert(body.end(), {5, 0x11, (uint8_t)(sessionExpirySeconds_ >> 24), (uint8_t)(sessionExpirySeconds_ >> 16),
+                               (uint8_t)(sessionExpirySeconds_ >> 8), (uint8_t)sessionExpirySeconds_});
+    } else {
+      body.push_back(0);  // no properties
+    }
+  }
+  putString(body, clientId);
+  if (hasUser) putString(body, username);
+  if (hasPassword) putString(body, password);
+  if (!sendPacket(CONNECT, body)) return false;
+
+  // Wait for CONNACK: 0x20 <length> <flags> <return/reason code> [properties (5)]
+  int64_t deadline = nowMs() + timeoutMs;
+  size_t length = 0;
+  int header = 0;
+  for (;;) {
+    if (rx_.size() >= 2) {
+      header = readVarint(rx_.data() + 1, rx_.size() - 1, length);
+      if (header < 0 || (header > 0 && rx_.size() >= 1 + header + length)) break;
+    }
+    int64_t left = deadline - nowMs();
+    if (left <= 0 || !readAvailable((int)left)) {
+      closeSocket(MQTT_CONNECTION_TIMEOUT);
+      return false;
+    }
+  }
+  if (header < 0 || rx_[0] != CONNACK || length < 2 || rx_[2 + header] != 0) {
+    int code = header > 0 && rx_[0] == CONNACK && length >= 2 ? rx_[2 + header] : MQTT_CONNECT_FAILED;
+    closeSocket(code);
+    return false;
+  }
+  sessionPresent_ = rx_[1 + header] & 0x01;
+  rx_.erase(rx_.begin(), rx_.begin() + 1 + header + length);
+  state_ = MQTT_CONNECTED;
+  lastInboundMs_ = nowMs();
+  return true;
+}
+
+void MqttClient::disconnect() {
+  if (!connected()) return;
+  sendPacket(DISCONNECT, {});
+  closeSocket(MQTT_DISCONNECTED);
+}
+
+bool MqttClient::sendPacket(uint8_t header, const std::vector<uint8_t>& body) {
+  if (fd_ < 0) return false;
+  uint8_t fixed[5];
+  size_t fixedLength = 0;
+  fixed[fixedLength++] = header;
+  size_t remaining = body.size();
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    fixed[fixedLength++] = digit | (remaining ? 0x80 : 0);
+  } while (remaining);
+
+  iovec parts[2] = {{fixed, fixedLength}, {(void*)body.data(), body.size()}};
+  msghdr message = {};
+  message.msg_iov = parts;
+  message.msg_iovlen = body.empty() ? 1 : 2;
+  size_t total = fixedLength + body.size();
+  size_t sent = 0;
+  while (sent < total) {
+    ssize_t n = sendmsg(fd_, &message, MSG_NOSIGNAL);
+    if (n <= 0) {
+      closeSocket(MQTT_CONNECTION_LOST);
+      return false;
+    }
+    sent += n;
+    // Skip what went out so a partial send resumes in the right place
+    while (n > 0 && message.msg_iovlen > 0) {
+      size_t step = std::min((size_t)n, message.msg_iov->iov_len);
+      message.msg_iov->iov_base = (uint8_t*)message.msg_iov->iov_base + step;
+      message.msg_iov->iov_len -= step;
+      n -= step;
+      if (message.msg_iov->iov_len == 0) {
+        message.msg_iov++;
+        message.msg_iovlen--;
+      }
+    }
+  }
+  lastOutboundMs_ = nowMs();
+  return true;
+}
+
+bool MqttClient::readAvailable(int timeoutMs) {
+  pollfd p = {fd_, POLLIN, 0};
+  int ready = poll(&p, 1, timeoutMs);
+  if (ready <= 0) return ready == 0 ? false : (closeSocket(MQTT_CONNECTION_LOST), false);
+
+  uint8_t buffer[16384];
+  ssize_t n = recv(fd_, buffer, sizeof(buffer), 0);
+  if (n <= 0) {
+    closeSocket(MQTT_CONNECTION_LOST);
+    return false;
+  }
+  rx_.insert(rx_.end(), buffer, buffer + n);
+  lastInboundMs_ = nowMs();
+  return true;
+}
+
+bool MqttClient::handlePackets() {
+  size_t offset = 0;
+  while (connected()) {
+    // Fixed header: type byte, then a 1-4 byte remaining length
+    size_t available = rx_.size() - offset;
+    if (available < 2) break;
+    size_t length = 0;
+    int lengthBytes = readVarint(rx_.data() + offset + 1, available - 1, length);
+    if (lengthBytes < 0) {
+      closeSocket(MQTT_CONNECTION_LOST);
+      return false;
+    }
+    if (lengthBytes == 0) break;
+    size_t header = 1 + lengthBytes;
+    if (available < header + length) break;
+
+    uint8_t type = rx_[offset];
+    uint8_t* body = rx_.data() + offset + header;
+    offset += header + length;
+
+    if ((type & 0xF0) == PUBLISH && length >= 2) {
+      uint8_t qos = (type >> 1) & 0x03;
+      size_t topicLength = (body[0] << 8) | body[1];
+      size_t position = 2 + topicLength;
+      if (position > length) continue;
+      uint16_t packetId = 0;
+      if (qos > 0) {
+        if (position + 2 > length) continue;
+        packetId = (body[position] << 8) | body[position + 1];
+        position += 2;
+      }
+      if (protocolVersion_ >= MQTT_VERSION_5) {
+        size_t propertiesLength = 0;
+        int used = readVarint(body + position, length - position, propertiesLength);
+        if (used <= 0 || position + used + propertiesLength > length) continue;
+        position += used + propertiesLength;
+      }
+      topic_.assign((const char*)body + 2, topicLength);
+      if (callback_) callback_(&topic_[0], body + position, length - position);
+      if (qos == 1) sendPacket(PUBACK, {(uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF)});
+    } else if (type == PINGRESP) {
+      pingOutstanding_ = false;
+    } else if (type == DISCONNECT) {
+      // MQTT 5 brokers say why they drop a client (e.g. session taken over)
+      closeSocket(MQTT_CONNECTION_LOST);
+      return false;
+    }
+    // SUBACK and PUBACK need no action at QoS 0 publishing
+  }
+  if (offset) rx_.erase(rx_.begin(), rx_.begin() + std::min(offset, rx_.size()));
+  return connected();
+}
+
+bool MqttClient::loop(int timeoutMs) {
+  if (!connected()) return false;
+
+  if (readAvailable(timeoutMs)) {
+    // Drain whatever else is already queued without waiting
+    while (connected() && readAvailable(0)) {
+    }
+  }
+  if (!handlePackets()) return false;
+
+  int64_t now = nowMs();
+  int64_t keepAliveMs = (int64_t)keepAliveSeconds_ * 1000;
+  if (keepAliveMs > 0) {
+    if (pingOutstanding_ && now - lastInboundMs_ > keepAliveMs) {
+      closeSocket(MQTT_CONNECTION_TIMEOUT);
+      return false;
+    }
+    if (!pingOutstanding_ && (now - lastOutboundMs_ > keepAliveMs || now - lastInboundMs_ > keepAliveMs)) {
+      if (!sendPacket(PINGREQ, {})) return false;
+      // The broker gets a keepalive from the ping on to answer, as PubSubClient allows
+      lastInboundMs_ = now;
+      pingOutstanding_ = true;
+    }
+  }
+  return true;
+}
+
+bool MqttClient::subscribe(const char* topic, uint8_t qos) {
+  std::vector<uint8_t> body;
+  uint16_t packetId = nextPacketId_++;
+  if (nextPacketId_ == 0) nextPacketId_ = 1;
+  body.push_back(packetId >> 8);
+  body.push_back(packetId & 0xFF);
+  if (protocolVersion_ >= MQTT_VERSION_5) body.push_back(0);  // no properties
+  putString(body, topic);
+  body.push_back(qos);  // MQTT 5 subscription options: retain handling 0, no-local off
+  return sendPacket(SUBSCRIBE, body);
+}
+
+bool MqttClient::publish(const char* topic, const uint8_t* payload, size_t length, bool retain) {
+  std::vector<uint8_t> body;
+  size_t topicLength = strlen(topic);
+  body.reserve(3 + topicLength + length);
+  putString(body, topic, topicLength);
+  if (protocolVersion_ >= MQTT_VERSION_5) body.push_back(0);  // no properties
+  body.insert(body.end(), payload, payload + length);
+  return sendPacket(PUBLISH | (retain ? 0x01 : 0), body);
+}
+
+bool MqttClient::publish(const char* topic, const char* payload) {
+  return publish(topic, (const uint8_t*)payload, strlen(payload), false);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Same state codes as PubSubClient, so logs read the same on both sides
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+typedef std::function<void(char* topic, uint8_t* payload, unsigned int length)> MqttCallback;
+
+// Protocol levels for setProtocolVersion()
+#define MQTT_VERSION_3_1_1           4
+#define MQTT_VERSION_5               5
+
+/**
+ * @brief Minimal MQTT 3.1.1 / 5 client for host services
+ *
+ * Mirrors the PubSubClient calls the firmware uses (setServer, connect,
+ * subscribe, publish, loop) over a plain POSIX socket. QoS 0 publishes,
+ * QoS 0/1 subscriptions; incoming QoS 1 messages are acknowledged.
+ *
+ * MQTT 5 sessions send no properties besides the session expiry and skip
+ * the ones they receive; they exist for shared subscriptions
+ * ("$share/<group>/<filter>"), which the broker spreads across the clients
+ * of a group.
+ *
+ * setCleanSession(false) asks the broker to keep the session (subscriptions
+ * and undelivered QoS 1 messages) across connections; in MQTT 5 it is kept
+ * for setSessionExpiry() seconds after a disconnect. sessionPresent() says
+ * whether the broker had one, so the subscriptions need not be sent again.
+ */
+class MqttClient {
+public:
+  MqttClient();
+  ~MqttClient();
+
+  void setServer(const char* host, uint16_t port);
+  void setCallback(MqttCallback callback) { callback_ = callback; }
+  void setKeepAlive(uint16_t seconds) { keepAliveSeconds_ = seconds; }
+  void setProtocolVersion(uint8_t version) { protocolVersion_ = version; }
+  // How long connect() waits for the TCP handshake and for CONNACK, each
+  void setSocketTimeout(uint16_t seconds) { socketTimeoutSeconds_ = seconds; }
+  // false: resume the broker's session for this client id (3.1.1 clean session, 5 clean start)
+  void setCleanSession(bool clean) { cleanSession_ = clean; }
+  // MQTT 5: how long the broker keeps the session after a disconnect (0: not at all)
+  void setSessionExpiry(uint32_t seconds) { sessionExpirySeconds_ = seconds; }
+
+  bool connect(const char* clientId, const char* username = nullptr, const char* password = nullptr);
+  void disconnect();
+  bool connected() const { return fd_ >= 0; }
+  int state() const { return state_; }
+  // CONNACK of the last connect: the broker resumed a stored session
+  bool sessionPresent() const { return sessionPresent_; }
+
+  bool subscribe(const char* topic, uint8_t qos = 0);
+  bool publish(const char* topic, const uint8_t* payload, size_t length, bool retain = false);
+  bool publish(const char* topic, const char* payload);
+
+  /**
+   * @brief Handle whatever arrived, keep the connection alive
+   * @param timeoutMs How long to wait for data when nothing is buffered
+   * @return false once the connection is gone
+   */
+  bool loop(int timeoutMs = 0);
+
+private:
+  bool sendPacket(uint8_t header, const std::vector<uint8_t>& body);
+  bool readAvailable(int timeoutMs);
+  bool handlePackets();
+  void closeSocket(int state);
+  int64_t nowMs() const;
+
+  std::string host_;
+  uint16_t port_ = 1883;
+  uint16_t keepAliveSeconds_ = 60;
+  uint16_t socketTimeoutSeconds_ = 5;
+  uint8_t protocolVersion_ = MQTT_VERSION_3_1_1;
+  bool cleanSession_ = true;
+  uint32_t sessionExpirySeconds_ = 0;
+  bool sessionPresent_ = false;
+  MqttCallback callback_;
+
+  int fd_ = -1;
+  int state_ = MQTT_DISCONNECTED;
+  uint16_t nextPacketId_ = 1;
+  int64_t lastOutboundMs_ = 0;
+  int64_t lastInboundMs_ = 0;
+  bool pingOutstanding_ = false;
+  std::vector<uint8_t> rx_;
+  std::string topic_;
+};
@@ -0,0 +1,126 @@
+#include "OrderBook.h"
+
+#include <algorithm>
+
+OrderBook::OrderBook(uint32_t maxPrice) : maxPrice_(maxPrice) {
+  for (int side = 0; side < 2; side++) {
+    levels_[side].resize(maxPrice + 1);
+    occupied_[side].assign(maxPrice / 64 + 1, 0);
+  }
+}
+
+uint32_t OrderBook::allocate() {
+  if (!free_.empty()) {
+    uint32_t slot = free_.back();
+    free_.pop_back();
+    return slot;
+  }
+  pool_.emplace_back();
+  return pool_.size() - 1;
+}
+
+void OrderBook::append(MarketSide side, uint32_t slot) {
+  BookOrder& order = pool_[slot];
+  Level& level = levels_[side][order.price];
+  order.prev = level.tail;
+  order.next = NONE;
+  if (level.tail != NONE) {
+    pool_[level.tail].next = slot;
+  } else {
+    level.head = slot;
+    occupied_[side][order.price >> 6] |= 1ULL << (order.price & 63);
+  }
+  level.tail = slot;
+  level.quantity += order.quantity;
+  ids_[order.id] = slot;
+}
+
+void OrderBook::unlink(uint32_t slot) {
+  BookOrder& order = pool_[slot];
+  Level& level = levels_[order.side][order.price];
+  if (order.prev != NONE) pool_[order.prev].next = order.next;
+  else level.head = order.next;
+  if (order.next != NONE) pool_[order.next].prev = order.prev;
+  else level.tail = order.prev;
+  level.quantity -= order.quantity;
+
+  if (level.head == NONE) {
+    occupied_[order.side][order.price >> 6] &= ~(1ULL << (order.price & 63));
+    if (order.side == MARKET_BUY && order.price == bestBid_) bestBid_ = nextBidAtOrBelow(order.price);
+    if (order.side == MARKET_SELL && order.price == bestAsk_) bestAsk_ = nextAskAtOrAbove(order.price);
+  }
+  ids_.erase(order.id);
+  free_.push_back(slot);
+}
+
+uint32_t OrderBook::nextBidAtOrBelow(uint32_t price) const {
+  const std::vector<uint64_t>& bits = occupied_[MARKET_BUY];
+  int64_t word = price >> 6;
+  uint64_t mask = bits[word] & (~0ULL >> (63 - (price & 63)));
+  while (true) {
+    if (mask) return (uint32_t)(word * 64 + 63 - __builtin_clzll(mask));
+    if (--word < 0) return 0;
+    mask = bits[word];
+  }
+}
+
+uint32_t OrderBook::nextAskAtOrAbove(uint32_t price) const {
+  const std::vector<uint64_t>& bits = occupied_[MARKET_SELL];
+  size_t word = price >> 6;
+  uint64_t mask = bits[word] & (~0ULL << (price & 63));
+  while (true) {
+    if (mask) return (uint32_t)(word * 64 + __builtin_ctzll(mask));
+    if (++word >= bits.size()) return 0;
+    mask = bits[word];
+  }
+}
+
+uint64_t OrderBook::submit(MarketSide side, uint32_t price, uint32_t quantity, std::vector<BookFill>& fills) {
+  if (price == 0 || price > maxPrice_ || quantity == 0) return 0;
+  uint64_t id = nextId_++;
+
+  // Walk the opposite side from its best price while it still crosses
+  MarketSide opposite = side == MARKET_BUY ? MARKET_SELL : MARKET_BUY;
+  while (quantity > 0) {
+    uint32_t best = side == MARKET_BUY ? bestAsk_ : bestBid_;
+    if (best == 0) break;
+    if (side == MARKET_BUY ? best > price : best < price) break;
+
+    Level& level = levels_[opposite][best];
+    while (quantity > 0 && level.head != NONE) {
+      uint32_t makerSlot = level.head;
+      BookOrder& maker = pool_[makerSlot];
+      uint32_t traded = std::min(quantity, maker.quantity);
+      maker.quantity -= traded;
+      level.quantity -= traded;
+      quantity -= traded;
+      fills.push_back({maker.id, id, best, traded, maker.quantity, quantity});
+      if (maker.quantity == 0) unlink(makerSlot);  // also moves the best price on when the level empties
+    }
+  }
+
+  if (quantity > 0) {
+    uint32_t slot = allocate();
+    pool_[slot] = {id, price, quantity, side, NONE, NONE};
+    append(side, slot);
+    if (side == MARKET_BUY && price > bestBid_) bestBid_ = price;
+    if (side == MARKET_SELL && (bestAsk_ == 0 || price < bestAsk_)) bestAsk_ = price;
+  }
+  return id;
+}
+
+bool OrderBook::cancel(uint64_t id) {
+  auto it = ids_.find(id);
+  if (it == ids_.end()) return false;
+  unlink(it->second);
+  return true;
+}
+
+const BookOrder* OrderBook::find(uint64_t id) const {
+  auto it = ids_.find(id);
+  return it == ids_.end() ? nullptr : &pool_[it->second];
+}
+
+uint64_t OrderBook::levelQuantity(MarketSide side, uint32_t price) const {
+  return price <= maxPrice_ ? levels_[side][price].quantity : 0;
+}
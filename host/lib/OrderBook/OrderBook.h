@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <CreditMarket.h>
+
+/**
+ * @brief One trade between a resting (maker) and an incoming (taker) order
+ */
+struct BookFill {
+  uint64_t makerId;
+  uint64_t takerId;
+  uint32_t price;           // always the maker's price
+  uint32_t quantity;
+  uint32_t makerRemaining;
+  uint32_t takerRemaining;
+};
+
+/**
+ * @brief A resting order, kept in its price level's FIFO
+ */
+struct BookOrder {
+  uint64_t id;
+  uint32_t price;
+  uint32_t quantity;
+  MarketSide side;
+  uint32_t prev;
+  uint32_t next;
+};
+
+/**
+ * @brief Price-time priority limit order book for carbon credits
+ *
+ * Prices are ticks in [1, maxPrice]. Each side has one level per tick with
+ * a FIFO of orders drawn from a shared pool, plus a bitmap of non-empty
+ * levels so the next best price is a few word scans away. Submitting an
+ * order matches it against the opposite side at the resting orders' prices
+ * and rests whatever is left; nothing allocates once the pool has grown.
+ */
+class OrderBook {
+public:
+  explicit OrderBook(uint32_t maxPrice = MARKET_MAX_PRICE);
+
+  /**
+   * @brief Match a limit order, then rest the remainder
+   * @param fills Trades are appended here, makers in priority order
+   * @return Id of the order; 0 if price or quantity are out of range
+   */
+  uint64_t submit(MarketSide side, uint32_t price, uint32_t quantity, std::vector<BookFill>& fills);
+
+  /**
+   * @return false if the order is not resting (filled, cancelled or unknown)
+   */
+  bool cancel(uint64_t id);
+
+  const BookOrder* find(uint64_t id) const;
+
+  uint32_t bestBid() const { return bestBid_; }  // 0 if no bids
+  uint32_t bestAsk() const { return bestAsk_; }  // 0 if no asks
+  uint64_t levelQuantity(MarketSide side, uint32_t price) const;
+  size_t restingOrders() const { return ids_.size(); }
+  uint32_t maxPrice() const { return maxPrice_; }
+
+private:
+  static const uint32_t NONE = UINT32_MAX;
+
+  struct Level {
+    uint32_t head = NONE;
+    uint32_t tail = NONE;
+    uint64_t quantity = 0;
+  };
+
+  uint32_t allocate();
+  void append(MarketSide side, uint32_t slot);
+  void unlink(uint32_t slot);
+  uint32_t nextBidAtOrBelow(uint32_t price) const;
+  uint32_t nextAskAtOrAbove(uint32_t price) const;
+
+  uint32_t maxPrice_;
+  uint64_t nextId_ = 1;
+  uint32_t bestBid_ = 0;
+  uint32_t bestAsk_ = 0;
+  std::vector<Level> levels_[2];
+  std::vector<uint64_t> occupied_[2];  // one bit per non-empty level
+  std::vector<BookOrder> pool_;
+  std::vector<uint32_t> free_;
+  std::unordered_map<uint64_t, uint32_t> ids_;  // resting order id -> pool slot
+};
@@ -0,0 +1,622 @@
+#include "PushServer.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+static const int MAX_EVENTS = 256;
+static const size_t READ_CHUNK = 4096;
+static const size_t MAX_REQUEST = 8192;
+// Rows copied per readRange() while building a snapshot
+static const uint32_t SNAPSHOT_BLOCK = 64;
+// A comment line this often keeps idle streams from timing out in proxies
+static const int64_t KEEPALIVE_MS = 15000;
+// Sent bytes are dropped from the front of a client's buffer past this much
+static const size_t COMPACT_BYTES = 1 << 16;
+
+static const char STREAM_HEADERS[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/event-stream\r\n"
+  "Cache-Control: no-cache\r\n"
+  "Connection: keep-alive\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "\r\n"
+  "retry: 2000\n\n";
+
+struct PushServer::Client {
+  int fd;
+  bool closing = false;
+  bool streaming = false;       // /stream accepted
+  bool closeWhenFlushed = false;
+  bool writeWatched = false;    // EPOLLOUT armed
+  bool synced = false;          // has had a snapshot
+  std::string request;
+  std::string tx;
+  size_t txOffset = 0;
+
+  // Device set
+  bool all = true;
+  DeviceType type = DeviceType::Unknown;    // Unknown: any type
+  std::vector<uint64_t> watched;            // bitset by device id
+  std::vector<uint64_t> macs;               // asked for but not seen yet
+
+  int intervalMs = 250;
+  int64_t nextFlushMs = 0;
+  int64_t lastSendMs = 0;
+  int64_t slowSinceMs = 0;      // over maxPendingBytes since, 0 if not
+  uint64_t lastTick = 0;        // every change up to this tick has been sent
+
+  size_t pending() const { return tx.size() - txOffset; }
+};
+
+static int64_t steadyNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t wallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void appendUnsigned(std::string& out, uint64_t value) {
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  while (count) out += digits[--count];
+}
+
+static void appendSigned(std::string& out, int64_t value) {
+  if (value < 0) {
+    out += '-';
+    appendUnsigned(out, (uint64_t)-value);
+  } else {
+    appendUnsigned(out, (uint64_t)value);
+  }
+}
+
+/**
+ * @brief value to 0.1, without a trailing ".0"
+ */
+static void appendTenths(std::string& out, float value) {
+  int64_t tenths = isfinite(value) ? llroundf(value * 10) : 0;
+  if (tenths < 0) {
+    out += '-';
+    tenths = -tenths;
+  }
+  appendUnsigned(out, (uint64_t)tenths / 10);
+  if (tenths % 10) {
+    out += '.';
+    out += (char)('0' + tenths % 10);
+  }
+}
+
+/**
+ * @brief "id,co2,credits,flags,rssi[,mac]"
+ */
+static void encodeRow(std::string& out, uint32_t id, const DeviceLastValue& row, bool withMac) {
+  static const char HEX[] = "0123456789abcdef";
+  appendUnsigned(out, id);
+  out += ',';
+  appendSigned(out, isfinite(row.co2) ? llroundf(row.co2) : 0);
+  out += ',';
+  appendTenths(out, row.credits);
+  out += ',';
+  appendUnsigned(out, row.flags);
+  out += ',';
+  appendSigned(out, row.rssi);
+  if (withMac) {
+    out += ',';
+    for (int shift = 44; shift >= 0; shift -= 4) out += HEX[(row.mac >> shift) & 15];
+  }
+}
+
+static void setBit(std::vector<uint64_t>& bits, uint32_t index) {
+  if (index / 64 >= bits.size()) bits.resize(index / 64 + 1, 0);
+  bits[index / 64] |= 1ULL << (index % 64);
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**
+ * @brief Query value with %XX and '+' decoded
+ */
+static std::string decodeQueryValue(const char* text, size_t length) {
+  std::string value;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] == '%' && i + 2 < length && hexDigit(text[i + 1]) >= 0 && hexDigit(text[i + 2]) >= 0) {
+      value += (char)(hexDigit(text[i + 1]) << 4 | hexDigit(text[i + 2]));
+      i += 2;
+    } else {
+      value += text[i] == '+' ? ' ' : text[i];
+    }
+  }
+  return value;
+}
+
+PushServer::PushServer(const LastValueCache& cache, const PushServerConfig& config)
+  : cache_(cache), config_(config), lastVersion_(cache.capacity(), 0), changedTick_(cache.capacity(), 0),
+    firstTick_(cache.capacity(), 0) {
+  if (config_.tickMs < 1) config_.tickMs = 1;
+  if (config_.maxHz < 1) config_.maxHz = 1;
+  if (config_.retainedTicks < 1) config_.retainedTicks = 1;
+}
+
+PushServer::~PushServer() {
+  for (auto& client : clients_) {
+    if (client) close(client->fd);
+  }
+  if (listenFd_ >= 0) close(listenFd_);
+  if (wakeFd_ >= 0) close(wakeFd_);
+  if (epollFd_ >= 0) close(epollFd_);
+}
+
+bool PushServer::start() {
+  listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) return false;
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(config_.port);
+  if (inet_pton(AF_INET, config_.bindAddress, &address.sin_addr) != 1) return false;
+  if (bind(listenFd_, (sockaddr*)&address, sizeof(address)) != 0) return false;
+  if (listen(listenFd_, 4096) != 0) return false;
+  socklen_t addressLength = sizeof(address);
+  getsockname(listenFd_, (sockaddr*)&address, &addressLength);
+  port_ = ntohs(address.sin_port);
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epollFd_ < 0 || wakeFd_ < 0) return false;
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = listenFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+  event.data.fd = wakeFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+  nextTickMs_ = steadyNowMs();
+  return true;
+}
+
+void PushServer::run() {
+  running_ = true;
+  while (running_) poll(100);
+}
+
+void PushServer::stop() {
+  running_ = false;
+  uint64_t one = 1;
+  if (wakeFd_ >= 0 && write(wakeFd_, &one, sizeof(one)) < 0) {
+    // Already signalled
+  }
+}
+
+PushServerStats PushServer::stats() const {
+  PushServerStats stats;
+  stats.clients = clientCount_.load(std::memory_order_relaxed);
+  stats.clientsAccepted = clientsAccepted_.load(std::memory_order_relaxed);
+  stats.ticks = ticks_.load(std::memory_order_relaxed);
+  stats.rowsEncoded = rowsEncoded_.load(std::memory_order_relaxed);
+  stats.events = events_.load(std::memory_order_relaxed);
+  stats.rowsSent = rowsSent_.load(std::memory_order_relaxed);
+  stats.snapshots = snapshots_.load(std::memory_order_relaxed);
+  stats.resyncs = resyncs_.load(std::memory_order_relaxed);
+  stats.skippedFlushes = skippedFlushes_.load(std::memory_order_relaxed);
+  stats.slowClientsDropped = slowClientsDropped_.load(std::memory_order_relaxed);
+  stats.bytesOut = bytesOut_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+int PushServer::poll(int timeoutMs) {
+  if (epollFd_ < 0) return 0;
+  int64_t now = steadyNowMs();
+  int untilTick = (int)std::max<int64_t>(0, nextTickMs_ - now);
+  epoll_event events[MAX_EVENTS];
+  int count = epoll_wait(epollFd_, events, MAX_EVENTS, std::min(timeoutMs, untilTick));
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    if (fd == listenFd_) {
+      acceptClients();
+    } else if (fd == wakeFd_) {
+      uint64_t value;
+      if (read(wakeFd_, &value, sizeof(value)) < 0) {
+        // Nothing pending
+      }
+    } else if ((size_t)fd < clients_.size() && clients_[fd]) {
+      Client* client = clients_[fd].get();
+      if (client->closing) continue;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readClient(client);
+      if (!client->closing && (events[i].events & EPOLLOUT)) flush(client);
+    }
+  }
+
+  now = steadyNowMs();
+  if (now >= nextTickMs_) {
+    // A late tick is not made up for: the next one still covers every change
+    nextTickMs_ = std::max(nextTickMs_ + config_.tickMs, now + 1);
+    runTick();
+    flushDue(now);
+  }
+  releaseClosed();
+  return count;
+}
+
+void PushServer::acceptClients() {
+  while (true) {
+    int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;
+    if (connections_ >= config_.maxClients) {
+      close(fd);
+      continue;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if ((size_t)fd >= clients_.size()) clients_.resize(fd + 1);
+    clients_[fd].reset(new Client());
+    Client* client = clients_[fd].get();
+    client->fd = fd;
+    client->intervalMs = 1000 / std::min(std::max(config_.defaultHz, 1), config_.maxHz);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+    connections_++;
+    clientsAccepted_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void PushServer::readClient(Client* client) {
+  char buffer[READ_CHUNK];
+  ssize_t n = recv(client->fd, buffer, sizeof(buffer), 0);
+  if (n <= 0) {
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    closeClient(client);
+    return;
+  }
+  // Nothing is expected after the request
+  if (client->streaming || client->closeWhenFlushed) return;
+
+  client->request.append(buffer, n);
+  if (client->request.find("\r\n\r\n") != std::string::npos) {
+    handleRequest(client);
+  } else if (client->request.size() > MAX_REQUEST) {
+    static const char BODY[] = "request too large\n";
+    respond(client, "431 Request Header Fields Too Large", "text/plain", BODY, sizeof(BODY) - 1);
+  }
+}
+
+void PushServer::handleRequest(Client* client) {
+  const std::string& request = client->request;
+  size_t targetEnd = request.find_first_of(" \r", 4);
+  if (request.compare(0, 4, "GET ") != 0 || targetEnd == std::string::npos) {
+    static const char BODY[] = "only GET\n";
+    respond(client, "405 Method Not Allowed", "text/plain", BODY, sizeof(BODY) - 1);
+    return;
+  }
+  const char* target = request.data() + 4;
+  size_t targetLength = targetEnd - 4;
+  const char* question = (const char*)memchr(target, '?', targetLength);
+  size_t pathLength = question ? (size_t)(question - target) : targetLength;
+
+  if (pathLength == 7 && memcmp(target, "/stream", 7) == 0) {
+    const char* query = question ? question + 1 : target + targetLength;
+    if (!parseStreamQuery(client, query, target + targetLength - query)) {
+      static const char BODY[] = "bad device set: ids=<id>|<first>-<last>,... macs=<mac>,... type=<type> hz=<n>\n";
+      respond(client, "400 Bad Request", "text/plain", BODY, sizeof(BODY) - 1);
+      return;
+    }
+    client->streaming = true;
+    client->tx.append(STREAM_HEADERS, sizeof(STREAM_HEADERS) - 1);
+    client->nextFlushMs = 0;    // snapshot on the next tick
+    client->lastSendMs = steadyNowMs();
+    clientCount_.fetch_add(1, std::memory_order_relaxed);
+    flush(client);
+  } else if (pathLength == 9 && memcmp(target, "/snapshot", 9) == 0) {
+    std::vector<uint8_t> snapshot;
+    cache_.snapshot(snapshot, wallClockMs());
+    respond(client, "200 OK", "application/octet-stream", (const char*)snapshot.data(), snapshot.size());
+  } else {
+    static const char BODY[] = "try /stream or /snapshot\n";
+    respond(client, "404 Not Found", "text/plain", BODY, sizeof(BODY) - 1);
+  }
+  std::string().swap(client->request);
+}
+
+bool PushServer::parseStreamQuery(Client* client, const char* query, size_t length) {
+  const char* end = query + length;
+  while (query < end) {
+    const char* next = std::find(query, end, '&');
+    const char* equals = std::find(query, next, '=');
+    std::string key(query, equals);
+    std::string value = equals < next ? decodeQueryValue(equals + 1, next - equals - 1) : std::string();
+    query = next < end ? next + 1 : end;
+
+    if (key == "ids") {
+      client->all = false;
+      for (size_t start = 0; start < value.size();) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string::npos) comma = value.size();
+        std::string range = value.substr(start, comma - start);
+        start = comma + 1;
+        char* rest;
+        unsigned long first = strtoul(range.c_str(), &rest, 10);
+        unsigned long last = first;
+        if (rest == range.c_str()) return false;
+        if (*rest == '-') last = strtoul(rest + 1, &rest, 10);
+        if (*rest != '\0' || last < first || last >= cache_.capacity()) return false;
+        for (unsigned long id = first; id <= last; id++) setBit(client->watched, (uint32_t)id);
+      }
+    } else if (key == "macs") {
+      client->all = false;
+      for (size_t start = 0; start < value.size();) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string::npos) comma = value.size();
+        uint64_t mac = parseMacAddress(value.data() + start, comma - start);
+        if (mac == 0) return false;
+        client->macs.push_back(mac);
+        start = comma + 1;
+      }
+    } else if (key == "type") {
+      client->type = parseDeviceType(value.data(), value.size());
+      if (client->type == DeviceType::Unknown) return false;
+    } else if (key == "hz") {
+      int hz = atoi(value.c_str());
+      if (hz < 1) return false;
+      client->intervalMs = 1000 / std::min(hz, config_.maxHz);
+    }
+  }
+  resolveMacs(client);
+  return true;
+}
+
+void PushServer::respond(Client* client, const char* status, const char* type, const char* body, size_t length) {
+  char headers[256];
+  int headerLength = snprintf(headers, sizeof(headers),
+                              "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                              "Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                              status, type, length);
+  client->tx.append(headers, headerLength);
+  client->tx.append(body, length);
+  client->closeWhenFlushed = true;
+  flush(client);
+}
+
+void PushServer::runTick() {
+  tick_++;
+  tickWallMs_ = wallClockMs();
+  if (log_.size() >= config_.retainedTicks) {
+    // Reuse the oldest tick's buffers
+    log_.push_back(std::move(log_.front()));
+    log_.pop_front();
+  } else {
+    log_.emplace_back();
+  }
+  TickLog& log = log_.back();
+  log.tick = tick_;
+  log.rows.clear();
+  log.entries.clear();
+
+  uint32_t devices = cache_.deviceCount();
+  for (uint32_t id = 0; id < devices; id++) {
+    if (cache_.version(id) == lastVersion_[id]) continue;
+    DeviceLastValue row = cache_.read(id);
+    if (lastVersion_[id] == 0) firstTick_[id] = tick_;
+    lastVersion_[id] = row.version;
+    changedTick_[id] = tick_;
+
+    // The MAC rides along while a client could have missed the first row
+    bool withMac = tick_ - firstTick_[id] < config_.retainedTicks;
+    LogEntry entry;
+    entry.id = id;
+    entry.offset = (uint32_t)log.rows.size();
+    encodeRow(log.rows, id, row, withMac);
+    entry.length = (uint16_t)(log.rows.size() - entry.offset);
+    entry.type = row.type();
+    log.entries.push_back(entry);
+  }
+  ticks_.fetch_add(1, std::memory_order_relaxed);
+  rowsEncoded_.fetch_add(log.entries.size(), std::memory_order_relaxed);
+}
+
+void PushServer::buildSnapshotRows() {
+  if (snapshotRows_.tick == tick_) return;
+  snapshotRows_.tick = tick_;
+  snapshotRows_.rows.clear();
+  snapshotRows_.entries.clear();
+
+  uint32_t devices = cache_.deviceCount();
+  DeviceLastValue block[SNAPSHOT_BLOCK];
+  for (uint32_t base = 0; base < devices; base += SNAPSHOT_BLOCK) {
+    uint32_t rows = std::min(SNAPSHOT_BLOCK, devices - base);
+    cache_.readRange(base, rows, block);
+    for (uint32_t i = 0; i < rows; i++) {
+      if (block[i].version == 0) continue;   // id taken, first write still in progress
+      LogEntry entry;
+      entry.id = base + i;
+      entry.offset = (uint32_t)snapshotRows_.rows.size();
+      encodeRow(snapshotRows_.rows, entry.id, block[i], true);
+      entry.length = (uint16_t)(snapshotRows_.rows.size() - entry.offset);
+      entry.type = block[i].type();
+      snapshotRows_.entries.push_back(entry);
+    }
+  }
+}
+
+bool PushServer::watches(const Client* client, const LogEntry& entry) const {
+  if (client->type != DeviceType::Unknown && entry.type != client->type) return false;
+  if (client->all) return true;
+  return entry.id / 64 < client->watched.size() && (client->watched[entry.id / 64] >> (entry.id % 64) & 1);
+}
+
+void PushServer::resolveMacs(Client* client) {
+  for (size_t i = 0; i < client->macs.size();) {
+    int32_t id = cache_.findDevice(client->macs[i]);
+    if (id < 0) {
+      i++;
+      continue;
+    }
+    setBit(client->watched, (uint32_t)id);
+    client->macs[i] = client->macs.back();
+    client->macs.pop_back();
+  }
+}
+
+void PushServer::appendSnapshot(Client* client) {
+  buildSnapshotRows();
+  std::string& tx = client->tx;
+  tx += "event: snapshot\ndata: ";
+  appendSigned(tx, tickWallMs_);
+  uint64_t rows = 0;
+  for (const LogEntry& entry : snapshotRows_.entries) {
+    if (!watches(client, entry)) continue;
+    tx += ';';
+    tx.append(snapshotRows_.rows, entry.offset, entry.length);
+    rows++;
+  }
+  tx += "\n\n";
+  events_.fetch_add(1, std::memory_order_relaxed);
+  snapshots_.fetch_add(1, std::memory_order_relaxed);
+  rowsSent_.fetch_add(rows, std::memory_order_relaxed);
+}
+
+bool PushServer::appendDelta(Client* client) {
+  std::string& tx = client->tx;
+  size_t mark = tx.size();
+  tx += "event: delta\ndata: ";
+  appendSigned(tx, tickWallMs_);
+  uint64_t rows = 0;
+  for (const TickLog& log : log_) {
+    if (log.tick <= client->lastTick) continue;
+    for (const LogEntry& entry : log.entries) {
+      // Only a device's latest row: older ones in the same event are stale
+      if (changedTick_[entry.id] != log.tick || !watches(client, entry)) continue;
+      tx += ';';
+      tx.append(log.rows, entry.offset, entry.length);
+      rows++;
+    }
+  }
+  if (rows == 0) {
+    tx.resize(mark);
+    return false;
+  }
+  tx += "\n\n";
+  events_.fetch_add(1, std::memory_order_relaxed);
+  rowsSent_.fetch_add(rows, std::memory_order_relaxed);
+  return true;
+}
+
+void PushServer::flushDue(int64_t nowMs) {
+  for (auto& holder : clients_) {
+    Client* client = holder.get();
+    if (!client || client->closing || !client->streaming || nowMs < client->nextFlushMs) continue;
+    // Half a tick early still counts, so 4 Hz stays 4 Hz on a 50 ms tick
+    client->nextFlushMs = nowMs + client->intervalMs - config_.tickMs / 2;
+
+    if (client->pending() > config_.maxPendingBytes) {
+      skippedFlushes_.fetch_add(1, std::memory_order_relaxed);
+      if (client->slowSinceMs == 0) {
+        client->slowSinceMs = nowMs;
+      } else if (nowMs - client->slowSinceMs > config_.slowClientTimeoutMs) {
+        slowClientsDropped_.fetch_add(1, std::memory_order_relaxed);
+        closeClient(client);
+      }
+      continue;
+    }
+    client->slowSinceMs = 0;
+
+    if (!client->macs.empty()) resolveMacs(client);
+    bool sent = true;
+    if (!client->synced || client->lastTick + 1 < log_.front().tick) {
+      if (client->synced) resyncs_.fetch_add(1, std::memory_order_relaxed);
+      appendSnapshot(client);
+      client->synced = true;
+    } else {
+      sent = appendDelta(client);
+    }
+    client->lastTick = tick_;
+
+    if (sent) {
+      client->lastSendMs = nowMs;
+    } else if (nowMs - client->lastSendMs >= KEEPALIVE_MS) {
+      client->tx += ":\n\n";
+      client->lastSendMs = nowMs;
+    }
+    flush(client);
+  }
+}
+
+void PushServer::flush(Client* client) {
+  while (client->pending() > 0) {
+    ssize_t n = send(client->fd, client->tx.data() + client->txOffset, client->pending(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      closeClient(client);
+      return;
+    }
+    bytesOut_.fetch_add(n, std::memory_order_relaxed);
+    client->txOffset += n;
+  }
+
+  if (client->pending() == 0) {
+    client->tx.clear();
+    client->txOffset = 0;
+    if (client->closeWhenFlushed) {
+      closeClient(client);
+      return;
+    }
+  } else if (client->txOffset >= COMPACT_BYTES && client->txOffset * 2 >= client->tx.size()) {
+    client->tx.erase(0, client->txOffset);
+    client->txOffset = 0;
+  }
+
+  // Wait for room only while something is left over
+  bool wantWrite = client->pending() > 0;
+  if (wantWrite != client->writeWatched) {
+    client->writeWatched = wantWrite;
+    epoll_event event = {};
+    event.events = wantWrite ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.fd = client->fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, client->fd, &event);
+  }
+}
+
+void PushServer::closeClient(Client* client) {
+  if (client->closing) return;
+  client->closing = true;
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, client->fd, nullptr);
+  closed_.push_back(client);
+}
+
+void PushServer::releaseClosed() {
+  // The fd is closed only now, so no event of this pass can refer to a reused number
+  for (Client* client : closed_) {
+    int fd = client->fd;
+    if (client->streaming) clientCount_.fetch_sub(1, std::memory_order_relaxed);
+    close(fd);
+    clients_[fd].reset();
+    connections_--;
+  }
+  closed_.clear();
+}
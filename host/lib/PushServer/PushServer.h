@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <LastValueCache.h>
+
+/*
+ * Live fleet state for dashboards over Server-Sent Events (Linux, epoll).
+ *
+ * Every tick (50 ms by default) one pass over the last-value cache's row
+ * versions finds the devices that changed, and each changed row is encoded
+ * once into that tick's log, however many viewers watch it. A client gets
+ * a snapshot of its device set when it connects, then at its own rate
+ * (4 Hz by default) one event with the latest row of every watched device
+ * that changed since its previous event: a device updated ten times in
+ * between is sent once. Viewers never multiply the raw broker traffic.
+ *
+ *   GET /stream[?ids=0-999,4096&macs=AA:BB:CC:DD:EE:FF&type=emitter&hz=4]
+ *   GET /snapshot     the binary LastValueCache snapshot
+ *
+ * ids are the cache's dense device ids, i.e. row numbers of /snapshot; no
+ * ids and no macs watches the whole fleet. Events:
+ *
+ *   event: snapshot | delta
+ *   data: <wall ms>;<row>;<row>...
+ *
+ * with a row "id,co2,credits,flags,rssi[,mac]": CO2 in whole ppm, credits
+ * to 0.1, flags and type as in DeviceLastValue, RSSI 0 before the first
+ * heartbeat. The MAC (12 hex digits) is added while a device is new, and
+ * always in snapshots.
+ *
+ * Backpressure: a client with more than maxPendingBytes unsent is skipped,
+ * so its changes coalesce further instead of queueing. Once it falls behind
+ * the retained ticks it gets a fresh snapshot, and after
+ * slowClientTimeoutMs without catching up it is disconnected.
+ */
+
+struct PushServerConfig {
+  const char* bindAddress = "127.0.0.1";
+  uint16_t port = 0;                     // 0 picks a free port, see PushServer::port()
+  int tickMs = 50;                       // change detection period
+  int defaultHz = 4;                     // events per second per client
+  int maxHz = 20;
+  uint32_t retainedTicks = 64;           // how far behind a client may resume with deltas
+  size_t maxPendingBytes = 1u << 20;     // per client
+  int64_t slowClientTimeoutMs = 30000;
+  size_t maxClients = 100000;            // still bounded by the process fd limit
+};
+
+struct PushServerStats {
+  uint64_t clients = 0;                  // streaming right now
+  uint64_t clientsAccepted = 0;
+  uint64_t ticks = 0;
+  uint64_t rowsEncoded = 0;              // changed rows, once per tick
+  uint64_t events = 0;                   // snapshot and delta events sent
+  uint64_t rowsSent = 0;
+  uint64_t snapshots = 0;
+  uint64_t resyncs = 0;                  // snapshots sent again to clients that fell behind
+  uint64_t skippedFlushes = 0;           // client over maxPendingBytes when due
+  uint64_t slowClientsDropped = 0;
+  uint64_t bytesOut = 0;
+};
+
+class PushServer {
+public:
+  PushServer(const LastValueCache& cache, const PushServerConfig& config = PushServerConfig());
+  ~PushServer();
+
+  PushServer(const PushServer&) = delete;
+  PushServer& operator=(const PushServer&) = delete;
+
+  /**
+   * @brief Bind and listen
+   * @return false if the socket could not be set up
+   */
+  bool start();
+
+  uint16_t port() const { return port_; }
+
+  /**
+   * @brief One pass of the event loop, running the tick when it is due
+   * @return Number of events handled
+   */
+  int poll(int timeoutMs);
+
+  /**
+   * @brief Run the event loop until stop()
+   */
+  void run();
+
+  /**
+   * @brief Make run() return (any thread)
+   */
+  void stop();
+
+  PushServerStats stats() const;
+
+private:
+  struct Client;
+
+  // One changed row in a tick's text
+  struct LogEntry {
+    uint32_t id;
+    uint32_t offset;
+    uint16_t length;
+    DeviceType type;
+  };
+
+  struct TickLog {
+    uint64_t tick = 0;
+    std::string rows;
+    std::vector<LogEntry> entries;
+  };
+
+  void acceptClients();
+  void readClient(Client* client);
+  void handleRequest(Client* client);
+  bool parseStreamQuery(Client* client, const char* query, size_t length);
+  void respond(Client* client, const char* status, const char* type, const char* body, size_t length);
+
+  void runTick();
+  void buildSnapshotRows();
+  void flushDue(int64_t nowMs);
+  bool watches(const Client* client, const LogEntry& entry) const;
+  void resolveMacs(Client* client);
+  void appendSnapshot(Client* client);
+  bool appendDelta(Client* client);
+
+  void flush(Client* client);
+  void closeClient(Client* client);
+  void releaseClosed();
+
+  const LastValueCache& cache_;
+  PushServerConfig config_;
+  uint16_t port_ = 0;
+  int listenFd_ = -1;
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  std::atomic<bool> running_{false};
+
+  std::vector<std::unique_ptr<Client>> clients_;  // by fd
+  std::vector<Client*> closed_;                   // freed at the end of the pass
+  size_t connections_ = 0;
+
+  // Change detection, by device id
+  std::vector<uint32_t> lastVersion_;            // version last encoded, 0 if never
+  std::vector<uint64_t> changedTick_;            // tick of the latest entry
+  std::vector<uint64_t> firstTick_;              // tick the device was first encoded
+  std::deque<TickLog> log_;                       // the last retainedTicks ticks
+  uint64_t tick_ = 0;
+  int64_t nextTickMs_ = 0;
+  int64_t tickWallMs_ = 0;
+
+  // Every device with its MAC, built at most once per tick when a client needs it
+  TickLog snapshotRows_;
+
+  std::atomic<uint64_t> clientCount_{0};
+  std::atomic<uint64_t> clientsAccepted_{0};
+  std::atomic<uint64_t> ticks_{0};
+  std::atomic<uint64_t> rowsEncoded_{0};
+  std::atomic<uint64_t> events_{0};
+  std::atomic<uint64_t> rowsSent_{0};
+  std::atomic<uint64_t> snapshots_{0};
+  std::atomic<uint64_t> resyncs_{0};
+  std::atomic<uint64_t> skippedFlushes_{0};
+  std::atomic<uint64_t> slowClientsDropped_{0};
+  std::atomic<uint64_t> bytesOut_{0};
+};
@@ -0,0 +1,60 @@
+#include "Rollup.h"
+
+#include <algorithm>
+
+void RollupCell::add(const SensorWindow& window) {
+  windows++;
+  samples += window.samples;
+  if (window.offset) offsetWindows++;
+  minCo2 = std::min<uint16_t>(minCo2, (uint16_t)std::max(0, window.minCo2));
+  maxCo2 = std::max<uint16_t>(maxCo2, (uint16_t)std::max(0, window.maxCo2));
+  minHumidity = std::min<uint16_t>(minHumidity, (uint16_t)std::max(0, window.minHumidity));
+  maxHumidity = std::max<uint16_t>(maxHumidity, (uint16_t)std::max(0, window.maxHumidity));
+  co2Sum += (double)window.avgCo2 * window.samples;
+  humiditySum += (double)window.avgHumidity * window.samples;
+  creditsSum += window.credits;
+  emissionsSum += window.emissions;
+}
+
+void RollupCell::merge(const RollupCell& other) {
+  if (other.empty()) return;
+  windows += other.windows;
+  samples += other.samples;
+  offsetWindows += other.offsetWindows;
+  minCo2 = std::min(minCo2, other.minCo2);
+  maxCo2 = std::max(maxCo2, other.maxCo2);
+  minHumidity = std::min(minHumidity, other.minHumidity);
+  maxHumidity = std::max(maxHumidity, other.maxHumidity);
+  co2Sum += other.co2Sum;
+  humiditySum += other.humiditySum;
+  creditsSum += other.creditsSum;
+  emissionsSum += other.emissionsSum;
+}
+
+RollupStore::RollupStore(const RollupRetention& deviceRetention, const RollupRetention& typeRetention)
+  : deviceRetention_(deviceRetention),
+    types_{RollupSeries(typeRetention), RollupSeries(typeRetention), RollupSeries(typeRetention)} {
+}
+
+void RollupStore::ingest(const SensorWindow& window, int64_t timestampMs) {
+  auto it = devices_.find(window.mac);
+  if (it == devices_.end()) {
+    it = devices_.emplace(window.mac, RollupSeries(deviceRetention_)).first;
+  }
+  it->second.add(window, timestampMs);
+  types_[(int)window.type].add(window, timestampMs);
+}
+
+const RollupSeries* RollupStore::device(uint64_t mac) const {
+  auto it = devices_.find(mac);
+  return it == devices_.end() ? nullptr : &it->second;
+}
+
+RollupCell RollupStore::queryDevice(uint64_t mac, int64_t fromMs, int64_t toMs) const {
+  const RollupSeries* series = device(mac);
+  return series ? series->query(fromMs, toMs) : RollupCell();
+}
+
+RollupCell RollupStore::queryType(DeviceType type, int64_t fromMs, int64_t toMs) const {
+  return types_[(int)type].query(fromMs, toMs);
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <Telemetry.h>
+
+/**
+ * @brief Rollup resolutions, finest first
+ */
+enum RollupLevel {
+  ROLLUP_MINUTE = 0,
+  ROLLUP_HOUR = 1,
+  ROLLUP_DAY = 2,
+  ROLLUP_LEVEL_COUNT = 3,
+};
+
+const int64_t ROLLUP_WIDTH_MS[ROLLUP_LEVEL_COUNT] = {
+  60LL * 1000,            // 1 minute
+  60LL * 60 * 1000,       // 1 hour
+  24LL * 60 * 60 * 1000,  // 1 day
+};
+
+/**
+ * @brief Mergeable aggregate of every window that fell into one bucket
+ *
+ * Sums are weighted by the window's sample count so that merging cells and
+ * dividing by samples gives the same mean as averaging the raw readings.
+ */
+struct RollupCell {
+  int32_t bucket = -1;      // bucket index at this cell's level, -1 when empty
+  uint32_t windows = 0;     // sensor_data messages merged in
+  uint32_t samples = 0;     // raw readings behind those messages
+  uint32_t offsetWindows = 0;
+  uint16_t minCo2 = UINT16_MAX;
+  uint16_t maxCo2 = 0;
+  uint16_t minHumidity = UINT16_MAX;
+  uint16_t maxHumidity = 0;
+  double co2Sum = 0;
+  double humiditySum = 0;
+  double creditsSum = 0;    // sum of "cr" over windows
+  double emissionsSum = 0;  // sum of "e" over windows
+
+  void add(const SensorWindow& window);
+  void merge(const RollupCell& other);
+
+  bool empty() const { return windows == 0; }
+  double avgCo2() const { return samples ? co2Sum / samples : 0; }
+  double avgHumidity() const { return samples ? humiditySum / samples : 0; }
+};
+
+/**
+ * @brief How many buckets each level keeps before the oldest is overwritten
+ */
+struct RollupRetention {
+  uint32_t buckets[ROLLUP_LEVEL_COUNT];
+};
+
+// Per device: 2 hours of minutes, 2 days of hours, ~4 months of days (~16 KB/device)
+const RollupRetention DEVICE_ROLLUP_RETENTION = {{120, 48, 120}};
+// Per device type: 1 day of minutes, 90 days of hours, 10 years of days
+const RollupRetention TYPE_ROLLUP_RETENTION = {{1440, 90 * 24, 3650}};
+
+inline int64_t rollupFloorDiv(int64_t value, int64_t divisor) {
+  int64_t q = value / divisor;
+  return (value % divisor != 0 && value < 0) ? q - 1 : q;
+}
+
+inline int64_t rollupCeilDiv(int64_t value, int64_t divisor) {
+  return -rollupFloorDiv(-value, divisor);
+}
+
+/**
+ * @brief Multi-resolution rollups for a single series (one device or one type)
+ *
+ * Each level is a ring indexed by bucket number, so an update touches exactly
+ * one cell per level and a query touches at most one ring span per level.
+ * Cell needs a `bucket` member, add(const SensorWindow&), merge() and empty().
+ */
+template <typename Cell>
+class BasicRollupSeries {
+public:
+  explicit BasicRollupSeries(const RollupRetention& retention = DEVICE_ROLLUP_RETENTION)
+    : retention_(retention) {
+    for (int level = 0; level < ROLLUP_LEVEL_COUNT; level++) newest_[level] = INT32_MIN;
+  }
+
+  /**
+   * @brief Fold one window into every level (O(1))
+   * @param timestampMs Time the window is attributed to, epoch milliseconds
+   */
+  void add(const SensorWindow& window, int64_t timestampMs) {
+    for (int level = 0; level < ROLLUP_LEVEL_COUNT; level++) {
+      uint32_t capacity = retention_.buckets[level];
+      if (capacity == 0) continue;
+
+      int32_t bucket = (int32_t)rollupFloorDiv(timestampMs, ROLLUP_WIDTH_MS[level]);
+      if (newest_[level] != INT32_MIN && bucket <= (int64_t)newest_[level] - capacity) {
+        continue;  // Older than this level keeps
+      }
+
+      std::vector<Cell>& ring = rings_[level];
+      if (ring.empty()) ring.resize(capacity);  // Allocate lazily, most devices never need every level
+
+      Cell& cell = ring[(uint32_t)bucket % capacity];
+      if (cell.bucket != bucket) {
+        cell = Cell();
+        cell.bucket = bucket;
+      }
+      cell.add(window);
+      if (bucket > newest_[level]) newest_[level] = bucket;
+    }
+  }
+
+  /**
+   * @brief Aggregate over [fromMs, toMs)
+   *
+   * Whole days are answered from the day level, the remaining edges from
+   * hours, then minutes. Edges older than a finer level's retention are
+   * resolved at the coarser level, i.e. rounded outward to its buckets.
+   */
+  Cell query(int64_t fromMs, int64_t toMs) const {
+    Cell result;
+    visit(fromMs, toMs, [&](const Cell& cell) { result.merge(cell); });
+    return result;
+  }
+
+  /**
+   * @brief Call visitor(const Cell&) for every non-empty cell query() would merge
+   */
+  template <typename Visitor>
+  void visit(int64_t fromMs, int64_t toMs, Visitor&& visitor) const {
+    int coarsest = ROLLUP_LEVEL_COUNT - 1;
+    while (coarsest > 0 && retention_.buckets[coarsest] == 0) coarsest--;
+    collect(coarsest, fromMs, toMs, visitor);
+  }
+
+  /**
+   * @brief Raw access to one bucket at one level, for charts
+   */
+  const Cell* cell(RollupLevel level, int32_t bucket) const {
+    const std::vector<Cell>& ring = rings_[level];
+    if (ring.empty() || bucket < 0) return nullptr;
+    const Cell& cell = ring[(uint32_t)bucket % ring.size()];
+    return cell.bucket == bucket ? &cell : nullptr;
+  }
+
+  bool retains(RollupLevel level, int64_t timestampMs) const {
+    uint32_t capacity = retention_.buckets[level];
+    if (capacity == 0) return false;
+    if (newest_[level] == INT32_MIN) return true;
+    return rollupFloorDiv(timestampMs, ROLLUP_WIDTH_MS[level]) > (int64_t)newest_[level] - capacity;
+  }
+
+private:
+  template <typename Visitor>
+  void collect(int level, int64_t fromMs, int64_t toMs, Visitor& visitor) const {
+    if (fromMs >= toMs) return;
+
+    int64_t width = ROLLUP_WIDTH_MS[level];
+    if (level == ROLLUP_MINUTE || retention_.buckets[level - 1] == 0) {
+      visitBuckets(level, rollupFloorDiv(fromMs, width), rollupCeilDiv(toMs, width) - 1, visitor);
+      return;
+    }
+
+    // Whole buckets of this level inside the range, edges go one level down
+    int64_t first = rollupCeilDiv(fromMs, width);
+    int64_t end = rollupFloorDiv(toMs, width);
+
+    auto edge = [&](int64_t edgeFrom, int64_t edgeTo) {
+      if (edgeFrom >= edgeTo) return;
+      if (retains((RollupLevel)(level - 1), edgeFrom)) {
+        collect(level - 1, edgeFrom, edgeTo, visitor);
+      } else {
+        visitBuckets(level, rollupFloorDiv(edgeFrom, width), rollupCeilDiv(edgeTo, width) - 1, visitor);
+      }
+    };
+
+    if (first < end) {
+      visitBuckets(level, first, end - 1, visitor);
+      edge(fromMs, first * width);
+      edge(end * width, toMs);
+    } else {
+      edge(fromMs, toMs);
+    }
+  }
+
+  template <typename Visitor>
+  void visitBuckets(int level, int64_t first, int64_t last, Visitor& visitor) const {
+    const std::vector<Cell>& ring = rings_[level];
+    if (ring.empty()) return;
+
+    int64_t capacity = ring.size();
+    if (first < (int64_t)newest_[level] - capacity + 1) first = (int64_t)newest_[level] - capacity + 1;
+    if (last > (int64_t)newest_[level]) last = newest_[level];
+
+    for (int64_t bucket = first; bucket <= last; bucket++) {
+      const Cell& cell = ring[(uint64_t)bucket % capacity];
+      if (cell.bucket == bucket && !cell.empty()) visitor(cell);
+    }
+  }
+
+  RollupRetention retention_;
+  int32_t newest_[ROLLUP_LEVEL_COUNT];
+  std::vector<Cell> rings_[ROLLUP_LEVEL_COUNT];
+};
+
+typedef BasicRollupSeries<RollupCell> RollupSeries;
+
+/**
+ * @brief Rollups for every device and every device type, fed by the ingest path
+ */
+class RollupStore {
+public:
+  RollupStore(const RollupRetention& deviceRetention = DEVICE_ROLLUP_RETENTION,
+              const RollupRetention& typeRetention = TYPE_ROLLUP_RETENTION);
+
+  void ingest(const SensorWindow& window, int64_t timestampMs);
+
+  RollupCell queryDevice(uint64_t mac, int64_t fromMs, int64_t toMs) const;
+  RollupCell queryType(DeviceType type, int64_t fromMs, int64_t toMs) const;
+
+  const RollupSeries* device(uint64_t mac) const;
+  const RollupSeries& type(DeviceType type) const { return types_[(int)type]; }
+  size_t deviceCount() const { return devices_.size(); }
+
+private:
+  RollupRetention deviceRetention_;
+  std::unordered_map<uint64_t, RollupSeries> devices_;
+  RollupSeries types_[DEVICE_TYPE_COUNT];
+};
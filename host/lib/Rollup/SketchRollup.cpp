@@ -0,0 +1,45 @@
+#include "SketchRollup.h"
+
+void SketchCell::add(const SensorWindow& window) {
+  bool added = false;
+  if (window.co2Sketch) added |= co2.addEncoded(window.co2Sketch, window.co2SketchLength);
+  if (window.humiditySketch) added |= humidity.addEncoded(window.humiditySketch, window.humiditySketchLength);
+  if (added) windows++;
+}
+
+void SketchCell::merge(const SketchCell& other) {
+  windows += other.windows;
+  co2.merge(other.co2);
+  humidity.merge(other.humidity);
+}
+
+SketchRollup::SketchRollup(const RollupRetention& retention)
+  : types_{BasicRollupSeries<SketchCell>(retention), BasicRollupSeries<SketchCell>(retention),
+           BasicRollupSeries<SketchCell>(retention)} {
+}
+
+void SketchRollup::ingest(const SensorWindow& window, int64_t timestampMs) {
+  if (!window.co2Sketch && !window.humiditySketch) return;
+  types_[(int)window.type].add(window, timestampMs);
+}
+
+void SketchRollup::query(DeviceType type, int64_t fromMs, int64_t toMs,
+                         LogHistogram& co2, LogHistogram& humidity) const {
+  // Gather the buckets first so each output histogram is written once
+  std::vector<const LogHistogram*> co2Sources, humiditySources;
+  types_[(int)type].visit(fromMs, toMs, [&](const SketchCell& cell) {
+    co2Sources.push_back(&cell.co2);
+    humiditySources.push_back(&cell.humidity);
+  });
+  sketchMergeMany(co2, co2Sources.data(), co2Sources.size());
+  sketchMergeMany(humidity, humiditySources.data(), humiditySources.size());
+}
+
+QuantileSummary SketchRollup::summarize(const LogHistogram& histogram) {
+  QuantileSummary summary;
+  summary.samples = histogram.total();
+  summary.p50 = histogram.quantile(0.50);
+  summary.p95 = histogram.quantile(0.95);
+  summary.p99 = histogram.quantile(0.99);
+  return summary;
+}
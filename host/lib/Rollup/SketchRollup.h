@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QuantileSketch.h>
+
+#include "Rollup.h"
+
+/**
+ * @brief Fleet CO2 / humidity distribution for one bucket
+ */
+struct SketchCell {
+  int32_t bucket = -1;
+  uint32_t windows = 0;  // windows that carried sketches
+  LogHistogram co2;
+  LogHistogram humidity;
+
+  void add(const SensorWindow& window);
+  void merge(const SketchCell& other);
+  bool empty() const { return windows == 0; }
+};
+
+// Hourly and daily distributions only, a minute level would cost 3 KB per minute per type
+const RollupRetention SKETCH_ROLLUP_RETENTION = {{0, 90 * 24, 3650}};
+
+/**
+ * @brief Percentiles of a merged distribution
+ */
+struct QuantileSummary {
+  uint64_t samples = 0;
+  float p50 = 0;
+  float p95 = 0;
+  float p99 = 0;
+};
+
+/**
+ * @brief Merges per-window sketches across devices and time, per device type
+ */
+class SketchRollup {
+public:
+  explicit SketchRollup(const RollupRetention& retention = SKETCH_ROLLUP_RETENTION);
+
+  /**
+   * @brief Fold a window's sketches in, windows without sketches are ignored
+   */
+  void ingest(const SensorWindow& window, int64_t timestampMs);
+
+  /**
+   * @brief Merge every bucket in [fromMs, toMs) into co2 / humidity
+   */
+  void query(DeviceType type, int64_t fromMs, int64_t toMs, LogHistogram& co2, LogHistogram& humidity) const;
+
+  static QuantileSummary summarize(const LogHistogram& histogram);
+
+private:
+  BasicRollupSeries<SketchCell> types_[DEVICE_TYPE_COUNT];
+};
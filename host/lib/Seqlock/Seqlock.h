@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+/**
+ * @brief Single-writer, many-reader publication of a small trivially copyable value
+ *
+ * Readers never block the writer and never take a lock: they copy the value
+ * and retry if the sequence changed underneath them. The payload is stored as
+ * relaxed atomic words so concurrent copies are well defined.
+ */
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+
+public:
+  Seqlock() {
+    T empty{};
+    write(empty);
+  }
+
+  /**
+   * @brief Publish a new value (one writer at a time)
+   */
+  void write(const T& value) {
+    uint64_t buffer[WORDS] = {};
+    memcpy(buffer, &value, sizeof(T));
+
+    uint32_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) words_[i].store(buffer[i], std::memory_order_relaxed);
+    sequence_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Copy out a consistent value, retrying while a write is in flight
+   */
+  T read() const {
+    uint64_t buffer[WORDS];
+    while (true) {
+      uint32_t before = sequence_.load(std::memory_order_acquire);
+      if (before & 1) continue;
+      for (size_t i = 0; i < WORDS; i++) buffer[i] = words_[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == before) break;
+    }
+    T value;
+    memcpy(&value, buffer, sizeof(T));
+    return value;
+  }
+
+  /**
+   * @brief Number of completed writes, lets readers skip unchanged values
+   */
+  uint32_t version() const { return sequence_.load(std::memory_order_acquire) >> 1; }
+
+private:
+  static const size_t WORDS = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint32_t> sequence_{0};
+  std::atomic<uint64_t> words_[WORDS];
+};
@@ -0,0 +1,140 @@
+#include "SequenceDedupe.h"
+
+#include <string.h>
+
+static inline uint64_t mixMac(uint64_t mac) {
+  uint64_t h = mac * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 29);
+}
+
+/**
+ * @brief Clear count ring positions starting at sequence from, a word at a time
+ */
+static void clearRange(uint64_t* bits, uint32_t from, uint32_t count) {
+  while (count > 0) {
+    uint32_t index = from % DEDUPE_WINDOW;
+    uint32_t bit = index % 64;
+    uint32_t n = count < 64 - bit ? count : 64 - bit;
+    uint64_t mask = n == 64 ? ~0ULL : ((1ULL << n) - 1) << bit;
+    bits[index / 64] &= ~mask;
+    from += n;
+    count -= n;
+  }
+}
+
+SequenceDedupe::SequenceDedupe(size_t expectedDevices) {
+  size_t capacity = 16;
+  while (capacity < expectedDevices * 2) capacity <<= 1;
+  slots_.assign(capacity, Slot());
+  mask_ = capacity - 1;
+  windows_.reserve(expectedDevices);
+}
+
+SequenceDedupe::Slot& SequenceDedupe::find(uint64_t mac, bool& created) {
+  created = false;
+  size_t i = mixMac(mac) & mask_;
+  while (true) {
+    Slot& slot = slots_[i];
+    if (slot.mac == mac) return slot;
+    if (slot.mac == 0) break;
+    i = (i + 1) & mask_;
+  }
+
+  // Keep the table at most half full
+  if ((stats_.devices + 1) * 2 > slots_.size()) {
+    grow();
+    return find(mac, created);
+  }
+  Slot& slot = slots_[i];
+  slot = Slot();
+  slot.mac = mac;
+  slot.window = (uint32_t)windows_.size();
+  windows_.emplace_back();
+  stats_.devices++;
+  created = true;
+  return slot;
+}
+
+void SequenceDedupe::grow() {
+  std::vector<Slot> old;
+  old.swap(slots_);
+  slots_.assign(old.size() * 2, Slot());
+  mask_ = slots_.size() - 1;
+  for (const Slot& slot : old) {
+    if (slot.mac == 0) continue;
+    size_t i = mixMac(slot.mac) & mask_;
+    while (slots_[i].mac != 0) i = (i + 1) & mask_;
+    slots_[i] = slot;
+  }
+}
+
+void SequenceDedupe::restart(Slot& slot, uint32_t sequence) {
+  Window& window = windows_[slot.window];
+  memset(window.bits, 0, sizeof(window.bits));
+  slot.top = sequence;
+  slot.staleRun = 0;
+  window.bits[sequence % DEDUPE_WINDOW / 64] |= 1ULL << (sequence % 64);
+}
+
+SequenceVerdict SequenceDedupe::accept(uint64_t mac, uint32_t sequence) {
+  if (sequence == 0) {
+    stats_.unsequenced++;
+    return SequenceVerdict::Unsequenced;
+  }
+
+  bool created;
+  Slot& slot = find(mac, created);
+  uint64_t* bits = windows_[slot.window].bits;
+  uint64_t bit = 1ULL << (sequence % 64);
+  uint64_t& word = bits[sequence % DEDUPE_WINDOW / 64];
+
+  if (created) {
+    restart(slot, sequence);
+    stats_.fresh++;
+    return SequenceVerdict::Fresh;
+  }
+
+  // Ahead: slide the window, forgetting what falls out of it
+  if (sequence > slot.top) {
+    uint32_t ahead = sequence - slot.top;
+    if (ahead >= DEDUPE_WINDOW) {
+      memset(bits, 0, DEDUPE_WINDOW / 8);
+    } else {
+      clearRange(bits, slot.top + 1, ahead);
+    }
+    slot.top = sequence;
+    slot.staleRun = 0;
+    word |= bit;
+    stats_.fresh++;
+    return SequenceVerdict::Fresh;
+  }
+
+  // Inside the window: one bit says it all
+  uint32_t behind = slot.top - sequence;
+  if (behind < DEDUPE_WINDOW) {
+    if (word & bit) {
+      stats_.duplicates++;
+      return SequenceVerdict::Duplicate;
+    }
+    word |= bit;
+    stats_.fresh++;
+    return SequenceVerdict::Fresh;
+  }
+
+  // Older than the window: a replay, unless the counter restarted
+  slot.staleRun = slot.staleRun > 0 && sequence > slot.lastStale ? slot.staleRun + 1 : 1;
+  slot.lastStale = sequence;
+  if (behind > DEDUPE_RESET_GAP || slot.staleRun >= DEDUPE_RESTART_RUN) {
+    restart(slot, sequence);
+    stats_.resets++;
+    stats_.fresh++;
+    return SequenceVerdict::Fresh;
+  }
+  stats_.stale++;
+  return SequenceVerdict::Stale;
+}
+
+double SequenceDedupe::bytesPerDevice() const {
+  if (stats_.devices == 0) return 0;
+  return (double)(slots_.size() * sizeof(Slot) + windows_.capacity() * sizeof(Window)) / stats_.devices;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ * Exactly-once filter on the per-device "seq" of every payload.
+ *
+ * A QoS retry, a backlog batch resent after a publish that did arrive, or
+ * the burner's fallback topic can deliver a window twice. Each device keeps
+ * the highest sequence seen and a bitmap of the DEDUPE_WINDOW sequences at
+ * and below it (one 64-byte cache line, a ring indexed by seq % window).
+ * A number above the top slides the window (clearing at most the whole
+ * line), one inside it is a single bit test, so gaps and reordering cost
+ * O(1). Numbers older than the window are stale and dropped, unless they
+ * show the device's counter restarted (its NVS was erased): one far back,
+ * or a run of DEDUPE_RESTART_RUN rising ones, longer than any backlog
+ * resend. After such a run the window starts over from there.
+ *
+ * Devices are found through an open-addressing table keyed by MAC; one
+ * instance per ingest shard, so every device has a single writer.
+ */
+
+const uint32_t DEDUPE_WINDOW = 512;                   // sequences remembered per device
+const uint32_t DEDUPE_RESET_GAP = 1u << 20;           // further back than this: the counter restarted
+const uint32_t DEDUPE_RESTART_RUN = 32;               // rising stale numbers that mean the same
+
+enum class SequenceVerdict : uint8_t {
+  Fresh,          // first time seen: ingest it
+  Duplicate,      // seen before
+  Stale,          // older than the window, most likely a replay
+  Unsequenced,    // no "seq" (older firmware): cannot tell, ingest it
+};
+
+struct SequenceDedupeStats {
+  uint64_t fresh = 0;
+  uint64_t duplicates = 0;
+  uint64_t stale = 0;
+  uint64_t resets = 0;        // counters that restarted (treated as fresh)
+  uint64_t unsequenced = 0;
+  uint64_t devices = 0;
+};
+
+class SequenceDedupe {
+public:
+  explicit SequenceDedupe(size_t expectedDevices = 1024);
+
+  /**
+   * @brief Record a device's sequence number and say whether it is new
+   */
+  SequenceVerdict accept(uint64_t mac, uint32_t sequence);
+
+  const SequenceDedupeStats& stats() const { return stats_; }
+
+  /**
+   * @brief Bytes held per tracked device, table slack included
+   */
+  double bytesPerDevice() const;
+
+private:
+  static const int WORDS = DEDUPE_WINDOW / 64;
+
+  struct Slot {
+    uint64_t mac;             // 0: empty
+    uint32_t top;             // highest sequence seen
+    uint32_t window;          // index into windows_
+    uint32_t lastStale;       // latest stale number, and how many rose in a row up to it
+    uint32_t staleRun;
+  };
+
+  struct alignas(64) Window {
+    uint64_t bits[WORDS];
+  };
+
+  Slot& find(uint64_t mac, bool& created);
+  void grow();
+  void restart(Slot& slot, uint32_t sequence);
+
+  std::vector<Slot> slots_;
+  std::vector<Window> windows_;
+  size_t mask_ = 0;
+  SequenceDedupeStats stats_;
+};
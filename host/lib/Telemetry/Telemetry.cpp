@@ -0,0 +1,199 @@
+#include "Telemetry.h"
+
+#include <stdio.h>
+#include <string.h>
+
+double parseJsonNumber(const char* text, size_t length) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < length && (text[i] == '-' || text[i] == '+')) {
+    negative = text[i] == '-';
+    i++;
+  }
+
+  double value = 0;
+  while (i < length && text[i] >= '0' && text[i] <= '9') {
+    value = value * 10 + (text[i] - '0');
+    i++;
+  }
+
+  if (i < length && text[i] == '.') {
+    i++;
+    double scale = 0.1;
+    while (i < length && text[i] >= '0' && text[i] <= '9') {
+      value += (text[i] - '0') * scale;
+      scale *= 0.1;
+      i++;
+    }
+  }
+
+  return negative ? -value : value;
+}
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+uint64_t parseMacAddress(const char* text, size_t length) {
+  if (length != 17) return 0;
+
+  uint64_t mac = 0;
+  for (int octet = 0; octet < 6; octet++) {
+    const char* p = text + octet * 3;
+    if (octet > 0 && p[-1] != ':') return 0;
+    int hi = hexDigit(p[0]);
+    int lo = hexDigit(p[1]);
+    if (hi < 0 || lo < 0) return 0;
+    mac = (mac << 8) | (uint64_t)(hi << 4 | lo);
+  }
+  return mac;
+}
+
+void formatMacAddress(uint64_t mac, char* out) {
+  snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
+           (unsigned)(mac >> 40) & 0xFF, (unsigned)(mac >> 32) & 0xFF,
+           (unsigned)(mac >> 24) & 0xFF, (unsigned)(mac >> 16) & 0xFF,
+           (unsigned)(mac >> 8) & 0xFF, (unsigned)mac & 0xFF);
+}
+
+uint32_t parseIpAddress(const char* text, size_t length) {
+  uint32_t ip = 0;
+  uint32_t octet = 0;
+  int dots = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] == '.') {
+      ip = (ip << 8) | (octet & 0xFF);
+      octet = 0;
+      dots++;
+    } else if (text[i] >= '0' && text[i] <= '9') {
+      octet = octet * 10 + (text[i] - '0');
+    } else {
+      return 0;
+    }
+  }
+  if (dots != 3) return 0;
+  return (ip << 8) | (octet & 0xFF);
+}
+
+DeviceType parseDeviceType(const char* text, size_t length) {
+  if (jsonKeyIs(text, length, "sequester")) return DeviceType::Sequester;
+  if (jsonKeyIs(text, length, "emitter")) return DeviceType::Emitter;
+  return DeviceType::Unknown;
+}
+
+const char* deviceTypeName(DeviceType type) {
+  switch (type) {
+    case DeviceType::Sequester: return "sequester";
+    case DeviceType::Emitter: return "emitter";
+    default: return "unknown";
+  }
+}
+
+bool parseSensorWindow(const char* payload, size_t length, SensorWindow& out) {
+  out = SensorWindow();
+
+  bool wellFormed = forEachJsonField(payload, length,
+    [&](const char* key, size_t keyLen, const char* value, size_t valueLen, bool isString) {
+      // Keys are short and mostly distinct by their first character
+      switch (key[0]) {
+        case 'i':
+          if (jsonKeyIs(key, keyLen, "ip") && isString) out.ip = parseIpAddress(value, valueLen);
+          break;
+        case 'm':
+          if (jsonKeyIs(key, keyLen, "mac") && isString) out.mac = parseMacAddress(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "max_c")) out.maxCo2 = (int)parseJsonNumber(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "min_c")) out.minCo2 = (int)parseJsonNumber(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "max_h")) out.maxHumidity = (int)parseJsonNumber(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "min_h")) out.minHumidity = (int)parseJsonNumber(value, valueLen);
+          break;
+        case 'a':
+          if (jsonKeyIs(key, keyLen, "avg_c")) out.avgCo2 = (float)parseJsonNumber(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "avg_h")) out.avgHumidity = (float)parseJsonNumber(value, valueLen);
+          break;
+        case 'c':
+          if (jsonKeyIs(key, keyLen, "cr")) {
+            out.credits = (float)parseJsonNumber(value, valueLen);
+          } else if (jsonKeyIs(key, keyLen, "credits_avail")) {
+            out.creditsAvailable = (float)parseJsonNumber(value, valueLen);
+            out.hasCreditsAvailable = true;
+          }
+          break;
+        case 'e':
+          if (keyLen == 1) out.emissions = (float)parseJsonNumber(value, valueLen);
+          break;
+        case 'o':
+          if (keyLen == 1) out.offset = valueLen == 4 && value[0] == 't';
+          break;
+        case 't':
+          if (keyLen == 1) out.deviceTime = (uint64_t)parseJsonNumber(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "ts")) out.timeSynced = valueLen == 1 && value[0] == '1';
+          else if (jsonKeyIs(key, keyLen, "type")) out.type = parseDeviceType(value, valueLen);
+          break;
+        case 's':
+          if (jsonKeyIs(key, keyLen, "samples")) out.samples = (int)parseJsonNumber(value, valueLen);
+          else if (jsonKeyIs(key, keyLen, "seq")) out.sequence = (uint32_t)parseJsonNumber(value, valueLen);
+          break;
+        case 'q':
+          if (jsonKeyIs(key, keyLen, "q_c")) {
+            out.co2Sketch = value;
+            out.co2SketchLength = (uint16_t)valueLen;
+          } else if (jsonKeyIs(key, keyLen, "q_h")) {
+            out.humiditySketch = value;
+            out.humiditySketchLength = (uint16_t)valueLen;
+          }
+          break;
+      }
+    });
+
+  return wellFormed && out.mac != 0 && out.type != DeviceType::Unknown && out.samples > 0;
+}
+
+bool parseHeartbeat(const char* payload, size_t length, Heartbeat& out) {
+  out = Heartbeat();
+
+  bool wellFormed = forEachJsonField(payload, length,
+    [&](const char* key, size_t keyLen, const char* value, size_t valueLen, bool isString) {
+      if (jsonKeyIs(key, keyLen, "mac") && isString) out.mac = parseMacAddress(value, valueLen);
+      else if (jsonKeyIs(key, keyLen, "ip") && isString) out.ip = parseIpAddress(value, valueLen);
+      else if (jsonKeyIs(key, keyLen, "rssi")) out.rssi = (int)parseJsonNumber(value, valueLen);
+      else if (jsonKeyIs(key, keyLen, "uptime")) out.uptimeMs = (uint64_t)parseJsonNumber(value, valueLen);
+      else if (jsonKeyIs(key, keyLen, "status")) out.online = valueLen == 6 && memcmp(value, "online", 6) == 0;
+      else if (jsonKeyIs(key, keyLen, "t")) out.deviceTime = (uint64_t)parseJsonNumber(value, valueLen);
+      else if (jsonKeyIs(key, keyLen, "ts")) out.timeSynced = valueLen == 1 && value[0] == '1';
+      else if (jsonKeyIs(key, keyLen, "seq")) out.sequence = (uint32_t)parseJsonNumber(value, valueLen);
+    });
+
+  return wellFormed && out.mac != 0;
+}
+
+int formatSensorWindow(const SensorWindow& window, char* out, size_t size) {
+  char mac[18];
+  formatMacAddress(window.mac, mac);
+
+  int length = snprintf(out, size,
+    "{\"ip\":\"%u.%u.%u.%u\",\"mac\":\"%s\",\"avg_c\":%.1f,\"max_c\":%d,\"min_c\":%d,\"avg_h\":%.1f,\"max_h\":%d,\"min_h\":%d,\"cr\":%.1f,\"e\":%.1f,\"o\":%s,\"t\":%llu,\"ts\":%d,\"seq\":%u,\"type\":\"%s\",\"samples\":%d",
+    (window.ip >> 24) & 0xFF, (window.ip >> 16) & 0xFF, (window.ip >> 8) & 0xFF, window.ip & 0xFF, mac,
+    window.avgCo2, window.maxCo2, window.minCo2, window.avgHumidity, window.maxHumidity, window.minHumidity,
+    window.credits, window.emissions, window.offset ? "true" : "false",
+    (unsigned long long)window.deviceTime, window.timeSynced ? 1 : 0, (unsigned)window.sequence,
+    deviceTypeName(window.type), window.samples);
+  if (length < 0 || (size_t)length >= size) return length;
+
+  if (window.hasCreditsAvailable) {
+    length += snprintf(out + length, size - length, ",\"credits_avail\":%.1f", window.creditsAvailable);
+    if ((size_t)length >= size) return length;
+  }
+  if (window.co2Sketch) {
+    length += snprintf(out + length, size - length, ",\"q_c\":%.*s", (int)window.co2SketchLength, window.co2Sketch);
+    if ((size_t)length >= size) return length;
+  }
+  if (window.humiditySketch) {
+    length += snprintf(out + length, size - length, ",\"q_h\":%.*s", (int)window.humiditySketchLength, window.humiditySketch);
+    if ((size_t)length >= size) return length;
+  }
+  length += snprintf(out + length, size - length, "}");
+  return length;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <PayloadCodec.h>
+
+/**
+ * @brief Device role as reported in the payload "type" field
+ */
+enum class DeviceType : uint8_t {
+  Unknown = 0,
+  Sequester = 1,  // creator firmware, "type":"sequester"
+  Emitter = 2,    // burner firmware, "type":"emitter"
+};
+
+const int DEVICE_TYPE_COUNT = 3;
+
+/**
+ * @brief One aggregated window as published by publishAggregatedDataToMqtt()
+ */
+struct SensorWindow {
+  uint32_t ip = 0;
+  uint64_t mac = 0;
+  float avgCo2 = 0;
+  int maxCo2 = 0;
+  int minCo2 = 0;
+  float avgHumidity = 0;
+  int maxHumidity = 0;
+  int minHumidity = 0;
+  float credits = 0;           // "cr": credits generated (sequester) or needed (emitter)
+  float emissions = 0;         // "e"
+  bool offset = false;         // "o"
+  uint64_t deviceTime = 0;     // "t": Unix ms if timeSynced, else ms since boot
+  bool timeSynced = false;     // "ts":1, the device clock is SNTP-disciplined
+  uint32_t sequence = 0;       // "seq": per message, 0 if absent (older firmware)
+  DeviceType type = DeviceType::Unknown;
+  int samples = 0;
+  float creditsAvailable = 0;  // "credits_avail", emitter only
+  bool hasCreditsAvailable = false;
+  // Optional quantile sketches ("q_c", "q_h"), pointing into the parsed payload
+  const char* co2Sketch = nullptr;
+  const char* humiditySketch = nullptr;
+  uint16_t co2SketchLength = 0;
+  uint16_t humiditySketchLength = 0;
+};
+
+/**
+ * @brief Device status as published by sendHeartbeat()
+ */
+struct Heartbeat {
+  uint32_t ip = 0;
+  uint64_t mac = 0;
+  bool online = false;
+  uint64_t uptimeMs = 0;
+  int rssi = 0;               // dBm
+  uint64_t deviceTime = 0;    // "t": Unix ms if timeSynced, else ms since boot
+  bool timeSynced = false;    // "ts"
+  uint32_t sequence = 0;      // "seq"
+};
+
+/**
+ * @brief Walk the fields of a flat JSON object without allocating
+ *
+ * Calls onField(key, keyLen, value, valueLen, isString) for every member.
+ * String values are passed without their quotes, arrays are passed as the
+ * raw "[...]" span. Nested objects are not supported (devices never send them).
+ * @return true if the whole object was well formed
+ */
+template <typename Callback>
+bool forEachJsonField(const char* json, size_t length, Callback onField) {
+  size_t i = 0;
+  auto skipSpace = [&]() {
+    while (i < length && (json[i] == ' ' || json[i] == '\t' || json[i] == '\r' || json[i] == '\n')) i++;
+  };
+
+  skipSpace();
+  if (i >= length || json[i] != '{') return false;
+  i++;
+
+  while (true) {
+    skipSpace();
+    if (i < length && json[i] == '}') return true;
+    if (i >= length || json[i] != '"') return false;
+
+    const char* key = json + ++i;
+    while (i < length && json[i] != '"') i++;
+    if (i >= length) return false;
+    size_t keyLen = (json + i) - key;
+    i++;
+
+    skipSpace();
+    if (i >= length || json[i] != ':') return false;
+    i++;
+    skipSpace();
+    if (i >= length) return false;
+
+    const char* value = json + i;
+    size_t valueLen;
+    bool isString = false;
+    if (json[i] == '"') {
+      value = json + ++i;
+      while (i < length && json[i] != '"') {
+        if (json[i] == '\\') i++;
+        i++;
+      }
+      if (i >= length) return false;
+      valueLen = (json + i) - value;
+      isString = true;
+      i++;
+    } else if (json[i] == '[') {
+      while (i < length && json[i] != ']') i++;
+      if (i >= length) return false;
+      i++;
+      valueLen = (json + i) - value;
+    } else {
+      while (i < length && json[i] != ',' && json[i] != '}' && json[i] != ' ') i++;
+      valueLen = (json + i) - value;
+    }
+
+    onField(key, keyLen, value, valueLen, isString);
+
+    skipSpace();
+    if (i < length && json[i] == ',') {
+      i++;
+      continue;
+    }
+    if (i < length && json[i] == '}') return true;
+    return false;
+  }
+}
+
+/**
+ * @brief Compare a length-delimited key against a literal
+ */
+inline bool jsonKeyIs(const char* key, size_t keyLen, const char* literal) {
+  size_t i = 0;
+  for (; i < keyLen; i++) {
+    if (literal[i] != key[i]) return false;
+  }
+  return literal[i] == '\0';
+}
+
+/**
+ * @brief Parse a decimal number as printed by the firmware's "%d" / "%.1f"
+ */
+double parseJsonNumber(const char* text, size_t length);
+
+/**
+ * @brief Parse "AA:BB:CC:DD:EE:FF" into the low 48 bits of an integer
+ * @return 0 if the text is not a MAC address
+ */
+uint64_t parseMacAddress(const char* text, size_t length);
+
+/**
+ * @brief Format a 48-bit MAC the way the firmware prints it
+ * @param out Buffer of at least 18 bytes
+ */
+void formatMacAddress(uint64_t mac, char* out);
+
+/**
+ * @brief Parse "a.b.c.d" into a host-order IPv4 address
+ */
+uint32_t parseIpAddress(const char* text, size_t length);
+
+DeviceType parseDeviceType(const char* text, size_t length);
+const char* deviceTypeName(DeviceType type);
+
+/**
+ * @brief Parse a sensor_data payload
+ *
+ * Sketch fields are not copied: out stays valid only as long as payload does.
+ * @return true if the payload carried at least a MAC, a type and a sample count
+ */
+bool parseSensorWindow(const char* payload, size_t length, SensorWindow& out);
+
+// A synced device time further ahead of arrival than this is not believed
+const int64_t MAX_DEVICE_CLOCK_LEAD_MS = 60000;
+
+/**
+ * @brief When a window was taken, in Unix ms
+ *
+ * The device's own "t" if its clock is synced (and not implausibly ahead),
+ * otherwise arrival less how long the window waited in a backlog batch.
+ */
+inline int64_t windowTimestampMs(const SensorWindow& window, int64_t arrivalMs, uint64_t ageMs) {
+  if (window.timeSynced && (int64_t)window.deviceTime <= arrivalMs + MAX_DEVICE_CLOCK_LEAD_MS) {
+    return (int64_t)window.deviceTime;
+  }
+  return arrivalMs - (int64_t)ageMs;
+}
+
+/**
+ * @brief Every window of a sensor_data payload, plain JSON or framed by PayloadCodec
+ *
+ * Calls onWindow(const SensorWindow&, int64_t timestampMs) in publish order,
+ * with the window placed by windowTimestampMs(). Framed text is decoded into
+ * scratch, which the windows' sketch pointers then refer to.
+ * @return Windows passed to onWindow, -1 if the payload is malformed (windows
+ *         before a malformed line of a batch have been passed already)
+ */
+template <typename Callback>
+int forEachSensorWindow(const char* payload, size_t length, int64_t arrivalMs, std::vector<char>& scratch,
+                        Callback onWindow) {
+  SensorWindow window;
+  const uint8_t* data = (const uint8_t*)payload;
+  if (!isFramedPayload(data, length)) {
+    if (!parseSensorWindow(payload, length, window)) return -1;
+    onWindow(window, windowTimestampMs(window, arrivalMs, 0));
+    return 1;
+  }
+
+  uint8_t flags;
+  scratch.resize(framedTextLength(data));
+  int textLength = decodePayload(data, length, scratch.data(), scratch.size(), flags);
+  if (textLength < 0) return -1;
+  const char* text = scratch.data();
+  if (!(flags & PAYLOAD_BATCH)) {
+    if (!parseSensorWindow(text, textLength, window)) return -1;
+    onWindow(window, windowTimestampMs(window, arrivalMs, 0));
+    return 1;
+  }
+
+  // First line: the device's uptime when it sent the batch, the base of unsynced "t"
+  const char* end = text + textLength;
+  const char* line = (const char*)memchr(text, '\n', textLength);
+  if (!line) return -1;
+  uint64_t sentMs = (uint64_t)parseJsonNumber(text, line - text);
+  int windows = 0;
+  for (const char* start = line + 1; start < end;) {
+    const char* next = (const char*)memchr(start, '\n', end - start);
+    if (!next) next = end;
+    if (next > start) {
+      if (!parseSensorWindow(start, next - start, window)) return -1;
+      uint64_t ageMs = !window.timeSynced && window.deviceTime <= sentMs ? sentMs - window.deviceTime : 0;
+      onWindow(window, windowTimestampMs(window, arrivalMs, ageMs));
+      windows++;
+    }
+    start = next + 1;
+  }
+  return windows;
+}
+
+/**
+ * @brief Parse a heartbeat payload
+ * @return true if the payload carried at least a MAC
+ */
+bool parseHeartbeat(const char* payload, size_t length, Heartbeat& out);
+
+/**
+ * @brief Format a window with the same layout the firmware publishes
+ * @return Number of characters written (snprintf semantics)
+ */
+int formatSensorWindow(const SensorWindow& window, char* out, size_t size);
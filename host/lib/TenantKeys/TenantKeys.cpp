@@ -0,0 +1,259 @@
+#include "TenantKeys.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Pilots tried per bucket before the build starts over with another seed
+static const uint32_t MAX_PILOT = 1u << 28;
+
+static inline uint64_t mix64(uint64_t h) {
+  h ^= h >> 32;
+  h *= 0xD6E8FEB86659FD93ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+static inline uint64_t hashKey(const ApiKey& key, uint64_t seed) {
+  uint64_t w[4];
+  memcpy(w, key.bytes, sizeof(w));
+  // Independent lanes, then one final mix
+  uint64_t h = (w[0] ^ seed) * 0x9E3779B97F4A7C15ULL;
+  h ^= (w[1] + seed) * 0xBF58476D1CE4E5B9ULL;
+  h ^= (w[2] ^ (seed >> 17)) * 0x94D049BB133111EBULL;
+  h ^= (w[3] + (seed << 7)) * 0xD6E8FEB86659FD93ULL;
+  return mix64(h);
+}
+
+static inline bool keysEqual(const ApiKey& a, const ApiKey& b) {
+#if defined(__SSE2__)
+  __m128i a0 = _mm_loadu_si128((const __m128i*)a.bytes);
+  __m128i a1 = _mm_loadu_si128((const __m128i*)(a.bytes + 16));
+  __m128i b0 = _mm_loadu_si128((const __m128i*)b.bytes);
+  __m128i b1 = _mm_loadu_si128((const __m128i*)(b.bytes + 16));
+  __m128i equal = _mm_and_si128(_mm_cmpeq_epi8(a0, b0), _mm_cmpeq_epi8(a1, b1));
+  return _mm_movemask_epi8(equal) == 0xFFFF;
+#else
+  return memcmp(a.bytes, b.bytes, API_KEY_BYTES) == 0;
+#endif
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseApiKeyScalar(const char* text, size_t length, ApiKey& key) {
+  if (length != API_KEY_TEXT_LENGTH || memcmp(text, "cc_", 3) != 0) return false;
+  const char* hex = text + 3;
+  for (int i = 0; i < API_KEY_BYTES; i++) {
+    int high = hexValue(hex[2 * i]);
+    int low = hexValue(hex[2 * i + 1]);
+    if (high < 0 || low < 0) return false;
+    key.bytes[i] = (uint8_t)(high << 4 | low);
+  }
+  return true;
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief 16 hex digits to 16 nibbles in 16-bit lanes, high digit first; flags anything else in invalid
+ */
+static inline __m128i hexNibbles(const char* text, __m128i& invalid) {
+  const __m128i bias = _mm_set1_epi8((char)0x80);
+  __m128i c = _mm_loadu_si128((const __m128i*)text);
+  // Unsigned range checks through a signed compare on biased bytes
+  __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  __m128i isDigit = _mm_cmplt_epi8(_mm_xor_si128(digit, bias), _mm_set1_epi8((char)(0x80 + 10)));
+  __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i isLetter = _mm_cmplt_epi8(_mm_xor_si128(letter, bias), _mm_set1_epi8((char)(0x80 + 6)));
+  invalid = _mm_or_si128(invalid, _mm_andnot_si128(_mm_or_si128(isDigit, isLetter), _mm_set1_epi8(-1)));
+  __m128i value = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                               _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+  // Each 16-bit lane holds (high digit, low digit); make it the byte value
+  return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(value, _mm_set1_epi16(0x00FF)), 4), _mm_srli_epi16(value, 8));
+}
+#endif
+
+bool parseApiKey(const char* text, size_t length, ApiKey& key) {
+#if defined(__SSE2__)
+  if (length != API_KEY_TEXT_LENGTH || text[0] != 'c' || text[1] != 'c' || text[2] != '_') return false;
+  const char* hex = text + 3;
+  __m128i invalid = _mm_setzero_si128();
+  __m128i n0 = hexNibbles(hex, invalid);
+  __m128i n1 = hexNibbles(hex + 16, invalid);
+  __m128i n2 = hexNibbles(hex + 32, invalid);
+  __m128i n3 = hexNibbles(hex + 48, invalid);
+  if (_mm_movemask_epi8(invalid)) return false;
+  _mm_storeu_si128((__m128i*)key.bytes, _mm_packus_epi16(n0, n1));
+  _mm_storeu_si128((__m128i*)(key.bytes + 16), _mm_packus_epi16(n2, n3));
+  return true;
+#else
+  return parseApiKeyScalar(text, length, key);
+#endif
+}
+
+bool loadTenantKeys(const char* path, std::vector<TenantKeyEntry>& entries) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+  char line[256];
+  bool ok = true;
+  while (fgets(line, sizeof(line), file)) {
+    char* text = line + strspn(line, " \t");
+    if (*text == '#' || *text == '\r' || *text == '\n' || *text == '\0') continue;
+
+    size_t keyLength = strcspn(text, " \t\r\n");
+    TenantKeyEntry entry;
+    char* end;
+    if (!parseApiKey(text, keyLength, entry.key)) {
+      ok = false;
+      break;
+    }
+    entry.record.tenant = (uint32_t)strtoul(text + keyLength, &end, 10);
+    if (end == text + keyLength) {
+      ok = false;
+      break;
+    }
+    entry.record.deviceSet = (uint32_t)strtoul(end, &end, 10);
+    entries.push_back(entry);
+  }
+  fclose(file);
+  return ok;
+}
+
+uint32_t TenantIndex::slotOf(uint64_t hash) const {
+  uint64_t bucket = ((hash >> 32) * pilots_.size()) >> 32;
+  uint64_t placed = mix64(hash ^ (pilots_[bucket] * 0x9E3779B97F4A7C15ULL));
+  return (uint32_t)(((unsigned __int128)placed * slots_.size()) >> 64);
+}
+
+bool TenantIndex::build(const std::vector<TenantKeyEntry>& entries) {
+  size_t n = entries.size();
+  size_t bucketCount = n / KEYS_PER_BUCKET + 1;
+  std::vector<uint64_t> hashes(n);
+  std::vector<uint32_t> order(n);
+  std::vector<uint32_t> bucketStart(bucketCount + 1);
+  std::vector<uint32_t> bucketOrder(bucketCount);
+  std::vector<uint64_t> taken((n + 63) / 64);
+  std::vector<uint32_t> placedSlots;
+
+  for (uint64_t seed = 0x5851F42D4C957F2DULL;; seed = mix64(seed + 1)) {
+    seed_ = seed;
+    pilots_.assign(bucketCount, 0);
+    slots_.assign(n, Slot());
+
+    // Group keys by bucket (counting sort)
+    std::fill(bucketStart.begin(), bucketStart.end(), 0);
+    for (size_t i = 0; i < n; i++) {
+      hashes[i] = hashKey(entries[i].key, seed);
+      bucketStart[((hashes[i] >> 32) * bucketCount >> 32) + 1]++;
+    }
+    for (size_t b = 0; b < bucketCount; b++) bucketStart[b + 1] += bucketStart[b];
+    std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (size_t i = 0; i < n; i++) order[fill[(hashes[i] >> 32) * bucketCount >> 32]++] = (uint32_t)i;
+
+    // Biggest buckets first, while the table is still empty
+    for (size_t b = 0; b < bucketCount; b++) bucketOrder[b] = (uint32_t)b;
+    std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](uint32_t a, uint32_t b) {
+      return bucketStart[a + 1] - bucketStart[a] > bucketStart[b + 1] - bucketStart[b];
+    });
+
+    std::fill(taken.begin(), taken.end(), 0);
+    bool placedAll = true;
+    for (uint32_t bucket : bucketOrder) {
+      uint32_t begin = bucketStart[bucket], end = bucketStart[bucket + 1];
+      if (begin == end) break;   // sorted by size, the rest are empty
+
+      // A key listed twice lands in the same bucket with the same hash
+      for (uint32_t i = begin; i < end; i++) {
+        for (uint32_t j = begin; j < i; j++) {
+          if (hashes[order[i]] != hashes[order[j]]) continue;
+          if (keysEqual(entries[order[i]].key, entries[order[j]].key)) {
+            pilots_.clear();
+            slots_.clear();
+            return false;
+          }
+          placedAll = false;   // 64-bit collision between different keys: new seed
+        }
+      }
+      if (!placedAll) break;
+
+      uint32_t pilot = 0;
+      for (; pilot < MAX_PILOT; pilot++) {
+        placedSlots.clear();
+        bool fits = true;
+        for (uint32_t i = begin; i < end && fits; i++) {
+          uint64_t placed = mix64(hashes[order[i]] ^ (pilot * 0x9E3779B97F4A7C15ULL));
+          uint32_t slot = (uint32_t)(((unsigned __int128)placed * n) >> 64);
+          if (taken[slot >> 6] >> (slot & 63) & 1) fits = false;
+          for (uint32_t other : placedSlots) fits = fits && other != slot;
+          placedSlots.push_back(slot);
+        }
+        if (fits) break;
+      }
+      if (pilot == MAX_PILOT) {
+        placedAll = false;
+        break;
+      }
+      pilots_[bucket] = pilot;
+      for (uint32_t i = begin; i < end; i++) {
+        uint32_t slot = placedSlots[i - begin];
+        taken[slot >> 6] |= 1ULL << (slot & 63);
+        slots_[slot].key = entries[order[i]].key;
+        slots_[slot].record = entries[order[i]].record;
+      }
+    }
+    if (placedAll) return true;
+  }
+}
+
+const TenantRecord* TenantIndex::find(const ApiKey& key) const {
+  if (slots_.empty()) return nullptr;
+  const Slot& slot = slots_[slotOf(hashKey(key, seed_))];
+  return keysEqual(slot.key, key) ? &slot.record : nullptr;
+}
+
+const TenantRecord* TenantIndex::find(const char* text, size_t length) const {
+  ApiKey key;
+  if (!parseApiKey(text, length, key)) return nullptr;
+  return find(key);
+}
+
+TenantDirectory::TenantDirectory() : current_(new TenantIndex()) {}
+
+TenantDirectory::~TenantDirectory() {
+  delete current_.load();
+}
+
+int TenantDirectory::registerReader() {
+  int reader = readerCount_.fetch_add(1);
+  if (reader >= MAX_READERS) return -1;
+  quiescent(reader);
+  return reader;
+}
+
+void TenantDirectory::publish(std::unique_ptr<TenantIndex> index) {
+  std::lock_guard<std::mutex> guard(publishLock_);
+  const TenantIndex* old = current_.exchange(index.release(), std::memory_order_seq_cst);
+  uint64_t target = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+  // Grace period: every online reader has announced the new epoch
+  int readers = std::min<int>(readerCount_.load(), (int)MAX_READERS);
+  for (int r = 0; r < readers; r++) {
+    while (true) {
+      uint64_t seen = readers_[r].epoch.load(std::memory_order_seq_cst);
+      if (seen == OFFLINE || seen >= target) break;
+      std::this_thread::yield();
+    }
+  }
+  delete old;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * API key -> tenant authorization for multi-tenant ingest.
+ *
+ * Every topic carries the device's API_KEY, "cc_" and 64 hex digits. Keys
+ * are decoded to 32 bytes (SSE2 when the target has it, 16 digits per step
+ * with validation folded in) and looked up in a minimal perfect hash built
+ * from the key list: keys are hashed into buckets of about four, and each
+ * bucket stores the pilot that places all of its keys into free slots of a
+ * table with exactly one slot per key. A lookup is one hash, one pilot
+ * load and one 32-byte compare against the only slot the key can be in;
+ * unknown keys fail that compare.
+ *
+ * TenantDirectory swaps in a rebuilt index without stopping readers.
+ * Readers announce quiescent points (between messages) and the old index
+ * is freed once every reader has passed one, so a lookup never takes a
+ * lock or touches a reference count.
+ */
+
+const int API_KEY_BYTES = 32;
+const size_t API_KEY_TEXT_LENGTH = 67;   // "cc_" + 64 hex digits
+
+struct ApiKey {
+  uint8_t bytes[API_KEY_BYTES];
+};
+
+/**
+ * @brief Decode "cc_" + 64 hex digits (either case)
+ * @return false for anything else
+ */
+bool parseApiKey(const char* text, size_t length, ApiKey& key);
+
+/**
+ * @brief One digit at a time, the reference for parseApiKey()
+ */
+bool parseApiKeyScalar(const char* text, size_t length, ApiKey& key);
+
+/**
+ * @brief What a key is authorized as
+ */
+struct TenantRecord {
+  uint32_t tenant = 0;
+  uint32_t deviceSet = 0;   // devices the key may publish for, tenant-defined
+};
+
+struct TenantKeyEntry {
+  ApiKey key;
+  TenantRecord record;
+};
+
+/**
+ * @brief Read "<api key> <tenant> [<device set>]" lines; blank lines and "#" comments are skipped
+ * @return false if the file can't be read or a line is malformed
+ */
+bool loadTenantKeys(const char* path, std::vector<TenantKeyEntry>& entries);
+
+/**
+ * @brief Immutable key -> tenant table over a minimal perfect hash
+ */
+class TenantIndex {
+public:
+  static const int KEYS_PER_BUCKET = 4;
+
+  /**
+   * @brief Build from a key list
+   * @return false if a key is listed twice
+   */
+  bool build(const std::vector<TenantKeyEntry>& entries);
+
+  const TenantRecord* find(const ApiKey& key) const;
+
+  /**
+   * @brief Look up a key as it appears in a topic, nullptr if unknown or malformed
+   */
+  const TenantRecord* find(const char* text, size_t length) const;
+
+  size_t size() const { return slots_.size(); }
+  size_t memoryBytes() const { return pilots_.size() * sizeof(uint32_t) + slots_.size() * sizeof(Slot); }
+  double pilotBitsPerKey() const { return slots_.empty() ? 0 : 32.0 * pilots_.size() / slots_.size(); }
+
+private:
+  struct Slot {
+    ApiKey key;
+    TenantRecord record;
+  };
+
+  uint32_t slotOf(uint64_t hash) const;
+
+  uint64_t seed_ = 0;
+  std::vector<uint32_t> pilots_;
+  std::vector<Slot> slots_;
+};
+
+/**
+ * @brief The live TenantIndex, replaceable while ingest threads keep reading it
+ */
+class TenantDirectory {
+public:
+  static const int MAX_READERS = 64;
+
+  TenantDirectory();
+  ~TenantDirectory();
+
+  /**
+   * @brief Claim a reader slot for the calling thread
+   * @return Reader id, -1 if all slots are taken
+   */
+  int registerReader();
+
+  /**
+   * @brief The reader holds no index pointer from here on (call between messages)
+   */
+  void quiescent(int reader) {
+    std::atomic<uint64_t>& epoch = readers_[reader].epoch;
+    if (epoch.load(std::memory_order_relaxed) != OFFLINE) {
+      epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_release);
+      return;
+    }
+    // Back online: publish() may have skipped this reader, so the store must be visible
+    // before the next current() load (a release store can be passed by a later load)
+    epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  /**
+   * @brief The reader will not look anything up until its next quiescent() (e.g. while blocked)
+   */
+  void offline(int reader) { readers_[reader].epoch.store(OFFLINE, std::memory_order_release); }
+
+  /**
+   * @brief Current index, valid until the reader's next quiescent() or offline()
+   */
+  const TenantIndex* current() const { return current_.load(std::memory_order_acquire); }
+
+  const TenantRecord* find(const char* text, size_t length) const { return current()->find(text, length); }
+
+  /**
+   * @brief Swap in a new index; returns once no reader can still see the old one, and frees it
+   */
+  void publish(std::unique_ptr<TenantIndex> index);
+
+  uint64_t reloads() const { return epoch_.load(std::memory_order_relaxed); }
+
+private:
+  static const uint64_t OFFLINE = UINT64_MAX;
+
+  struct alignas(64) Reader {
+    std::atomic<uint64_t> epoch{OFFLINE};
+  };
+
+  std::atomic<const TenantIndex*> current_;
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<int> readerCount_{0};
+  std::mutex publishLock_;
+  Reader readers_[MAX_READERS];
+};
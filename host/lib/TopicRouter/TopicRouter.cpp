@@ -0,0 +1,347 @@
+#include "TopicRouter.h"
+
+#include <string.h>
+
+// Interned first, in TopicKind order, so a channel's token id is its kind
+static const char* const KIND_NAMES[TOPIC_KIND_COUNT] = {"sensor_data", "alerts", "heartbeat", "commands", "other"};
+static const uint32_t TOKEN_SEQUESTER = TOPIC_OTHER;
+static const uint32_t TOKEN_EMITTER = TOPIC_OTHER + 1;
+
+static const size_t INITIAL_TOKEN_SLOTS = 64;
+static const size_t INITIAL_EDGE_SLOTS = 64;
+
+const char* topicKindName(TopicKind kind) {
+  return kind < TOPIC_KIND_COUNT ? KIND_NAMES[kind] : "?";
+}
+
+/**
+ * @brief Hash one topic level, 16 bytes at a time in two independent lanes (API keys are 67 characters)
+ */
+static uint64_t hashLevel(const char* text, size_t length) {
+  uint64_t a = 0x9E3779B97F4A7C15ULL ^ length;
+  uint64_t b = 0xD6E8FEB86659FD93ULL;
+  while (length >= 16) {
+    uint64_t x, y;
+    memcpy(&x, text, 8);
+    memcpy(&y, text + 8, 8);
+    a = (a ^ x) * 0xBF58476D1CE4E5B9ULL;
+    b = (b ^ y) * 0x94D049BB133111EBULL;
+    a ^= a >> 29;
+    b ^= b >> 32;
+    text += 16;
+    length -= 16;
+  }
+  uint64_t x = 0, y = 0;
+  if (length > 8) {
+    memcpy(&x, text, 8);
+    memcpy(&y, text + 8, length - 8);
+  } else {
+    memcpy(&x, text, length);
+  }
+  uint64_t h = (a ^ x) * 0xBF58476D1CE4E5B9ULL + (b ^ y) * 0x94D049BB133111EBULL;
+  return h ^ (h >> 32);
+}
+
+static uint64_t hashEdge(uint64_t key) {
+  key *= 0x9E3779B97F4A7C15ULL;
+  return key ^ (key >> 29);
+}
+
+TopicRouter::TopicRouter()
+  : tokenSlots_(INITIAL_TOKEN_SLOTS, TokenSlot{0, NO_TOKEN}), tokenMask_(INITIAL_TOKEN_SLOTS - 1),
+    edges_(INITIAL_EDGE_SLOTS, Edge{0, 0}), edgeMask_(INITIAL_EDGE_SLOTS - 1), nodes_(1) {
+  for (int kind = 0; kind < TOPIC_OTHER; kind++) intern(KIND_NAMES[kind], strlen(KIND_NAMES[kind]));
+  intern("carbon_sequester", 16);
+  intern("carbon_emitter", 14);
+  for (int kind = 0; kind < TOPIC_KIND_COUNT; kind++) {
+    handlers_[kind] = nullptr;
+    contexts_[kind] = nullptr;
+  }
+}
+
+uint32_t TopicRouter::findToken(const char* text, size_t length, uint64_t hash) const {
+  for (uint64_t slot = hash & tokenMask_;; slot = (slot + 1) & tokenMask_) {
+    const TokenSlot& entry = tokenSlots_[slot];
+    if (entry.id == NO_TOKEN) return NO_TOKEN;
+    if (entry.hash == hash && tokenLengths_[entry.id] == length &&
+        memcmp(tokenText_.data() + tokenOffsets_[entry.id], text, length) == 0) {
+      return entry.id;
+    }
+  }
+}
+
+uint32_t TopicRouter::findToken(const char* text, size_t length) const {
+  return findToken(text, length, hashLevel(text, length));
+}
+
+uint32_t TopicRouter::intern(const char* text, size_t length) {
+  uint64_t hash = hashLevel(text, length);
+  uint32_t id = findToken(text, length, hash);
+  if (id != NO_TOKEN) return id;
+
+  id = (uint32_t)tokenOffsets_.size();
+  tokenOffsets_.push_back((uint32_t)tokenText_.size());
+  tokenLengths_.push_back((uint32_t)length);
+  tokenText_.append(text, length);
+  // Keep the table at most half full so misses end quickly
+  if (2 * tokenOffsets_.size() > tokenSlots_.size()) growTokens();
+  uint64_t slot = hash & tokenMask_;
+  while (tokenSlots_[slot].id != NO_TOKEN) slot = (slot + 1) & tokenMask_;
+  tokenSlots_[slot] = TokenSlot{hash, id};
+  return id;
+}
+
+void TopicRouter::growTokens() {
+  std::vector<TokenSlot> old;
+  old.swap(tokenSlots_);
+  tokenSlots_.assign(old.size() * 2, TokenSlot{0, NO_TOKEN});
+  tokenMask_ = tokenSlots_.size() - 1;
+  for (const TokenSlot& entry : old) {
+    if (entry.id == NO_TOKEN) continue;
+    uint64_t slot = entry.hash & tokenMask_;
+    while (tokenSlots_[slot].id != NO_TOKEN) slot = (slot + 1) & tokenMask_;
+    tokenSlots_[slot] = entry;
+  }
+}
+
+uint32_t TopicRouter::child(uint32_t parent, uint32_t token) const {
+  uint64_t key = (uint64_t)parent << 32 | token;
+  for (uint64_t slot = hashEdge(key) & edgeMask_;; slot = (slot + 1) & edgeMask_) {
+    const Edge& edge = edges_[slot];
+    if (edge.child == 0) return 0;
+    if (edge.key == key) return edge.child;
+  }
+}
+
+uint32_t TopicRouter::addChild(uint32_t parent, uint32_t token) {
+  uint32_t existing = child(parent, token);
+  if (existing) return existing;
+
+  uint32_t node = (uint32_t)nodes_.size();
+  nodes_.emplace_back();
+  if (2 * (edgeCount_ + 1) > edges_.size()) growEdges();
+  uint64_t key = (uint64_t)parent << 32 | token;
+  uint64_t slot = hashEdge(key) & edgeMask_;
+  while (edges_[slot].child != 0) slot = (slot + 1) & edgeMask_;
+  edges_[slot] = Edge{key, node};
+  edgeCount_++;
+  return node;
+}
+
+void TopicRouter::growEdges() {
+  std::vector<Edge> old;
+  old.swap(edges_);
+  edges_.assign(old.size() * 2, Edge{0, 0});
+  edgeMask_ = edges_.size() - 1;
+  for (const Edge& edge : old) {
+    if (edge.child == 0) continue;
+    uint64_t slot = hashEdge(edge.key) & edgeMask_;
+    while (edges_[slot].child != 0) slot = (slot + 1) & edgeMask_;
+    edges_[slot] = edge;
+  }
+}
+
+int TopicRouter::splitLevels(const char* topic, size_t length, Level* levels) {
+  int count = 0;
+  const char* end = topic + length;
+  const char* start = topic;
+  while (true) {
+    const char* slash = (const char*)memchr(start, '/', end - start);
+    const char* stop = slash ? slash : end;
+    if (count == MAX_TOPIC_LEVELS) return -1;
+    levels[count++] = Level{start, (size_t)(stop - start)};
+    if (!slash) return count;
+    start = slash + 1;
+  }
+}
+
+int TopicRouter::subscribe(const char* filter, uint32_t tag) {
+  size_t length = strlen(filter);
+  Level levels[MAX_TOPIC_LEVELS];
+  int count = length ? splitLevels(filter, length, levels) : -1;
+  if (count < 0) return -1;
+  for (int i = 0; i < count; i++) {
+    const Level& level = levels[i];
+    bool wildcard = memchr(level.text, '+', level.length) || memchr(level.text, '#', level.length);
+    if (!wildcard) continue;
+    // A wildcard must be a whole level, and "#" only the last one
+    if (level.length != 1) return -1;
+    if (level.text[0] == '#' && i != count - 1) return -1;
+  }
+
+  uint32_t node = 0;
+  for (int i = 0; i < count; i++) {
+    const Level& level = levels[i];
+    if (level.length == 1 && level.text[0] == '+') {
+      if (!nodes_[node].plus) {
+        nodes_[node].plus = (uint32_t)nodes_.size();
+        nodes_.emplace_back();
+      }
+      node = nodes_[node].plus;
+    } else if (level.length == 1 && level.text[0] == '#') {
+      if (!nodes_[node].hash) {
+        nodes_[node].hash = (uint32_t)nodes_.size();
+        nodes_.emplace_back();
+      }
+      node = nodes_[node].hash;
+    } else {
+      node = addChild(node, intern(level.text, level.length));
+    }
+  }
+
+  uint32_t id = (uint32_t)subscriptions_.size();
+  subscriptions_.push_back(Subscription{tag, node, true});
+  Node& target = nodes_[node];
+  if (target.first == NONE) {
+    target.first = id;
+  } else {
+    if (target.overflow == NONE) {
+      target.overflow = (uint32_t)overflow_.size();
+      overflow_.emplace_back();
+    }
+    overflow_[target.overflow].push_back(id);
+  }
+  active_++;
+  return (int)id;
+}
+
+bool TopicRouter::unsubscribe(int id) {
+  if (id < 0 || (size_t)id >= subscriptions_.size() || !subscriptions_[id].active) return false;
+  Subscription& subscription = subscriptions_[id];
+  Node& node = nodes_[subscription.node];
+  std::vector<uint32_t>* more = node.overflow == NONE ? nullptr : &overflow_[node.overflow];
+  if (node.first == (uint32_t)id) {
+    node.first = NONE;
+    if (more && !more->empty()) {
+      node.first = more->back();
+      more->pop_back();
+    }
+  } else if (more) {
+    for (size_t i = 0; i < more->size(); i++) {
+      if ((*more)[i] == (uint32_t)id) {
+        (*more)[i] = more->back();
+        more->pop_back();
+        break;
+      }
+    }
+  }
+  subscription.active = false;
+  active_--;
+  return true;
+}
+
+void TopicRouter::on(TopicKind kind, TopicHandler handler, void* context) {
+  if (kind >= TOPIC_KIND_COUNT) return;
+  handlers_[kind] = handler;
+  contexts_[kind] = context;
+}
+
+TopicKind TopicRouter::kindOfToken(uint32_t token) const {
+  return token < TOPIC_OTHER ? (TopicKind)token : TOPIC_OTHER;
+}
+
+TopicKind TopicRouter::kindOf(const char* topic, size_t length) const {
+  const char* last = topic + length;
+  while (last > topic && last[-1] != '/') last--;
+  return kindOfToken(findToken(last, topic + length - last));
+}
+
+int TopicRouter::tokenize(const char* topic, size_t length, uint32_t* tokens, Level* levels) const {
+  int count = length ? splitLevels(topic, length, levels) : -1;
+  for (int i = 0; i < count; i++) tokens[i] = findToken(levels[i].text, levels[i].length);
+  return count;
+}
+
+void TopicRouter::emit(const Node& node, uint32_t* ids, size_t capacity, size_t& found) const {
+  if (node.first == NONE) return;
+  if (found < capacity) ids[found] = node.first;
+  found++;
+  if (node.overflow == NONE) return;
+  for (uint32_t id : overflow_[node.overflow]) {
+    if (found < capacity) ids[found] = id;
+    found++;
+  }
+}
+
+size_t TopicRouter::match(const char* topic, size_t length, uint32_t* ids, size_t capacity) const {
+  Level levels[MAX_TOPIC_LEVELS];
+  uint32_t tokens[MAX_TOPIC_LEVELS];
+  int count = tokenize(topic, length, tokens, levels);
+  if (count < 0) return 0;
+  return matchTokens(tokens, count, topic[0] == '$', ids, capacity);
+}
+
+size_t TopicRouter::matchTokens(const uint32_t* tokens, int count, bool reserved, uint32_t* ids, size_t capacity) const {
+  // Wildcards in the first level don't match "$SYS/..." and other reserved topics
+  size_t found = 0;
+
+  struct Frame {
+    uint32_t node;
+    int depth;
+  };
+  // Each step pops one frame and pushes at most two, one of them a level deeper
+  Frame stack[2 * MAX_TOPIC_LEVELS + 2];
+  int top = 0;
+  stack[top++] = Frame{0, 0};
+  while (top > 0) {
+    Frame frame = stack[--top];
+    const Node& node = nodes_[frame.node];
+    bool wildcards = !(reserved && frame.depth == 0);
+    // "#" also matches the level above it: "a/#" matches "a"
+    if (node.hash && wildcards) emit(nodes_[node.hash], ids, capacity, found);
+    if (frame.depth == count) {
+      emit(node, ids, capacity, found);
+      continue;
+    }
+    if (node.plus && wildcards) stack[top++] = Frame{node.plus, frame.depth + 1};
+    uint32_t token = tokens[frame.depth];
+    if (token != NO_TOKEN) {
+      uint32_t next = child(frame.node, token);
+      if (next) stack[top++] = Frame{next, frame.depth + 1};
+    }
+  }
+  return found;
+}
+
+size_t TopicRouter::dispatch(const char* topic, size_t topicLength, const char* payload, size_t length) const {
+  Level levels[MAX_TOPIC_LEVELS];
+  uint32_t tokens[MAX_TOPIC_LEVELS];
+  int count = tokenize(topic, topicLength, tokens, levels);
+  if (count < 0) return 0;
+
+  TopicMessage message;
+  message.kind = kindOfToken(tokens[count - 1]);
+  TopicHandler handler = handlers_[message.kind];
+  if (!handler) return 0;
+
+  uint32_t ids[MAX_DISPATCH];
+  size_t found = matchTokens(tokens, count, topic[0] == '$', ids, MAX_DISPATCH);
+  if (found == 0) return 0;
+  if (found > MAX_DISPATCH) found = MAX_DISPATCH;
+
+  if (tokens[0] == TOKEN_SEQUESTER) message.deviceType = DeviceType::Sequester;
+  else if (tokens[0] == TOKEN_EMITTER) message.deviceType = DeviceType::Emitter;
+  if (count == 3) {
+    message.apiKey = levels[1].text;
+    message.apiKeyLength = levels[1].length;
+  }
+  message.topic = topic;
+  message.topicLength = topicLength;
+  message.payload = payload;
+  message.length = length;
+
+  for (size_t i = 0; i < found; i++) {
+    message.tag = subscriptions_[ids[i]].tag;
+    handler(message, contexts_[message.kind]);
+  }
+  return found;
+}
+
+size_t TopicRouter::memoryBytes() const {
+  size_t bytes = tokenText_.capacity() + tokenOffsets_.capacity() * sizeof(uint32_t) +
+                 tokenLengths_.capacity() * sizeof(uint32_t) + tokenSlots_.capacity() * sizeof(TokenSlot) +
+                 edges_.capacity() * sizeof(Edge) + nodes_.capacity() * sizeof(Node) +
+                 subscriptions_.capacity() * sizeof(Subscription) + overflow_.capacity() * sizeof(overflow_[0]);
+  for (const std::vector<uint32_t>& more : overflow_) bytes += more.capacity() * sizeof(uint32_t);
+  return bytes;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <Telemetry.h>
+
+/*
+ * Consumer-side topic routing over precompiled subscriptions.
+ *
+ * Devices publish to "<prefix>/<API_KEY>/<channel>" (and the burner falls
+ * back to "<prefix>/<channel>"). Filters are compiled into a trie over
+ * interned level tokens: every distinct level string gets a 32-bit id once,
+ * at subscribe time, and edges are (node, token) pairs in one
+ * open-addressing table, next to each node's "+" and "#" children. A topic
+ * is matched by hashing each of its levels once and walking the trie, so
+ * the cost follows the topic's depth and the wildcards present on its
+ * path, not the number of subscriptions. A level that was never interned
+ * can only match a wildcard and costs one failed table probe.
+ *
+ * The channel is known from the last level's token id, so dispatch() calls
+ * the handler for that message type directly, with the device type and API
+ * key already sliced out of the topic.
+ *
+ * Subscribe and unsubscribe while no thread is matching; match() and
+ * dispatch() are read-only and can run on any number of threads at once.
+ */
+
+/**
+ * @brief Message type, from the last topic level
+ */
+enum TopicKind : uint8_t {
+  TOPIC_SENSOR_DATA,
+  TOPIC_ALERTS,
+  TOPIC_HEARTBEAT,
+  TOPIC_COMMANDS,
+  TOPIC_OTHER,
+  TOPIC_KIND_COUNT
+};
+
+const char* topicKindName(TopicKind kind);
+
+const int MAX_TOPIC_LEVELS = 32;   // deeper topics match nothing
+const size_t MAX_DISPATCH = 64;    // handler calls per message, at most
+
+/**
+ * @brief What a handler receives; pointers are into the caller's topic and payload
+ */
+struct TopicMessage {
+  TopicKind kind = TOPIC_OTHER;
+  DeviceType deviceType = DeviceType::Unknown;   // from a carbon_sequester / carbon_emitter prefix
+  const char* apiKey = nullptr;                  // middle level of "<prefix>/<key>/<channel>"
+  size_t apiKeyLength = 0;
+  const char* topic = nullptr;
+  size_t topicLength = 0;
+  const char* payload = nullptr;
+  size_t length = 0;
+  uint32_t tag = 0;                              // given to subscribe(), e.g. a tenant id
+};
+
+typedef void (*TopicHandler)(const TopicMessage& message, void* context);
+
+class TopicRouter {
+public:
+  TopicRouter();
+
+  /**
+   * @brief Compile a filter ("+" and "#" allowed) into the trie
+   * @param tag Handed back with every message the filter matches
+   * @return Subscription id, or -1 for an invalid filter
+   */
+  int subscribe(const char* filter, uint32_t tag);
+
+  /**
+   * @brief Drop a subscription; its trie nodes stay for the next subscribe()
+   */
+  bool unsubscribe(int id);
+
+  /**
+   * @brief Handler for one message type (nullptr to ignore that type)
+   */
+  void on(TopicKind kind, TopicHandler handler, void* context = nullptr);
+
+  /**
+   * @brief Find every subscription whose filter matches the topic
+   * @param ids Receives up to capacity subscription ids
+   * @return Number of matching subscriptions, which may exceed capacity
+   */
+  size_t match(const char* topic, size_t length, uint32_t* ids, size_t capacity) const;
+
+  /**
+   * @brief Match and call the handler for the topic's message type once per matching subscription
+   * @return Handler calls made (the first MAX_DISPATCH matches)
+   */
+  size_t dispatch(const char* topic, size_t topicLength, const char* payload, size_t length) const;
+
+  /**
+   * @brief Message type of a topic, without matching it
+   */
+  TopicKind kindOf(const char* topic, size_t length) const;
+
+  uint32_t tag(int id) const { return subscriptions_[id].tag; }
+  size_t subscriptionCount() const { return active_; }
+  size_t tokenCount() const { return tokenOffsets_.size(); }
+  size_t nodeCount() const { return nodes_.size(); }
+
+  /**
+   * @brief Heap held by the tokens, trie and subscriptions
+   */
+  size_t memoryBytes() const;
+
+private:
+  static const uint32_t NO_TOKEN = UINT32_MAX;
+  static const uint32_t NONE = UINT32_MAX;
+
+  struct TokenSlot {
+    uint64_t hash;
+    uint32_t id;       // NO_TOKEN when empty
+  };
+
+  struct Edge {
+    uint64_t key;      // parent << 32 | token
+    uint32_t child;    // 0 when empty; the root is never a child
+  };
+
+  // 16 bytes: the usual single subscription is stored inline, further ones in overflow_
+  struct Node {
+    uint32_t plus = 0;
+    uint32_t hash = 0;
+    uint32_t first = NONE;
+    uint32_t overflow = NONE;
+  };
+
+  struct Subscription {
+    uint32_t tag;
+    uint32_t node;
+    bool active;
+  };
+
+  struct Level {
+    const char* text;
+    size_t length;
+  };
+
+  uint32_t intern(const char* text, size_t length);
+  uint32_t findToken(const char* text, size_t length) const;
+  uint32_t findToken(const char* text, size_t length, uint64_t hash) const;
+  uint32_t child(uint32_t parent, uint32_t token) const;
+  uint32_t addChild(uint32_t parent, uint32_t token);
+  void growTokens();
+  void growEdges();
+  static int splitLevels(const char* topic, size_t length, Level* levels);
+  int tokenize(const char* topic, size_t length, uint32_t* tokens, Level* levels) const;
+  void emit(const Node& node, uint32_t* ids, size_t capacity, size_t& found) const;
+  size_t matchTokens(const uint32_t* tokens, int count, bool reserved, uint32_t* ids, size_t capacity) const;
+  TopicKind kindOfToken(uint32_t token) const;
+
+  // Token strings live back to back in one arena
+  std::string tokenText_;
+  std::vector<uint32_t> tokenOffsets_;
+  std::vector<uint32_t> tokenLengths_;
+  std::vector<TokenSlot> tokenSlots_;
+  uint64_t tokenMask_;
+
+  std::vector<Edge> edges_;
+  uint64_t edgeMask_;
+  size_t edgeCount_ = 0;
+
+  std::vector<Node> nodes_;
+  std::vector<std::vector<uint32_t>> overflow_;
+  std::vector<Subscription> subscriptions_;
+  size_t active_ = 0;
+
+  TopicHandler handlers_[TOPIC_KIND_COUNT];
+  void* contexts_[TOPIC_KIND_COUNT];
+};
@@ -0,0 +1,306 @@
+#include <Bench.h>
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <FleetSim.h>
+#include <IngestPool.h>
+#include <MiniBroker.h>
+#include <MqttClient.h>
+#include <Telemetry.h>
+
+static const int64_t DELIVERY_TIMEOUT_NS = 30LL * 1000 * 1000 * 1000;
+
+/**
+ * @brief MiniBroker on its own thread for the length of a benchmark
+ */
+struct BrokerThread {
+  MiniBroker broker;
+  std::thread thread;
+
+  BrokerThread() {
+    broker.start();
+    thread = std::thread([this] { broker.run(); });
+  }
+  ~BrokerThread() {
+    broker.stop();
+    thread.join();
+  }
+};
+
+/**
+ * @brief Formatted sensor_data payloads from a seeded fleet
+ */
+static std::vector<std::string> fleetPayloads(int count, uint32_t devices) {
+  FleetSimConfig config;
+  config.devices = devices;
+  config.sketches = true;
+  FleetSim sim(config);
+  std::vector<std::string> payloads(count);
+  SensorWindow window;
+  int64_t timestamp;
+  char buffer[1024];
+  for (int i = 0; i < count; i++) {
+    sim.next(window, timestamp);
+    payloads[i].assign(buffer, formatSensorWindow(window, buffer, sizeof(buffer)));
+  }
+  return payloads;
+}
+
+BENCHMARK(broker_fanout) {
+  // One publisher, S subscribers on the same filter: every message goes out S times
+  const int messages = 50000;
+  std::vector<std::string> payloads = fleetPayloads(messages, 1000);
+  for (int subscribers : {1, 16}) {
+    BrokerThread broker;
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    std::atomic<int64_t> received{0};
+    for (int s = 0; s < subscribers; s++) {
+      clients.emplace_back(new MqttClient());
+      clients.back()->setServer("127.0.0.1", broker.broker.port());
+      clients.back()->setCallback([&received](char*, uint8_t*, unsigned int) { received++; });
+      clients.back()->connect(("sub-" + std::to_string(s)).c_str());
+      clients.back()->subscribe("carbon_sequester/+/sensor_data");
+    }
+    MqttClient publisher;
+    publisher.setServer("127.0.0.1", broker.broker.port());
+    publisher.connect("pub");
+    for (int i = 0; i < 20; i++) {
+      for (auto& client : clients) client->loop(1);  // SUBACKs in before the clock starts
+    }
+
+    const int64_t expected = (int64_t)messages * subscribers;
+    int64_t start = benchNowNs();
+    std::thread sender([&] {
+      for (const std::string& payload : payloads) {
+        publisher.publish("carbon_sequester/fleet/sensor_data", (const uint8_t*)payload.data(), payload.size());
+      }
+    });
+    while (received < expected && benchNowNs() - start < DELIVERY_TIMEOUT_NS) {
+      for (auto& client : clients) client->loop(0);
+    }
+    int64_t elapsed = benchNowNs() - start;
+    sender.join();
+
+    MiniBrokerStats stats = broker.broker.stats();
+    char metric[48];
+    snprintf(metric, sizeof(metric), "subscribers_%d_delivered_per_second", subscribers);
+    state.report(metric, received * 1e9 / elapsed, "msg/s");
+    snprintf(metric, sizeof(metric), "subscribers_%d_published_per_second", subscribers);
+    state.report(metric, messages * 1e9 / elapsed, "msg/s");
+    snprintf(metric, sizeof(metric), "subscribers_%d_lost", subscribers);
+    state.report(metric, (double)(expected - received), "msg");
+    snprintf(metric, sizeof(metric), "subscribers_%d_dropped", subscribers);
+    state.report(metric, (double)stats.messagesDropped, "msg");
+  }
+}
+
+BENCHMARK(broker_connections) {
+  // Devices connecting and subscribing to their commands topic, as many as the fd limit allows
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  int devices = (int)std::min<rlim_t>(10000, (limit.rlim_cur - 256) / 2);
+  BrokerThread broker;
+  std::vector<std::unique_ptr<MqttClient>> clients;
+  clients.reserve(devices);
+  char id[32], topic[64];
+
+  int64_t start = benchNowNs();
+  for (int d = 0; d < devices; d++) {
+    clients.emplace_back(new MqttClient());
+    MqttClient& client = *clients.back();
+    client.setServer("127.0.0.1", broker.broker.port());
+    snprintf(id, sizeof(id), "device-%d", d);
+    if (!client.connect(id)) break;
+    snprintf(topic, sizeof(topic), "carbon_sequester/%d/commands", d);
+    client.subscribe(topic);
+  }
+  int64_t elapsed = benchNowNs() - start;
+  state.report("devices", (double)broker.broker.stats().connections, "connections");
+  state.report("connects_per_second", clients.size() * 1e9 / elapsed, "1/s");
+
+  // A command to every device, routed through the trie one topic at a time
+  std::atomic<int> received{0};
+  for (auto& client : clients) client->setCallback([&received](char*, uint8_t*, unsigned int) { received++; });
+  const char* command = "{\"cmd\":\"ping\"}";
+  start = benchNowNs();
+  for (int d = 0; d < (int)clients.size(); d++) {
+    snprintf(topic, sizeof(topic), "carbon_sequester/%d/commands", d);
+    broker.broker.publish(topic, (const uint8_t*)command, strlen(command));
+  }
+  while (received < (int)clients.size() && benchNowNs() - start < DELIVERY_TIMEOUT_NS) {
+    for (auto& client : clients) client->loop(0);
+  }
+  elapsed = benchNowNs() - start;
+  state.report("commands_delivered", received, "msg");
+  state.report("command_round_ms", elapsed / 1e6, "ms");
+}
+
+BENCHMARK(broker_persistent_sessions) {
+  // The fleet drops off together, a command is queued for every device, then it comes back.
+  // Clean sessions subscribe again and never see the commands; persistent ones skip both.
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  int devices = (int)std::min<rlim_t>(2000, (limit.rlim_cur - 256) / 2);
+  const char* command = "{\"cmd\":\"set\",\"interval\":60000}";
+  const int64_t commandWaitNs = 2LL * 1000 * 1000 * 1000;
+  char id[32], topic[64];
+
+  for (bool persistent : {false, true}) {
+    BrokerThread broker;
+    std::atomic<int> received{0};
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    for (int d = 0; d < devices; d++) {
+      clients.emplace_back(new MqttClient());
+      clients.back()->setServer("127.0.0.1", broker.broker.port());
+      clients.back()->setCleanSession(!persistent);
+      clients.back()->setCallback([&received](char*, uint8_t*, unsigned int) { received++; });
+    }
+    // What connectToMqtt() does: commands and fills at QoS 1, unless the session is back
+    int subscribes = 0;
+    auto connectDevice = [&](int d) {
+      MqttClient& client = *clients[d];
+      snprintf(id, sizeof(id), "device-%d", d);
+      if (!client.connect(id) || client.sessionPresent()) return;
+      snprintf(topic, sizeof(topic), "carbon_sequester/%d/commands", d);
+      client.subscribe(topic, 1);
+      snprintf(topic, sizeof(topic), "carbon_market/%d/fills/device", d);
+      client.subscribe(topic, 1);
+      subscribes += 2;
+    };
+
+    for (int d = 0; d < devices; d++) connectDevice(d);
+    for (auto& client : clients) client->disconnect();
+    int64_t start = benchNowNs();
+    while (broker.broker.stats().connections > 0 && benchNowNs() - start < DELIVERY_TIMEOUT_NS) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Commands sent during the outage
+    uint64_t published = broker.broker.stats().messagesIn + devices;
+    for (int d = 0; d < devices; d++) {
+      snprintf(topic, sizeof(topic), "carbon_sequester/%d/commands", d);
+      broker.broker.publish(topic, (const uint8_t*)command, strlen(command), 1);
+    }
+    while (broker.broker.stats().messagesIn < published && benchNowNs() - start < DELIVERY_TIMEOUT_NS) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    MiniBrokerStats before = broker.broker.stats();
+    subscribes = 0;
+    start = benchNowNs();
+    for (int d = 0; d < devices; d++) connectDevice(d);
+    int64_t elapsed = benchNowNs() - start;
+    while (received < devices && benchNowNs() - start < commandWaitNs) {
+      for (auto& client : clients) client->loop(0);
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    MiniBrokerStats after = broker.broker.stats();
+
+    // CONNECT/CONNACK, then SUBSCRIBE/SUBACK (both topics in one round trip, as PubSubClient sends them)
+    const char* mode = persistent ? "persistent" : "clean";
+    int subscribed = subscribes / 2;
+    char metric[48];
+    snprintf(metric, sizeof(metric), "%s_round_trips_per_reconnect", mode);
+    state.report(metric, (double)(devices + subscribed) / devices, "rtt");
+    snprintf(metric, sizeof(metric), "%s_packets_per_reconnect", mode);
+    state.report(metric, (double)(devices + subscribes) / devices, "packets");
+    snprintf(metric, sizeof(metric), "%s_reconnects_per_second", mode);
+    state.report(metric, devices * 1e9 / elapsed, "1/s");
+    snprintf(metric, sizeof(metric), "%s_sessions_resumed", mode);
+    state.report(metric, (double)(after.sessionsResumed - before.sessionsResumed), "sessions");
+    snprintf(metric, sizeof(metric), "%s_commands_after_outage", mode);
+    state.report(metric, received, "msg");
+  }
+}
+
+BENCHMARK(broker_shared_ingest) {
+  // Fleet -> broker -> $share ingest workers -> IngestPool, all in this process
+  const int messages = 50000;
+  // Unacknowledged messages the fleet may have out at once; well inside the broker's
+  // per-subscriber queue, so this measures ingest rather than slow-consumer drops
+  const uint64_t window = 2048;
+  std::vector<std::string> payloads = fleetPayloads(messages, 10000);
+  for (int workers : {1, 4, 16}) {
+    BrokerThread broker;
+    IngestPool pool(workers);
+    std::atomic<uint64_t> refused{0};
+    std::vector<std::unique_ptr<MqttClient>> clients;
+    for (int w = 0; w < workers; w++) {
+      clients.emplace_back(new MqttClient());
+      MqttClient& client = *clients.back();
+      client.setServer("127.0.0.1", broker.broker.port());
+      client.setProtocolVersion(MQTT_VERSION_5);
+      client.setCallback([&pool, &refused](char*, uint8_t* payload, unsigned int length) {
+        if (!pool.route((const char*)payload, length, 0)) refused++;
+      });
+      client.connect(("ingest-" + std::to_string(w)).c_str());
+      client.subscribe("$share/ingest/carbon_sequester/+/sensor_data");
+    }
+    for (int i = 0; i < 20; i++) {
+      for (auto& client : clients) client->loop(1);
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) {
+      threads.emplace_back([&, w] {
+        IngestPool::setWorkerShard(w);
+        while (!done) {
+          clients[w]->loop(1);
+          pool.drain(w);
+        }
+        pool.drain(w);
+      });
+    }
+
+    // A message is settled once it is ingested, refused by the pool or dropped by the broker
+    auto settled = [&] { return pool.ingested() + refused.load() + broker.broker.stats().messagesDropped; };
+    int64_t start = benchNowNs();
+    bool timedOut = false;
+    uint64_t published = 0, settledSoFar = 0;
+    while (published < (uint64_t)messages && !timedOut) {
+      if (published - settledSoFar < window) {
+        const std::string& payload = payloads[published++];
+        broker.broker.publish("carbon_sequester/fleet/sensor_data", (const uint8_t*)payload.data(), payload.size());
+        continue;
+      }
+      settledSoFar = settled();
+      if (published - settledSoFar >= window) {
+        timedOut = benchNowNs() - start >= DELIVERY_TIMEOUT_NS;
+        std::this_thread::yield();
+      }
+    }
+    while (settled() < (uint64_t)messages && !timedOut) {
+      timedOut = benchNowNs() - start >= DELIVERY_TIMEOUT_NS;
+      std::this_thread::yield();
+    }
+    int64_t elapsed = benchNowNs() - start;
+    done = true;
+    for (std::thread& thread : threads) thread.join();
+
+    uint64_t ingested = pool.ingested();
+    uint64_t dropped = broker.broker.stats().messagesDropped;
+    char metric[48];
+    snprintf(metric, sizeof(metric), "workers_%d_broker_dropped", workers);
+    state.report(metric, (double)dropped, "msg");
+    snprintf(metric, sizeof(metric), "workers_%d_lost", workers);
+    state.report(metric, (double)messages - ingested, "msg");
+    if (ingested < (uint64_t)messages) {
+      // A rate over a partial delivery (or the timeout) says nothing about throughput
+      char why[96];
+      snprintf(why, sizeof(why), "%d workers ingested %llu of %d messages", workers, (unsigned long long)ingested,
+               messages);
+      state.fail(why);
+      continue;
+    }
+    snprintf(metric, sizeof(metric), "workers_%d_messages_per_second", workers);
+    state.report(metric, ingested * 1e9 / elapsed, "msg/s");
+  }
+}
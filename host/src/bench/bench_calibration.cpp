@@ -0,0 +1,94 @@
+#include <Bench.h>
+
+#include <math.h>
+
+#include <vector>
+
+#include <FastRandom.h>
+#include <SensorCalibration.h>
+
+static const int32_t FULL_SCALE_CODE = 4095 << SIGNAL_CODE_FRACTION_BITS;
+
+/**
+ * @brief Rs/R0 for a filtered code with the default R0 and no correction
+ */
+static double referenceRatio(int32_t code) {
+  return MQ135_RLOAD_KOHM * (FULL_SCALE_CODE - code) / code / MQ135_RZERO_KOHM;
+}
+
+BENCHMARK(calibration_accuracy) {
+  // Every filtered code whose reference reading is inside the MQ135's 10-10000 ppm range
+  Mq135 mq135;
+  double maxError = 0, errorSum = 0;
+  int codes = 0;
+  for (int32_t code = 1; code < FULL_SCALE_CODE; code++) {
+    double reference = mq135ReferencePpm(referenceRatio(code));
+    if (reference < 10 || reference > 10000) continue;
+    double error = fabs(mq135.ppmQ8(code) / 256.0 - reference) / reference;
+    maxError = fmax(maxError, error);
+    errorSum += error;
+    codes++;
+  }
+  state.report("mq135_codes", codes, "codes");
+  state.report("mq135_max_error", maxError * 100, "%");
+  state.report("mq135_mean_error", errorSum / codes * 100, "%");
+
+  // Humidity over the whole code range at two temperatures
+  const float temperatures[] = {25, 35};
+  double humidityError = 0;
+  for (float temperature : temperatures) {
+    HumidityCalibration humidity;
+    humidity.setTemperature(temperature);
+    for (int32_t code = 0; code <= FULL_SCALE_CODE; code++) {
+      double reference = humidityReferencePercent(code / 16.0, temperature);
+      humidityError = fmax(humidityError, fabs(humidity.percentQ8(code) / 256.0 - reference));
+    }
+  }
+  state.report("humidity_max_error", humidityError, "%RH");
+}
+
+BENCHMARK(calibration_speed) {
+  const size_t count = 1 << 22;
+  FastRandom random(36);
+  std::vector<int32_t> codes(count);
+  for (size_t i = 0; i < count; i++) codes[i] = random.range(8000, 40000);
+  Mq135 mq135;
+  mq135.setEnvironment(22, 55);
+
+  uint64_t sum = 0;
+  int64_t start = benchNowNs();
+  for (size_t i = 0; i < count; i++) sum += mq135.ppmQ8(codes[i]);
+  int64_t elapsed = benchNowNs() - start;
+  benchDoNotOptimize(sum);
+  state.report("lut_ns", (double)elapsed / count, "ns");
+
+  // The same conversion in floating point: Rs, correction, powf()
+  float correction = mq135Correction(22, 55);
+  float floatSum = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < count; i++) {
+    float rs = (float)MQ135_RLOAD_KOHM * (FULL_SCALE_CODE - codes[i]) / codes[i] / correction;
+    floatSum += (float)MQ135_PARA * powf(rs / (float)MQ135_RZERO_KOHM, (float)MQ135_PARB);
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(floatSum);
+  state.report("powf_ns", (double)elapsed / count, "ns");
+
+  double doubleSum = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < count; i++) {
+    doubleSum += mq135ReferencePpm(referenceRatio(codes[i]) / correction);
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(doubleSum);
+  state.report("pow_ns", (double)elapsed / count, "ns");
+
+  HumidityCalibration humidity;
+  humidity.setTemperature(22);
+  int64_t humiditySum = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < count; i++) humiditySum += humidity.percentQ8(codes[i]);
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(humiditySum);
+  state.report("humidity_lut_ns", (double)elapsed / count, "ns");
+}
@@ -0,0 +1,402 @@
+#include <Bench.h>
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ChaosProxy.h>
+#include <MiniBroker.h>
+#include <MqttClient.h>
+#include <ReconnectPolicy.h>
+#include <SequenceDedupe.h>
+#include <Telemetry.h>
+
+/*
+ * Reconnect storms and other faults, with every device running the
+ * firmware's connection logic against a real broker.
+ *
+ * Each device is a thread doing what loop() does: an MqttClient with the
+ * firmware's keepalive and PubSubClient's socket timeout, retries paced by
+ * a ReconnectPolicy, a window every publish interval and a backlog of up to
+ * 18 windows while disconnected. Devices reach the broker through a
+ * ChaosProxy, which injects the fault and limits how fast the broker takes
+ * new connections; an ingest subscriber connects to the broker directly and
+ * tells lost and duplicate windows apart by "seq". Time runs TIME_SCALE
+ * times faster than the wall clock, so a 5-minute scenario takes 20 s, and
+ * all figures below are in simulated time.
+ */
+
+static const int TIME_SCALE = 15;
+static const uint32_t PUBLISH_MS = 15000;            // mqttPublishInterval
+static const uint32_t RETRY_MS = 5000;               // the firmware's old fixed mqttRetryInterval
+static const uint16_t KEEPALIVE_S = 60;              // MQTT_KEEPALIVE_S
+static const uint16_t SOCKET_TIMEOUT_S = 15;         // PubSubClient's MQTT_SOCKET_TIMEOUT
+static const size_t BACKLOG_WINDOWS = 18;            // what WINDOW_BACKLOG_BYTES holds
+static const uint32_t BROKER_CONNECTS_PER_S = 200;   // CONNECT handshakes the broker gets through
+static const int64_t BOOT_SPREAD_MS = 30000;         // devices power up over this long
+static const int64_t FAULT_AT_MS = 60000;
+static const int64_t SETTLE_MS = 180000;             // observed after the fault ends
+static const int MAX_DEVICES = 2000;
+
+static std::atomic<int64_t> simEpochNs{0};
+
+/**
+ * @brief Simulated milliseconds since the scenario started
+ */
+static int64_t simNowMs() {
+  return (benchNowNs() - simEpochNs.load(std::memory_order_relaxed)) * TIME_SCALE / 1000000;
+}
+
+static void simSleepMs(int64_t ms) {
+  if (ms > 0) std::this_thread::sleep_for(std::chrono::microseconds(ms * 1000 / TIME_SCALE));
+}
+
+/**
+ * @brief What the scenario does to the fleet between FAULT_AT_MS and its end
+ */
+struct ChaosScenario {
+  int64_t durationMs;
+  ChaosFaults faults;          // in simulated ms; scaled before they reach the proxy
+  bool restartBroker;          // broker down for the whole duration, then a fresh one
+  bool slowConsumer;           // ingest stops reading for the duration
+  bool comparePolicies;        // also run the old fixed interval
+};
+
+struct FleetShared {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> attempts{0};
+  uint16_t proxyPort = 0;
+};
+
+/**
+ * @brief One device: the firmware's connection handling, publishing and backlog
+ */
+struct ChaosDevice {
+  uint32_t index = 0;
+  uint64_t mac = 0;
+  ReconnectConfig policyConfig;
+  // Results, read after the thread is joined
+  uint32_t generated = 0;
+  uint32_t backlogDropped = 0;
+  uint32_t pending = 0;              // still in the backlog at the end
+  uint32_t disconnects = 0;
+  int64_t connectedSinceMs = -1;     // -1 while disconnected
+
+  void run(FleetShared& shared) {
+    MqttClient client;
+    client.setServer("127.0.0.1", shared.proxyPort);
+    client.setKeepAlive(KEEPALIVE_S / TIME_SCALE);
+    client.setSocketTimeout(SOCKET_TIMEOUT_S / TIME_SCALE);
+    ReconnectPolicy policy(policyConfig, (47ULL << 32) | index);
+    char clientId[32], topic[64], commands[64];
+    snprintf(clientId, sizeof(clientId), "device-%u", index);
+    snprintf(topic, sizeof(topic), "carbon_sequester/key%u/sensor_data", index);
+    snprintf(commands, sizeof(commands), "carbon_sequester/key%u/commands", index);
+
+    std::deque<std::string> backlog;
+    SensorWindow window;
+    window.mac = mac;
+    window.type = DeviceType::Sequester;
+    window.samples = 15;
+    window.avgCo2 = 410;
+    window.avgHumidity = 55;
+    window.timeSynced = true;
+    char payload[512];
+    uint32_t sequence = 0;
+    bool wasConnected = false;
+
+    simSleepMs((int64_t)(index * 7919ULL % BOOT_SPREAD_MS));
+    int64_t nextPublish = simNowMs() + PUBLISH_MS;
+    while (!shared.stop.load(std::memory_order_relaxed)) {
+      int64_t now = simNowMs();
+      if (!client.connected()) {
+        if (wasConnected) {
+          wasConnected = false;
+          connectedSinceMs = -1;
+          disconnects++;
+          policy.disconnected((uint32_t)now);
+        }
+        if (policy.due((uint32_t)now)) {
+          shared.attempts.fetch_add(1, std::memory_order_relaxed);
+          bool connected = client.connect(clientId);
+          policy.attempted((uint32_t)simNowMs(), connected);
+          if (connected) {
+            client.subscribe(commands);
+            wasConnected = true;
+            connectedSinceMs = simNowMs();
+          }
+        }
+      } else {
+        client.loop(0);
+      }
+
+      now = simNowMs();
+      if (now >= nextPublish) {
+        nextPublish += PUBLISH_MS;
+        window.sequence = ++sequence;
+        window.deviceTime = (uint64_t)now;
+        int length = formatSensorWindow(window, payload, sizeof(payload));
+        generated++;
+        // Backlog first, then this window; whatever does not go out waits for the next reconnect
+        while (client.connected() && !backlog.empty()) {
+          if (!client.publish(topic, (const uint8_t*)backlog.front().data(), backlog.front().size())) break;
+          backlog.pop_front();
+        }
+        if (!client.connected() || !backlog.empty() || !client.publish(topic, (const uint8_t*)payload, length)) {
+          backlog.emplace_back(payload, length);
+          if (backlog.size() > BACKLOG_WINDOWS) {
+            backlog.pop_front();
+            backlogDropped++;
+          }
+        }
+      }
+
+      now = simNowMs();
+      int64_t wait = nextPublish - now;
+      if (!client.connected()) {
+        wait = std::min<int64_t>(wait, policy.msUntilAttempt((uint32_t)now));
+        simSleepMs(std::min<int64_t>(wait, 1000));
+      } else if (wait > 0) {
+        client.loop((int)std::min<int64_t>(wait / TIME_SCALE + 1, 200));
+      }
+    }
+    pending = backlog.size();
+  }
+};
+
+/**
+ * @brief The ingest side: every window the broker delivers, checked against "seq"
+ */
+struct IngestWatcher {
+  SequenceDedupe dedupe{MAX_DEVICES};
+  std::vector<double> latencyMs;
+  uint64_t received = 0;
+  std::mutex lock;
+  std::atomic<bool> slow{false};
+  std::atomic<bool> stop{false};
+  std::atomic<uint16_t> brokerPort{0};
+  std::atomic<bool> connected{false};
+
+  void run() {
+    MqttClient client;
+    client.setKeepAlive(KEEPALIVE_S / TIME_SCALE);
+    client.setSocketTimeout(1);
+    client.setCallback([this](char*, uint8_t* payload, unsigned int length) {
+      SensorWindow window;
+      if (!parseSensorWindow((const char*)payload, length, window)) return;
+      std::lock_guard<std::mutex> guard(lock);
+      received++;
+      if (dedupe.accept(window.mac, window.sequence) == SequenceVerdict::Fresh) {
+        latencyMs.push_back((double)(simNowMs() - (int64_t)window.deviceTime));
+      }
+    });
+    uint16_t port = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (brokerPort != port || !client.connected()) {
+        connected = false;
+        client.disconnect();
+        port = brokerPort;
+        if (!port) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          continue;
+        }
+        client.setServer("127.0.0.1", port);
+        if (!client.connect("ingest")) continue;
+        client.subscribe("carbon_sequester/+/sensor_data");
+        client.loop(20);
+        connected = true;
+      }
+      if (slow) {
+        simSleepMs(1000);
+        continue;
+      }
+      client.loop(5);
+    }
+    // What is still in flight
+    for (int i = 0; i < 50 && client.loop(10); i++) {
+    }
+  }
+};
+
+struct BrokerProcess {
+  MiniBroker broker;
+  std::thread thread;
+
+  explicit BrokerProcess(const MiniBrokerConfig& config) : broker(config) {
+    broker.start();
+    thread = std::thread([this] { broker.run(); });
+  }
+  ~BrokerProcess() {
+    broker.stop();
+    thread.join();
+  }
+};
+
+static ChaosFaults scaled(ChaosFaults faults) {
+  faults.latencyMs /= TIME_SCALE;
+  faults.jitterMs /= TIME_SCALE;
+  faults.retransmitMs /= TIME_SCALE;
+  faults.acceptPerSecond *= TIME_SCALE;
+  return faults;
+}
+
+static int fleetSize() {
+  // Per device: its socket and both ends at the proxy
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  return (int)std::min<rlim_t>(MAX_DEVICES, (limit.rlim_cur - 256) / 3);
+}
+
+/**
+ * @brief Run one scenario with one reconnect policy and report it under prefix
+ */
+static void runScenario(BenchState& state, const ChaosScenario& scenario, const ReconnectConfig& policy,
+                        const char* prefix) {
+  int devices = fleetSize();
+  MiniBrokerConfig brokerConfig;
+  brokerConfig.maxQueuedBytes = 256 << 10;
+  std::unique_ptr<BrokerProcess> broker(new BrokerProcess(brokerConfig));
+  brokerConfig.port = broker->broker.port();   // a restart comes back on the same port
+
+  ChaosProxyConfig proxyConfig;
+  proxyConfig.upstreamPort = brokerConfig.port;
+  ChaosProxy proxy(proxyConfig, 47);
+  proxy.start();
+  ChaosFaults normal;
+  normal.acceptPerSecond = BROKER_CONNECTS_PER_S;
+  proxy.setFaults(scaled(normal));
+  std::thread proxyThread([&] { proxy.run(); });
+
+  simEpochNs = benchNowNs();
+  IngestWatcher watcher;
+  watcher.brokerPort = brokerConfig.port;
+  std::thread watcherThread([&] { watcher.run(); });
+  while (!watcher.connected) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  FleetShared shared;
+  shared.proxyPort = proxy.port();
+  std::vector<ChaosDevice> fleet(devices);
+  std::vector<std::thread> threads;
+  threads.reserve(devices);
+  for (int d = 0; d < devices; d++) {
+    fleet[d].index = d;
+    fleet[d].mac = 0x02CC00000000ULL | d;
+    fleet[d].policyConfig = policy;
+    threads.emplace_back([&shared, &fleet, d] { fleet[d].run(shared); });
+  }
+
+  // Offered and admitted connects per simulated second, sampled as the scenario runs
+  int64_t faultEnd = FAULT_AT_MS + scenario.durationMs;
+  int64_t end = faultEnd + SETTLE_MS;
+  uint64_t lastAttempts = 0, lastAccepted = 0, peakAttempts = 0, peakAccepted = 0;
+  bool faulted = false, healed = false;
+  for (int64_t second = 1000; second <= end; second += 1000) {
+    simSleepMs(second - simNowMs());
+    if (!faulted && second >= FAULT_AT_MS) {
+      faulted = true;
+      ChaosFaults faults = scenario.faults;
+      faults.acceptPerSecond = BROKER_CONNECTS_PER_S;
+      if (scenario.restartBroker) {
+        faults.refuse = true;
+        proxy.setFaults(scaled(faults));
+        broker.reset();
+        watcher.brokerPort = 0;
+      } else {
+        proxy.setFaults(scaled(faults));
+      }
+      watcher.slow = scenario.slowConsumer;
+    }
+    if (!healed && second >= faultEnd) {
+      healed = true;
+      if (scenario.restartBroker) {
+        broker.reset(new BrokerProcess(brokerConfig));
+        watcher.brokerPort = brokerConfig.port;
+        while (!watcher.connected) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      proxy.setFaults(scaled(normal));
+      watcher.slow = false;
+    }
+    uint64_t attempts = shared.attempts.load(std::memory_order_relaxed);
+    uint64_t accepted = proxy.stats().connectionsAccepted;
+    if (second > BOOT_SPREAD_MS + 15000) {
+      peakAttempts = std::max(peakAttempts, attempts - lastAttempts);
+      peakAccepted = std::max(peakAccepted, accepted - lastAccepted);
+    }
+    lastAttempts = attempts;
+    lastAccepted = accepted;
+  }
+
+  shared.stop = true;
+  for (std::thread& thread : threads) thread.join();
+  watcher.stop = true;
+  watcherThread.join();
+  proxy.stop();
+  proxyThread.join();
+
+  std::vector<double> recovery;
+  uint64_t generated = 0, pending = 0, unrecovered = 0, disconnects = 0;
+  for (const ChaosDevice& device : fleet) {
+    generated += device.generated;
+    pending += device.pending;
+    disconnects += device.disconnects;
+    if (device.connectedSinceMs < 0) unrecovered++;
+    else recovery.push_back(std::max<int64_t>(0, device.connectedSinceMs - faultEnd) / 1000.0);
+  }
+  const SequenceDedupeStats& seen = watcher.dedupe.stats();
+  std::string name(prefix);
+  auto report = [&](const char* metric, double value, const char* unit) {
+    state.report((name + "_" + metric).c_str(), value, unit);
+  };
+  report("devices", devices, "");
+  report("disconnects", (double)disconnects, "");
+  report("recover_p50", benchPercentile(recovery, 0.5), "s");
+  report("recover_p99", benchPercentile(recovery, 0.99), "s");
+  report("recover_max", benchPercentile(recovery, 1.0), "s");
+  report("unrecovered", (double)unrecovered, "devices");
+  report("peak_connect_attempts", (double)peakAttempts, "1/s");
+  report("peak_connects_accepted", (double)peakAccepted, "1/s");
+  report("connect_attempts", (double)shared.attempts, "");
+  report("windows_lost", (double)(generated - seen.fresh - pending), "");
+  report("windows_duplicated", (double)(seen.duplicates + seen.stale), "");
+  report("delivery_p99", benchPercentile(watcher.latencyMs, 0.99), "ms");
+}
+
+static void runChaos(BenchState& state, const ChaosScenario& scenario) {
+  runScenario(state, scenario, ReconnectConfig(), "backoff");
+  if (scenario.comparePolicies) runScenario(state, scenario, ReconnectPolicy::fixedInterval(RETRY_MS), "fixed");
+}
+
+BENCHMARK(chaos_broker_restart) {
+  // The broker goes away for 20 s and comes back empty: every device reconnects at once
+  ChaosScenario scenario = {20000, ChaosFaults(), true, false, true};
+  runChaos(state, scenario);
+}
+
+BENCHMARK(chaos_partition) {
+  // Nothing gets through for 2 minutes; devices find out through keepalive
+  ChaosScenario scenario = {120000, ChaosFaults(), false, false, true};
+  scenario.faults.partition = true;
+  runChaos(state, scenario);
+}
+
+BENCHMARK(chaos_latency_loss) {
+  // A bad uplink for 2 minutes: 300 +- 150 ms each way and 5% of segments retransmitted
+  ChaosScenario scenario = {120000, ChaosFaults(), false, false, false};
+  scenario.faults.latencyMs = 150;
+  scenario.faults.jitterMs = 300;
+  scenario.faults.lossRate = 0.05f;
+  scenario.faults.retransmitMs = 1000;
+  runChaos(state, scenario);
+}
+
+BENCHMARK(chaos_slow_consumer) {
+  // Ingest stops reading for 3 minutes; the broker holds 256 KiB for it, the sockets some more
+  ChaosScenario scenario = {180000, ChaosFaults(), false, true, false};
+  runChaos(state, scenario);
+}
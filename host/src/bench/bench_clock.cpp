@@ -0,0 +1,115 @@
+#include <Bench.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <ClockSync.h>
+#include <FastRandom.h>
+
+static const double CRYSTAL_PPM = 40;                // an ESP32 crystal this fast: Unix time drifts -40 ppm against it
+static const int64_t SIMULATED_US = 24LL * 3600 * 1000000;
+static const int64_t WARMUP_US = 3600LL * 1000000;    // the first hour is not scored
+static const int64_t PUBLISH_US = 15LL * 1000000;     // mqttPublishInterval
+static const int NTP_BURST = 4;                       // exchanges per poll, as the firmware sends
+static const int64_t BOOT_UNIX_US = 1735689600LL * 1000000;
+
+/**
+ * @brief One-way Wi-Fi/WAN delay: a floor, exponential queueing and occasional spikes
+ */
+static int64_t linkDelayUs(FastRandom& random) {
+  double delayMs = 4 + -8 * log(1 - random.nextFloat() * 0.999999);
+  if (random.below(100) < 2) delayMs += 150 + random.nextFloat() * 250;
+  return (int64_t)(delayMs * 1000);
+}
+
+static double percentile(std::vector<double>& values, double p) {
+  if (values.empty()) return 0;
+  size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+struct ClockRun {
+  std::vector<double> errorsMs;   // |payload t - true time| at every publish after the warmup
+  uint32_t polls = 0;
+  uint32_t backwards = 0;         // payload t lower than the one before
+  ClockSyncStats stats;
+  double driftPpm = 0;
+};
+
+/**
+ * @brief A device publishing for a day, its clock disciplined against a true-time server
+ */
+static ClockRun simulateDevice(bool trackDrift, uint64_t seed) {
+  FastRandom random(seed);
+  ClockDiscipline clock;
+  clock.setDriftTracking(trackDrift);
+  auto monotonicAt = [](int64_t trueUs) { return (int64_t)(trueUs * (1 + CRYSTAL_PPM * 1e-6)); };
+
+  ClockRun run;
+  int64_t lastPollUs = 0;
+  bool polled = false;
+  uint64_t lastEpochMs = 0;
+  for (int64_t now = 0; now < SIMULATED_US; now += PUBLISH_US) {
+    int64_t monotonic = monotonicAt(now);
+    if (!polled || monotonic - lastPollUs >= (int64_t)clock.pollIntervalS() * 1000000) {
+      int64_t at = now;
+      for (int i = 0; i < NTP_BURST; i++) {
+        int64_t serverReceive = at + linkDelayUs(random);
+        int64_t serverTransmit = serverReceive + 50;
+        int64_t back = serverTransmit + linkDelayUs(random);
+        NtpReply reply = {BOOT_UNIX_US + serverReceive, BOOT_UNIX_US + serverTransmit, 1};
+        clock.addSample(monotonicAt(at), reply, monotonicAt(back));
+        at = back;
+      }
+      lastPollUs = monotonic;
+      polled = true;
+      if (now >= WARMUP_US) run.polls++;
+    }
+
+    if (!clock.synced()) continue;
+    uint64_t epochMs = clock.epochMs(monotonicAt(now));
+    run.backwards += epochMs < lastEpochMs;
+    lastEpochMs = epochMs;
+    if (now >= WARMUP_US) run.errorsMs.push_back(fabs((double)epochMs - (BOOT_UNIX_US + now) / 1000.0));
+  }
+  run.stats = clock.stats();
+  run.driftPpm = clock.driftPpm();
+  return run;
+}
+
+BENCHMARK(clock_sync) {
+  const int devices = 20;
+  double scoredHours = (SIMULATED_US - WARMUP_US) / 3600e6;
+  for (bool trackDrift : {true, false}) {
+    std::vector<double> errors;
+    uint32_t polls = 0, backwards = 0, steps = 0;
+    double driftError = 0;
+    for (int d = 0; d < devices; d++) {
+      ClockRun run = simulateDevice(trackDrift, 45 + d);
+      errors.insert(errors.end(), run.errorsMs.begin(), run.errorsMs.end());
+      polls += run.polls;
+      backwards += run.backwards;
+      steps += run.stats.steps;
+      driftError = std::max(driftError, fabs(run.driftPpm + CRYSTAL_PPM));
+    }
+    std::string prefix = trackDrift ? "drift_tracked" : "free_running";
+    state.report((prefix + "_error_p50").c_str(), percentile(errors, 0.5), "ms");
+    state.report((prefix + "_error_p99").c_str(), percentile(errors, 0.99), "ms");
+    state.report((prefix + "_error_max").c_str(), percentile(errors, 1.0), "ms");
+    state.report((prefix + "_polls_per_hour").c_str(), polls / scoredHours / devices, "1/h");
+    state.report((prefix + "_steps").c_str(), (double)steps / devices, "");
+    state.report((prefix + "_backwards").c_str(), (double)backwards, "");
+    if (trackDrift) state.report("drift_estimate_error_max", driftError, "ppm");
+  }
+
+  // What arrival-time placement costs on the same link, before any backlog
+  FastRandom random(46);
+  std::vector<double> arrival(100000);
+  for (double& delay : arrival) delay = linkDelayUs(random) / 1000.0;
+  state.report("arrival_error_p50", percentile(arrival, 0.5), "ms");
+  state.report("arrival_error_p99", percentile(arrival, 0.99), "ms");
+}
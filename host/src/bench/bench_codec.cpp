@@ -0,0 +1,149 @@
+#include <Bench.h>
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <FleetSim.h>
+#include <PayloadCodec.h>
+#include <Scenario.h>
+#include <Telemetry.h>
+
+// The firmware's limits: batch text, and what fits one MQTT packet
+static const size_t BATCH_TEXT_BYTES = 4096;
+static const size_t MAX_FRAMED_PAYLOAD = 1024 - 128;
+
+/**
+ * @brief One device's windows as the firmware formats them, with sketches
+ */
+static std::vector<std::string> deviceWindows(int count) {
+  ScenarioConfig scenario;
+  bool shaped = loadScenarioConfig("scenarios/emitter.ini", scenario) ||
+                loadScenarioConfig("host/scenarios/emitter.ini", scenario);
+  FleetSimConfig config;
+  config.devices = 1;
+  config.emitterShare = 1;
+  config.sketches = true;
+  config.emitterScenario = shaped ? &scenario : nullptr;
+  FleetSim sim(config);
+  std::vector<std::string> windows(count);
+  SensorWindow window;
+  int64_t timestamp;
+  char buffer[1024];
+  for (int i = 0; i < count; i++) {
+    sim.next(window, timestamp);
+    windows[i].assign(buffer, formatSensorWindow(window, buffer, sizeof(buffer)));
+  }
+  return windows;
+}
+
+/**
+ * @brief Batch text the way flushWindowBacklog() builds it, windows [first, first + count)
+ */
+static std::string batchText(const std::vector<std::string>& windows, size_t first, size_t count) {
+  std::string text = std::to_string((first + count) * 15000) + "\n";
+  for (size_t i = first; i < first + count; i++) text += windows[i] + "\n";
+  return text;
+}
+
+BENCHMARK(payload_compression) {
+  const int windowCount = 4096;
+  std::vector<std::string> windows = deviceWindows(windowCount);
+  LzssWorkspace work;
+  std::vector<uint8_t> framed(PAYLOAD_MAX_TEXT + PAYLOAD_HEADER_BYTES);
+  state.report("encoder_ram", (double)sizeof(LzssWorkspace), "B");
+
+  // One window at a time: what a connected device sends every 15 s
+  size_t jsonBytes = 0, wireBytes = 0;
+  int64_t start = benchNowNs();
+  for (const std::string& window : windows) {
+    size_t length = encodePayload(window.data(), window.size(), PAYLOAD_LZSS, framed.data(), framed.size(), work);
+    jsonBytes += window.size();
+    wireBytes += length && length < window.size() ? length : window.size();
+  }
+  int64_t elapsed = benchNowNs() - start;
+  state.report("window_json_bytes", (double)jsonBytes / windowCount, "B");
+  state.report("window_ratio", (double)jsonBytes / wireBytes, "x");
+  state.report("window_compress_us", elapsed / 1e3 / windowCount, "us");
+
+  // Backlog batches: as many windows as the firmware packs into one publish
+  for (size_t perBatch : {4, 8, 12}) {
+    size_t batches = 0, text = 0, wire = 0, oversized = 0;
+    int64_t compressNs = 0;
+    for (size_t first = 0; first + perBatch <= windows.size(); first += perBatch) {
+      std::string batch = batchText(windows, first, perBatch);
+      if (batch.size() > BATCH_TEXT_BYTES) {
+        oversized++;
+        continue;
+      }
+      int64_t t0 = benchNowNs();
+      size_t length = encodePayload(batch.data(), batch.size(), PAYLOAD_BATCH | PAYLOAD_LZSS, framed.data(),
+                                    framed.size(), work);
+      compressNs += benchNowNs() - t0;
+      oversized += length > MAX_FRAMED_PAYLOAD;
+      batches++;
+      text += batch.size();
+      wire += length;
+    }
+    std::string prefix = "batch" + std::to_string(perBatch);
+    state.report((prefix + "_ratio").c_str(), batches ? (double)text / wire : 0, "x");
+    state.report((prefix + "_bytes_per_window").c_str(), batches ? (double)wire / (batches * perBatch) : 0, "B");
+    state.report((prefix + "_compress_us").c_str(), batches ? compressNs / 1e3 / batches : 0, "us");
+    state.report((prefix + "_over_one_packet").c_str(), (double)oversized, "");
+  }
+
+  // Host side: decode and parse every window of 8-window batches
+  std::vector<std::vector<uint8_t>> payloads;
+  size_t textBytes = 0;
+  for (size_t first = 0; first + 8 <= windows.size(); first += 8) {
+    std::string batch = batchText(windows, first, 8);
+    size_t length = encodePayload(batch.data(), batch.size(), PAYLOAD_BATCH | PAYLOAD_LZSS, framed.data(),
+                                  framed.size(), work);
+    payloads.emplace_back(framed.begin(), framed.begin() + length);
+    textBytes += batch.size();
+  }
+
+  std::vector<char> text(BATCH_TEXT_BYTES * 2);
+  const int rounds = 50;
+  size_t wrong = 0;
+  start = benchNowNs();
+  for (int r = 0; r < rounds; r++) {
+    for (const std::vector<uint8_t>& payload : payloads) {
+      uint8_t flags;
+      wrong += decodePayload(payload.data(), payload.size(), text.data(), text.size(), flags) < 0;
+    }
+  }
+  elapsed = benchNowNs() - start;
+  state.report("decode_MBps", (double)textBytes * rounds / (elapsed / 1e9) / 1e6, "MB/s");
+  state.report("decode_errors", (double)wrong, "");
+
+  std::vector<char> scratch;
+  size_t parsed = 0;
+  double co2Sum = 0;
+  start = benchNowNs();
+  for (int r = 0; r < rounds; r++) {
+    for (const std::vector<uint8_t>& payload : payloads) {
+      forEachSensorWindow((const char*)payload.data(), payload.size(), 0, scratch,
+                          [&](const SensorWindow& window, int64_t) {
+        co2Sum += window.avgCo2;
+        parsed++;
+      });
+    }
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(co2Sum);
+  state.report("batch_windows_per_s", parsed / (elapsed / 1e9), "1/s");
+
+  // Every window decoded must be the one sent
+  size_t mismatched = 0;
+  size_t index = 0;
+  for (const std::vector<uint8_t>& payload : payloads) {
+    uint8_t flags;
+    int length = decodePayload(payload.data(), payload.size(), text.data(), text.size(), flags);
+    std::string expected = batchText(windows, index, 8);
+    mismatched += length != (int)expected.size() || memcmp(text.data(), expected.data(), expected.size()) != 0;
+    index += 8;
+  }
+  state.report("round_trip_mismatches", (double)mismatched, "");
+}
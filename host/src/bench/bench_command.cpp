@@ -0,0 +1,70 @@
+#include <Bench.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include <DeviceCommand.h>
+
+BENCHMARK(command_parse) {
+  // Commands as a backend sends them on <prefix>/<API_KEY>/commands
+  const struct {
+    const char* name;
+    const char* json;
+  } commands[] = {
+    {"set", "{\"id\":42,\"cmd\":\"set\",\"publish_ms\":30000,\"deadband_c\":25,\"deadband_h\":2,\"credits_alert\":12.5}"},
+    {"get", "{\"id\":43,\"cmd\":\"get\",\"mac\":\"AA:BB:CC:DD:EE:FF\"}"},
+    {"rejected", "{\"id\":44,\"cmd\":\"set\",\"sample_ms\":1000,\"publish_ms\":60000}"},
+  };
+  const int iterations = 200000;
+  DeviceSettings current;
+  DeviceCommand command;
+
+  for (const auto& entry : commands) {
+    size_t length = strlen(entry.json);
+    char metric[48];
+
+    // In place, as handleCommand() does with the payload PubSubClient hands over
+    int64_t start = benchNowNs();
+    for (int i = 0; i < iterations; i++) {
+      benchDoNotOptimize(parseDeviceCommand(entry.json, length, current, command));
+    }
+    snprintf(metric, sizeof(metric), "%s_parse_ns", entry.name);
+    state.report(metric, (double)(benchNowNs() - start) / iterations, "ns");
+
+    // The old callback first built a String one character at a time
+    start = benchNowNs();
+    for (int i = 0; i < iterations; i++) {
+      std::string message;
+      for (size_t c = 0; c < length; c++) message += entry.json[c];
+      benchDoNotOptimize(parseDeviceCommand(message.data(), message.size(), current, command));
+    }
+    snprintf(metric, sizeof(metric), "%s_copy_parse_ns", entry.name);
+    state.report(metric, (double)(benchNowNs() - start) / iterations, "ns");
+  }
+
+  // The reply carrying every setting, the largest one a device sends
+  parseDeviceCommand(commands[0].json, strlen(commands[0].json), current, command);
+  char reply[512];
+  int replyLen = 0;
+  int64_t start = benchNowNs();
+  for (int i = 0; i < iterations; i++) {
+    replyLen = formatCommandReply(reply, sizeof(reply), command, "AA:BB:CC:DD:EE:FF", true, command.settings);
+    benchDoNotOptimize(reply[0]);
+  }
+  state.report("reply_format_ns", (double)(benchNowNs() - start) / iterations, "ns");
+  state.report("reply_bytes", replyLen, "B");
+  state.report("command_ram", (double)sizeof(DeviceCommand), "B");
+
+  // Blobs as restoreSettings() may find them in NVS, never parsed: each must be refused before
+  // publish_ms / sample_ms is computed
+  DeviceSettings zero;
+  zero.sampleMs = 0;
+  zero.publishMs = 0;
+  DeviceSettings oversized;
+  oversized.batchWindows = 1000;
+  if (checkDeviceSettings(DeviceSettings(), nullptr)) state.fail("the default settings fail their own check");
+  if (!checkDeviceSettings(zero, nullptr)) state.fail("a stored sample_ms of 0 passed the check");
+  if (!checkDeviceSettings(oversized, nullptr)) state.fail("a stored batch_windows out of range passed the check");
+}
@@ -0,0 +1,79 @@
+#include <Bench.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <FleetSim.h>
+#include <IngestPool.h>
+#include <Telemetry.h>
+
+// Windows a worker routes before folding in what others handed it, like one poll of the socket
+static const int DRAIN_EVERY = 64;
+
+BENCHMARK(ingest_workers) {
+  // sensor_data payloads as they come off the wire
+  FleetSimConfig config;
+  config.devices = 10000;
+  config.sketches = true;
+  FleetSim sim(config);
+  const int messages = 200000;
+  std::vector<std::string> payloads(messages);
+  std::vector<int64_t> timestamps(messages);
+  char buffer[1024];
+  SensorWindow window;
+  for (int i = 0; i < messages; i++) {
+    sim.next(window, timestamps[i]);
+    int length = formatSensorWindow(window, buffer, sizeof(buffer));
+    payloads[i].assign(buffer, length);
+  }
+  state.report("hardware_threads", std::thread::hardware_concurrency(), "threads");
+
+  // The broker deals a shared subscription out round-robin: worker w gets every k-th message
+  double singleRate = 0;
+  uint32_t expectedWindows = 0;
+  for (int workers : {1, 2, 4, 8, 16}) {
+    IngestPool pool(workers);
+    auto work = [&](int index) {
+      IngestPool::setWorkerShard(index);
+      int received = 0;
+      for (int i = index; i < messages; i += workers) {
+        pool.route(payloads[i].data(), payloads[i].size(), timestamps[i]);
+        if (++received % DRAIN_EVERY == 0) pool.drain(index);
+      }
+    };
+
+    int64_t start = benchNowNs();
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) threads.emplace_back(work, w);
+    for (std::thread& thread : threads) thread.join();
+    for (int w = 0; w < workers; w++) pool.drain(w);
+    int64_t elapsed = benchNowNs() - start;
+
+    double rate = messages * 1e9 / elapsed;
+    if (workers == 1) singleRate = rate;
+    char metric[48];
+    snprintf(metric, sizeof(metric), "workers_%d_messages_per_second", workers);
+    state.report(metric, rate, "msg/s");
+    snprintf(metric, sizeof(metric), "workers_%d_speedup", workers);
+    state.report(metric, rate / singleRate, "x");
+
+    // Whatever the split, the merged per-type rollups must match the single worker's
+    int64_t from = config.startMs, to = timestamps[messages - 1] + 1;
+    uint32_t windows = pool.queryType(DeviceType::Emitter, from, to).windows +
+                       pool.queryType(DeviceType::Sequester, from, to).windows;
+    if (workers == 1) expectedWindows = windows;
+    if (windows != expectedWindows || pool.ingested() != (uint64_t)messages) {
+      snprintf(metric, sizeof(metric), "workers_%d_lost_windows", workers);
+      state.report(metric, (double)expectedWindows - windows, "windows");
+      char why[96];
+      snprintf(why, sizeof(why), "%d workers rolled up %u of %u windows from %llu of %d messages", workers, windows,
+               expectedWindows, (unsigned long long)pool.ingested(), messages);
+      state.fail(why);
+    }
+    if (workers > 1) {
+      snprintf(metric, sizeof(metric), "workers_%d_handoff", workers);
+      state.report(metric, pool.routedAway() * 100.0 / messages, "%");
+    }
+  }
+}
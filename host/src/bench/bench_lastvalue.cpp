@@ -0,0 +1,99 @@
+#include <Bench.h>
+
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <FastRandom.h>
+#include <LastValueCache.h>
+
+static const uint32_t FLEET_DEVICES = 100000;
+
+static SensorWindow randomWindow(FastRandom& random, uint32_t device) {
+  SensorWindow window;
+  window.mac = 0x02AB00000000ULL | device;
+  window.type = device % 2 ? DeviceType::Emitter : DeviceType::Sequester;
+  window.avgCo2 = 400 + random.nextFloat() * 1600;
+  window.credits = random.nextFloat() * 50;
+  window.offset = random.next() & 1;
+  window.samples = 30;
+  return window;
+}
+
+BENCHMARK(last_value_cache) {
+  FastRandom random(42);
+  LastValueCache cache(FLEET_DEVICES);
+
+  // Ingest: random devices, like windows arriving from the whole fleet
+  const size_t updates = 1 << 21;
+  std::vector<SensorWindow> windows(1 << 16);
+  for (size_t i = 0; i < windows.size(); i++) windows[i] = randomWindow(random, random.next() % FLEET_DEVICES);
+  for (uint32_t d = 0; d < FLEET_DEVICES; d++) cache.update(randomWindow(random, d), 0);
+  int64_t start = benchNowNs();
+  for (size_t i = 0; i < updates; i++) cache.update(windows[i & 0xFFFF], (int64_t)i);
+  int64_t elapsed = benchNowNs() - start;
+  state.report("update_ns", (double)elapsed / updates, "ns");
+
+  Heartbeat heartbeat;
+  heartbeat.online = true;
+  heartbeat.rssi = -60;
+  start = benchNowNs();
+  for (uint32_t d = 0; d < FLEET_DEVICES; d++) {
+    heartbeat.mac = 0x02AB00000000ULL | d;
+    cache.update(heartbeat, DeviceType::Unknown, 1);
+  }
+  elapsed = benchNowNs() - start;
+  state.report("heartbeat_ns", (double)elapsed / FLEET_DEVICES, "ns");
+
+  // Overview page: every device's row, consistent per row
+  std::vector<DeviceLastValue> rows(FLEET_DEVICES);
+  const int pages = 50;
+  start = benchNowNs();
+  for (int p = 0; p < pages; p++) cache.readRange(0, FLEET_DEVICES, rows.data());
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(rows[FLEET_DEVICES / 2]);
+  state.report("overview_100k_us", elapsed / 1e3 / pages, "us");
+
+  std::vector<uint8_t> snapshot;
+  start = benchNowNs();
+  for (int p = 0; p < pages; p++) cache.snapshot(snapshot, 2);
+  elapsed = benchNowNs() - start;
+  state.report("snapshot_100k_us", elapsed / 1e3 / pages, "us");
+  state.report("snapshot_bytes", (double)snapshot.size(), "B");
+
+  int64_t asOfMs;
+  std::vector<DeviceLastValue> decoded;
+  bool ok = decodeLastValueSnapshot(snapshot.data(), snapshot.size(), asOfMs, decoded);
+  size_t mismatched = ok ? 0 : FLEET_DEVICES;
+  for (size_t i = 0; ok && i < decoded.size(); i++) {
+    mismatched += decoded[i].mac != rows[i].mac || decoded[i].co2 != rows[i].co2 || decoded[i].flags != rows[i].flags;
+  }
+  state.report("snapshot_mismatches", (double)mismatched, "");
+
+  // The same page with a writer hammering the cache
+  std::atomic<bool> stop{false};
+  std::thread writer([&] {
+    size_t i = 0;
+    while (!stop.load(std::memory_order_relaxed)) cache.update(windows[i++ & 0xFFFF], 3);
+  });
+  size_t retried = 0;
+  start = benchNowNs();
+  for (int p = 0; p < pages; p++) retried += cache.readRange(0, FLEET_DEVICES, rows.data());
+  elapsed = benchNowNs() - start;
+  stop = true;
+  writer.join();
+  state.report("overview_under_writes_us", elapsed / 1e3 / pages, "us");
+  state.report("rows_reread_per_page", (double)retried / pages, "");
+
+  // Baseline: latest window per device from ten minutes of history
+  std::vector<SensorWindow> history(FLEET_DEVICES * 5);
+  for (size_t i = 0; i < history.size(); i++) history[i] = randomWindow(random, (uint32_t)(i % FLEET_DEVICES));
+  start = benchNowNs();
+  std::unordered_map<uint64_t, const SensorWindow*> latest;
+  latest.reserve(FLEET_DEVICES);
+  for (const SensorWindow& window : history) latest[window.mac] = &window;
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(latest.size());
+  state.report("history_scan_us", elapsed / 1e3, "us");
+}
@@ -0,0 +1,229 @@
+#include <Bench.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <CreditLedger.h>
+#include <FileLedgerStorage.h>
+
+/**
+ * @brief Fresh scratch directory for one ledger
+ */
+static std::string ledgerDirectory() {
+  char path[] = "/tmp/ledger_bench_XXXXXX";
+  return mkdtemp(path) ? path : "/tmp";
+}
+
+static void removeLedger(const std::string& directory) {
+  unlink((directory + "/ledger.wal").c_str());
+  unlink((directory + "/ledger.snap").c_str());
+  rmdir(directory.c_str());
+}
+
+BENCHMARK(ledger_append) {
+  // Burner-style burns with an fdatasync per group; bigger groups amortize the sync
+  const uint32_t groups[] = {1, 16, 256};
+  for (uint32_t group : groups) {
+    std::string directory = ledgerDirectory();
+    FileLedgerStorage storage(directory.c_str());
+    LedgerConfig config;
+    config.groupCommitEntries = group;
+    config.snapshotEntries = 0;
+    CreditLedger ledger(storage, config);
+    ledger.recover();
+
+    const uint32_t entries = group == 1 ? 2000 : 50000;
+    int64_t start = benchNowNs();
+    for (uint32_t i = 0; i < entries; i++) {
+      ledger.transfer(LEDGER_AVAILABLE, LEDGER_BURNED, 100 + i % 2000, i);
+    }
+    ledger.commit();
+    double seconds = (benchNowNs() - start) / 1e9;
+
+    std::string metric = "appends_per_s_group_" + std::to_string(group);
+    state.report(metric.c_str(), entries / seconds, "1/s");
+    removeLedger(directory);
+  }
+}
+
+BENCHMARK(ledger_recovery) {
+  // A long journal replayed from scratch vs. the same history with snapshots
+  const uint32_t entries = 2000000;
+  const uint32_t snapshotEvery[] = {0, 4096};
+
+  for (uint32_t every : snapshotEvery) {
+    std::string directory = ledgerDirectory();
+    {
+      FileLedgerStorage storage(directory.c_str());
+      LedgerConfig config;
+      config.groupCommitEntries = 256;
+      config.snapshotEntries = every;
+      CreditLedger ledger(storage, config);
+      ledger.recover();
+      for (uint32_t i = 0; i < entries; i++) {
+        ledger.transfer(LEDGER_EXTERNAL, LEDGER_AVAILABLE, 1000, i);
+        ledger.poll(i);
+      }
+      ledger.commit();
+    }
+
+    FileLedgerStorage storage(directory.c_str());
+    CreditLedger ledger(storage);
+    int64_t start = benchNowNs();
+    ledger.recover();
+    double ms = (benchNowNs() - start) / 1e6;
+
+    std::string suffix = every ? "_snapshot_" + std::to_string(every) : "_no_snapshot";
+    state.report(("recovery_ms" + suffix).c_str(), ms, "ms");
+    state.report(("replayed" + suffix).c_str(), ledger.stats().replayed, "");
+    if (!every) state.report("replay_entries_per_s", ledger.stats().replayed / (ms / 1e3), "1/s");
+    benchDoNotOptimize(ledger.balance(LEDGER_AVAILABLE));
+    removeLedger(directory);
+  }
+}
+
+/**
+ * @brief Storage that leaves part of one append behind, ending mid-record, and reports failure
+ *
+ * What FileLedgerStorage can leave when it cannot cut a short write back.
+ */
+class TornAppendStorage : public LedgerStorage {
+public:
+  explicit TornAppendStorage(LedgerStorage& inner) : inner_(inner) {}
+
+  bool tearNext = false;
+
+  bool readSnapshot(LedgerSnapshot& snapshot) override { return inner_.readSnapshot(snapshot); }
+  bool writeSnapshot(const LedgerSnapshot& snapshot) override { return inner_.writeSnapshot(snapshot); }
+  long journalSize() override { return inner_.journalSize(); }
+  bool readJournal(long offset, void* data, size_t size) override { return inner_.readJournal(offset, data, size); }
+  bool truncateJournal(long size) override { return inner_.truncateJournal(size); }
+
+  bool appendJournal(const void* data, size_t size) override {
+    if (!tearNext) return inner_.appendJournal(data, size);
+    tearNext = false;
+    inner_.appendJournal(data, size / 2 + sizeof(LedgerRecord) / 2);
+    return false;
+  }
+
+private:
+  LedgerStorage& inner_;
+};
+
+BENCHMARK(ledger_faults) {
+  // Checks rather than timings: a failed append is retried without losing a
+  // committed group, and a damaged snapshot stops recovery instead of wiping the journal
+  LedgerConfig config;
+  config.groupCommitEntries = 16;
+  config.snapshotEntries = 0;
+  const uint32_t groups = 8;
+
+  // "short_write": the file size limit lets half a group through, ending mid-record, then write() fails with EFBIG
+  // "torn_append": the storage itself leaves that half group in the journal
+  for (bool storageTears : {false, true}) {
+    const char* scenario = storageTears ? "torn_append" : "short_write";
+    std::string directory = ledgerDirectory();
+    int64_t expected;
+    uint64_t expectedSequence;
+    bool failedOnce = false;
+    {
+      FileLedgerStorage file(directory.c_str());
+      TornAppendStorage storage(file);
+      CreditLedger ledger(storage, config);
+      ledger.recover();
+
+      for (uint32_t group = 0; group < groups; group++) {
+        bool inject = group == groups / 2;
+        struct rlimit saved;
+        getrlimit(RLIMIT_FSIZE, &saved);
+        if (inject && storageTears) {
+          storage.tearNext = true;
+        } else if (inject) {
+          signal(SIGXFSZ, SIG_IGN);
+          struct rlimit limit = saved;
+          limit.rlim_cur = file.journalSize() + (config.groupCommitEntries * sizeof(LedgerRecord) + sizeof(LedgerRecord)) / 2;
+          setrlimit(RLIMIT_FSIZE, &limit);
+        }
+
+        for (uint32_t i = 0; i < config.groupCommitEntries; i++) {
+          ledger.transfer(LEDGER_EXTERNAL, LEDGER_AVAILABLE, 1000 + group, group);
+        }
+        if (inject) {
+          failedOnce = ledger.pendingEntries() == config.groupCommitEntries;
+          setrlimit(RLIMIT_FSIZE, &saved);
+          ledger.commit();
+        }
+      }
+      expected = ledger.balance(LEDGER_AVAILABLE);
+      expectedSequence = ledger.sequence();
+    }
+
+    FileLedgerStorage storage(directory.c_str());
+    CreditLedger ledger(storage, config);
+    bool recovered = ledger.recover();
+    double lost = (double)expectedSequence - ledger.sequence();
+
+    char metric[48];
+    snprintf(metric, sizeof(metric), "%s_entries_lost", scenario);
+    state.report(metric, lost, "");
+    snprintf(metric, sizeof(metric), "%s_truncated_bytes", scenario);
+    state.report(metric, ledger.stats().truncated, "B");
+    if (!failedOnce) state.fail("the injected fault did not fail the commit");
+    if (!recovered || lost != 0 || ledger.balance(LEDGER_AVAILABLE) != expected || ledger.stats().truncated != 0) {
+      state.fail("a group committed after a failed append did not survive recovery");
+    }
+    removeLedger(directory);
+  }
+
+  // A snapshot with a flipped byte, then one cut short
+  for (bool cutShort : {false, true}) {
+    const char* scenario = cutShort ? "short_snapshot" : "corrupt_snapshot";
+    std::string directory = ledgerDirectory();
+    {
+      FileLedgerStorage storage(directory.c_str());
+      LedgerConfig snapshotting = config;
+      snapshotting.snapshotEntries = 64;
+      CreditLedger ledger(storage, snapshotting);
+      ledger.recover();
+      for (uint32_t i = 0; i < 100; i++) {
+        ledger.transfer(LEDGER_EXTERNAL, LEDGER_AVAILABLE, 1000, i);
+        ledger.poll(i);
+      }
+      ledger.commit();
+    }
+
+    std::string snapshotPath = directory + "/ledger.snap";
+    const off_t middle = sizeof(LedgerSnapshot) / 2;
+    bool damaged;
+    if (cutShort) {
+      damaged = truncate(snapshotPath.c_str(), middle) == 0;
+    } else {
+      int fd = open(snapshotPath.c_str(), O_RDWR);
+      uint8_t byte = 0;
+      damaged = fd >= 0 && pread(fd, &byte, 1, middle) == 1;
+      byte ^= 0x40;
+      damaged = damaged && pwrite(fd, &byte, 1, middle) == 1;
+      if (fd >= 0) close(fd);
+    }
+    if (!damaged) state.fail("could not damage the snapshot");
+
+    FileLedgerStorage storage(directory.c_str());
+    long before = storage.journalSize();
+    CreditLedger ledger(storage, config);
+    bool recovered = ledger.recover();
+    double lost = before - storage.journalSize();
+
+    char metric[48];
+    snprintf(metric, sizeof(metric), "%s_wal_bytes_lost", scenario);
+    state.report(metric, lost, "B");
+    if (recovered) state.fail("recovery went ahead without a valid snapshot");
+    if (before <= 0 || lost != 0) state.fail("recovery cut the journal after a bad snapshot");
+    removeLedger(directory);
+  }
+}
@@ -0,0 +1,80 @@
+#include <Bench.h>
+
+#include <random>
+
+#include <FleetSim.h>
+#include <OrderBook.h>
+
+/**
+ * @brief One order as the marketplace would see it, with the device's previous one to replace
+ */
+struct BenchOrder {
+  MarketSide side;
+  uint32_t price;
+  uint32_t quantity;
+  uint32_t device;
+};
+
+BENCHMARK(market_matching) {
+  // Order flow shaped by the fleet: every window an emitter buys what it
+  // burned and a sequester sells what it accrued, as the firmware does
+  FleetSimConfig config;
+  config.devices = 20000;
+  FleetSim sim(config);
+
+  const int windows = 1000000;
+  std::vector<BenchOrder> orders;
+  orders.reserve(windows);
+  std::mt19937_64 rng(29);
+  SensorWindow window;
+  int64_t timestamp;
+
+  for (int i = 0; i < windows; i++) {
+    uint32_t device = sim.next(window, timestamp);
+    const int* co2 = sim.lastCo2Readings();
+    float credits = 0;
+    for (int s = 0; s < window.samples; s++) {
+      if (window.type == DeviceType::Emitter) credits += co2[s] > 1000 ? (co2[s] - 1000) * 0.001f : 0;
+      else credits += co2[s] * 0.5f * 0.001f;
+    }
+    uint32_t quantity = marketQuantity(credits);
+    if (quantity == 0) continue;
+    if (window.type == DeviceType::Emitter) {
+      orders.push_back({MARKET_BUY, 1000 + (uint32_t)(rng() % 301), quantity, device});
+    } else {
+      orders.push_back({MARKET_SELL, 900 + (uint32_t)(rng() % 301), quantity, device});
+    }
+  }
+
+  // Like the marketplace, a device keeps one resting order: a new one replaces it
+  OrderBook book;
+  std::vector<uint64_t> resting(config.devices, 0);
+  std::vector<BookFill> fills;
+  fills.reserve(256);
+  std::vector<double> latencies;
+  latencies.reserve(orders.size());
+  uint64_t fillCount = 0, volume = 0;
+
+  int64_t start = benchNowNs();
+  for (const BenchOrder& order : orders) {
+    int64_t t0 = benchNowNs();
+    if (resting[order.device]) book.cancel(resting[order.device]);
+    fills.clear();
+    uint64_t id = book.submit(order.side, order.price, order.quantity, fills);
+    resting[order.device] = book.find(id) ? id : 0;
+    latencies.push_back(benchNowNs() - t0);
+
+    fillCount += fills.size();
+    for (const BookFill& fill : fills) volume += fill.quantity;
+  }
+  double seconds = (benchNowNs() - start) / 1e9;
+
+  state.report("orders", orders.size(), "");
+  state.report("orders_per_s", orders.size() / seconds, "1/s");
+  state.report("match_p50_ns", benchPercentile(latencies, 0.50), "ns");
+  state.report("match_p99_ns", benchPercentile(latencies, 0.99), "ns");
+  state.report("match_max_ns", benchPercentile(latencies, 1.0), "ns");
+  state.report("fills", fillCount, "");
+  state.report("credits_traded", marketCredits(volume), "credits");
+  state.report("resting_at_end", book.restingOrders(), "");
+}
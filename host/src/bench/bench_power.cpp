@@ -0,0 +1,38 @@
+#include <Bench.h>
+
+#include <PowerModel.h>
+
+// 18650 cell a field unit would carry
+static const float BATTERY_MAH = 2500;
+
+BENCHMARK(power_model) {
+  // The firmware's schedule under each power mode
+  const struct { PowerMode mode; const char* name; } modes[] = {
+    {POWER_ALWAYS_ON, "always_on"},
+    {POWER_MODEM_SLEEP, "modem_sleep"},
+    {POWER_LIGHT_SLEEP, "light_sleep"},
+  };
+  PowerProfile profile;
+  char metric[48];
+  for (const auto& m : modes) {
+    DutySchedule schedule;
+    schedule.mode = m.mode;
+    EnergyEstimate estimate = estimateDailyEnergy(profile, schedule);
+    snprintf(metric, sizeof(metric), "%s_average", m.name);
+    state.report(metric, estimate.averageMa, "mA");
+    snprintf(metric, sizeof(metric), "%s_energy", m.name);
+    state.report(metric, estimate.mWhPerDay, "mWh/day");
+    snprintf(metric, sizeof(metric), "%s_battery", m.name);
+    state.report(metric, batteryDays(estimate, BATTERY_MAH), "days");
+    snprintf(metric, sizeof(metric), "%s_wakeups", m.name);
+    state.report(metric, estimate.wakeups, "1/day");
+  }
+
+  // Once asleep, beacons dominate: a longer listen interval is the next lever
+  DutySchedule sparse;
+  sparse.mode = POWER_LIGHT_SLEEP;
+  sparse.listenInterval = 10;
+  EnergyEstimate estimate = estimateDailyEnergy(profile, sparse);
+  state.report("light_sleep_li10_energy", estimate.mWhPerDay, "mWh/day");
+  state.report("light_sleep_li10_battery", batteryDays(estimate, BATTERY_MAH), "days");
+}
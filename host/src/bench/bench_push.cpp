@@ -0,0 +1,207 @@
+#include <Bench.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <FastRandom.h>
+#include <LastValueCache.h>
+#include <PushServer.h>
+#include <Telemetry.h>
+#include <TenantKeys.h>
+
+static const uint32_t FLEET_DEVICES = 100000;
+static const int VIEWERS = 1000;
+static const int FLEET_VIEWERS = 50;            // the rest watch 1000 devices each
+static const uint32_t VIEWER_DEVICES = 1000;
+// Every device publishes a window every 15 s, as the firmware does
+static const int WINDOWS_PER_SECOND = FLEET_DEVICES / 15;
+static const int64_t SNAPSHOT_TIMEOUT_NS = 60LL * 1000 * 1000 * 1000;
+static const int64_t MEASURE_NS = 5LL * 1000 * 1000 * 1000;
+
+static SensorWindow randomWindow(FastRandom& random, uint32_t device) {
+  SensorWindow window;
+  window.mac = 0x02AB00000000ULL | device;
+  window.type = device % 2 ? DeviceType::Emitter : DeviceType::Sequester;
+  window.avgCo2 = 400 + random.nextFloat() * 1600;
+  window.maxCo2 = (int)window.avgCo2 + 50;
+  window.minCo2 = (int)window.avgCo2 - 50;
+  window.credits = random.nextFloat() * 50;
+  window.offset = random.next() & 1;
+  window.samples = 30;
+  return window;
+}
+
+/**
+ * @brief One dashboard connection, counting what arrives
+ */
+struct Viewer {
+  int fd = -1;
+  uint64_t bytes = 0;
+  uint64_t events = 0;       // includes the "retry:" preamble
+  uint64_t rows = 0;
+  char last = 0;
+};
+
+static int connectViewer(uint16_t port, const std::string& query, int receiveBuffer) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (receiveBuffer > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  std::string request = "GET /stream" + query + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+  if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+    close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+static void readViewer(Viewer& viewer) {
+  char buffer[65536];
+  while (true) {
+    ssize_t n = recv(viewer.fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) return;
+    viewer.bytes += n;
+    for (ssize_t i = 0; i < n; i++) {
+      viewer.events += buffer[i] == '\n' && viewer.last == '\n';
+      viewer.rows += buffer[i] == ';';
+      viewer.last = buffer[i];
+    }
+  }
+}
+
+static int64_t threadCpuNs(std::thread& thread) {
+  clockid_t clock;
+  timespec now;
+  if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0 || clock_gettime(clock, &now) != 0) return 0;
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+BENCHMARK(push_fanout) {
+  FastRandom random(43);
+  LastValueCache cache(FLEET_DEVICES);
+  for (uint32_t d = 0; d < FLEET_DEVICES; d++) cache.update(randomWindow(random, d), 0);
+
+  PushServer server(cache);
+  server.start();
+  std::thread loop([&] { server.run(); });
+
+  // Overview dashboards on the whole fleet, the rest on a site each; plus one viewer that never reads
+  std::vector<Viewer> viewers(VIEWERS);
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  int64_t start = benchNowNs();
+  for (int v = 0; v < VIEWERS; v++) {
+    std::string query;
+    if (v >= FLEET_VIEWERS) {
+      uint32_t first = random.next() % (FLEET_DEVICES - VIEWER_DEVICES);
+      query = "?ids=" + std::to_string(first) + "-" + std::to_string(first + VIEWER_DEVICES - 1);
+    }
+    viewers[v].fd = connectViewer(server.port(), query, 0);
+    if (viewers[v].fd < 0) continue;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = v;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, viewers[v].fd, &event);
+  }
+  int stalled = connectViewer(server.port(), "", 4096);
+
+  // Everyone has the preamble and a snapshot
+  epoll_event events[256];
+  while (benchNowNs() - start < SNAPSHOT_TIMEOUT_NS) {
+    int count = epoll_wait(epollFd, events, 256, 10);
+    for (int i = 0; i < count; i++) readViewer(viewers[events[i].data.u32]);
+    int synced = 0;
+    for (const Viewer& viewer : viewers) synced += viewer.events >= 2;
+    if (synced == VIEWERS) break;
+  }
+  int64_t elapsed = benchNowNs() - start;
+  int synced = 0;
+  uint64_t snapshotBytes = 0;
+  for (Viewer& viewer : viewers) {
+    synced += viewer.events >= 2;
+    snapshotBytes += viewer.bytes;
+    viewer.bytes = viewer.events = viewer.rows = 0;
+  }
+  state.report("viewers_synced", synced, "");
+  state.report("connect_and_snapshot_ms", elapsed / 1e6, "ms");
+  state.report("snapshot_MiB", snapshotBytes / 1048576.0, "MiB");
+
+  // The fleet keeps publishing while the viewers watch
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> updates{0};
+  std::thread writer([&] {
+    FastRandom pick(44);
+    const int batch = WINDOWS_PER_SECOND / 100;
+    while (!stop.load(std::memory_order_relaxed)) {
+      for (int i = 0; i < batch; i++) cache.update(randomWindow(pick, pick.next() % FLEET_DEVICES), 1);
+      updates.fetch_add(batch, std::memory_order_relaxed);
+      timespec pause = {0, 10 * 1000000L};
+      nanosleep(&pause, nullptr);
+    }
+  });
+
+  PushServerStats before = server.stats();
+  int64_t cpuBefore = threadCpuNs(loop);
+  start = benchNowNs();
+  while (benchNowNs() - start < MEASURE_NS) {
+    int count = epoll_wait(epollFd, events, 256, 10);
+    for (int i = 0; i < count; i++) readViewer(viewers[events[i].data.u32]);
+  }
+  elapsed = benchNowNs() - start;
+  int64_t cpu = threadCpuNs(loop) - cpuBefore;
+  PushServerStats after = server.stats();
+  stop = true;
+  writer.join();
+
+  double seconds = elapsed / 1e9;
+  uint64_t bytes = 0, received = 0, rows = 0;
+  for (const Viewer& viewer : viewers) {
+    bytes += viewer.bytes;
+    received += viewer.events;
+    rows += viewer.rows;
+  }
+  state.report("device_updates_per_s", updates.load() / seconds, "1/s");
+  state.report("events_per_viewer_per_s", received / seconds / VIEWERS, "1/s");
+  state.report("rows_encoded_per_s", (after.rowsEncoded - before.rowsEncoded) / seconds, "1/s");
+  state.report("rows_sent_per_s", rows / seconds, "1/s");
+  state.report("bytes_per_row", rows ? (double)bytes / rows : 0, "B");
+  state.report("push_MBps", bytes / seconds / 1e6, "MB/s");
+  state.report("server_cpu_pct", 100.0 * cpu / elapsed, "%");
+
+  // Baseline: every viewer subscribed to the raw topics of the devices it watches
+  char payload[1024];
+  SensorWindow sample = randomWindow(random, 1);
+  size_t rawBytes = formatSensorWindow(sample, payload, sizeof(payload)) + strlen("carbon_emitter/") +
+                    API_KEY_TEXT_LENGTH + strlen("/sensor_data") + 4;
+  double watchedShare = (FLEET_VIEWERS + (double)(VIEWERS - FLEET_VIEWERS) * VIEWER_DEVICES / FLEET_DEVICES);
+  state.report("raw_fanout_MBps", updates.load() / seconds * rawBytes * watchedShare / 1e6, "MB/s");
+
+  state.report("stalled_viewer_skips", (double)(after.skippedFlushes - before.skippedFlushes), "");
+  state.report("stalled_viewer_connected", after.clients == (uint64_t)VIEWERS + 1, "");
+
+  server.stop();
+  loop.join();
+  for (const Viewer& viewer : viewers) {
+    if (viewer.fd >= 0) close(viewer.fd);
+  }
+  if (stalled >= 0) close(stalled);
+  close(epollFd);
+}
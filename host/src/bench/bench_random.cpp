@@ -0,0 +1,102 @@
+#include <Bench.h>
+
+#include <stdlib.h>
+
+#include <random>
+
+#include <FastRandom.h>
+#include <FleetSim.h>
+
+static const int DRAWS = 50000000;
+
+/**
+ * @brief Time DRAWS calls of draw() and report them as ns per draw under the given name
+ */
+template <typename Draw>
+static void timeDraws(BenchState& state, const char* metric, Draw draw) {
+  uint32_t sink = 0;
+  int64_t start = benchNowNs();
+  for (int i = 0; i < DRAWS; i++) sink += draw();
+  int64_t elapsed = benchNowNs() - start;
+  benchDoNotOptimize(sink);
+  state.report(metric, (double)elapsed / DRAWS, "ns");
+}
+
+BENCHMARK(random_throughput) {
+  FastRandom fast(32);
+  std::mt19937 mt(32);
+  std::mt19937_64 mt64(32);
+  srand(32);
+
+  timeDraws(state, "fastrandom_ns", [&]() { return fast.next(); });
+  timeDraws(state, "mt19937_ns", [&]() { return (uint32_t)mt(); });
+  timeDraws(state, "mt19937_64_ns", [&]() { return (uint32_t)mt64(); });
+  timeDraws(state, "rand_ns", [&]() { return (uint32_t)rand(); });
+
+  // Ranged draws as the generators make them: CO2 in [800, 3000)
+  std::uniform_int_distribution<int> co2(800, 2999);
+  timeDraws(state, "fastrandom_range_ns", [&]() { return (uint32_t)fast.range(800, 3000); });
+  timeDraws(state, "mt19937_range_ns", [&]() { return (uint32_t)co2(mt); });
+  timeDraws(state, "rand_range_ns", [&]() { return (uint32_t)(800 + rand() % 2200); });
+}
+
+/**
+ * @brief FNV-1a over the fields of a window that come from the generator
+ */
+static uint64_t digestWindow(uint64_t hash, const SensorWindow& window) {
+  uint64_t fields[] = {window.mac, window.ip, (uint64_t)window.maxCo2, (uint64_t)window.minCo2,
+                       (uint64_t)window.maxHumidity, (uint64_t)window.minHumidity,
+                       (uint64_t)(window.credits * 1000), (uint64_t)(window.avgCo2 * 1000)};
+  for (uint64_t field : fields) {
+    for (int b = 0; b < 8; b++) {
+      hash ^= (field >> (b * 8)) & 0xFF;
+      hash *= 0x100000001B3ULL;
+    }
+  }
+  return hash;
+}
+
+/**
+ * @brief Digest of the first rounds of a seeded fleet
+ */
+static uint64_t digestFleet(uint32_t devices, uint64_t seed, int rounds, double& windowsPerSecond) {
+  FleetSimConfig config;
+  config.devices = devices;
+  config.seed = seed;
+  FleetSim sim(config);
+
+  SensorWindow window;
+  int64_t timestamp;
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  uint64_t windows = (uint64_t)devices * rounds;
+  int64_t start = benchNowNs();
+  for (uint64_t i = 0; i < windows; i++) {
+    sim.next(window, timestamp);
+    hash = digestWindow(hash, window);
+  }
+  windowsPerSecond = windows * 1e9 / (benchNowNs() - start);
+  return hash;
+}
+
+BENCHMARK(random_fleet_replay) {
+  // A million devices, replayed twice from the same seed: the digests must match
+  double windowsPerSecond, ignored;
+  uint64_t first = digestFleet(1000000, 2024, 3, windowsPerSecond);
+  uint64_t second = digestFleet(1000000, 2024, 3, ignored);
+  uint64_t otherSeed = digestFleet(1000000, 2025, 3, ignored);
+  state.report("windows_per_s", windowsPerSecond, "1/s");
+  state.report("replay_identical", first == second ? 1 : 0, "bool");
+  state.report("seed_changes_digest", first != otherSeed ? 1 : 0, "bool");
+
+  // A device's stream does not depend on the fleet around it
+  FleetSimConfig small, large;
+  small.devices = 1000;
+  large.devices = 100000;
+  small.seed = large.seed = 2024;
+  FleetSim smallFleet(small), largeFleet(large);
+  uint32_t same = 0;
+  for (uint32_t i = 0; i < small.devices; i++) {
+    same += smallFleet.device(i).mac == largeFleet.device(i).mac && smallFleet.device(i).ip == largeFleet.device(i).ip;
+  }
+  state.report("streams_stable_across_fleet_size", 100.0 * same / small.devices, "%");
+}
@@ -0,0 +1,74 @@
+#include <Bench.h>
+
+#include <random>
+
+#include <FleetSim.h>
+#include <Rollup.h>
+
+static const int64_t DAY_MS = 24LL * 60 * 60 * 1000;
+
+BENCHMARK(rollup_ingest) {
+  FleetSimConfig config;
+  config.devices = 10000;
+  FleetSim sim(config);
+
+  const int messages = 1000000;
+  std::vector<SensorWindow> windows(messages);
+  std::vector<int64_t> timestamps(messages);
+  for (int i = 0; i < messages; i++) sim.next(windows[i], timestamps[i]);
+
+  RollupStore store;
+  int64_t start = benchNowNs();
+  for (int i = 0; i < messages; i++) store.ingest(windows[i], timestamps[i]);
+  int64_t elapsed = benchNowNs() - start;
+
+  state.report("ns_per_message", (double)elapsed / messages, "ns");
+  state.report("messages_per_second", messages * 1e9 / elapsed, "msg/s");
+  state.report("devices", (double)store.deviceCount(), "devices");
+}
+
+BENCHMARK(rollup_query_months) {
+  // 120 days of history for 200 devices, one window every 5 minutes
+  FleetSimConfig config;
+  config.devices = 200;
+  config.publishIntervalMs = 5 * 60 * 1000;
+  FleetSim sim(config);
+
+  RollupStore store;
+  SensorWindow window;
+  int64_t timestamp = 0;
+  int64_t end = config.startMs + 120 * DAY_MS;
+  while (true) {
+    sim.next(window, timestamp);
+    if (timestamp >= end) break;
+    store.ingest(window, timestamp);
+  }
+
+  std::mt19937_64 rng(7);
+  const int queries = 2000;
+  std::vector<double> typeLatency, deviceLatency;
+  double checksum = 0;
+
+  for (int i = 0; i < queries; i++) {
+    // Ranges of 30-90 days with unaligned edges, ending somewhere in the last week
+    int64_t to = end - (int64_t)(rng() % (7 * DAY_MS));
+    int64_t from = to - 30 * DAY_MS - (int64_t)(rng() % (60 * DAY_MS));
+
+    int64_t start = benchNowNs();
+    RollupCell cell = store.queryType(DeviceType::Emitter, from, to);
+    typeLatency.push_back((benchNowNs() - start) / 1000.0);
+    checksum += cell.avgCo2();
+
+    uint64_t mac = sim.device(rng() % config.devices).mac;
+    start = benchNowNs();
+    cell = store.queryDevice(mac, from, to);
+    deviceLatency.push_back((benchNowNs() - start) / 1000.0);
+    checksum += cell.creditsSum;
+  }
+  benchDoNotOptimize(checksum);
+
+  state.report("type_query_p50", benchPercentile(typeLatency, 0.50), "us");
+  state.report("type_query_p99", benchPercentile(typeLatency, 0.99), "us");
+  state.report("device_query_p50", benchPercentile(deviceLatency, 0.50), "us");
+  state.report("device_query_p99", benchPercentile(deviceLatency, 0.99), "us");
+}
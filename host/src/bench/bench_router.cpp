@@ -0,0 +1,140 @@
+#include <Bench.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <FastRandom.h>
+#include <TopicRouter.h>
+
+static const int TENANTS = 25000;
+static const char* const CHANNELS[] = {"sensor_data", "alerts", "heartbeat", "commands"};
+
+/**
+ * @brief "cc_" and 64 hex digits, like a firmware API_KEY
+ */
+static std::string apiKey(FastRandom& random) {
+  static const char HEX[] = "0123456789abcdef";
+  std::string key = "cc_";
+  for (int i = 0; i < 64; i++) key += HEX[random.next() & 15];
+  return key;
+}
+
+/**
+ * @brief Filters only: what every message would cost without the trie
+ */
+static bool filterMatches(const std::string& filter, const char* topic, size_t length) {
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    size_t fEnd = filter.find('/', f);
+    if (fEnd == std::string::npos) fEnd = filter.size();
+    if (t > length) return false;
+    const char* slash = (const char*)memchr(topic + t, '/', length - t);
+    size_t tEnd = slash ? (size_t)(slash - topic) : length;
+    bool plus = fEnd - f == 1 && filter[f] == '+';
+    if (!plus && (fEnd - f != tEnd - t || memcmp(filter.data() + f, topic + t, tEnd - t) != 0)) return false;
+    f = fEnd + 1;
+    t = tEnd + 1;
+    if (f > filter.size()) return t > length;
+  }
+  return t > length;
+}
+
+static void countMessage(const TopicMessage& message, void* context) {
+  (*(uint64_t*)context) += message.tag;
+}
+
+BENCHMARK(topic_router) {
+  // 25k tenants x 4 channels on exact filters = 100k subscriptions, plus fleet-wide wildcards
+  FastRandom random(40);
+  std::vector<std::string> keys(TENANTS);
+  for (std::string& key : keys) key = apiKey(random);
+
+  std::vector<std::string> filters;
+  for (int tenant = 0; tenant < TENANTS; tenant++) {
+    const char* prefix = tenant % 2 ? "carbon_emitter" : "carbon_sequester";
+    for (const char* channel : CHANNELS) filters.push_back(std::string(prefix) + "/" + keys[tenant] + "/" + channel);
+  }
+  filters.push_back("carbon_sequester/+/alerts");
+  filters.push_back("carbon_emitter/+/alerts");
+  filters.push_back("carbon_sequester/alerts");
+  filters.push_back("+/+/heartbeat");
+
+  TopicRouter router;
+  int64_t start = benchNowNs();
+  for (size_t i = 0; i < filters.size(); i++) router.subscribe(filters[i].c_str(), (uint32_t)i);
+  int64_t elapsed = benchNowNs() - start;
+  state.report("subscriptions", (double)router.subscriptionCount(), "");
+  state.report("compile_ns_per_filter", (double)elapsed / filters.size(), "ns");
+  state.report("tokens", (double)router.tokenCount(), "");
+  state.report("memory", router.memoryBytes() / 1048576.0, "MiB");
+
+  // Traffic: mostly sensor_data, some heartbeats and alerts, 1% from unknown keys
+  const size_t messages = 1 << 20;
+  std::vector<std::string> topics(4096);
+  for (std::string& topic : topics) {
+    uint32_t pick = random.next();
+    int tenant = (int)(pick % TENANTS);
+    const char* prefix = tenant % 2 ? "carbon_emitter" : "carbon_sequester";
+    const char* channel = (pick >> 20) % 10 < 7 ? "sensor_data" : (pick >> 20) % 10 < 9 ? "heartbeat" : "alerts";
+    std::string key = (pick >> 8) % 100 == 0 ? apiKey(random) : keys[tenant];
+    topic = std::string(prefix) + "/" + key + "/" + channel;
+  }
+
+  uint32_t ids[MAX_DISPATCH];
+  size_t matched = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < messages; i++) {
+    const std::string& topic = topics[i & 4095];
+    matched += router.match(topic.data(), topic.size(), ids, MAX_DISPATCH);
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(matched);
+  state.report("match_ns", (double)elapsed / messages, "ns");
+  state.report("match_per_s", messages * 1e9 / elapsed, "1/s");
+  state.report("matches_per_message", (double)matched / messages, "");
+
+  uint64_t tagSum = 0;
+  router.on(TOPIC_SENSOR_DATA, countMessage, &tagSum);
+  router.on(TOPIC_HEARTBEAT, countMessage, &tagSum);
+  router.on(TOPIC_ALERTS, countMessage, &tagSum);
+  const char payload[] = "{}";
+  start = benchNowNs();
+  for (size_t i = 0; i < messages; i++) {
+    const std::string& topic = topics[i & 4095];
+    router.dispatch(topic.data(), topic.size(), payload, 2);
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(tagSum);
+  state.report("dispatch_ns", (double)elapsed / messages, "ns");
+
+  // The burner's fallback topic only reaches the fleet-wide filter
+  const char fallback[] = "carbon_sequester/alerts";
+  start = benchNowNs();
+  for (size_t i = 0; i < messages; i++) matched += router.match(fallback, sizeof(fallback) - 1, ids, MAX_DISPATCH);
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(matched);
+  state.report("fallback_match_ns", (double)elapsed / messages, "ns");
+
+  // Naive: test every filter against every message
+  const size_t naiveMessages = 256;
+  size_t naiveMatched = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < naiveMessages; i++) {
+    const std::string& topic = topics[i];
+    for (const std::string& filter : filters) naiveMatched += filterMatches(filter, topic.data(), topic.size());
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(naiveMatched);
+  state.report("linear_scan_ns", (double)elapsed / naiveMessages, "ns");
+
+  // Both must agree on the sample
+  size_t trieMatched = 0;
+  for (size_t i = 0; i < naiveMessages; i++) {
+    trieMatched += router.match(topics[i].data(), topics[i].size(), ids, MAX_DISPATCH);
+  }
+  state.report("mismatches", (double)(trieMatched > naiveMatched ? trieMatched - naiveMatched : naiveMatched - trieMatched), "");
+}
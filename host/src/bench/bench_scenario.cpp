@@ -0,0 +1,139 @@
+#include <Bench.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <FastRandom.h>
+#include <Scenario.h>
+
+static const int64_t SAMPLE_INTERVAL_MS = 2000;  // dataUpdateInterval
+
+/**
+ * @brief Load host/scenarios/<name>.ini whether run from host/ or the repository root
+ */
+static bool loadBenchScenario(const char* name, ScenarioConfig& config) {
+  const char* directories[] = {"scenarios/", "host/scenarios/"};
+  for (const char* directory : directories) {
+    if (loadScenarioConfig((std::string(directory) + name + ".ini").c_str(), config)) return true;
+  }
+  fprintf(stderr, "❌ Scenario %s.ini not found, run from host/\n", name);
+  return false;
+}
+
+BENCHMARK(scenario_generate) {
+  ScenarioConfig config;
+  if (!loadBenchScenario("emitter", config)) return;
+
+  const uint32_t devices = 1000000;
+  const int steps = 20;
+  ScenarioBank bank(config, devices, SAMPLE_INTERVAL_MS);
+  std::vector<int> co2(devices), humidity(devices);
+  std::vector<uint8_t> valid(devices);
+
+  int64_t start = benchNowNs();
+  for (int s = 0; s < steps; s++) bank.step(s * SAMPLE_INTERVAL_MS, co2.data(), humidity.data(), valid.data());
+  int64_t elapsed = benchNowNs() - start;
+  benchDoNotOptimize(co2[devices / 2]);
+  state.report("samples_per_s", (double)devices * steps * 1e9 / elapsed, "1/s");
+  state.report("ns_per_sample", (double)elapsed / ((double)devices * steps), "ns");
+
+  // What the firmware did before: two uniform draws per sample
+  FastRandom random(33);
+  start = benchNowNs();
+  for (int s = 0; s < steps; s++) {
+    for (uint32_t i = 0; i < devices; i++) {
+      co2[i] = random.range(800, 3001);
+      humidity[i] = random.range(40, 91);
+    }
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(co2[devices / 2]);
+  state.report("uniform_samples_per_s", (double)devices * steps * 1e9 / elapsed, "1/s");
+}
+
+/**
+ * @brief Signal statistics that matter to caching and deadband filters
+ */
+struct SignalStats {
+  double lag1Correlation;      // CO2 sample to next sample
+  double co2HumidityCorrelation;
+  double deadbandSuppressed;   // % of samples within 25 ppm of the last one sent
+  double missing;              // % of samples lost to outages
+};
+
+static double correlation(double n, double sx, double sy, double sxx, double syy, double sxy) {
+  double cov = sxy / n - (sx / n) * (sy / n);
+  double vx = sxx / n - (sx / n) * (sx / n);
+  double vy = syy / n - (sy / n) * (sy / n);
+  return vx > 0 && vy > 0 ? cov / sqrt(vx * vy) : 0;
+}
+
+static SignalStats measureSignal(const ScenarioConfig* config) {
+  const uint32_t devices = 1000;
+  const int steps = 43200;  // one day at 2 s
+  const int deadbandPpm = 25;
+
+  ScenarioBank bank(config ? *config : ScenarioConfig(), devices, SAMPLE_INTERVAL_MS);
+  FastRandom random(34);
+  std::vector<int> co2(devices), humidity(devices), previous(devices, -1), sent(devices, -100000);
+  std::vector<uint8_t> valid(devices, 1);
+
+  double lagN = 0, lx = 0, ly = 0, lxx = 0, lyy = 0, lxy = 0;
+  double n = 0, cx = 0, cy = 0, cxx = 0, cyy = 0, cxy = 0;
+  uint64_t suppressed = 0, missing = 0, total = 0;
+
+  for (int s = 0; s < steps; s++) {
+    if (config) {
+      bank.step(s * SAMPLE_INTERVAL_MS, co2.data(), humidity.data(), valid.data());
+    } else {
+      for (uint32_t i = 0; i < devices; i++) {
+        co2[i] = random.range(800, 3001);
+        humidity[i] = random.range(40, 91);
+      }
+    }
+    for (uint32_t i = 0; i < devices; i++) {
+      total++;
+      if (!valid[i]) {
+        missing++;
+        previous[i] = -1;
+        continue;
+      }
+      double x = co2[i], y = humidity[i];
+      n++; cx += x; cy += y; cxx += x * x; cyy += y * y; cxy += x * y;
+      if (previous[i] >= 0) {
+        double p = previous[i];
+        lagN++; lx += p; ly += x; lxx += p * p; lyy += x * x; lxy += p * x;
+      }
+      previous[i] = co2[i];
+      if (abs(co2[i] - sent[i]) <= deadbandPpm) suppressed++;
+      else sent[i] = co2[i];
+    }
+  }
+
+  SignalStats stats;
+  stats.lag1Correlation = correlation(lagN, lx, ly, lxx, lyy, lxy);
+  stats.co2HumidityCorrelation = correlation(n, cx, cy, cxx, cyy, cxy);
+  stats.deadbandSuppressed = 100.0 * suppressed / (total - missing);
+  stats.missing = 100.0 * missing / total;
+  return stats;
+}
+
+BENCHMARK(scenario_realism) {
+  // A day of 1000 devices per scenario, against the old uniform readings
+  const char* names[] = {"uniform", "emitter", "sequester", "stress"};
+  for (const char* name : names) {
+    ScenarioConfig config;
+    bool uniform = name == names[0];
+    if (!uniform && !loadBenchScenario(name, config)) return;
+    SignalStats stats = measureSignal(uniform ? nullptr : &config);
+
+    std::string prefix(name);
+    state.report((prefix + "_lag1_corr").c_str(), stats.lag1Correlation, "r");
+    state.report((prefix + "_co2_humidity_corr").c_str(), stats.co2HumidityCorrelation, "r");
+    state.report((prefix + "_deadband_25ppm").c_str(), stats.deadbandSuppressed, "%");
+    state.report((prefix + "_missing").c_str(), stats.missing, "%");
+  }
+}
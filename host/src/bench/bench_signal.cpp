@@ -0,0 +1,129 @@
+#include <Bench.h>
+
+#include <math.h>
+
+#include <vector>
+
+#include <FastRandom.h>
+#include <SignalChain.h>
+
+// Firmware settings: 200 frames/s per pin, one reading every 2 s
+static const uint32_t FRAME_RATE_HZ = 200;
+static const double ADC_NOISE_LSB = 30;    // typical ESP32 single-shot noise
+
+/**
+ * @brief Normally distributed noise (Box-Muller)
+ */
+static double gaussian(FastRandom& random) {
+  double u = (random.next() + 1.0) / 4294967297.0;
+  double v = random.nextFloat();
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/**
+ * @brief Slow signal plus ADC noise, clamped to 12 bits
+ */
+static std::vector<uint16_t> noisyCodes(size_t count, double level, double noise, uint64_t seed) {
+  FastRandom random(seed);
+  std::vector<uint16_t> codes(count);
+  for (size_t i = 0; i < count; i++) {
+    double drift = 300 * sin(2 * M_PI * i / (FRAME_RATE_HZ * 600.0));  // 10 minute cycle
+    double value = level + drift + noise * gaussian(random);
+    codes[i] = (uint16_t)(value < 0 ? 0 : value > 4095 ? 4095 : lround(value));
+  }
+  return codes;
+}
+
+BENCHMARK(signal_chain_throughput) {
+  const size_t count = 1 << 24;
+  std::vector<uint16_t> codes = noisyCodes(count, 2048, ADC_NOISE_LSB, 35);
+  SignalChainConfig config;
+  std::vector<int32_t> out(count / 400 + 2);
+
+  // Blocks, like a DMA buffer drained at once
+  SignalChain chain(config);
+  int64_t start = benchNowNs();
+  size_t written = 0;
+  for (size_t i = 0; i < count; i += 4096) {
+    written += chain.process(&codes[i], 4096, &out[written]);
+  }
+  int64_t elapsed = benchNowNs() - start;
+  benchDoNotOptimize(out[written / 2]);
+  state.report("block_samples_per_s", count * 1e9 / elapsed, "1/s");
+  state.report("block_ns_per_sample", (double)elapsed / count, "ns");
+
+  // One frame at a time, like the firmware's filter task
+  chain.reset();
+  int32_t value = 0, last = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < count; i++) {
+    if (chain.push(codes[i], value)) last = value;
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(last);
+  state.report("push_ns_per_sample", (double)elapsed / count, "ns");
+
+  // Naive: a float FIR of the same span (R*M taps) evaluated at every input sample
+  const size_t taps = chain.decimation();
+  std::vector<float> weights(taps, 1.0f / taps);
+  const size_t naiveCount = count / 64;
+  float sink = 0;
+  start = benchNowNs();
+  for (size_t i = taps; i < naiveCount; i++) {
+    float acc = 0;
+    for (size_t t = 0; t < taps; t++) acc += weights[t] * codes[i - t];
+    sink += acc;
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(sink);
+  state.report("naive_fir_ns_per_sample", (double)elapsed / (naiveCount - taps), "ns");
+}
+
+BENCHMARK(signal_chain_noise) {
+  // Constant level plus noise: what the chain leaves of the noise, and its DC error
+  const double level = 1500.5;
+  const size_t count = FRAME_RATE_HZ * 3600;  // one hour of frames
+  FastRandom random(36);
+  std::vector<uint16_t> codes(count);
+  double rawError = 0;
+  for (size_t i = 0; i < count; i++) {
+    codes[i] = (uint16_t)lround(level + ADC_NOISE_LSB * gaussian(random));
+    rawError += (codes[i] - level) * (codes[i] - level);
+  }
+
+  SignalChain chain;
+  std::vector<int32_t> out(count / chain.decimation() + 2);
+  size_t written = 0;
+  double outError = 0, outSum = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (chain.push(codes[i], out[written])) {
+      double code = chain.lastCode() / (double)(1 << SIGNAL_CODE_FRACTION_BITS);
+      outError += (code - level) * (code - level);
+      outSum += code;
+      written++;
+    }
+  }
+  double rawRms = sqrt(rawError / count);
+  double outRms = sqrt(outError / written);
+  state.report("raw_noise_rms", rawRms, "LSB");
+  state.report("output_noise_rms", outRms, "LSB");
+  state.report("noise_reduction", 20 * log10(rawRms / outRms), "dB");
+  state.report("dc_error", outSum / written - level, "LSB");
+
+  // Step from 1000 to 3000: outputs until within 0.5% and staying there
+  chain.reset();
+  std::vector<uint16_t> low(FRAME_RATE_HZ * 60, 1000);
+  std::vector<uint16_t> high(FRAME_RATE_HZ * 60, 3000);
+  int32_t value = 0;
+  for (uint16_t code : low) chain.push(code, value);
+  int outputs = 0, settled = -1;
+  for (uint16_t code : high) {
+    if (!chain.push(code, value)) continue;
+    outputs++;
+    double code16 = chain.lastCode() / (double)(1 << SIGNAL_CODE_FRACTION_BITS);
+    bool within = fabs(code16 - 3000) <= 15;
+    if (within && settled < 0) settled = outputs;
+    if (!within) settled = -1;
+  }
+  state.report("step_settling", settled * chain.decimation() * 1000.0 / FRAME_RATE_HZ, "ms");
+}
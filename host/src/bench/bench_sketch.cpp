@@ -0,0 +1,139 @@
+#include <Bench.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+
+#include <FleetSim.h>
+#include <QuantileSketch.h>
+#include <SketchRollup.h>
+
+static double exactQuantile(std::vector<int>& values, double q) {
+  size_t rank = (size_t)ceil(q * values.size());
+  if (rank == 0) rank = 1;
+  std::nth_element(values.begin(), values.begin() + (rank - 1), values.end());
+  return values[rank - 1];
+}
+
+BENCHMARK(sketch_accuracy) {
+  // Device windows -> JSON sketches -> merged fleet histogram, against the exact readings
+  FleetSimConfig config;
+  config.devices = 2000;
+  config.sketches = true;
+  FleetSim sim(config);
+
+  LogHistogram co2, humidity;
+  std::vector<int> rawCo2, rawHumidity;
+  SensorWindow window;
+  int64_t timestamp;
+  size_t sketchBytes = 0;
+  const int windows = 200000;
+
+  for (int i = 0; i < windows; i++) {
+    sim.next(window, timestamp);
+    co2.addEncoded(window.co2Sketch, window.co2SketchLength);
+    humidity.addEncoded(window.humiditySketch, window.humiditySketchLength);
+    sketchBytes += window.co2SketchLength + window.humiditySketchLength;
+    rawCo2.insert(rawCo2.end(), sim.lastCo2Readings(), sim.lastCo2Readings() + window.samples);
+    rawHumidity.insert(rawHumidity.end(), sim.lastHumidityReadings(), sim.lastHumidityReadings() + window.samples);
+  }
+
+  const double quantiles[] = {0.50, 0.95, 0.99};
+  const char* names[] = {"p50", "p95", "p99"};
+  double worst = 0;
+  for (int i = 0; i < 3; i++) {
+    double exact = exactQuantile(rawCo2, quantiles[i]);
+    double error = fabs(co2.quantile(quantiles[i]) - exact) / exact * 100;
+    worst = std::max(worst, error);
+    std::string metric = std::string("co2_") + names[i] + "_error";
+    state.report(metric.c_str(), error, "%");
+  }
+  for (int i = 0; i < 3; i++) {
+    double exact = exactQuantile(rawHumidity, quantiles[i]);
+    double error = fabs(humidity.quantile(quantiles[i]) - exact) / exact * 100;
+    worst = std::max(worst, error);
+    std::string metric = std::string("humidity_") + names[i] + "_error";
+    state.report(metric.c_str(), error, "%");
+  }
+  state.report("worst_relative_error", worst, "%");
+  state.report("sketch_bytes_per_window", (double)sketchBytes / windows, "B");
+}
+
+BENCHMARK(sketch_merge) {
+  // A day of hourly cells for 100 series, merged repeatedly
+  const int histograms = 2400;
+  std::vector<LogHistogram> sources(histograms);
+  std::mt19937_64 rng(11);
+  for (LogHistogram& histogram : sources) {
+    for (int i = 0; i < 500; i++) histogram.add(300 + (int)(rng() % 2700));
+  }
+  std::vector<const LogHistogram*> pointers;
+  for (const LogHistogram& histogram : sources) pointers.push_back(&histogram);
+
+  const int rounds = 200;
+  double bytes = (double)rounds * histograms * sizeof(LogHistogram);
+  LogHistogram dst;
+
+  int64_t start = benchNowNs();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < histograms; i++) {
+      sketchMergeCountsScalar(dst.counts, sources[i].counts, SKETCH_BUCKETS);
+    }
+    benchDoNotOptimize(dst.counts[r % SKETCH_BUCKETS]);
+  }
+  int64_t scalar = benchNowNs() - start;
+
+  start = benchNowNs();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < histograms; i++) {
+      sketchMergeCountsSimd(dst.counts, sources[i].counts, SKETCH_BUCKETS);
+    }
+    benchDoNotOptimize(dst.counts[r % SKETCH_BUCKETS]);
+  }
+  int64_t simd = benchNowNs() - start;
+
+  start = benchNowNs();
+  for (int r = 0; r < rounds; r++) {
+    sketchMergeMany(dst, pointers.data(), pointers.size());
+    benchDoNotOptimize(dst.counts[r % SKETCH_BUCKETS]);
+  }
+  int64_t many = benchNowNs() - start;
+
+  // LogHistogram::merge() runs the scalar loop unless built with -DSKETCH_SIMD_MERGE
+  state.report("scalar_merges_per_second", rounds * histograms * 1e9 / scalar, "merge/s");
+  state.report("simd_merges_per_second", rounds * histograms * 1e9 / simd, "merge/s");
+  state.report("merge_many_per_second", rounds * histograms * 1e9 / many, "merge/s");
+  state.report("merge_many_bandwidth", bytes / many, "GB/s");
+}
+
+BENCHMARK(sketch_fleet_query) {
+  // 30 days of sketches for 500 devices, then a 30-day percentile query
+  FleetSimConfig config;
+  config.devices = 500;
+  config.publishIntervalMs = 5 * 60 * 1000;
+  config.sketches = true;
+  FleetSim sim(config);
+
+  SketchRollup rollup;
+  SensorWindow window;
+  int64_t timestamp = 0;
+  int64_t end = config.startMs + 30LL * 24 * 60 * 60 * 1000;
+  while (true) {
+    sim.next(window, timestamp);
+    if (timestamp >= end) break;
+    rollup.ingest(window, timestamp);
+  }
+
+  std::vector<double> latency;
+  for (int i = 0; i < 200; i++) {
+    LogHistogram co2, humidity;
+    int64_t start = benchNowNs();
+    rollup.query(DeviceType::Emitter, config.startMs + i * 60000LL, end, co2, humidity);
+    QuantileSummary summary = SketchRollup::summarize(co2);
+    latency.push_back((benchNowNs() - start) / 1000.0);
+    benchDoNotOptimize(summary.p99);
+  }
+  state.report("query_30d_p50", benchPercentile(latency, 0.50), "us");
+  state.report("query_30d_p99", benchPercentile(latency, 0.99), "us");
+}
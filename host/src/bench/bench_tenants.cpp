@@ -0,0 +1,240 @@
+#include <Bench.h>
+
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <FastRandom.h>
+#include <TenantKeys.h>
+
+static const size_t TENANT_KEYS = 1 << 20;
+
+static std::string keyText(FastRandom& random) {
+  static const char HEX[] = "0123456789abcdef";
+  std::string text = "cc_";
+  for (int i = 0; i < 64; i++) text += HEX[random.next() & 15];
+  return text;
+}
+
+static std::unique_ptr<TenantIndex> buildIndex(const std::vector<TenantKeyEntry>& entries) {
+  std::unique_ptr<TenantIndex> index(new TenantIndex());
+  index->build(entries);
+  return index;
+}
+
+BENCHMARK(tenant_keys) {
+  FastRandom random(41);
+  std::vector<std::string> texts(TENANT_KEYS);
+  std::vector<TenantKeyEntry> entries(TENANT_KEYS);
+  for (size_t i = 0; i < TENANT_KEYS; i++) {
+    texts[i] = keyText(random);
+    parseApiKey(texts[i].data(), texts[i].size(), entries[i].key);
+    entries[i].record.tenant = (uint32_t)i;
+    entries[i].record.deviceSet = (uint32_t)(i % 97);
+  }
+
+  int64_t start = benchNowNs();
+  TenantIndex index;
+  index.build(entries);
+  int64_t elapsed = benchNowNs() - start;
+  state.report("keys", (double)index.size(), "");
+  state.report("build", elapsed / 1e6, "ms");
+  state.report("pilot_bits_per_key", index.pilotBitsPerKey(), "bit");
+  state.report("memory", index.memoryBytes() / 1048576.0, "MiB");
+
+  // Topic keys in arrival order: random tenants, 1% unknown
+  const size_t lookups = 1 << 22;
+  std::vector<std::string> traffic(1 << 16);
+  for (std::string& text : traffic) {
+    text = random.next() % 100 == 0 ? keyText(random) : texts[random.next() % TENANT_KEYS];
+  }
+
+  size_t authorized = 0;
+  uint32_t tenantSum = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < lookups; i++) {
+    const std::string& text = traffic[i & 0xFFFF];
+    const TenantRecord* record = index.find(text.data(), text.size());
+    if (record) {
+      authorized++;
+      tenantSum += record->tenant;
+    }
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(tenantSum);
+  state.report("lookup_ns", (double)elapsed / lookups, "ns");
+  state.report("lookups_per_s", lookups * 1e9 / elapsed, "1/s");
+  state.report("authorized_pct", 100.0 * authorized / lookups, "%");
+
+  // Key text must map back to its own tenant
+  size_t wrong = 0;
+  for (size_t i = 0; i < TENANT_KEYS; i += 97) {
+    const TenantRecord* record = index.find(texts[i].data(), texts[i].size());
+    wrong += !record || record->tenant != i;
+  }
+  state.report("wrong_tenant", (double)wrong, "");
+
+  // Hex decode alone
+  ApiKey key;
+  uint32_t sink = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < lookups; i++) {
+    const std::string& text = traffic[i & 0xFFFF];
+    parseApiKey(text.data(), text.size(), key);
+    sink += key.bytes[i & 31];
+  }
+  elapsed = benchNowNs() - start;
+  state.report("decode_ns", (double)elapsed / lookups, "ns");
+  start = benchNowNs();
+  for (size_t i = 0; i < lookups; i++) {
+    const std::string& text = traffic[i & 0xFFFF];
+    parseApiKeyScalar(text.data(), text.size(), key);
+    sink += key.bytes[i & 31];
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(sink);
+  state.report("decode_scalar_ns", (double)elapsed / lookups, "ns");
+
+  // Baseline: the key text in a hash map
+  std::unordered_map<std::string, TenantRecord> map;
+  map.reserve(TENANT_KEYS);
+  for (size_t i = 0; i < TENANT_KEYS; i++) map.emplace(texts[i], entries[i].record);
+  tenantSum = 0;
+  start = benchNowNs();
+  for (size_t i = 0; i < lookups; i++) {
+    auto it = map.find(traffic[i & 0xFFFF]);
+    if (it != map.end()) tenantSum += it->second.tenant;
+  }
+  elapsed = benchNowNs() - start;
+  benchDoNotOptimize(tenantSum);
+  state.report("unordered_map_ns", (double)elapsed / lookups, "ns");
+}
+
+BENCHMARK(tenant_keys_reload) {
+  // A reader keeps authorizing while the key list is rebuilt and swapped in
+  const size_t keys = 1 << 18;
+  FastRandom random(42);
+  std::vector<std::string> texts(keys);
+  std::vector<TenantKeyEntry> entries(keys);
+  for (size_t i = 0; i < keys; i++) {
+    texts[i] = keyText(random);
+    parseApiKey(texts[i].data(), texts[i].size(), entries[i].key);
+    entries[i].record.tenant = (uint32_t)i;
+  }
+
+  TenantDirectory directory;
+  directory.publish(buildIndex(entries));
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> lookups{0}, misses{0};
+  std::atomic<int64_t> worstGapNs{0};
+  std::thread reader([&] {
+    int id = directory.registerReader();
+    uint64_t done = 0, missed = 0;
+    int64_t last = benchNowNs(), worst = 0;
+    FastRandom pick(7);
+    while (!stop.load(std::memory_order_relaxed)) {
+      // A batch of messages between quiescent points, like a worker's loop
+      for (int i = 0; i < 256; i++) {
+        const std::string& text = texts[pick.next() % keys];
+        missed += directory.find(text.data(), text.size()) == nullptr;
+      }
+      done += 256;
+      directory.quiescent(id);
+      int64_t now = benchNowNs();
+      if (now - last > worst) worst = now - last;
+      last = now;
+    }
+    directory.offline(id);
+    lookups = done;
+    misses = missed;
+    worstGapNs = worst;
+  });
+
+  const int reloads = 8;
+  int64_t buildNs = 0, swapNs = 0;
+  int64_t start = benchNowNs();
+  for (int r = 0; r < reloads; r++) {
+    // Same keys, new tenant numbering: a reader must always find every key
+    for (TenantKeyEntry& entry : entries) entry.record.tenant++;
+    int64_t t0 = benchNowNs();
+    std::unique_ptr<TenantIndex> next = buildIndex(entries);
+    int64_t t1 = benchNowNs();
+    directory.publish(std::move(next));
+    int64_t t2 = benchNowNs();
+    buildNs += t1 - t0;
+    swapNs += t2 - t1;
+  }
+  stop = true;
+  reader.join();
+  int64_t elapsed = benchNowNs() - start;
+
+  state.report("reloads", (double)directory.reloads() - 1, "");
+  state.report("build_ms", buildNs / 1e6 / reloads, "ms");
+  state.report("swap_grace_us", swapNs / 1e3 / reloads, "us");
+  state.report("reader_lookups_per_s", lookups * 1e9 / elapsed, "1/s");
+  state.report("reader_misses", (double)misses, "");
+  state.report("reader_worst_batch_gap_us", worstGapNs / 1e3, "us");
+}
+
+BENCHMARK(tenant_keys_offline_stress) {
+  // Readers that go offline between every few lookups (a worker blocked on its queue)
+  // while the index is swapped as fast as it can be built; a reader coming back online
+  // must never look into an index publish() has already freed. Under
+  // -fsanitize=address that shows up as a use-after-free, otherwise as wrong tenants.
+  const size_t keys = 256;
+  const int readerThreads = 4;
+  const int reloads = 500;
+  FastRandom random(43);
+  std::vector<std::string> texts(keys);
+  std::vector<TenantKeyEntry> entries(keys);
+  for (size_t i = 0; i < keys; i++) {
+    texts[i] = keyText(random);
+    parseApiKey(texts[i].data(), texts[i].size(), entries[i].key);
+    entries[i].record.tenant = (uint32_t)i;
+  }
+
+  TenantDirectory directory;
+  directory.publish(buildIndex(entries));
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> cycles{0}, wrong{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < readerThreads; t++) {
+    readers.emplace_back([&, t] {
+      int id = directory.registerReader();
+      directory.offline(id);
+      FastRandom pick(100 + t);
+      uint64_t done = 0, bad = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        directory.quiescent(id);
+        for (int i = 0; i < 4; i++) {
+          size_t key = pick.next() % keys;
+          const TenantRecord* record = directory.find(texts[key].data(), texts[key].size());
+          bad += record == nullptr || record->tenant % keys != key;
+        }
+        directory.offline(id);
+        done++;
+      }
+      cycles += done;
+      wrong += bad;
+    });
+  }
+
+  // Each generation numbers the tenants generation * keys + i
+  int64_t start = benchNowNs();
+  for (int r = 1; r <= reloads; r++) {
+    for (size_t i = 0; i < keys; i++) entries[i].record.tenant = (uint32_t)(r * keys + i);
+    directory.publish(buildIndex(entries));
+  }
+  stop = true;
+  for (std::thread& reader : readers) reader.join();
+  double seconds = (benchNowNs() - start) / 1e9;
+
+  state.report("reloads_per_s", reloads / seconds, "1/s");
+  state.report("reader_online_cycles", (double)cycles, "");
+  state.report("wrong_lookups", (double)wrong, "");
+  if (wrong != 0) state.fail("a reader coming back online looked up a freed or wrong index");
+}
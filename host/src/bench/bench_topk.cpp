@@ -0,0 +1,90 @@
+#include <Bench.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <HeavyHitters.h>
+
+BENCHMARK(topk_emitters) {
+  // 100k emitters, Zipf-skewed credits needed, one window per 15 s each
+  const uint32_t devices = 100000;
+  const int rounds = 20;
+  const int64_t publishIntervalMs = 15000;
+  const int64_t startMs = 1735689600000LL;
+
+  std::vector<uint64_t> macs(devices);
+  std::vector<double> scale(devices);
+  std::mt19937_64 rng(28);
+  for (uint32_t i = 0; i < devices; i++) {
+    macs[i] = rng() & 0xFFFFFFFFFFFFULL;
+    scale[i] = 1.0 / pow(i + 1, 1.1);
+  }
+  std::uniform_real_distribution<double> jitter(0.5, 1.5);
+
+  TopEmitters top;
+  std::unordered_map<uint64_t, double> exact;
+  int64_t updateNs = 0;
+  int64_t lastMs = startMs;
+
+  for (int r = 0; r < rounds; r++) {
+    for (uint32_t i = 0; i < devices; i++) {
+      int64_t timestamp = startMs + r * publishIntervalMs + publishIntervalMs * i / devices;
+      double credits = 2400.0 * scale[i] * jitter(rng);
+      // Within 5 min of data the 5 min window holds everything fed so far
+      exact[macs[i]] += credits;
+
+      int64_t start = benchNowNs();
+      top.add(macs[i], credits, timestamp);
+      updateNs += benchNowNs() - start;
+      lastMs = timestamp;
+    }
+  }
+  double updates = (double)rounds * devices;
+  state.report("update_ns", (double)updateNs / updates, "ns");
+  state.report("updates_per_s", updates / (updateNs / 1e9), "1/s");
+
+  top.publish(lastMs);
+  TopKSnapshot snapshot = top.snapshot(TOP_WINDOW_5_MIN);
+
+  std::vector<std::pair<double, uint64_t>> ranked;
+  for (const auto& entry : exact) ranked.push_back({entry.second, entry.first});
+  std::partial_sort(ranked.begin(), ranked.begin() + TOP_K, ranked.end(), std::greater<std::pair<double, uint64_t>>());
+  std::unordered_set<uint64_t> truth;
+  for (int i = 0; i < TOP_K; i++) truth.insert(ranked[i].second);
+
+  int hits = 0;
+  double worstError = 0;
+  for (uint32_t i = 0; i < snapshot.count; i++) {
+    if (truth.count(snapshot.entries[i].key)) hits++;
+    double actual = exact[snapshot.entries[i].key];
+    worstError = std::max(worstError, fabs(snapshot.entries[i].weight - actual) / actual * 100);
+  }
+  state.report("recall_at_32", 100.0 * hits / TOP_K, "%");
+  state.report("worst_weight_error", worstError, "%");
+
+  // Dashboard reads while the ingest thread keeps publishing
+  std::atomic<bool> stop(false);
+  std::thread writer([&]() {
+    int64_t timestamp = lastMs;
+    while (!stop.load(std::memory_order_relaxed)) top.publish(timestamp += 1000);
+  });
+  const int reads = 200000;
+  std::vector<double> readNs;
+  readNs.reserve(reads);
+  for (int i = 0; i < reads; i++) {
+    int64_t start = benchNowNs();
+    TopKSnapshot read = top.snapshot(TOP_WINDOW_1_HOUR);
+    readNs.push_back(benchNowNs() - start);
+    benchDoNotOptimize(read);
+  }
+  stop = true;
+  writer.join();
+  state.report("snapshot_read_p50_ns", benchPercentile(readNs, 0.50), "ns");
+  state.report("snapshot_read_p99_ns", benchPercentile(readNs, 0.99), "ns");
+}
@@ -0,0 +1,172 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include <ClockSync.h>
+#include <FleetSim.h>
+#include <MiniBroker.h>
+#include <Telemetry.h>
+
+/*
+ * Stand-in MQTT broker for load tests
+ *
+ * Serves MQTT 3.1.1 / 5 on --port like the dockerized mosquitto, without its
+ * connection limit. With --fleet it also runs FleetSim in the same process
+ * and publishes the fleet's sensor_data windows straight into the broker:
+ *
+ *   .pio/build/broker/program --port 1883 --fleet 10000 --speed 10
+ *
+ * --speed runs simulated time faster than the wall clock (0: as fast as possible).
+ * Simulated devices report synced Unix time only at --speed 1.
+ *
+ * --ntp <port> also answers SNTP requests from this host's clock, a local
+ * stand-in for pool.ntp.org (point NTP_SERVER/NTP_SERVER_PORT at it).
+ */
+
+const int64_t REPORT_INTERVAL_MS = 10000;
+const char* FLEET_API_KEY = "fleet";
+
+static int64_t steadyMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int64_t wallClockUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Answer SNTP requests on a UDP port with the host clock
+ */
+void runNtpServer(int fd) {
+  uint8_t request[NTP_PACKET_BYTES * 2];
+  uint8_t reply[NTP_PACKET_BYTES];
+  while (true) {
+    sockaddr_in from = {};
+    socklen_t fromLength = sizeof(from);
+    ssize_t n = recvfrom(fd, request, sizeof(request), 0, (sockaddr*)&from, &fromLength);
+    int64_t receiveUs = wallClockUs();
+    if (n < 0) continue;
+    if (!formatNtpReply(request, (size_t)n, receiveUs, wallClockUs(), 2, reply)) continue;
+    sendto(fd, reply, sizeof(reply), 0, (sockaddr*)&from, fromLength);
+  }
+}
+
+static int openNtpSocket(const char* bindAddress, uint16_t port) {
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  if (inet_pton(AF_INET, bindAddress, &address.sin_addr) != 1 || bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Publish the simulated fleet's windows at simulated-time pace
+ */
+void runFleet(MiniBroker& broker, uint32_t devices, double speed) {
+  FleetSimConfig config;
+  config.devices = devices;
+  config.sketches = true;
+  config.startMs = wallClockUs() / 1000;
+  config.timeSynced = speed == 1;
+  FleetSim sim(config);
+
+  SensorWindow window;
+  int64_t timestamp = 0;
+  char payload[1024];
+  char topic[100];
+  int64_t startMs = steadyMs();
+  while (true) {
+    sim.next(window, timestamp);
+    if (speed > 0) {
+      int64_t dueMs = startMs + (int64_t)((timestamp - config.startMs) / speed);
+      int64_t waitMs = dueMs - steadyMs();
+      if (waitMs > 0) {
+        struct timespec pause = {(time_t)(waitMs / 1000), (long)(waitMs % 1000) * 1000000L};
+        nanosleep(&pause, nullptr);
+      }
+    }
+    int length = formatSensorWindow(window, payload, sizeof(payload));
+    if (length <= 0 || length >= (int)sizeof(payload)) continue;
+    const char* prefix = window.type == DeviceType::Emitter ? "carbon_emitter" : "carbon_sequester";
+    snprintf(topic, sizeof(topic), "%s/%s/sensor_data", prefix, FLEET_API_KEY);
+    broker.publish(topic, (const uint8_t*)payload, length);
+  }
+}
+
+int main(int argc, char** argv) {
+  MiniBrokerConfig config;
+  config.bindAddress = "0.0.0.0";
+  config.port = 1883;
+  uint32_t fleet = 0;
+  double speed = 1;
+  int ntpPort = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) config.port = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) config.bindAddress = argv[++i];
+    else if (strcmp(argv[i], "--fleet") == 0 && i + 1 < argc) fleet = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+    else if (strcmp(argv[i], "--ntp") == 0 && i + 1 < argc) ntpPort = atoi(argv[++i]);
+  }
+
+  MiniBroker broker(config);
+  if (!broker.start()) {
+    fprintf(stderr, "❌ Could not listen on %s:%u\n", config.bindAddress, config.port);
+    return 1;
+  }
+  printf("✅ Broker listening on %s:%u\n", config.bindAddress, broker.port());
+  fflush(stdout);
+
+  if (ntpPort > 0) {
+    int ntpFd = openNtpSocket(config.bindAddress, (uint16_t)ntpPort);
+    if (ntpFd < 0) {
+      fprintf(stderr, "❌ Could not bind NTP on %s:%d\n", config.bindAddress, ntpPort);
+      return 1;
+    }
+    std::thread(runNtpServer, ntpFd).detach();
+    printf("🕒 NTP stand-in on %s:%d\n", config.bindAddress, ntpPort);
+  }
+
+  std::thread fleetThread;
+  if (fleet > 0) {
+    fleetThread = std::thread(runFleet, std::ref(broker), fleet, speed);
+    printf("🚗 Simulating %u devices at %.1fx\n", fleet, speed);
+  }
+
+  MiniBrokerStats last = broker.stats();
+  int64_t lastReport = steadyMs();
+  while (true) {
+    broker.poll(100);
+    int64_t now = steadyMs();
+    if (now - lastReport < REPORT_INTERVAL_MS) continue;
+
+    MiniBrokerStats stats = broker.stats();
+    double seconds = (now - lastReport) / 1000.0;
+    printf("📊 %llu connections, %.0f msg/s in, %.0f msg/s out, %.1f MB/s out, %llu dropped, "
+           "%llu stored sessions, %llu resumed\n",
+           (unsigned long long)stats.connections,
+           (stats.messagesIn - last.messagesIn) / seconds,
+           (stats.messagesOut - last.messagesOut) / seconds,
+           (stats.bytesOut - last.bytesOut) / seconds / 1e6,
+           (unsigned long long)stats.messagesDropped,
+           (unsigned long long)stats.sessionsStored,
+           (unsigned long long)stats.sessionsResumed);
+    fflush(stdout);
+    last = stats;
+    lastReport = now;
+  }
+}
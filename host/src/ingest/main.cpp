@@ -0,0 +1,480 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <HeavyHitters.h>
+#include <IngestPool.h>
+#include <LastValueCache.h>
+#include <MqttClient.h>
+#include <PushServer.h>
+#include <Rollup.h>
+#include <SketchRollup.h>
+#include <Telemetry.h>
+#include <TenantKeys.h>
+#include <TopicRouter.h>
+
+/*
+ * Ingest consumer
+ *
+ * Reads "<topic> <length> <payload>" records as printed by
+ * `mosquitto_sub -F '%t %l %p'`, e.g.
+ *
+ *   mosquitto_sub -h localhost -F '%t %l %p' -t 'carbon_sequester/+/sensor_data' \
+ *                 -t 'carbon_emitter/+/sensor_data' | .pio/build/ingest/program
+ *
+ * The length keeps framed (LZSS) payloads intact, binary as they are. Plain
+ * "<topic> <payload>" lines from `mosquitto_sub -v` still work for JSON
+ * payloads, but cut a framed one at its first newline byte.
+ *
+ * and keeps multi-resolution rollups per device and per device type, fleet
+ * CO2 / humidity percentiles from the windows' quantile sketches, and the
+ * worst emitters by credits needed over 5 min, 1 h and 24 h. The latest
+ * window and heartbeat of every device are kept in a last-value cache;
+ * --snapshot <file> writes it out every second for dashboards, and
+ * --push <port> streams it to them as Server-Sent Events (see PushServer).
+ *
+ * With --host it subscribes itself, as a pool of workers sharing one MQTT 5
+ * shared subscription ($share/<group>/...). The broker splits the stream
+ * across the workers, and IngestPool hands each window to the worker that
+ * owns its device:
+ *
+ *   .pio/build/ingest/program --host localhost --workers 8 --group ingest
+ *
+ * Several processes with the same --group split the stream the same way,
+ * but each keeps its own devices' state only for what it received.
+ *
+ * With --keys <file> only API keys listed there are accepted; SIGHUP
+ * reloads the file without stopping the workers.
+ */
+
+// Fleet summary cadence
+const int64_t REPORT_INTERVAL_MS = 60000;
+// Worst emitters printed per window in the summary
+const int TOP_EMITTERS_SHOWN = 5;
+
+const char* const INGEST_TOPICS[] = {"carbon_sequester/+/sensor_data", "carbon_emitter/+/sensor_data",
+                                     "carbon_sequester/+/heartbeat", "carbon_emitter/+/heartbeat"};
+const uint32_t MAX_CACHED_DEVICES = 1 << 18;
+const int64_t SNAPSHOT_INTERVAL_MS = 1000;
+// Largest payload read from stdin; anything beyond is skipped
+const size_t MAX_STDIN_PAYLOAD = 1 << 20;
+// Each worker republishes its shard's top emitters this often; the summary reads them lock-free
+const int64_t TOP_PUBLISH_INTERVAL_MS = 1000;
+const int64_t RECONNECT_INTERVAL_MS = 5000;
+const int WORKER_POLL_MS = 20;
+const int MAX_WORKERS = 64;
+
+/**
+ * @brief What the topic handlers work on
+ */
+struct IngestContext {
+  IngestPool* pool = nullptr;
+  TenantDirectory* tenants = nullptr;   // nullptr accepts every key
+  LastValueCache* lastValues = nullptr;
+  std::atomic<uint64_t> unauthorized{0};
+};
+
+static volatile sig_atomic_t reloadRequested = 0;
+
+static void onHangup(int) {
+  reloadRequested = 1;
+}
+
+/**
+ * @brief How the MQTT workers connect
+ */
+struct WorkerConfig {
+  const char* host = nullptr;
+  int port = 1883;
+  const char* group = "ingest";
+  uint8_t protocolVersion = MQTT_VERSION_5;
+};
+
+static int64_t wallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool authorized(IngestContext& ingest, const TopicMessage& message) {
+  if (!ingest.tenants || ingest.tenants->find(message.apiKey, message.apiKeyLength)) return true;
+  ingest.unauthorized.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+/**
+ * @brief sensor_data handler: parse the window(s) and queue each for the worker that owns the device
+ */
+static void onSensorData(const TopicMessage& message, void* context) {
+  IngestContext& ingest = *(IngestContext*)context;
+  if (!authorized(ingest, message)) return;
+  // Placed at the device's "t" when its clock is synced, else at arrival less the backlog age
+  static thread_local std::vector<char> scratch;
+  int windows = forEachSensorWindow(message.payload, message.length, wallClockMs(), scratch,
+                                    [&](const SensorWindow& window, int64_t timestampMs) {
+    ingest.lastValues->update(window, timestampMs);
+    ingest.pool->route(window, timestampMs);
+  });
+  if (windows < 0) {
+    ingest.pool->countRejected(1);
+    fprintf(stderr, "❌ Rejected payload on %.*s\n", (int)message.topicLength, message.topic);
+  }
+}
+
+/**
+ * @brief heartbeat handler: only the last-value cache keeps heartbeats
+ */
+static void onHeartbeat(const TopicMessage& message, void* context) {
+  IngestContext& ingest = *(IngestContext*)context;
+  if (!authorized(ingest, message)) return;
+  Heartbeat heartbeat;
+  if (!parseHeartbeat(message.payload, message.length, heartbeat)) {
+    ingest.pool->countRejected(1);
+    fprintf(stderr, "❌ Rejected payload on %.*s\n", (int)message.topicLength, message.topic);
+    return;
+  }
+  ingest.lastValues->update(heartbeat, message.deviceType, wallClockMs());
+}
+
+/**
+ * @brief Topics this consumer handles; other messages on the subscription are ignored
+ */
+static void setupRouter(TopicRouter& router, IngestContext& context) {
+  for (const char* topic : INGEST_TOPICS) router.subscribe(topic, 0);
+  router.on(TOPIC_SENSOR_DATA, onSensorData, &context);
+  router.on(TOPIC_HEARTBEAT, onHeartbeat, &context);
+}
+
+/**
+ * @brief Write the last-value snapshot beside path, then rename it into place
+ */
+static void writeSnapshot(const LastValueCache& lastValues, const char* path, std::vector<uint8_t>& buffer,
+                          int64_t nowMs) {
+  size_t bytes = lastValues.snapshot(buffer, nowMs);
+  char temporary[512];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+  FILE* file = fopen(temporary, "wb");
+  if (!file) return;
+  bool written = fwrite(buffer.data(), 1, bytes, file) == bytes;
+  if (fclose(file) == 0 && written) rename(temporary, path);
+}
+
+/**
+ * @brief Rebuild the key index from the file and swap it in
+ */
+static bool loadKeys(TenantDirectory& tenants, const char* path) {
+  std::vector<TenantKeyEntry> entries;
+  std::unique_ptr<TenantIndex> index(new TenantIndex());
+  if (!loadTenantKeys(path, entries) || !index->build(entries)) {
+    fprintf(stderr, "❌ Could not load tenant keys from %s, keeping the current ones\n", path);
+    return false;
+  }
+  tenants.publish(std::move(index));
+  printf("🔑 %zu tenant keys loaded from %s\n", entries.size(), path);
+  fflush(stdout);
+  return true;
+}
+
+/**
+ * @brief Print the last hour and last day for every device type
+ */
+void printFleetSummary(IngestContext& context, int64_t nowMs) {
+  IngestPool& pool = *context.pool;
+  SequenceDedupeStats dedupe = pool.dedupeStats();
+  printf("📊 %llu messages ingested, %llu rejected, %llu unauthorized, %llu duplicates, %llu handed to another worker, %zu devices\n",
+         (unsigned long long)pool.ingested(), (unsigned long long)pool.rejected(),
+         (unsigned long long)context.unauthorized.load(), (unsigned long long)(dedupe.duplicates + dedupe.stale),
+         (unsigned long long)pool.routedAway(), pool.deviceCount());
+
+  // Current state of the fleet, straight from the last-value cache
+  const LastValueCache& lastValues = *context.lastValues;
+  uint32_t devices = lastValues.deviceCount(), online = 0, offset = 0, withRssi = 0;
+  double rssiSum = 0;
+  std::vector<DeviceLastValue> rows(1024);
+  for (uint32_t first = 0; first < devices; first += rows.size()) {
+    uint32_t count = std::min<uint32_t>(rows.size(), devices - first);
+    lastValues.readRange(first, count, rows.data());
+    for (uint32_t i = 0; i < count; i++) {
+      online += (rows[i].flags & LAST_VALUE_ONLINE) != 0;
+      offset += rows[i].offset();
+      if (rows[i].flags & LAST_VALUE_HAS_HEARTBEAT) {
+        rssiSum += rows[i].rssi;
+        withRssi++;
+      }
+    }
+  }
+  printf("🗂️  %u devices cached, %u online, %u offset, mean RSSI %.0f dBm\n",
+         devices, online, offset, withRssi ? rssiSum / withRssi : 0.0);
+
+  for (int t = 1; t < DEVICE_TYPE_COUNT; t++) {
+    DeviceType type = (DeviceType)t;
+    RollupCell hour = pool.queryType(type, nowMs - ROLLUP_WIDTH_MS[ROLLUP_HOUR], nowMs);
+    RollupCell day = pool.queryType(type, nowMs - ROLLUP_WIDTH_MS[ROLLUP_DAY], nowMs);
+    printf("   %-9s 1h: windows=%u avg_c=%.1f max_c=%u cr=%.1f | 24h: windows=%u avg_c=%.1f cr=%.1f\n",
+           deviceTypeName(type), hour.windows, hour.avgCo2(), hour.maxCo2, hour.creditsSum,
+           day.windows, day.avgCo2(), day.creditsSum);
+
+    LogHistogram co2, humidity;
+    pool.queryQuantiles(type, nowMs - ROLLUP_WIDTH_MS[ROLLUP_DAY], nowMs, co2, humidity);
+    QuantileSummary co2Summary = SketchRollup::summarize(co2);
+    QuantileSummary humiditySummary = SketchRollup::summarize(humidity);
+    if (co2Summary.samples > 0) {
+      printf("   %-9s 24h CO2 p50/p95/p99=%.0f/%.0f/%.0f ppm, humidity p50/p95/p99=%.0f/%.0f/%.0f %%\n",
+             "", co2Summary.p50, co2Summary.p95, co2Summary.p99,
+             humiditySummary.p50, humiditySummary.p95, humiditySummary.p99);
+    }
+  }
+
+  const char* windowNames[TOP_WINDOW_COUNT] = {"5m", "1h", "24h"};
+  for (int w = 0; w < TOP_WINDOW_COUNT; w++) {
+    TopKSnapshot top = pool.topEmitters((TopWindow)w);
+    if (top.count == 0) continue;
+    printf("🔥 Top emitters %s:", windowNames[w]);
+    for (uint32_t i = 0; i < top.count && i < TOP_EMITTERS_SHOWN; i++) {
+      char mac[18];
+      formatMacAddress(top.entries[i].key, mac);
+      printf(" %s cr=%.0f", mac, top.entries[i].weight);
+    }
+    printf("\n");
+  }
+  fflush(stdout);
+}
+
+/**
+ * @brief Next record from stdin: "<topic> <length> <payload>\n", or a "<topic> <payload>" line
+ *
+ * The topic comes first in record, the payload right after it, NUL-terminated.
+ * @return false at the end of input
+ */
+static bool readStdinRecord(std::vector<char>& record, size_t& topicLength, size_t& payloadLength) {
+  while (true) {
+    record.clear();
+    int c;
+    while ((c = getc(stdin)) != EOF && c != ' ' && c != '\n') record.push_back((char)c);
+    if (c == EOF) return false;
+    if (c == '\n') continue;  // no payload
+    topicLength = record.size();
+
+    // A length and a space: exactly that many bytes follow, newlines and NULs included
+    size_t length = 0, digits = 0;
+    while ((c = getc(stdin)) >= '0' && c <= '9' && digits < 10) {
+      record.push_back((char)c);
+      length = length * 10 + (c - '0');
+      digits++;
+    }
+    if (digits > 0 && c == ' ') {
+      record.resize(topicLength);
+      bool fits = length <= MAX_STDIN_PAYLOAD;
+      record.resize(topicLength + (fits ? length : 0));
+      if (fits && fread(record.data() + topicLength, 1, length, stdin) != length) return false;
+      if (!fits) {
+        for (size_t i = 0; i < length && getc(stdin) != EOF; i++) {}
+      }
+      if ((c = getc(stdin)) != '\n' && c != EOF) ungetc(c, stdin);
+      if (!fits) continue;
+    } else {
+      // `mosquitto_sub -v`: the payload is the rest of the line
+      while (c != EOF && c != '\n') {
+        if (record.size() - topicLength < MAX_STDIN_PAYLOAD) record.push_back((char)c);
+        c = getc(stdin);
+      }
+      if (record.size() > topicLength && record.back() == '\r') record.pop_back();
+    }
+
+    payloadLength = record.size() - topicLength;
+    record.push_back('\0');
+    return true;
+  }
+}
+
+/**
+ * @brief Ingest `mosquitto_sub -F '%t %l %p'` records (or `-v` lines) from stdin, single-threaded
+ */
+int runStdin(IngestContext& context, const char* keysPath, const char* snapshotPath) {
+  IngestPool& pool = *context.pool;
+  IngestPool::setWorkerShard(0);
+  TopicRouter router;
+  setupRouter(router, context);
+  std::vector<char> record;
+  size_t topicLength, payloadLength;
+  int64_t lastReport = wallClockMs();
+  int64_t lastSnapshot = lastReport;
+  std::vector<uint8_t> snapshot;
+
+  while (readStdinRecord(record, topicLength, payloadLength)) {
+    const char* topic = record.data();
+    const char* payload = topic + topicLength;
+
+    // No other reader, so the swap completes right away
+    if (reloadRequested) {
+      reloadRequested = 0;
+      loadKeys(*context.tenants, keysPath);
+    }
+    if (router.dispatch(topic, topicLength, payload, payloadLength)) pool.drain(0);
+
+    int64_t nowMs = wallClockMs();
+    if (snapshotPath && nowMs - lastSnapshot >= SNAPSHOT_INTERVAL_MS) {
+      writeSnapshot(*context.lastValues, snapshotPath, snapshot, nowMs);
+      lastSnapshot = nowMs;
+    }
+    if (nowMs - lastReport >= REPORT_INTERVAL_MS) {
+      pool.publishTopEmitters(0, nowMs);
+      printFleetSummary(context, nowMs);
+      lastReport = nowMs;
+    }
+  }
+
+  int64_t nowMs = wallClockMs();
+  if (snapshotPath) writeSnapshot(*context.lastValues, snapshotPath, snapshot, nowMs);
+  pool.publishTopEmitters(0, nowMs);
+  printFleetSummary(context, nowMs);
+  return 0;
+}
+
+/**
+ * @brief One shared-subscription consumer: route what it receives, ingest what it owns
+ */
+void runWorker(IngestContext& context, const TopicRouter& router, int index, const WorkerConfig& config) {
+  IngestPool& pool = *context.pool;
+  IngestPool::setWorkerShard(index);
+  int reader = context.tenants ? context.tenants->registerReader() : -1;
+  MqttClient client;
+  client.setServer(config.host, config.port);
+  client.setProtocolVersion(config.protocolVersion);
+  client.setCallback([&router](char* topic, uint8_t* payload, unsigned int length) {
+    router.dispatch(topic, strlen(topic), (const char*)payload, length);
+  });
+
+  // Unique per process too, so several ingest processes can join one group
+  char clientId[64];
+  snprintf(clientId, sizeof(clientId), "%s-%d-%d", config.group, (int)getpid(), index);
+
+  int64_t lastAttempt = 0;
+  int64_t lastTopPublish = 0;
+  while (true) {
+    // Between messages: a key reload may free the index this thread read
+    if (reader >= 0) context.tenants->quiescent(reader);
+    int64_t tickMs = wallClockMs();
+    if (tickMs - lastTopPublish >= TOP_PUBLISH_INTERVAL_MS) {
+      pool.publishTopEmitters(index, tickMs);
+      lastTopPublish = tickMs;
+    }
+    if (!client.connected()) {
+      int64_t now = wallClockMs();
+      if (now - lastAttempt >= RECONNECT_INTERVAL_MS) {
+        lastAttempt = now;
+        if (client.connect(clientId)) {
+          char filter[128];
+          for (const char* topic : INGEST_TOPICS) {
+            snprintf(filter, sizeof(filter), "$share/%s/%s", config.group, topic);
+            client.subscribe(filter);
+          }
+          printf("✅ Worker %d subscribed to $share/%s/...\n", index, config.group);
+          fflush(stdout);
+        } else {
+          fprintf(stderr, "❌ Worker %d: MQTT connection failed, rc=%d\n", index, client.state());
+        }
+      }
+      if (!client.connected()) {
+        // Other workers keep routing windows here meanwhile
+        pool.drain(index);
+        struct timespec pause = {0, WORKER_POLL_MS * 1000000L};
+        nanosleep(&pause, nullptr);
+        continue;
+      }
+    }
+    client.loop(WORKER_POLL_MS);
+    pool.drain(index);
+  }
+}
+
+int main(int argc, char** argv) {
+  WorkerConfig config;
+  int workers = 1;
+  const char* keysPath = nullptr;
+  const char* snapshotPath = nullptr;
+  int pushPort = -1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) config.host = argv[++i];
+    else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) config.port = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) workers = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--group") == 0 && i + 1 < argc) config.group = argv[++i];
+    else if (strcmp(argv[i], "--mqtt311") == 0) config.protocolVersion = MQTT_VERSION_3_1_1;
+    else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc) keysPath = argv[++i];
+    else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) snapshotPath = argv[++i];
+    else if (strcmp(argv[i], "--push") == 0 && i + 1 < argc) pushPort = atoi(argv[++i]);
+  }
+
+  TenantDirectory tenants;
+  LastValueCache lastValues(MAX_CACHED_DEVICES);
+  IngestContext context;
+  context.lastValues = &lastValues;
+  if (keysPath) {
+    if (!loadKeys(tenants, keysPath)) return 1;
+    context.tenants = &tenants;
+    signal(SIGHUP, onHangup);
+  }
+
+  // Dashboards are served from their own thread, reading the cache like the summary does
+  std::unique_ptr<PushServer> push;
+  std::thread pushThread;
+  if (pushPort >= 0) {
+    PushServerConfig pushConfig;
+    pushConfig.port = (uint16_t)pushPort;
+    push.reset(new PushServer(lastValues, pushConfig));
+    if (!push->start()) {
+      fprintf(stderr, "❌ Could not listen for dashboards on port %d\n", pushPort);
+      return 1;
+    }
+    pushThread = std::thread(&PushServer::run, push.get());
+    printf("📡 Dashboards: http://127.0.0.1:%u/stream\n", push->port());
+    fflush(stdout);
+  }
+
+  if (workers < 1) workers = 1;
+  if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+  IngestPool pool(config.host ? workers : 1);
+  context.pool = &pool;
+  if (!config.host) {
+    int status = runStdin(context, keysPath, snapshotPath);
+    if (push) {
+      push->stop();
+      pushThread.join();
+    }
+    return status;
+  }
+
+  // Built before the workers start; they only read it
+  TopicRouter router;
+  setupRouter(router, context);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < workers; i++) {
+    threads.emplace_back(runWorker, std::ref(context), std::cref(router), i, std::cref(config));
+  }
+
+  int64_t lastReport = wallClockMs();
+  std::vector<uint8_t> snapshot;
+  while (true) {
+    struct timespec pause = {SNAPSHOT_INTERVAL_MS / 1000, 0};
+    nanosleep(&pause, nullptr);
+    if (reloadRequested) {
+      reloadRequested = 0;
+      loadKeys(tenants, keysPath);
+    }
+    int64_t nowMs = wallClockMs();
+    if (snapshotPath) writeSnapshot(lastValues, snapshotPath, snapshot, nowMs);
+    if (nowMs - lastReport >= REPORT_INTERVAL_MS) {
+      printFleetSummary(context, nowMs);
+      lastReport = nowMs;
+    }
+  }
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <CreditMarket.h>
+#include <MqttClient.h>
+#include <OrderBook.h>
+#include <Telemetry.h>
+
+/*
+ * Credit marketplace
+ *
+ * Creators post supply and burners post buy orders on
+ * carbon_market/<API_KEY>/orders; this service matches them with price-time
+ * priority and sends every fill back on carbon_market/<API_KEY>/fills/<MAC>:
+ *
+ *   .pio/build/marketplace/program --host localhost --port 1883
+ */
+
+const char* MARKET_TOPIC_PREFIX = "carbon_market";
+const char* MARKET_CLIENT_ID = "carbon_marketplace";
+const int64_t REPORT_INTERVAL_MS = 60000;
+const int64_t RECONNECT_INTERVAL_MS = 5000;
+
+/**
+ * @brief Where fills for a resting order go
+ */
+struct OrderOwner {
+  std::string apiKey;
+  std::string mac;
+  uint32_t clientId;
+};
+
+MqttClient mqttClient;
+OrderBook book;
+std::vector<BookFill> fills;
+std::unordered_map<uint64_t, OrderOwner> owners;                   // book id -> device
+std::unordered_map<uint64_t, uint32_t> lastOrderId;                // mac -> last device order id
+
+unsigned long ordersReceived = 0;
+unsigned long ordersRejected = 0;
+unsigned long fillsSent = 0;
+uint64_t volumeTraded = 0;    // MARKET_QUANTITY_SCALE units
+double notionalTraded = 0;
+
+static int64_t wallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Publish one fill to carbon_market/<API_KEY>/fills/<MAC>
+ */
+void sendFill(const std::string& apiKey, const std::string& mac, const MarketFill& fill) {
+  char topic[200], payload[160];
+  snprintf(topic, sizeof(topic), "%s/%s/fills/%s", MARKET_TOPIC_PREFIX, apiKey.c_str(), mac.c_str());
+  formatMarketFill(payload, sizeof(payload), fill);
+  if (mqttClient.publish(topic, payload)) fillsSent++;
+}
+
+/**
+ * @brief Tell one side of a trade what happened, forget the order once it is done
+ */
+void reportFill(const OrderOwner& owner, const BookFill& trade, uint32_t remaining) {
+  MarketFill fill;
+  fill.id = owner.clientId;
+  fill.status = remaining == 0 ? FILL_COMPLETE : FILL_PARTIAL;
+  fill.quantity = trade.quantity;
+  fill.price = trade.price;
+  fill.remaining = remaining;
+  sendFill(owner.apiKey, owner.mac, fill);
+}
+
+void handleOrder(const char* topic, const char* payload, size_t length) {
+  // carbon_market/<API_KEY>/orders
+  const char* keyStart = strchr(topic, '/');
+  const char* keyEnd = keyStart ? strchr(keyStart + 1, '/') : nullptr;
+  if (!keyEnd) return;
+  std::string apiKey(keyStart + 1, keyEnd - keyStart - 1);
+
+  ordersReceived++;
+  MarketOrder order;
+  uint64_t mac = 0;
+  bool valid = parseMarketOrder(payload, length, order);
+  if (valid) mac = parseMacAddress(order.mac, strlen(order.mac));
+  if (!valid || mac == 0 || order.quantity == 0 || order.price == 0 || order.price > book.maxPrice()) {
+    ordersRejected++;
+    fprintf(stderr, "❌ Rejected order: %.*s\n", (int)length, payload);
+    if (order.mac[0]) {
+      MarketFill rejected;
+      rejected.id = order.id;
+      rejected.status = FILL_REJECTED;
+      rejected.remaining = order.quantity;
+      sendFill(apiKey, order.mac, rejected);
+    }
+    return;
+  }
+
+  // Devices resend unfilled orders with the same id: the original keeps its
+  // time priority, and a resend after the original filled buys nothing twice
+  auto last = lastOrderId.find(mac);
+  if (last != lastOrderId.end() && last->second == order.id) return;
+  lastOrderId[mac] = order.id;
+
+  fills.clear();
+  uint64_t takerId = book.submit(order.side, order.price, order.quantity, fills);
+  OrderOwner taker = {apiKey, order.mac, order.id};
+
+  for (const BookFill& trade : fills) {
+    auto maker = owners.find(trade.makerId);
+    if (maker != owners.end()) {
+      reportFill(maker->second, trade, trade.makerRemaining);
+      if (trade.makerRemaining == 0) owners.erase(maker);
+    }
+    reportFill(taker, trade, trade.takerRemaining);
+    volumeTraded += trade.quantity;
+    notionalTraded += marketCredits(trade.quantity) * marketPriceValue(trade.price);
+  }
+
+  if (book.find(takerId)) owners[takerId] = taker;
+}
+
+void mqttCallback(char* topic, uint8_t* payload, unsigned int length) {
+  size_t topicLength = strlen(topic);
+  if (topicLength > 7 && strcmp(topic + topicLength - 7, "/orders") == 0) {
+    handleOrder(topic, (const char*)payload, length);
+  }
+}
+
+bool connectToMqtt() {
+  if (mqttClient.connected()) return true;
+  if (!mqttClient.connect(MARKET_CLIENT_ID)) {
+    fprintf(stderr, "❌ MQTT connection failed, rc=%d\n", mqttClient.state());
+    return false;
+  }
+  char topic[100];
+  snprintf(topic, sizeof(topic), "%s/+/orders", MARKET_TOPIC_PREFIX);
+  mqttClient.subscribe(topic);
+  printf("✅ Connected, matching orders on %s\n", topic);
+  fflush(stdout);
+  return true;
+}
+
+void printMarketSummary() {
+  printf("📈 %lu orders (%lu rejected), %lu fills, %.1f credits traded for %.2f, %zu resting, bid %.2f / ask %.2f\n",
+         ordersReceived, ordersRejected, fillsSent, marketCredits(volumeTraded), notionalTraded,
+         book.restingOrders(), marketPriceValue(book.bestBid()), marketPriceValue(book.bestAsk()));
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  const char* host = "localhost";
+  int port = 1883;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+    else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+  }
+
+  mqttClient.setServer(host, port);
+  mqttClient.setCallback(mqttCallback);
+
+  int64_t lastReport = wallClockMs();
+  int64_t lastAttempt = 0;
+  while (true) {
+    int64_t now = wallClockMs();
+    if (!mqttClient.connected()) {
+      // The book survives reconnects, only new orders wait
+      if (now - lastAttempt >= RECONNECT_INTERVAL_MS) {
+        lastAttempt = now;
+        connectToMqtt();
+      }
+      if (!mqttClient.connected()) {
+        struct timespec pause = {0, 100 * 1000000L};
+        nanosleep(&pause, nullptr);
+        continue;
+      }
+    }
+    mqttClient.loop(100);
+
+    if (now - lastReport >= REPORT_INTERVAL_MS) {
+      printMarketSummary();
+      lastReport = now;
+    }
+  }
+}